@@ -6,6 +6,10 @@
 #include<bitset>
 #include<algorithm>
 #include<cmath>
+#include"../recovery/manifest.h"
+#include"../recovery/envpool.h"
+#include"../recovery/regress.h"
+#include"../recovery/native.h"
 #ifdef WIN32
 #include <windows.h>
 #else
@@ -74,28 +78,30 @@ I: cube indices
 J: monomial indices
 evalNumRounds: the number of initialization rounds
 target: 1-6 corresponding to s[66,93,162,177,243,288] resepectively. 
+out: the stream of the running time and the number of solutions (e.g. the result file of runJob)
 ***************************************************************/
-int veryfi855(vector<int> I, vector<int> J, int evalNumRounds, int target, int threadNumber) {
+int veryfi855(vector<int> I, vector<int> J, int evalNumRounds, int target, int threadNumber, ostream& out = cout) {
   ofstream outputfile;
   outputfile.open("log.txt", ios::app);
   outputfile << "++++++++++++++++++++++++++++" << endl;
 
   //gurobi
   try {
-    // Create the environment
-    GRBEnv env = GRBEnv();
-
-    // close standard output
-    env.set(GRB_IntParam_LogToConsole, 0);
-    env.set(GRB_IntParam_MIPFocus, GRB_MIPFOCUS_BESTBOUND);
-    env.set(GRB_IntParam_Threads, threadNumber);
-		env.set(GRB_StringParam_LogFile, "log.txt");
-		env.set(GRB_IntParam_PoolSearchMode, 2);
-		env.set(GRB_IntParam_PoolSolutions, 2000000000);
-		env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
+    // Check out the environment (the same parameters for every target)
+    sharedEnvPool().profile("veryfi855", [](GRBEnv& env) {
+      env.set(GRB_IntParam_MIPFocus, GRB_MIPFOCUS_BESTBOUND);
+      env.set(GRB_StringParam_LogFile, "log.txt");
+      env.set(GRB_IntParam_PoolSearchMode, 2);
+      env.set(GRB_IntParam_PoolSolutions, 2000000000);
+      env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
+    });
+    metricsJob metrics("veryfi855 " + to_string(evalNumRounds) + " target " + to_string(target), 0, threadNumber);
+    envLease env("veryfi855");
+    metrics.phase("env", { { "cacheHit", env.cacheHit() } });
 
     // Create the model
-    GRBModel model = GRBModel(env);
+    GRBModel model = GRBModel(env.get());
+    model.set(GRB_IntParam_Threads, env.threads(threadNumber));
 
     // Create variables
     vector<vector<GRBVar>> s(evalNumRounds + 1, vector<GRBVar>(288));
@@ -202,13 +208,15 @@ int veryfi855(vector<int> I, vector<int> J, int evalNumRounds, int target, int t
 
     // Solve
     model.update();
+    metrics.phase("build", { { "vars", model.get(GRB_IntAttr_NumVars) }, { "constrs", model.get(GRB_IntAttr_NumConstrs) } });
     model.optimize();
 
     //
 		int solCount = model.get(GRB_IntAttr_SolCount);
+    metrics.phase("solve", { { "solutions", solCount } });
     double dulation = model.get(GRB_DoubleAttr_Runtime);
-    cout << "Running time = " << dulation << " sec." << endl;
-    cout << "There are " << solCount << " solutions." << endl;
+    out << "Running time = " << dulation << " sec." << endl;
+    out << "There are " << solCount << " solutions." << endl;
 
 		//
 		ofstream outputSolution;
@@ -255,10 +263,205 @@ int veryfi855(vector<int> I, vector<int> J, int evalNumRounds, int target, int t
   return -1;
 }
 
+/************************************************************
+The predecessors of k by one round in the backward expansion of countNative855 (the same division trails as triviumCoreThree)
+***************************************************************/
+static const int taps855[3][5] = { { 65, 170, 90, 91, 92 }, { 161, 263, 174, 175, 176 }, { 242, 68, 285, 286, 287 } };
+void triviumBackward855(const bitset<288>& k, vector<bitset<288>>& pred) {
+
+  bitset<288> u = (k >> 1) | (k << 287);
+  pred.push_back(u);
+  for (int j = 0; j < 3; j++) {
+    const int* p = taps855[j];
+    if (u[p[4]] == 0)
+      continue;
+    int n = pred.size();
+    for (int e = 0; e < n; e++) {
+      bitset<288> x = pred[e];
+      x[p[4]] = 0;
+      bitset<288> x1 = x, x2 = x, x34 = x;
+      x1[p[0]] = 1;
+      x2[p[1]] = 1;
+      x34[p[2]] = 1;
+      x34[p[3]] = 1;
+      pred.push_back(x1);
+      pred.push_back(x2);
+      pred.push_back(x34);
+    }
+  }
+}
+/************************************************************
+The number of solutions of veryfi855 counted without Gurobi, for the check of the golden files of the regression benchmark.
+The division trails are expanded backward from the target bit to round 0 by nativeExpand (see ../recovery/native.h) with exact counts,
+and a vector is dropped if the upper bound of its degree in the cube and monomial bits is smaller than their number,
+or at round 0 if it does not contain them. As in veryfi855, s93 at round 210 is 0 in the later rounds and free in the round function.
+@Para
+I, J, evalNumRounds, target: same as veryfi855
+limit: the largest frontier
+return: the number of division trails, or -1 if a frontier is larger than limit
+***************************************************************/
+long long countNative855(vector<int> I, vector<int> J, int evalNumRounds, int target, int threadNumber, long long limit) {
+  const int pos[7] = { 0, 65, 92, 161, 176, 242, 287 };
+
+  bitset<288> mask;
+  for (int i = 0; i < I.size(); i++)
+    mask[93 + I[i]] = 1;
+  for (int i = 0; i < J.size(); i++)
+    mask[J[i]] = 1;
+  int size = mask.count();
+
+  // upper bound of the degree in the bits of mask
+  vector<vector<int>> deg(evalNumRounds + 1, vector<int>(288, 0));
+  for (int i = 0; i < 288; i++)
+    deg[0][i] = mask[i];
+  for (int r = 0; r < evalNumRounds; r++) {
+    vector<int> d = deg[r];
+    for (int j = 0; j < 3; j++) {
+      const int* p = taps855[j];
+      d[p[4]] = min(max(max(d[p[4]], d[p[0]]), max(d[p[1]], d[p[2]] + d[p[3]])), size);
+    }
+    for (int i = 0; i < 288; i++)
+      deg[r + 1][(i + 1) % 288] = d[i];
+  }
+
+  int numShards = 4 * max(threadNumber, 1);
+  nativeFrontier<288> frontier(numShards);
+  bitset<288> out;
+  out[pos[target]] = 1;
+  frontier[hash<bitset<288>>()(out) % numShards][out] = 1;
+  for (int r = evalNumRounds - 1; r >= 0; r--) {
+    if (r + 1 == 210) {
+      nativeFrontier<288> free(numShards);
+      for (int sh = 0; sh < numShards; sh++) {
+        for (auto it = frontier[sh].begin(); it != frontier[sh].end(); it++) {
+          if ((*it).first[93] == 1)
+            continue;
+          bitset<288> k = (*it).first;
+          free[hash<bitset<288>>()(k) % numShards][k] += (*it).second;
+          k[93] = 1;
+          free[hash<bitset<288>>()(k) % numShards][k] += (*it).second;
+        }
+      }
+      frontier.swap(free);
+    }
+    frontier = nativeExpand(frontier, triviumBackward855, [&](const bitset<288>& k) {
+      if ((r == 0) && ((k & mask) != mask))
+        return false;
+      int d = 0;
+      for (int i = 0; (i < 288) && (d < size); i++) {
+        if (k[i] == 1)
+          d += deg[r][i];
+      }
+      return (d >= size);
+    }, threadNumber, false);
+    if ((long long)nativeSize(frontier) > limit)
+      return -1;
+  }
+
+  long long count = 0;
+  for (int sh = 0; sh < numShards; sh++) {
+    for (auto it = frontier[sh].begin(); it != frontier[sh].end(); it++)
+      count += (*it).second;
+  }
+  return count;
+}
+
+/************************************************************
+Verify one trivium job of the manifest (see ../recovery/manifest.h) with monomial= for its targets and write the output into its result file.
+The non-cube IV bits are always 0 in veryfi855, so const= is not supported.
+return: 0, or 2 if the job is skipped
+***************************************************************/
+int runJob(manifestJob& job, int threadNumber) {
+
+  if ((job.cipher != "trivium") || (job.monomial.size() == 0) || (job.consts.size() > 0)) {
+    cerr << "manifest line " << job.line << " is skipped (trivium with monomial= and without const= is needed)" << endl;
+    return 2;
+  }
+
+  const char* names[7] = { "", "s66", "s93", "s162", "s177", "s243", "s288" };
+  ofstream result(job.out);
+  result << "# trivium " << job.rounds << " cube=" << job.cubeText << endl;
+  for (int t = 0; t < job.targets.size(); t++) {
+    result << "Target " << names[job.targets[t]] << endl;
+    veryfi855(job.cube, job.monomial, job.rounds, job.targets[t], threadNumber, result);
+    result << endl;
+  }
+  cerr << "manifest line " << job.line << " -> " << job.out << endl;
+
+  return 0;
+}
+
+/************************************************************
+Run the jobs of the manifest one after another (see runJob).
+***************************************************************/
+int runManifest(string filename, int threadNumber) {
+
+  vector<manifestJob> jobs;
+  if (readManifest(filename, jobs) == false)
+    return 0;
+
+  for (int j = 0; j < jobs.size(); j++)
+    runJob(jobs[j], threadNumber);
+  sharedEnvPool().report(cerr);
+
+  return 0;
+}
+
+/************************************************************
+The regression benchmark (make bench, see ../recovery/regress.h): the jobs of the suite are run by runJob,
+and the results are compared with the golden files line by line except for the running times.
+A missing golden file fails the job unless record is given (-record).
+The number of solutions of each target in the golden file is also checked against countNative855, independently of Gurobi,
+unless a frontier of the count is larger than 2^20 vectors (e.g. at 855 rounds).
+***************************************************************/
+int runRegress(string filename, string baseline, double threshold, bool rebaseline, bool record, int threadNumber) {
+
+  int rc = regressRun(filename, baseline, threshold, rebaseline, record, [&](manifestJob& job) {
+    return runJob(job, threadNumber);
+  }, [](string out, string golden, string& detail) {
+    return regressSameLines(out, golden, { "Running time" }, detail);
+  }, [&](manifestJob& job, string golden, string& detail) {
+    ifstream in(golden);
+    vector<long long> counts;
+    string line;
+    while (getline(in, line)) {
+      if (line.compare(0, 10, "There are ") == 0)
+        counts.push_back(atoll(line.c_str() + 10));
+    }
+    if (counts.size() != job.targets.size()) {
+      detail = "cannot read " + golden;
+      return false;
+    }
+    for (int t = 0; t < job.targets.size(); t++) {
+      long long count = countNative855(job.cube, job.monomial, job.rounds, job.targets[t], threadNumber, 1 << 20);
+      if (count < 0) {
+        detail = "not checked (too many trails)";
+        return true;
+      }
+      if (count != counts[t]) {
+        detail = "target " + to_string(job.targets[t]) + " has " + to_string(count) + " trails, the golden file " + to_string(counts[t]);
+        return false;
+      }
+    }
+    detail = "checked by countNative855";
+    return true;
+  });
+  sharedEnvPool().report(cerr);
+
+  return rc;
+}
+
 int main(int argc, char const* argv[]){
 
   int evalNumRounds = 0;
   int threadNumber = 2;
+  string manifest;
+  string profiles;
+  string regress;
+  string baseline = "regress_baseline.txt";
+  double threshold = 1.25;
+  bool rebaseline = false;
+  bool record = false;
   ofstream outputfile;
   outputfile.open("log.txt");
   ofstream outputSolution;
@@ -267,7 +470,20 @@ int main(int argc, char const* argv[]){
   for (int i = 0; i < argc; i++){
     if (!strcmp(argv[i], "-r")) evalNumRounds = atoi(argv[i + 1]);
     if (!strcmp(argv[i], "-t")) threadNumber = atoi(argv[i + 1]);
+    if (!strcmp(argv[i], "-manifest")) manifest = argv[i + 1];
+    if (!strcmp(argv[i], "-profiles")) profiles = argv[i + 1];
+    if (!strcmp(argv[i], "-regress")) regress = argv[i + 1];
+    if (!strcmp(argv[i], "-baseline")) baseline = argv[i + 1];
+    if (!strcmp(argv[i], "-threshold")) threshold = atof(argv[i + 1]);
+    if (!strcmp(argv[i], "-rebaseline")) rebaseline = true;
+    if (!strcmp(argv[i], "-record")) record = true;
   }
+  if ((profiles.size() > 0) && (sharedEnvPool().load(profiles) == false))
+    return 0;
+  if (manifest.size() > 0)
+    return runManifest(manifest, threadNumber);
+  if (regress.size() > 0)
+    return runRegress(regress, baseline, threshold, rebaseline, record, threadNumber);
 
   if (evalNumRounds == 0){
     cerr << "Please set option about number of rounds as '-r [number of rounds]]'" << endl;
@@ -329,6 +545,8 @@ int main(int argc, char const* argv[]){
   cout << "Target s66" << endl;
   veryfi855(I, J, evalNumRounds, 1, threadNumber);
   cout << endl;
+
+  sharedEnvPool().report(cerr);
   
   return 0;
 }
@@ -0,0 +1,74 @@
+#ifndef ANF_H
+#define ANF_H
+
+#include<bitset>
+#include<vector>
+#include<unordered_set>
+
+using namespace std;
+
+/*
+Exact algebraic normal form over GF(2).
+A monomial is the bit vector of the variables it contains, where the variables are indexed as the state of the MILP model (288 bits for Trivium, 256 bits for Grain-128a).
+A polynomial is the hash set of its monomials, so adding a monomial twice cancels it.
+The empty monomial represents the constant 1 and the empty set represents the constant 0.
+*/
+template<size_t N> using anfPoly = unordered_set<bitset<N>>;
+
+/*
+The polynomial consisting of the single variable x_i
+*/
+template<size_t N> anfPoly<N> anfVar(int i) {
+	bitset<N> m;
+	m[i] = 1;
+	return anfPoly<N>({ m });
+}
+
+/*
+The constant polynomial c (0 or 1)
+*/
+template<size_t N> anfPoly<N> anfConst(int c) {
+	if (c == 0)
+		return anfPoly<N>();
+	return anfPoly<N>({ bitset<N>() });
+}
+
+/*
+a <- a + b
+*/
+template<size_t N> void anfAdd(anfPoly<N>& a, const anfPoly<N>& b) {
+	auto it = b.begin();
+	while (it != b.end()) {
+		auto jt = a.find(*it);
+		if (jt == a.end())
+			a.insert(*it);
+		else
+			a.erase(jt);
+		it++;
+	}
+}
+
+/*
+return a * b, where x_i * x_i = x_i
+*/
+template<size_t N> anfPoly<N> anfMul(const anfPoly<N>& a, const anfPoly<N>& b) {
+	anfPoly<N> c;
+	c.reserve(a.size() * b.size());
+	auto it = a.begin();
+	while (it != a.end()) {
+		auto jt = b.begin();
+		while (jt != b.end()) {
+			bitset<N> m = (*it) | (*jt);
+			auto kt = c.find(m);
+			if (kt == c.end())
+				c.insert(m);
+			else
+				c.erase(kt);
+			jt++;
+		}
+		it++;
+	}
+	return c;
+}
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<map>
+#include<thread>
+#include<mutex>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<cstdint>
+
+using namespace std;
+
+/*
+The logs of the solves (log_trivium.txt, log_grain128a.txt, ...) are written by one background thread.
+The solver threads put the lines into a lock-free ring buffer (a bounded queue of Vyukov) and never wait:
+if the buffer is full, the line is dropped and counted. The background thread takes the lines in batches,
+writes the lines of each file with one fwrite and flushes once per batch.
+Every line of a file has four tab-separated fields, the UNIX time, the level, the job and the text, e.g.
+1792365997.134490	INFO	12	found 	 divide in 421	35.2sec
+where the job is the number of the logStream that wrote the line (one per solve, so the lines of a solve are found by the job).
+The level of the output is set by -loglevel (error, warn, info or debug, default debug); the messages of Gurobi are debug.
+*/
+enum logLevel { LOG_ERROR = 0, LOG_WARN = 1, LOG_INFO = 2, LOG_DEBUG = 3 };
+
+class asyncLog {
+public:
+	asyncLog(int capacityBits = 15) : slots(1ULL << capacityBits), mask((1ULL << capacityBits) - 1) {
+		for (uint64_t i = 0; i < slots.size(); i++)
+			slots[i].seq.store(i, memory_order_relaxed);
+		worker = thread([this]() { consume(); });
+	}
+
+	~asyncLog() {
+		stopping = true;
+		worker.join();
+		for (int i = 0; i < files.size(); i++) {
+			if (files[i] != NULL)
+				fclose(files[i]);
+		}
+		if (dropped > 0)
+			cerr << dropped << " log lines are dropped (the log buffer was full)" << endl;
+	}
+
+	// the id of a log file (appended, opened by the background thread)
+	int open(string filename) {
+		lock_guard<mutex> guard(fileLock);
+		if (ids.count(filename) == 0) {
+			ids[filename] = names.size();
+			names.push_back(filename);
+		}
+		return ids[filename];
+	}
+
+	void setLevel(int level) { threshold = level; }
+	bool enabled(int level) { return level <= threshold.load(memory_order_relaxed); }
+
+	long long nextJob() { return ++jobs; }
+
+	// put a line into the buffer, or drop it if the buffer is full
+	void push(int file, int level, long long job, string&& text) {
+		uint64_t pos = head.load(memory_order_relaxed);
+		slot* s;
+		while (true) {
+			s = &slots[pos & mask];
+			uint64_t seq = s->seq.load(memory_order_acquire);
+			int64_t diff = (int64_t)seq - (int64_t)pos;
+			if (diff == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) {
+				dropped++;
+				return;
+			}
+			else {
+				pos = head.load(memory_order_relaxed);
+			}
+		}
+		s->file = file;
+		s->level = level;
+		s->job = job;
+		s->wall = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+		s->text = move(text);
+		s->seq.store(pos + 1, memory_order_release);
+	}
+
+	// wait until the lines put so far are written (not for the solver threads)
+	void flush() {
+		uint64_t target = head.load();
+		while (written.load() < target)
+			this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	uint64_t numDropped() { return dropped; }
+
+private:
+	struct slot {
+		atomic<uint64_t> seq;
+		int file;
+		int level;
+		long long job;
+		double wall;
+		string text;
+	};
+
+	void consume() {
+		const char* levels[4] = { "ERROR", "WARN", "INFO", "DEBUG" };
+		vector<string> buffers;
+		char prefix[64];
+		uint64_t tail = 0;
+		while (true) {
+			int taken = 0;
+			for (; taken < 4096; taken++) {
+				slot& s = slots[tail & mask];
+				if (s.seq.load(memory_order_acquire) != tail + 1)
+					break;
+				if (s.file >= buffers.size())
+					buffers.resize(s.file + 1);
+				snprintf(prefix, sizeof(prefix), "%.6f\t%s\t%lld\t", s.wall, levels[s.level], s.job);
+				buffers[s.file] += prefix;
+				buffers[s.file] += s.text;
+				buffers[s.file] += '\n';
+				s.text.clear();
+				s.seq.store(tail + mask + 1, memory_order_release);
+				tail++;
+			}
+			for (int f = 0; f < buffers.size(); f++) {
+				if (buffers[f].size() == 0)
+					continue;
+				if (f >= files.size())
+					files.resize(f + 1, NULL);
+				if (files[f] == NULL) {
+					string name;
+					{
+						lock_guard<mutex> guard(fileLock);
+						name = names[f];
+					}
+					files[f] = fopen(name.c_str(), "a");
+				}
+				if (files[f] != NULL) {
+					fwrite(buffers[f].data(), 1, buffers[f].size(), files[f]);
+					fflush(files[f]);
+				}
+				buffers[f].clear();
+			}
+			written.store(tail);
+			if (taken == 0) {
+				if (stopping && (tail == head.load()))
+					return;
+				this_thread::sleep_for(chrono::milliseconds(2));
+			}
+		}
+	}
+
+	vector<slot> slots;
+	uint64_t mask;
+	atomic<uint64_t> head{ 0 };
+	atomic<uint64_t> written{ 0 };
+	atomic<uint64_t> dropped{ 0 };
+	atomic<long long> jobs{ 0 };
+	atomic<int> threshold{ LOG_DEBUG };
+	atomic<bool> stopping{ false };
+	thread worker;
+
+	mutex fileLock;
+	map<string, int> ids;
+	vector<string> names;
+	vector<FILE*> files;
+};
+
+/*
+The logger shared by all solves of the process
+*/
+inline asyncLog& sharedLog() {
+	static asyncLog log;
+	return log;
+}
+
+/*
+The lines written to a logStream (at its level, info by default) are put into the buffer of sharedLog line by line
+*/
+class logBuf : public streambuf {
+public:
+	logBuf(int xfile, long long xjob) : file(xfile), job(xjob) {}
+	~logBuf() {
+		if (line.size() > 0)
+			emit();
+	}
+	int level = LOG_INFO;
+	int file;
+	long long job;
+protected:
+	int overflow(int c) {
+		if (c == EOF)
+			return 0;
+		if (c == '\n')
+			emit();
+		else
+			line += (char)c;
+		return c;
+	}
+	streamsize xsputn(const char* p, streamsize n) {
+		for (streamsize i = 0; i < n; i++)
+			overflow((unsigned char)p[i]);
+		return n;
+	}
+private:
+	void emit() {
+		if (sharedLog().enabled(level))
+			sharedLog().push(file, level, job, move(line));
+		line.clear();
+	}
+	string line;
+};
+
+/*
+The log stream of one job, e.g. one solve of triviumThreeEnumuration (an ostream, so that outputfile << ... << endl works as with ofstream)
+*/
+class logStream : public ostream {
+public:
+	logStream(string filename) : ostream(NULL), buf(sharedLog().open(filename), sharedLog().nextJob()) {
+		rdbuf(&buf);
+	}
+
+	long long job() { return buf.job; }
+
+	// a text of another level (e.g. the messages of Gurobi at LOG_DEBUG), split into lines
+	void message(int level, const string& text) {
+		int previous = buf.level;
+		buf.level = level;
+		*this << text;
+		buf.level = previous;
+	}
+
+private:
+	logBuf buf;
+};
+
+#endif
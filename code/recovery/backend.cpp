@@ -0,0 +1,572 @@
+#include"main.h"
+#include"backend.h"
+#include<climits>
+
+/***************************************
+ * Backends
+ ***************************************/
+void backendProfile(string profile, bool lazy, bool bestBound) {
+#ifndef NOGUROBI
+	sharedEnvPool().profile(profile, [lazy, bestBound](GRBEnv& env) {
+		if (bestBound)
+			env.set(GRB_IntParam_MIPFocus, GRB_MIPFOCUS_BESTBOUND);
+		if (lazy) {
+			env.set(GRB_IntParam_LazyConstraints, 1);
+		}
+		else {
+			env.set(GRB_IntParam_PoolSearchMode, 2);
+			env.set(GRB_IntParam_PoolSolutions, 2000000000);
+			env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
+		}
+	});
+#endif
+}
+
+divBackend* newBackend(string name, string profile, int threadNumber) {
+	if (name == "cnf")
+		return new cnfBackend();
+#ifndef NOGUROBI
+	if ((name == "gurobi") || (name == ""))
+		return new gurobiBackend(profile, threadNumber);
+#else
+	if (name == "")
+		return new cnfBackend();
+#endif
+	return NULL;
+}
+
+
+
+/***************************************
+ * CNF backend
+ ***************************************/
+int cnfBackend::addVar() {
+	return numVars++;
+}
+void cnfBackend::addOr(int x, vector<int> ys, bool) {
+	vector<int> c = { 2 * x + 1 };
+	for (int i = 0; i < ys.size(); i++) {
+		clauses.push_back({ 2 * x, 2 * ys[i] + 1 });
+		c.push_back(2 * ys[i]);
+	}
+	clauses.push_back(c);
+}
+void cnfBackend::addSum(int y, vector<int> xs) {
+	// at most one x_i is 1 and y = x_1 | ... | x_n
+	for (int i = 0; i < xs.size(); i++) {
+		for (int j = i + 1; j < xs.size(); j++) {
+			clauses.push_back({ 2 * xs[i] + 1, 2 * xs[j] + 1 });
+		}
+	}
+	addOr(y, xs);
+}
+void cnfBackend::addEqual(int x, int y) {
+	clauses.push_back({ 2 * x + 1, 2 * y });
+	clauses.push_back({ 2 * x, 2 * y + 1 });
+}
+void cnfBackend::fix(int x, int value) {
+	units.push_back(2 * x + (1 - value));
+}
+void cnfBackend::addClause(vector<int> lits) {
+	vector<int> c;
+	for (int i = 0; i < lits.size(); i++) {
+		if (lits[i] > 0)
+			c.push_back(2 * (lits[i] - 1));
+		else
+			c.push_back(2 * (-lits[i] - 1) + 1);
+	}
+	if (c.size() == 1)
+		units.push_back(c[0]);
+	else
+		clauses.push_back(c);
+}
+void cnfBackend::setObjective(vector<int> xs, bool xmaximize) {
+	objective = xs;
+	maximize = xmaximize;
+}
+
+void cnfBackend::checkpoint() {
+	markVars = numVars;
+	markClauses = clauses.size();
+	markUnits = units.size();
+}
+void cnfBackend::rollback() {
+	numVars = markVars;
+	clauses.resize(markClauses);
+	units.resize(markUnits);
+}
+
+void cnfBackend::addLazy(vector<int> lits) {
+	vector<int> c;
+	for (int i = 0; i < lits.size(); i++) {
+		c.push_back((lits[i] > 0) ? 2 * (lits[i] - 1) : 2 * (-lits[i] - 1) + 1);
+	}
+	added.push_back(c);
+}
+
+void cnfBackend::enqueue(int lit) {
+	assign[lit >> 1] = 1 - (lit & 1);
+	trail.push_back(lit);
+}
+bool cnfBackend::propagate() {
+
+	while (qhead < trail.size()) {
+		int falseLit = trail[qhead++] ^ 1;
+		vector<int>& ws = watches[falseLit];
+		size_t i = 0, j = 0;
+		while (i < ws.size()) {
+			int ci = ws[i++];
+			vector<int>& c = clauses[ci];
+			if (c[0] == falseLit)
+				swap(c[0], c[1]);
+			if (value(c[0]) == 1) {
+				ws[j++] = ci;
+				continue;
+			}
+
+			// look for a new watch
+			bool found = false;
+			for (int k = 2; k < c.size(); k++) {
+				if (value(c[k]) != 0) {
+					swap(c[1], c[k]);
+					watches[c[1]].push_back(ci);
+					found = true;
+					break;
+				}
+			}
+			if (found)
+				continue;
+
+			ws[j++] = ci;
+			if (value(c[0]) == 0) {
+				while (i < ws.size())
+					ws[j++] = ws[i++];
+				ws.resize(j);
+				return false;
+			}
+			enqueue(c[0]);
+		}
+		ws.resize(j);
+	}
+	return true;
+
+}
+
+/*
+The lazy clauses after a backtrack: a clause with two literals which are not false is watched from now on,
+a clause with one such literal makes it true (until the next backtrack), and a clause without any is a conflict
+*/
+bool cnfBackend::checkPending() {
+
+	size_t j = 0;
+	bool ok = true;
+	for (size_t i = 0; i < pending.size(); i++) {
+		vector<int>& c = pending[i];
+		int open = 0;
+		for (int k = 0; (k < c.size()) && (open < 2); k++) {
+			if (value(c[k]) != 0)
+				swap(c[open++], c[k]);
+		}
+		if (ok && (open >= 2)) {
+			watches[c[0]].push_back(clauses.size());
+			watches[c[1]].push_back(clauses.size());
+			clauses.push_back(move(c));
+			continue;
+		}
+		if (open == 0)
+			ok = false;
+		else if (ok && (value(c[0]) == -1))
+			enqueue(c[0]);
+		if (j != i)
+			pending[j] = move(c);
+		j++;
+	}
+	pending.resize(j);
+	return ok;
+
+}
+
+/*
+DPLL over all solutions (see cnfBackend). The search stops after limit solutions, after timeLimit sec (0: no limit) or at stop.
+The lazy clauses are only for this search, so the model is the same afterwards
+*/
+long long cnfBackend::search(function<void(const vector<char>&)> onSolution, bool lazy, long long limit, double timeLimit) {
+
+	auto start = chrono::steady_clock::now();
+	size_t numClauses = clauses.size();
+	assign.assign(numVars, -1);
+	watches.assign(2 * numVars, vector<int>());
+	trail.clear();
+	qhead = 0;
+	pending.clear();
+	added.clear();
+	lastStatus = BACKEND_INFEASIBLE;
+	bestObj = 0;
+	decisions = 0;
+
+	// root level
+	bool ok = true;
+	for (int i = 0; ok && (i < units.size()); i++) {
+		if (value(units[i]) == 0)
+			ok = false;
+		else if (value(units[i]) == -1)
+			enqueue(units[i]);
+	}
+	for (int i = 0; ok && (i < clauses.size()); i++) {
+		if (clauses[i].size() == 0) {
+			ok = false;
+		}
+		else if (clauses[i].size() == 1) {
+			if (value(clauses[i][0]) == 0)
+				ok = false;
+			else if (value(clauses[i][0]) == -1)
+				enqueue(clauses[i][0]);
+		}
+		else {
+			watches[clauses[i][0]].push_back(i);
+			watches[clauses[i][1]].push_back(i);
+		}
+	}
+
+	// decision levels: the position in the trail, the decision literal and whether it is already flipped
+	vector<size_t> levelStart;
+	vector<int> levelLit;
+	vector<bool> levelFlipped;
+	vector<char> sol(numVars);
+	long long solCount = 0;
+	long long steps = 0;
+	int next = numVars - 1;
+
+	if (ok)
+		ok = propagate();
+	while (true) {
+		if (((stop != NULL) && stop->load()) || ((timeLimit > 0) && ((++steps & 1023) == 0)
+			&& (chrono::duration<double>(chrono::steady_clock::now() - start).count() > timeLimit))) {
+			lastStatus = ((stop != NULL) && stop->load()) ? BACKEND_INTERRUPTED : BACKEND_TIME_LIMIT;
+			break;
+		}
+		if (ok) {
+			while ((next >= 0) && (assign[next] >= 0))
+				next--;
+			if (next >= 0) {
+				// decide x_next = 0 first, since most variables of a trail are 0
+				levelStart.push_back(trail.size());
+				levelLit.push_back(2 * next + 1);
+				levelFlipped.push_back(false);
+				enqueue(2 * next + 1);
+				decisions++;
+				ok = propagate();
+				continue;
+			}
+
+			// a solution, unless onSolution cuts it off
+			for (int v = 0; v < numVars; v++) {
+				sol[v] = assign[v];
+			}
+			onSolution(sol);
+			bool kept = true;
+			for (int i = 0; lazy && (i < added.size()); i++) {
+				bool satisfied = false;
+				for (int k = 0; k < added[i].size(); k++) {
+					if (value(added[i][k]) == 1)
+						satisfied = true;
+				}
+				kept = kept && satisfied;
+				pending.push_back(added[i]);
+			}
+			added.clear();
+			if (kept) {
+				double obj = 0;
+				for (int i = 0; i < objective.size(); i++) {
+					obj += sol[objective[i]];
+				}
+				if ((solCount == 0) || (maximize && (obj > bestObj)) || (!maximize && (obj < bestObj)))
+					bestObj = obj;
+				solCount++;
+				if (solCount >= limit) {
+					lastStatus = BACKEND_SOLUTION_LIMIT;
+					break;
+				}
+			}
+		}
+
+		// conflict or blocking clause: flip the last unflipped decision
+		while ((levelFlipped.size() > 0) && levelFlipped.back()) {
+			levelStart.pop_back();
+			levelLit.pop_back();
+			levelFlipped.pop_back();
+		}
+		if (levelFlipped.size() == 0) {
+			lastStatus = (solCount > 0) ? BACKEND_OPTIMAL : BACKEND_INFEASIBLE;
+			break;
+		}
+
+		while (trail.size() > levelStart.back()) {
+			assign[trail.back() >> 1] = -1;
+			trail.pop_back();
+		}
+		qhead = trail.size();
+		next = levelLit.back() >> 1;
+		levelLit.back() ^= 1;
+		levelFlipped.back() = true;
+		enqueue(levelLit.back());
+		ok = checkPending() && propagate();
+	}
+
+	clauses.resize(numClauses);
+	pending.clear();
+	lastRuntime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return solCount;
+
+}
+
+int cnfBackend::feasible(double timeLimit) {
+	search([](const vector<char>&) {}, false, 1, timeLimit);
+	return lastStatus;
+}
+long long cnfBackend::enumerate(function<void(const vector<char>&)> onSolution, bool lazy) {
+	long long solCount = search(onSolution, lazy, LLONG_MAX, 0);
+	return ((lastStatus == BACKEND_OPTIMAL) || (lastStatus == BACKEND_INFEASIBLE)) ? solCount : -1;
+}
+
+
+
+/***************************************
+ * Gurobi backend
+ ***************************************/
+#ifndef NOGUROBI
+/*
+The callback of the lazy enumeration: stopCallback, and every MIPSOL is handed to onSolution, whose clauses are added by lazy
+*/
+class backendCallback : public stopCallback {
+public:
+	backendCallback(atomic<bool>* xstop, logStream* xlog, vector<GRBVar>& xvars, function<void(const vector<char>&)>& xonSolution)
+		: stopCallback(xstop, xlog), halt(xstop), vars(xvars), onSolution(xonSolution) {}
+	void lazy(GRBLinExpr expr) { addLazy(expr >= 1); }
+protected:
+	void callback() {
+		try {
+			stopCallback::callback();
+			if ((where == GRB_CB_MIPSOL) && ((halt == NULL) || (halt->load() == false))) {
+				double* x = getSolution(vars.data(), vars.size());
+				vector<char> sol(vars.size());
+				for (int v = 0; v < vars.size(); v++) {
+					sol[v] = (round(x[v]) == 1);
+				}
+				delete[] x;
+				onSolution(sol);
+			}
+		}
+		catch (GRBException e) {
+			cerr << "Error number: " << e.getErrorCode() << endl;
+			cerr << e.getMessage() << endl;
+		}
+		catch (...) {
+			cerr << "Error during callback" << endl;
+		}
+	}
+private:
+	atomic<bool>* halt;
+	vector<GRBVar>& vars;
+	function<void(const vector<char>&)>& onSolution;
+};
+
+gurobiBackend::gurobiBackend(string profile, int threadNumber) : env(profile), model(env.get()) {
+	model.set(GRB_IntParam_Threads, env.threads(threadNumber));
+}
+int gurobiBackend::addVar() {
+	vars.push_back(model.addVar(0, 1, 0, GRB_BINARY));
+	return vars.size() - 1;
+}
+void gurobiBackend::addOr(int x, vector<int> ys, bool linear) {
+	vector<GRBVar> tmp;
+	GRBLinExpr sum = 0;
+	for (int i = 0; i < ys.size(); i++) {
+		tmp.push_back(vars[ys[i]]);
+		sum += vars[ys[i]];
+	}
+	if (linear) {
+		for (int i = 0; i < tmp.size(); i++) {
+			model.addConstr(tmp[i] <= vars[x]);
+		}
+		model.addConstr(sum >= vars[x]);
+	}
+	else {
+		model.addGenConstrOr(vars[x], tmp.data(), tmp.size());
+	}
+}
+void gurobiBackend::addSum(int y, vector<int> xs) {
+	GRBLinExpr sum = 0;
+	for (int i = 0; i < xs.size(); i++) {
+		sum += vars[xs[i]];
+	}
+	model.addConstr(vars[y] == sum);
+}
+void gurobiBackend::addEqual(int x, int y) {
+	model.addConstr(vars[x] == vars[y]);
+}
+void gurobiBackend::fix(int x, int value) {
+	// a constraint rather than the bounds, so that a variable fixed twice to different values makes the model infeasible
+	model.addConstr(vars[x] == value);
+}
+GRBLinExpr gurobiBackend::clauseExpr(vector<int>& lits) {
+	GRBLinExpr sum = 0;
+	for (int i = 0; i < lits.size(); i++) {
+		if (lits[i] > 0)
+			sum += vars[lits[i] - 1];
+		else
+			sum += 1 - vars[-lits[i] - 1];
+	}
+	return sum;
+}
+void gurobiBackend::addClause(vector<int> lits) {
+	model.addConstr(clauseExpr(lits) >= 1);
+}
+void gurobiBackend::setObjective(vector<int> xs, bool maximize) {
+	GRBLinExpr sum = 0;
+	for (int i = 0; i < xs.size(); i++) {
+		sum += vars[xs[i]];
+	}
+	model.setObjective(sum, maximize ? GRB_MAXIMIZE : GRB_MINIMIZE);
+}
+void gurobiBackend::addStart(vector<pair<int, int>> values) {
+	model.set(GRB_IntAttr_NumStart, numStarts + 1);
+	model.set(GRB_IntParam_StartNumber, numStarts);
+	for (int i = 0; i < values.size(); i++) {
+		vars[values[i].first].set(GRB_DoubleAttr_Start, values[i].second);
+	}
+	numStarts++;
+}
+void gurobiBackend::setPriority(int x, int priority) {
+	vars[x].set(GRB_IntAttr_BranchPriority, priority);
+}
+
+void gurobiBackend::checkpoint() {
+	model.update();
+	markVars = vars.size();
+	markConstrs = model.get(GRB_IntAttr_NumConstrs);
+	markGenConstrs = model.get(GRB_IntAttr_NumGenConstrs);
+}
+void gurobiBackend::rollback() {
+	model.update();
+	GRBConstr* constrs = model.getConstrs();
+	for (int k = markConstrs; k < model.get(GRB_IntAttr_NumConstrs); k++) {
+		model.remove(constrs[k]);
+	}
+	delete[] constrs;
+	GRBGenConstr* genConstrs = model.getGenConstrs();
+	for (int k = markGenConstrs; k < model.get(GRB_IntAttr_NumGenConstrs); k++) {
+		model.remove(genConstrs[k]);
+	}
+	delete[] genConstrs;
+	for (int k = markVars; k < vars.size(); k++) {
+		model.remove(vars[k]);
+	}
+	vars.resize(markVars);
+	model.set(GRB_IntAttr_NumStart, 0);
+	numStarts = 0;
+}
+int gurobiBackend::numVariables() {
+	model.update();
+	return model.get(GRB_IntAttr_NumVars);
+}
+int gurobiBackend::numConstraints() {
+	model.update();
+	return model.get(GRB_IntAttr_NumConstrs);
+}
+int gurobiBackend::numGenConstraints() {
+	model.update();
+	return model.get(GRB_IntAttr_NumGenConstrs);
+}
+bool gurobiBackend::presolve(int& numVars, int& numConstrs) {
+	model.update();
+	GRBModel presolved = model.presolve();
+	numVars = presolved.get(GRB_IntAttr_NumVars);
+	numConstrs = presolved.get(GRB_IntAttr_NumConstrs);
+	return true;
+}
+
+int gurobiBackend::feasible(double timeLimit) {
+
+	// without the pool, and the enumeration starts from scratch afterwards, so that its pool only holds the trails found with
+	// the pool parameters (the trail of this pass would otherwise be kept as the incumbent, without its 2nd stage)
+	model.update();
+	int poolSearchMode = model.getEnv().get(GRB_IntParam_PoolSearchMode);
+	model.set(GRB_IntParam_PoolSearchMode, 0);
+	model.set(GRB_IntParam_SolutionLimit, 1);
+	model.set(GRB_DoubleParam_TimeLimit, timeLimit);
+	stopCallback plain(stop, log);
+	model.setCallback(&plain);
+	model.optimize();
+	int result = model.get(GRB_IntAttr_Status);
+	lastPresolveSec = plain.presolveSec;
+	model.set(GRB_IntParam_PoolSearchMode, poolSearchMode);
+	model.set(GRB_IntParam_SolutionLimit, 2000000000);
+	model.set(GRB_DoubleParam_TimeLimit, GRB_INFINITY);
+	model.reset();
+	return result;
+
+}
+long long gurobiBackend::enumerate(function<void(const vector<char>&)> onSolution, bool lazy) {
+
+	try {
+		model.update();
+		if (lazy) {
+			model.set(GRB_IntParam_LazyConstraints, 1);
+			backendCallback cb(stop, log, vars, onSolution);
+			active = &cb;
+			model.setCallback(&cb);
+			model.optimize();
+			active = NULL;
+			lastPresolveSec = cb.presolveSec;
+			return model.get(GRB_IntAttr_SolCount);
+		}
+
+		// the messages go to the log through the callback (the environments have no LogFile)
+		stopCallback plain(stop, log);
+		model.setCallback(&plain);
+		model.optimize();
+		lastPresolveSec = plain.presolveSec;
+
+		int solCount = model.get(GRB_IntAttr_SolCount);
+		if (solCount >= 2000000000) {
+			cerr << "Number of solutions is too large" << endl;
+			return -1;
+		}
+
+		vector<char> sol(vars.size());
+		for (int i = 0; i < solCount; i++) {
+			model.set(GRB_IntParam_SolutionNumber, i);
+			for (int v = 0; v < vars.size(); v++) {
+				sol[v] = (round(vars[v].get(GRB_DoubleAttr_Xn)) == 1);
+			}
+			onSolution(sol);
+		}
+		return solCount;
+	}
+	catch (GRBException e) {
+		active = NULL;
+		cerr << "Error code = " << e.getErrorCode() << endl;
+		cerr << e.getMessage() << endl;
+	}
+	return -1;
+
+}
+void gurobiBackend::addLazy(vector<int> lits) {
+	if (active != NULL)
+		active->lazy(clauseExpr(lits));
+}
+
+int gurobiBackend::status() {
+	return model.get(GRB_IntAttr_Status);
+}
+double gurobiBackend::runtime() {
+	return model.get(GRB_DoubleAttr_Runtime);
+}
+double gurobiBackend::objVal() {
+	return model.get(GRB_DoubleAttr_ObjVal);
+}
+double gurobiBackend::nodes() {
+	return model.get(GRB_DoubleAttr_NodeCount);
+}
+#endif
@@ -0,0 +1,274 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include"envpool.h"
+#include"asynclog.h"
+#include<string>
+#include<vector>
+#include<functional>
+#include<atomic>
+#include<chrono>
+
+using namespace std;
+
+// the status of a solve (the numbers are the status codes of Gurobi)
+enum backendStatus { BACKEND_OPTIMAL = 2, BACKEND_INFEASIBLE = 3, BACKEND_TIME_LIMIT = 9, BACKEND_SOLUTION_LIMIT = 10, BACKEND_INTERRUPTED = 11 };
+
+/*
+Thin interface of the solver backends for the three-subset division property.
+A variable is a binary index, and the constraints are those used by the division property:
+COPY (x = y | z), XOR (y = x_1 + ... + x_n over the integers), AND (x == y), constants and clauses.
+Every solution is one division trail, so the solutions are enumerated completely (solution pool),
+or handed one by one to a callback which may cut them off by lazy clauses (the 1st stage of the two-stage enumeration).
+The guidance of the search (objective, starts, branching priorities) is ignored by the backends which do not use it.
+*/
+class divBackend {
+public:
+	virtual ~divBackend() {}
+	virtual string name() = 0;
+
+	// a new binary variable
+	virtual int addVar() = 0;
+	// x = y_1 | ... | y_n. linear: as y_i <= x and y_1 + ... + y_n >= x instead of a general constraint (see Formulation in envpool.h)
+	virtual void addOr(int x, vector<int> ys, bool linear = false) = 0;
+	// y = x_1 + ... + x_n
+	virtual void addSum(int y, vector<int> xs) = 0;
+	// x == y
+	virtual void addEqual(int x, int y) = 0;
+	// x == value
+	virtual void fix(int x, int value) = 0;
+	// at least one literal is true. the literal v+1 is the variable v and -(v+1) is its negation
+	virtual void addClause(vector<int> lits) = 0;
+
+	// maximize (or minimize) the sum of xs. The objective of the best solution is objVal
+	virtual void setObjective(vector<int> /* xs */, bool /* maximize */) {}
+	// one more (partial) start solution of (variable, value)
+	virtual void addStart(vector<pair<int, int>> /* values */) {}
+	// the branching priority of x (higher first)
+	virtual void setPriority(int /* x */, int /* priority */) {}
+	// the pseudo parameter of the profile (see envPool::option), "" if not configured
+	virtual string option(string /* key */) { return ""; }
+	// true if the environment of the profile was reused (see metricsJob)
+	virtual bool cacheHit() { return false; }
+
+	// the model after checkpoint (variables, constraints and starts) is removed by rollback (see triviumSweep)
+	virtual void checkpoint() = 0;
+	virtual void rollback() = 0;
+
+	virtual int numVariables() = 0;
+	virtual int numConstraints() = 0;
+	virtual int numGenConstraints() { return 0; }
+	// the size of the presolved model, false if the backend has no presolve
+	virtual bool presolve(int& /* vars */, int& /* constrs */) { return false; }
+
+	// the solve is aborted once *stop becomes true, and the messages of the solver go to log (either may be NULL)
+	void watch(atomic<bool>* xstop, logStream* xlog) {
+		stop = xstop;
+		log = xlog;
+	}
+
+	/*
+	Feasibility pass: stop at the first solution, or after timeLimit sec.
+	return: BACKEND_SOLUTION_LIMIT if a solution exists, BACKEND_INFEASIBLE if not, otherwise the status
+	*/
+	virtual int feasible(double timeLimit) = 0;
+	/*
+	Enumerate all solutions.
+	onSolution is called with the value of every variable for each solution.
+	lazy: onSolution may call addLazy, and a solution violating the clauses of its call is cut off (not counted nor kept for objVal)
+	return: the number of solutions, or -1 if the enumeration did not finish
+	*/
+	virtual long long enumerate(function<void(const vector<char>&)> onSolution, bool lazy = false) = 0;
+	// a clause (as addClause) added from onSolution of a lazy enumeration
+	virtual void addLazy(vector<int> lits) = 0;
+
+	// the last solve: its status, its time in sec, the objective of the best solution, the time of the presolve (-1: unknown) and the nodes
+	virtual int status() = 0;
+	virtual double runtime() = 0;
+	virtual double objVal() = 0;
+	virtual double presolveSec() { return -1; }
+	virtual double nodes() { return 0; }
+
+protected:
+	atomic<bool>* stop = NULL;
+	logStream* log = NULL;
+};
+
+/*
+The backend with the embedded SAT solver.
+The constraints are encoded as CNF and all solutions are enumerated by DPLL with two watched literals.
+After each solution, the blocking clause of its decision literals is enforced by flipping the last unflipped decision,
+so no clause is actually stored and every solution is found exactly once.
+A lazy clause is attached once two of its literals are not false, and until then it is checked again at every backtrack.
+*/
+class cnfBackend : public divBackend {
+public:
+	cnfBackend() : numVars(0) {}
+	string name() { return "cnf"; }
+
+	int addVar();
+	void addOr(int x, vector<int> ys, bool linear = false);
+	void addSum(int y, vector<int> xs);
+	void addEqual(int x, int y);
+	void fix(int x, int value);
+	void addClause(vector<int> lits);
+	void setObjective(vector<int> xs, bool maximize);
+
+	void checkpoint();
+	void rollback();
+	int numVariables() { return numVars; }
+	int numConstraints() { return clauses.size() + units.size(); }
+
+	int feasible(double timeLimit);
+	long long enumerate(function<void(const vector<char>&)> onSolution, bool lazy = false);
+	void addLazy(vector<int> lits);
+
+	int status() { return lastStatus; }
+	double runtime() { return lastRuntime; }
+	double objVal() { return bestObj; }
+	double nodes() { return decisions; }
+
+private:
+	int numVars;
+	// literal 2v is the variable v and 2v+1 is its negation
+	vector<vector<int>> clauses;
+	vector<int> units;
+	vector<int> objective;
+	bool maximize = true;
+	int markVars = 0;
+	size_t markClauses = 0;
+	size_t markUnits = 0;
+
+	vector<vector<int>> watches;
+	vector<signed char> assign;
+	vector<int> trail;
+	size_t qhead;
+	// the lazy clauses which are not attached yet, and those of the current call of onSolution
+	vector<vector<int>> pending;
+	vector<vector<int>> added;
+
+	int lastStatus = 0;
+	double lastRuntime = 0;
+	double bestObj = 0;
+	double decisions = 0;
+
+	int value(int lit) { return (assign[lit >> 1] < 0) ? -1 : (assign[lit >> 1] ^ (lit & 1)); }
+	void enqueue(int lit);
+	bool propagate();
+	bool checkPending();
+	long long search(function<void(const vector<char>&)> onSolution, bool lazy, long long limit, double timeLimit);
+};
+
+/*
+The stubbed solver of the microbenchmarks (see microbench.h): the model is only counted,
+and enumerate passes the given solutions (e.g. random ones of numVariables() values) to onSolution,
+so that the model building and the extraction of the solutions are measured without a solver.
+*/
+class stubBackend : public divBackend {
+public:
+	stubBackend(const vector<vector<char>>* xreplay = NULL) : numVars(0), numConstrs(0), replay(xreplay) {}
+	string name() { return "stub"; }
+
+	int addVar() { return numVars++; }
+	void addOr(int, vector<int>, bool = false) { numConstrs++; }
+	void addSum(int, vector<int>) { numConstrs++; }
+	void addEqual(int, int) { numConstrs++; }
+	void fix(int, int) { numConstrs++; }
+	void addClause(vector<int>) { numConstrs++; }
+
+	void checkpoint() {}
+	void rollback() {}
+	int numVariables() { return numVars; }
+	int numConstraints() { return numConstrs; }
+
+	int feasible(double) { return ((replay != NULL) && (replay->size() > 0)) ? BACKEND_SOLUTION_LIMIT : BACKEND_INFEASIBLE; }
+	long long enumerate(function<void(const vector<char>&)> onSolution, bool = false) {
+		if (replay == NULL)
+			return 0;
+		for (int i = 0; i < replay->size(); i++)
+			onSolution((*replay)[i]);
+		return replay->size();
+	}
+	void addLazy(vector<int>) {}
+
+	int status() { return ((replay != NULL) && (replay->size() > 0)) ? BACKEND_OPTIMAL : BACKEND_INFEASIBLE; }
+	double runtime() { return 0; }
+	double objVal() { return 0; }
+
+private:
+	int numVars;
+	int numConstrs;
+	const vector<vector<char>>* replay;
+};
+
+#ifndef NOGUROBI
+class backendCallback;
+/*
+The backend with Gurobi. The environment comes from the shared pool (see envpool.h), and the model has its own threads.
+enumerate keeps all solutions in the solution pool, or in the lazy mode hands every MIPSOL of the callback to onSolution,
+whose clauses are added by addLazy of the callback.
+*/
+class gurobiBackend : public divBackend {
+public:
+	// profile: the parameter profile of the environment, e.g. "trivium1/fast" (see backendProfile)
+	gurobiBackend(string profile, int threadNumber);
+	string name() { return "gurobi"; }
+
+	int addVar();
+	void addOr(int x, vector<int> ys, bool linear = false);
+	void addSum(int y, vector<int> xs);
+	void addEqual(int x, int y);
+	void fix(int x, int value);
+	void addClause(vector<int> lits);
+	void setObjective(vector<int> xs, bool maximize);
+	void addStart(vector<pair<int, int>> values);
+	void setPriority(int x, int priority);
+	string option(string key) { return env.option(key); }
+	bool cacheHit() { return env.cacheHit(); }
+
+	void checkpoint();
+	void rollback();
+	int numVariables();
+	int numConstraints();
+	int numGenConstraints();
+	bool presolve(int& vars, int& constrs);
+
+	int feasible(double timeLimit);
+	long long enumerate(function<void(const vector<char>&)> onSolution, bool lazy = false);
+	void addLazy(vector<int> lits);
+
+	int status();
+	double runtime();
+	double objVal();
+	double presolveSec() { return lastPresolveSec; }
+	double nodes();
+
+private:
+	envLease env;
+	GRBModel model;
+	vector<GRBVar> vars;
+	backendCallback* active = NULL;
+	int numStarts = 0;
+	int markVars = 0;
+	int markConstrs = 0;
+	int markGenConstrs = 0;
+	double lastPresolveSec = -1;
+
+	GRBLinExpr clauseExpr(vector<int>& lits);
+};
+#endif
+
+/*
+Register the Gurobi parameters of a profile of the enumerations (see envpool.h): the lazy constraints of the 1st stage if lazy,
+the solution pool otherwise, and MIPFocus=BESTBOUND if bestBound. Nothing in the NOGUROBI build
+*/
+void backendProfile(string profile, bool lazy, bool bestBound);
+
+/*
+A new backend: name is gurobi, cnf, or empty for Gurobi (the embedded SAT solver in the NOGUROBI build).
+profile: the parameter profile of the environment of Gurobi (ignored by the SAT solver)
+return: NULL if the backend is not available
+*/
+divBackend* newBackend(string name, string profile, int threadNumber);
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef CUBESEARCH_H
+#define CUBESEARCH_H
+
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include<functional>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<condition_variable>
+#include<chrono>
+#include"manifest.h"
+
+using namespace std;
+
+/*
+One candidate of the cube search (-search). The stages are ordered by cost and a candidate goes to the next stage only if a target survives:
+1: bound, the reachability of every cube bit and the numeric degree bound of each target (no solver)
+2: feasibility, the feasibility pass of the three-subset model of each remaining target (see twoStage.screen)
+3: enumeration, the two-stage enumeration of the remaining targets limited to the budget
+cube: 1 for the active IV bits
+text: the cube in the syntax of the manifest
+stage: the last stage the candidate entered
+targets: the targets remaining after the stage
+status: bound, no trail (zero sum proven before the enumeration), zero sum, superpoly or timeout
+monomials, degree: the number of monomials and the degree of the superpoly (status superpoly)
+sec: the time spent on the candidate over all stages
+*/
+struct cubeCandidate {
+	vector<int> cube;
+	string text;
+	int stage;
+	vector<int> targets;
+	string status;
+	int monomials;
+	int degree;
+	double sec;
+};
+
+/*
+"1-33,35-46,48-80", the inverse of manifestIndices
+*/
+inline string cubeText(vector<int>& cube) {
+	string text;
+	int i = 0;
+	while (i < cube.size()) {
+		if (cube[i] == 0) {
+			i++;
+			continue;
+		}
+		int j = i;
+		while ((j + 1 < cube.size()) && (cube[j + 1] == 1))
+			j++;
+		if (text.size() > 0)
+			text += ",";
+		text += to_string(i + 1);
+		if (j > i)
+			text += "-" + to_string(j + 1);
+		i = j + 1;
+	}
+	return text;
+}
+
+/*
+Generate the candidates of a family:
+allbut[k] : all cubes with k non-cube IV bits (0), e.g. allbut2
+allbut[k]:[positions] : the same, where the non-cube bits are chosen from the positions, e.g. allbut2:20-60 (the syntax of the manifest)
+otherwise : a file with one cube per line in the syntax of the manifest, e.g. 1-33,35-46,48-80
+On error, the reason is written to cerr and false is returned
+*/
+inline bool cubeCandidates(string family, int ivSize, vector<cubeCandidate>& candidates) {
+
+	vector<vector<int>> cubes;
+	if (family.compare(0, 6, "allbut") == 0) {
+		size_t pos = family.find(':');
+		int k = atoi(family.substr(6, pos - 6).c_str());
+		vector<int> positions;
+		if (pos == string::npos) {
+			for (int i = 0; i < ivSize; i++) {
+				positions.push_back(i);
+			}
+		}
+		else if (manifestIndices(family.substr(pos + 1), ivSize, positions) == false) {
+			cerr << "cannot read the positions of " << family << endl;
+			return false;
+		}
+		if ((k < 1) || (k > positions.size())) {
+			cerr << "allbut needs 1 <= k <= the number of positions" << endl;
+			return false;
+		}
+
+		// every k-subset of the positions, in lexicographic order
+		vector<int> choice(k);
+		for (int i = 0; i < k; i++) {
+			choice[i] = i;
+		}
+		while (true) {
+			vector<int> cube(ivSize, 1);
+			for (int i = 0; i < k; i++) {
+				cube[positions[choice[i]]] = 0;
+			}
+			cubes.push_back(cube);
+
+			int i = k - 1;
+			while ((i >= 0) && (choice[i] == positions.size() - k + i))
+				i--;
+			if (i < 0)
+				break;
+			choice[i]++;
+			for (int j = i + 1; j < k; j++) {
+				choice[j] = choice[j - 1] + 1;
+			}
+		}
+	}
+	else {
+		ifstream file(family);
+		if (!file) {
+			cerr << "cannot open the cubes " << family << endl;
+			return false;
+		}
+		string line;
+		int lineNumber = 0;
+		while (getline(file, line)) {
+			lineNumber++;
+			stringstream ss(line);
+			string field;
+			if (!(ss >> field) || (field[0] == '#'))
+				continue;
+			vector<int> indices;
+			if ((manifestIndices(field, ivSize, indices) == false) || (indices.size() == 0)) {
+				cerr << "cubes line " << lineNumber << ": cannot read " << field << endl;
+				return false;
+			}
+			vector<int> cube(ivSize, 0);
+			for (int i = 0; i < indices.size(); i++) {
+				cube[indices[i]] = 1;
+			}
+			cubes.push_back(cube);
+		}
+	}
+
+	for (int c = 0; c < cubes.size(); c++) {
+		candidates.push_back({ cubes[c], cubeText(cubes[c]), 0, vector<int>(), "", 0, 0, 0 });
+	}
+	return true;
+
+}
+
+/*
+Rank the candidates: the recovered superpolies first (lower degree, fewer monomials and faster first), then the timeouts (fewer remaining targets first),
+then the zero sums found by the enumeration, the feasibility pass and the bound
+*/
+inline void cubeRank(vector<cubeCandidate>& candidates) {
+
+	auto order = [](const cubeCandidate& c) {
+		if (c.status == "superpoly") return 0;
+		if (c.status == "timeout") return 1;
+		if (c.status == "zero sum") return 2;
+		if (c.status == "no trail") return 3;
+		return 4;
+	};
+	stable_sort(candidates.begin(), candidates.end(), [&](const cubeCandidate& a, const cubeCandidate& b) {
+		if (order(a) != order(b))
+			return order(a) < order(b);
+		if (a.degree != b.degree)
+			return a.degree < b.degree;
+		if (a.monomials != b.monomials)
+			return a.monomials < b.monomials;
+		if (a.targets.size() != b.targets.size())
+			return a.targets.size() < b.targets.size();
+		return a.sec < b.sec;
+	});
+
+}
+
+/*
+The ranked table, one candidate per line
+*/
+inline void cubeTable(ostream& out, vector<cubeCandidate>& candidates) {
+
+	out << "rank\tstatus\tstage\ttargets\tmonomials\tdegree\tsec\tcube" << endl;
+	for (int c = 0; c < candidates.size(); c++) {
+		cubeCandidate& cand = candidates[c];
+		out << (c + 1) << "\t" << cand.status << "\t" << cand.stage << "\t" << cand.targets.size() << "\t";
+		if (cand.status == "superpoly")
+			out << cand.monomials << "\t" << cand.degree;
+		else
+			out << "-\t-";
+		out << "\t" << cand.sec << "\t" << cand.text << endl;
+	}
+
+}
+
+/*
+Run run(stop) and set *stop after sec, so that the solve aborts at the time limit (see twoStage.stop).
+return: true if the time limit was reached
+*/
+inline bool cubeDeadline(double sec, function<void(atomic<bool>*)> run) {
+
+	atomic<bool> stop(false);
+	bool done = false;
+	mutex lock;
+	condition_variable wake;
+	thread timer([&]() {
+		unique_lock<mutex> guard(lock);
+		if (wake.wait_for(guard, chrono::duration<double>(sec), [&]() { return done; }) == false)
+			stop = true;
+	});
+	run(&stop);
+	{
+		lock_guard<mutex> guard(lock);
+		done = true;
+	}
+	wake.notify_one();
+	timer.join();
+	return stop;
+
+}
+
+#endif
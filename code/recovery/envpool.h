@@ -0,0 +1,282 @@
+#ifndef ENVPOOL_H
+#define ENVPOOL_H
+
+#include<string>
+#include<cstdlib>
+#ifndef NOGUROBI
+#include"gurobi_c++.h"
+#include<iostream>
+#include<vector>
+#include<map>
+#include<functional>
+#include<mutex>
+#include<chrono>
+#include<fstream>
+#include<sstream>
+#include<atomic>
+#include"asynclog.h"
+
+using namespace std;
+
+/*
+Pool of preconfigured Gurobi environments keyed by parameter profile.
+A profile is a name and the parameters set once when an environment of the profile is created
+(e.g. "trivium1": the 1st stage with lazy constraints, "trivium2": the 2nd stage with the solution pool, "trivium": the single stage).
+A solve checks an environment out with envLease and the environment goes back to the pool when the lease is destroyed,
+so the environment is created (license check, log file, parameters) once per profile and concurrent solve, not once per solve.
+The parameters which differ between solves (e.g. Threads) are set on the model, which gets its own copy of the parameters.
+With setEnabled(false), every lease creates a fresh environment and deletes it afterwards (the behavior without the pool).
+
+The parameters of a profile can be overridden by a config file (load) with one profile per line:
++++
+trivium1 MIPFocus=0 Presolve=2
+trivium2 Cuts=0 Threads=4
+trivium1/fast Heuristics=0 RoundPriority=backward
++++
+Any Gurobi parameter can be given by its name. Threads overrides the number of threads from the caller (see envLease::threads).
+Some keys are not Gurobi parameters but the guidance of the search applied to the model (see option and roundPriority):
+RoundPriority: the branching priority of the state variables by round.
+  none, forward (the earlier rounds first), backward (the later rounds first) or middle (the divRound layer first, then outward)
+RegisterPriority: the register branched before the others (Trivium: A, B or C, Grain-128AEAD: b or s)
+AndPriority: 1 to branch on the outputs of the AND gates before any state variable
+Objective: key (maximize the key bits, default), minkey (minimize the key bits), middle (minimize the divRound layer) or none
+Formulation: the encoding of the COPY gadgets. general (addGenConstrOr, the default of Grain-128AEAD), linear (y_i <= x and sum y_i >= x,
+  the default of Trivium) or merged (linear, and all taps of one bit in one round form a single COPY)
+A name with /variant is a variant of the profile. It has the parameters of the profile and then its own, and is used by the solves
+with the variant (e.g. twoStage.profile in trivium.cpp), so that two variants can be raced on the same instance.
+*/
+class envPool {
+public:
+	~envPool() {
+		for (auto it = idle.begin(); it != idle.end(); it++) {
+			for (int i = 0; i < (*it).second.size(); i++) {
+				delete (*it).second[i];
+			}
+		}
+	}
+
+	// register the parameters of a profile. a profile registered twice keeps the first setup
+	void profile(string name, function<void(GRBEnv&)> setup) {
+		lock_guard<mutex> guard(lock);
+		if (setups.count(name) == 0)
+			setups[name] = setup;
+	}
+
+	// hit: set to true if an idle environment is reused
+	GRBEnv* checkOut(string name, bool* hit = NULL) {
+		{
+			lock_guard<mutex> guard(lock);
+			leases++;
+			if (hit != NULL)
+				*hit = enabled && (idle[name].size() > 0);
+			if (enabled && (idle[name].size() > 0)) {
+				GRBEnv* env = idle[name].back();
+				idle[name].pop_back();
+				return env;
+			}
+		}
+
+		// create the environment outside the lock
+		auto start = chrono::steady_clock::now();
+		GRBEnv* env = new GRBEnv();
+		env->set(GRB_IntParam_LogToConsole, 0);
+		string base = name.substr(0, name.find('/'));
+		function<void(GRBEnv&)> setup;
+		vector<pair<string, string>> params;
+		{
+			lock_guard<mutex> guard(lock);
+			if (setups.count(base) > 0)
+				setup = setups[base];
+			if (configs.count(base) > 0)
+				params = configs[base];
+			if ((name != base) && (configs.count(name) > 0))
+				params.insert(params.end(), configs[name].begin(), configs[name].end());
+		}
+		if (setup)
+			setup(*env);
+		for (int i = 0; i < params.size(); i++) {
+			if ((params[i].first != "Threads") && (params[i].first != "RoundPriority") && (params[i].first != "RegisterPriority")
+				&& (params[i].first != "AndPriority") && (params[i].first != "Objective") && (params[i].first != "Formulation"))
+				env->set(params[i].first, params[i].second);
+		}
+		double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		lock_guard<mutex> guard(lock);
+		created++;
+		createSec += sec;
+		return env;
+	}
+
+	// override the parameters of a profile or a variant. the idle environments of the name are discarded
+	void configure(string name, vector<pair<string, string>> params) {
+		lock_guard<mutex> guard(lock);
+		configs[name] = params;
+		for (auto it = idle.begin(); it != idle.end(); it++) {
+			if (((*it).first == name) || ((*it).first.compare(0, name.size() + 1, name + "/") == 0)) {
+				for (int i = 0; i < (*it).second.size(); i++) {
+					delete (*it).second[i];
+				}
+				(*it).second.clear();
+			}
+		}
+	}
+
+	// read the config file. On error, the reason and the line number are written to cerr and false is returned
+	bool load(string filename) {
+		ifstream file(filename);
+		if (!file) {
+			cerr << "cannot open the profiles " << filename << endl;
+			return false;
+		}
+		string line;
+		int lineNumber = 0;
+		while (getline(file, line)) {
+			lineNumber++;
+			stringstream ss(line);
+			string name, field;
+			if (!(ss >> name) || (name[0] == '#'))
+				continue;
+			vector<pair<string, string>> params;
+			while (ss >> field) {
+				size_t pos = field.find('=');
+				if ((pos == string::npos) || (pos == 0)) {
+					cerr << "profiles line " << lineNumber << ": cannot read " << field << endl;
+					return false;
+				}
+				params.push_back(make_pair(field.substr(0, pos), field.substr(pos + 1)));
+			}
+			configure(name, params);
+		}
+		return true;
+	}
+
+	// the value of key for the name (the variant first, then its profile), or "" if not configured
+	string option(string name, string key) {
+		lock_guard<mutex> guard(lock);
+		string value;
+		vector<string> names = { name.substr(0, name.find('/')), name };
+		for (int j = 0; j < 2; j++) {
+			if (configs.count(names[j]) == 0)
+				continue;
+			vector<pair<string, string>>& params = configs[names[j]];
+			for (int i = 0; i < params.size(); i++) {
+				if (params[i].first == key)
+					value = params[i].second;
+			}
+		}
+		return value;
+	}
+
+	void checkIn(string name, GRBEnv* env) {
+		lock_guard<mutex> guard(lock);
+		if (enabled)
+			idle[name].push_back(env);
+		else
+			delete env;
+	}
+
+	void setEnabled(bool xenabled) {
+		lock_guard<mutex> guard(lock);
+		enabled = xenabled;
+	}
+
+	// the number of leases, the number of created environments and the time spent on creating them
+	void report(ostream& out) {
+		lock_guard<mutex> guard(lock);
+		out << "Gurobi environments: " << created << " created for " << leases << " solves, " << createSec << " sec";
+		if (created > 0)
+			out << " (" << createSec / created << " sec each)";
+		out << endl;
+	}
+
+private:
+	mutex lock;
+	bool enabled = true;
+	map<string, function<void(GRBEnv&)>> setups;
+	map<string, vector<pair<string, string>>> configs;
+	map<string, vector<GRBEnv*>> idle;
+	long long leases = 0;
+	long long created = 0;
+	double createSec = 0;
+};
+
+/*
+The pool shared by all solves of the process
+*/
+inline envPool& sharedEnvPool() {
+	static envPool pool;
+	return pool;
+}
+
+/*
+An environment checked out of the shared pool for the lifetime of the lease.
+Declare the lease before the model, so the model is destroyed before the environment goes back.
+*/
+class envLease {
+public:
+	envLease(string xname) : name(xname), env(sharedEnvPool().checkOut(xname, &hit)) {}
+	~envLease() { sharedEnvPool().checkIn(name, env); }
+	envLease(const envLease&) = delete;
+	envLease& operator=(const envLease&) = delete;
+
+	GRBEnv& get() { return *env; }
+
+	// the number of threads for the model: Threads of the config if given, threadNumber otherwise
+	int threads(int threadNumber) {
+		string value = sharedEnvPool().option(name, "Threads");
+		return (value.size() > 0) ? atoi(value.c_str()) : threadNumber;
+	}
+
+	// the value of a pseudo parameter such as RoundPriority
+	string option(string key) { return sharedEnvPool().option(name, key); }
+
+	// true if an idle environment was reused (see metricsJob)
+	bool cacheHit() { return hit; }
+
+private:
+	string name;
+	bool hit = false;
+	GRBEnv* env;
+};
+
+/*
+Abort the solve once *stop becomes true (the loser of a race), and write the messages of Gurobi to log (see asynclog.h) if it is given.
+presolveSec is the runtime at the first callback after the presolve (-1 if the solve ended in the presolve), for the metrics
+*/
+class stopCallback : public GRBCallback {
+public:
+	stopCallback(atomic<bool>* xstop, logStream* xlog = NULL) : stop(xstop), log(xlog) {}
+	double presolveSec = -1;
+protected:
+	void callback() {
+		if ((stop != NULL) && stop->load())
+			abort();
+		else if ((where == GRB_CB_MESSAGE) && (log != NULL))
+			log->message(LOG_DEBUG, getStringInfo(GRB_CB_MSG_STRING));
+		else if ((presolveSec < 0) && (where != GRB_CB_POLLING) && (where != GRB_CB_PRESOLVE) && (where != GRB_CB_MESSAGE))
+			presolveSec = getDoubleInfo(GRB_CB_RUNTIME);
+	}
+private:
+	atomic<bool>* stop;
+	logStream* log;
+};
+
+#endif
+
+using namespace std;
+
+/*
+The branching priority of a variable of round r for RoundPriority=order: 0 (none) to evalNumRounds - preRound.
+RegisterPriority and AndPriority add evalNumRounds + 1 and 2 * (evalNumRounds + 1) on top of it
+*/
+inline int roundPriority(string order, int r, int preRound, int evalNumRounds, int divRound) {
+	if (order == "forward")
+		return evalNumRounds - r;
+	else if (order == "backward")
+		return r - preRound;
+	else if (order == "middle")
+		return (evalNumRounds - preRound) - abs(r - divRound);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,440 @@
+#ifndef GF2_H
+#define GF2_H
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<map>
+#include<bitset>
+#include<algorithm>
+#include<cstdint>
+#include"native.h"
+#include"superpoly.h"
+
+using namespace std;
+
+/*
+Dense GF(2) matrix. Each row is packed into words 64-bit words (column c is bit c % 64 of word c / 64),
+and the rows are stored one after another so that a row operation is a loop over contiguous words the compiler vectorizes.
+*/
+class gf2Matrix {
+public:
+	gf2Matrix(int xrows = 0, int xcols = 0) : rows(xrows), cols(xcols), words((xcols + 63) / 64), data((size_t)xrows * ((xcols + 63) / 64), 0) {}
+
+	uint64_t* row(int r) { return data.data() + (size_t)r * words; }
+	int get(int r, int c) { return (row(r)[c / 64] >> (c % 64)) & 1; }
+	void set(int r, int c) { row(r)[c / 64] |= (1ULL << (c % 64)); }
+	void flip(int r, int c) { row(r)[c / 64] ^= (1ULL << (c % 64)); }
+
+	// row a ^= row b
+	void add(int a, int b) {
+		uint64_t* __restrict x = row(a);
+		const uint64_t* __restrict y = row(b);
+		for (int w = 0; w < words; w++) {
+			x[w] ^= y[w];
+		}
+	}
+
+	void swapRows(int a, int b) {
+		if (a != b)
+			swap_ranges(row(a), row(a) + words, row(b));
+	}
+
+	int rows;
+	int cols;
+	int words;
+	vector<uint64_t> data;
+};
+
+/*
+Reduced row echelon form by the Method of Four Russians (M4RI).
+The pivot columns are taken k at a time: the k pivot rows of the block are found and reduced against each other by plain elimination,
+the 2^k sums of the pivot rows are tabulated in Gray code order, and every other row clears the k pivot columns with one table lookup
+and one row addition instead of up to k. The rows are cleared in parallel.
+@Para
+m: the matrix, reduced in place (the pivot rows come first)
+pivotCols: only the columns < pivotCols are eliminated (the other columns, e.g. the right-hand sides, are only carried along)
+pivots: the pivot column of each of the first rank rows
+threadNumber: the number of threads
+k: the block size (at most 16)
+return: the rank
+*/
+inline int gf2Echelon(gf2Matrix& m, int pivotCols, vector<int>& pivots, int threadNumber, int k = 8) {
+
+	pivots.clear();
+	int r = 0;
+	vector<uint64_t> table;
+	for (int c = 0; (c < pivotCols) && (r < m.rows); c += k) {
+		int width = min(k, pivotCols - c);
+
+		// find the pivots of the block. a candidate is first reduced by the pivots found before it in the block
+		vector<int> blockCols;
+		for (int j = c; (j < c + width) && (r + blockCols.size() < m.rows); j++) {
+			int top = r + blockCols.size();
+			int found = -1;
+			for (int i = top; i < m.rows; i++) {
+				for (int t = 0; t < blockCols.size(); t++) {
+					if (m.get(i, blockCols[t]))
+						m.add(i, r + t);
+				}
+				if (m.get(i, j)) {
+					found = i;
+					break;
+				}
+			}
+			if (found < 0)
+				continue;
+			m.swapRows(top, found);
+			blockCols.push_back(j);
+		}
+		int kk = blockCols.size();
+		if (kk == 0)
+			continue;
+
+		// make the pivot rows of the block an identity on the pivot columns
+		for (int t = kk - 1; t >= 0; t--) {
+			for (int u = 0; u < t; u++) {
+				if (m.get(r + u, blockCols[t]))
+					m.add(r + u, r + t);
+			}
+		}
+
+		// table of the 2^kk sums of the pivot rows, index bit t = pivot row t
+		table.assign(((size_t)1 << kk) * m.words, 0);
+		for (size_t g = 1; g < ((size_t)1 << kk); g++) {
+			int t = __builtin_ctzll(g);
+			uint64_t* __restrict dst = table.data() + g * m.words;
+			const uint64_t* __restrict src = table.data() + (g ^ ((size_t)1 << t)) * m.words;
+			const uint64_t* __restrict piv = m.row(r + t);
+			for (int w = 0; w < m.words; w++) {
+				dst[w] = src[w] ^ piv[w];
+			}
+		}
+
+		// clear the pivot columns from all other rows
+		int threads = ((size_t)m.rows * m.words < (1 << 14)) ? 1 : max(threadNumber, 1);
+		nativeRun(threads, [&](int th) {
+			for (int i = th; i < m.rows; i += threads) {
+				if ((r <= i) && (i < r + kk))
+					continue;
+				size_t index = 0;
+				for (int t = 0; t < kk; t++) {
+					index |= (size_t)m.get(i, blockCols[t]) << t;
+				}
+				if (index == 0)
+					continue;
+				uint64_t* __restrict x = m.row(i);
+				const uint64_t* __restrict y = table.data() + index * m.words;
+				for (int w = 0; w < m.words; w++) {
+					x[w] ^= y[w];
+				}
+			}
+		});
+
+		pivots.insert(pivots.end(), blockCols.begin(), blockCols.end());
+		r += kk;
+	}
+	return r;
+
+}
+
+/*
+Key recovery from superpolies: every cube gives the equation superpoly(key) = cube sum.
+The monomials of degree 2 to maxDegree are linearized (one new variable per monomial), the system is reduced by gf2Echelon
+with the nonlinear columns first, and the rows whose pivots are key bits are the linear equations in the key bits left after
+the nonlinear monomials are eliminated. A row with a single key bit recovers the bit.
+The non-cube IV bits are 0, so the monomials with an IV bit are dropped. The key bits are at most 128.
+*/
+class gf2KeyRecovery {
+public:
+	gf2KeyRecovery(int xkeySize) : keySize(xkeySize) {}
+
+	/*
+	Add the superpoly of one cube
+	name: the name of the cube in the report
+	monomials: the monomials of the superpoly (the key bits of each, bit i of word i / 64 is k[i + 1])
+	*/
+	void add(string name, vector<pair<uint64_t, uint64_t>> monomials) {
+		names.push_back(name);
+		polys.push_back(monomials);
+	}
+
+	// the superpoly (the odd counts) of a countingBox of a state of N bits, see superpolyWriter::section
+	template<size_t N, class Cmp> void add(string name, map<bitset<N>, int, Cmp>& countingBox, int keyOffset, int ivOffset, vector<int>& cube) {
+		map<pair<uint64_t, uint64_t>, long long> projected;
+		for (auto it = countingBox.begin(); it != countingBox.end(); it++) {
+			pair<uint64_t, uint64_t> mono(0, 0);
+			bool iv = false;
+			for (int i = 0; i < cube.size(); i++) {
+				iv = iv || ((cube[i] == 0) && ((*it).first[ivOffset + i] == 1));
+			}
+			if (iv)
+				continue;
+			for (int i = 0; i < keySize; i++) {
+				if ((*it).first[keyOffset + i] == 1)
+					((i < 64) ? mono.first : mono.second) |= (1ULL << (i % 64));
+			}
+			projected[mono] += (*it).second;
+		}
+		vector<pair<uint64_t, uint64_t>> monomials;
+		for (auto it = projected.begin(); it != projected.end(); it++) {
+			if (((*it).second % 2) == 1)
+				monomials.push_back((*it).first);
+		}
+		add(name, monomials);
+	}
+
+	// the superpoly of section 0 of a superpoly file (see superpoly.h). On error, the reason is written to cerr and false is returned
+	bool addFile(string filename) {
+		superpolyFile file;
+		if (file.open(filename) == false)
+			return false;
+		const superpolyHeader& h = file.header();
+		if (h.keySize != keySize) {
+			cerr << filename << " has " << h.keySize << " key bits, not " << keySize << endl;
+			return false;
+		}
+		map<pair<uint64_t, uint64_t>, long long> projected;
+		for (uint64_t i = 0; i < file.section(0).count; i++) {
+			const uint64_t* rec = file.record(0, i);
+			pair<uint64_t, uint64_t> mono(0, 0);
+			bool iv = false;
+			for (int b = 0; b < h.stateBits; b++) {
+				if (((rec[b / 64] >> (b % 64)) & 1) == 0)
+					continue;
+				if ((h.keyOffset <= b) && (b < h.keyOffset + h.keySize)) {
+					int key = b - h.keyOffset;
+					((key < 64) ? mono.first : mono.second) |= (1ULL << (key % 64));
+				}
+				else
+					iv = true;
+			}
+			if (iv == false)
+				projected[mono] += rec[h.words];
+		}
+		vector<pair<uint64_t, uint64_t>> monomials;
+		for (auto it = projected.begin(); it != projected.end(); it++) {
+			if (((*it).second % 2) == 1)
+				monomials.push_back((*it).first);
+		}
+		string name = filename.substr(filename.rfind('/') + 1);
+		add(name, monomials);
+		return true;
+	}
+
+	/*
+	Reduce the system and write the report
+	maxDegree: the superpolies of a larger degree are not used
+	sums: the cube sums in the order of add ("" if not known). With the sums, the recovered key bits are evaluated
+	threadNumber: the number of threads of gf2Echelon
+	return: the number of recovered key bits, or -1 if the sums are inconsistent
+	*/
+	int solve(ostream& out, int maxDegree, string sums, int threadNumber) {
+
+		// the equations and the columns: the nonlinear monomials, the key bits, the constant and one column per used cube
+		vector<int> used;
+		map<pair<uint64_t, uint64_t>, int> nonlinear;
+		for (int e = 0; e < polys.size(); e++) {
+			int degree = 0;
+			for (int m = 0; m < polys[e].size(); m++) {
+				degree = max(degree, __builtin_popcountll(polys[e][m].first) + __builtin_popcountll(polys[e][m].second));
+			}
+			out << names[e] << "\t" << polys[e].size() << " monomials, degree " << degree;
+			if (polys[e].size() == 0) {
+				out << " (zero sum, not used)" << endl;
+				continue;
+			}
+			if (degree > maxDegree) {
+				out << " (not used, larger than " << maxDegree << ")" << endl;
+				continue;
+			}
+			out << endl;
+			used.push_back(e);
+			for (int m = 0; m < polys[e].size(); m++) {
+				if (__builtin_popcountll(polys[e][m].first) + __builtin_popcountll(polys[e][m].second) >= 2)
+					nonlinear.insert(make_pair(polys[e][m], 0));
+			}
+		}
+		int numNonlinear = 0;
+		for (auto it = nonlinear.begin(); it != nonlinear.end(); it++) {
+			(*it).second = numNonlinear++;
+		}
+		int keyCol = numNonlinear;
+		int constCol = keyCol + keySize;
+		int cubeCol = constCol + 1;
+
+		gf2Matrix m(used.size(), cubeCol + used.size());
+		for (int e = 0; e < used.size(); e++) {
+			vector<pair<uint64_t, uint64_t>>& poly = polys[used[e]];
+			for (int j = 0; j < poly.size(); j++) {
+				int degree = __builtin_popcountll(poly[j].first) + __builtin_popcountll(poly[j].second);
+				if (degree == 0)
+					m.flip(e, constCol);
+				else if (degree == 1)
+					m.flip(e, keyCol + ((poly[j].first != 0) ? __builtin_ctzll(poly[j].first) : 64 + __builtin_ctzll(poly[j].second)));
+				else
+					m.flip(e, nonlinear[poly[j]]);
+			}
+			m.set(e, cubeCol + e);
+		}
+
+		vector<int> pivots;
+		int rank = gf2Echelon(m, constCol, pivots, threadNumber);
+		int linearRank = 0;
+		for (int i = 0; i < rank; i++) {
+			linearRank += (pivots[i] >= keyCol);
+		}
+		out << used.size() << " equations, " << numNonlinear << " nonlinear monomials up to degree " << maxDegree << " and " << keySize << " key bits" << endl;
+		out << "rank " << rank << ", " << linearRank << " linear equations in the key bits after the elimination of the nonlinear monomials, "
+			<< (numNonlinear + keySize - rank) << " dimensions of the solution space of the linearized system, "
+			<< "2^" << (keySize - linearRank) << " keys remain" << endl;
+
+		// the sum of the cubes which gives a row
+		bool haveSums = (sums.size() >= used.size());
+		auto rhs = [&](int i) {
+			int bit = m.get(i, constCol);
+			for (int e = 0; e < used.size(); e++) {
+				if (m.get(i, cubeCol + e))
+					bit ^= (sums[used[e]] == '1');
+			}
+			return bit;
+		};
+		auto cubes = [&](int i) {
+			string text = m.get(i, constCol) ? "1" : "";
+			for (int e = 0; e < used.size(); e++) {
+				if (m.get(i, cubeCol + e))
+					text += ((text.size() > 0) ? " + " : "") + names[used[e]];
+			}
+			return text;
+		};
+
+		int recovered = 0;
+		linearPivots.clear();
+		linearRows.clear();
+		linearRhs.clear();
+		out << "linear equations (key bits = the sum of the cube sums)" << endl;
+		for (int i = 0; i < rank; i++) {
+			if (pivots[i] < keyCol)
+				continue;
+			string keys;
+			int weight = 0;
+			linearRows.push_back(vector<int>(keySize, 0));
+			for (int b = 0; b < keySize; b++) {
+				if (m.get(i, keyCol + b)) {
+					keys += ((weight > 0) ? " + k" : "k") + to_string(b + 1);
+					weight++;
+					linearRows.back()[b] = 1;
+				}
+			}
+			linearPivots.push_back(pivots[i] - keyCol);
+			linearRhs.push_back(haveSums ? rhs(i) : 0);
+			recovered += (weight == 1);
+			out << keys << " = " << cubes(i);
+			if (haveSums)
+				out << " = " << rhs(i);
+			out << ((weight == 1) ? "\t(recovered)" : "") << endl;
+		}
+
+		// the rows without pivot are the sums of cubes whose superpolies cancel
+		bool consistent = true;
+		for (int i = rank; i < m.rows; i++) {
+			out << "0 = " << cubes(i);
+			if (haveSums) {
+				out << " = " << rhs(i);
+				consistent = consistent && (rhs(i) == 0);
+			}
+			out << "\t(check)" << endl;
+		}
+		out << recovered << " key bits are recovered" << endl;
+		if (consistent == false) {
+			out << "the cube sums are inconsistent with the superpolies" << endl;
+			return -1;
+		}
+		return recovered;
+
+	}
+
+	// the key bits which are not the pivot of a linear equation of the last solve
+	vector<int> freeKeyBits() {
+		vector<int> pivot(keySize, 0);
+		for (int i = 0; i < linearPivots.size(); i++)
+			pivot[linearPivots[i]] = 1;
+		vector<int> bits;
+		for (int b = 0; b < keySize; b++) {
+			if (pivot[b] == 0)
+				bits.push_back(b);
+		}
+		return bits;
+	}
+
+	/*
+	The affine space of the keys which satisfy the linear equations of the last solve with the sums (see keySearch)
+	known: the known values of the free key bits (-1 if unknown)
+	offset: the key with the unknown bits 0, basis: one vector per unknown bit, which flips the bit and the pivots of its equations
+	*/
+	void keySpace(vector<int>& known, vector<int>& offset, vector<vector<int>>& basis) {
+		vector<int> bits = freeKeyBits();
+		offset.assign(keySize, 0);
+		basis.clear();
+		for (int j = 0; j < bits.size(); j++) {
+			int b = bits[j];
+			if (known[b] < 0) {
+				basis.push_back(vector<int>(keySize, 0));
+				basis.back()[b] = 1;
+			}
+			else
+				offset[b] = known[b];
+		}
+		// a row is pivot + sum of free bits = rhs
+		for (int i = 0; i < linearRows.size(); i++) {
+			int p = linearPivots[i];
+			offset[p] = linearRhs[i];
+			for (int j = 0, u = 0; j < bits.size(); j++) {
+				int b = bits[j];
+				if (known[b] < 0) {
+					basis[u][p] ^= linearRows[i][b];
+					u++;
+				}
+				else
+					offset[p] ^= linearRows[i][b] & known[b];
+			}
+		}
+	}
+
+private:
+	int keySize;
+	vector<string> names;
+	vector<vector<pair<uint64_t, uint64_t>>> polys;
+	vector<int> linearPivots;
+	vector<vector<int>> linearRows;
+	vector<int> linearRhs;
+};
+
+/*
+The key recovery (-recover): the superpolies of section 0 of the superpoly files, one equation per file
+@Para
+filenames: the superpoly files (the same cipher)
+maxDegree: the largest degree of the linearized monomials
+sums: the cube sums in the order of the files, e.g. "0110" ("" if not known)
+return: 0, or 1 on error or inconsistent sums
+*/
+inline int gf2Recover(vector<string> filenames, int maxDegree, string sums, int threadNumber) {
+
+	superpolyFile first;
+	if ((filenames.size() == 0) || (first.open(filenames[0]) == false))
+		return 1;
+	gf2KeyRecovery system(first.header().keySize);
+	for (int f = 0; f < filenames.size(); f++) {
+		if (system.addFile(filenames[f]) == false)
+			return 1;
+	}
+	if ((sums.size() > 0) && (sums.size() != filenames.size())) {
+		cerr << "-sums has " << sums.size() << " bits for " << filenames.size() << " files" << endl;
+		return 1;
+	}
+	cout << first.header().cipher << " " << first.header().rounds << " rounds, " << filenames.size() << " cubes" << endl;
+	return (system.solve(cout, maxDegree, sums, threadNumber) < 0) ? 1 : 0;
+
+}
+
+#endif
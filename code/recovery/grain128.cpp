@@ -1,4 +1,22 @@
 #include"main.h"
+#include"anf.h"
+#include"native.h"
+#include"backend.h"
+#include"schedule.h"
+#include"envpool.h"
+#include"tune.h"
+#include"manifest.h"
+#include"cubesearch.h"
+#include"verify.h"
+#include"superpoly.h"
+#include"gf2.h"
+#include"keysearch.h"
+#include"oracle.h"
+#include"metrics.h"
+#include"histogram.h"
+#include"asynclog.h"
+#include"microbench.h"
+#include"legacy.h"
 
 //Regard two 256-bit vectors a and b as ordinary integers and compare them to see whether a<b
 struct cmpBitset256 {
@@ -27,1184 +45,3131 @@ Therefore, the 1st stage is to compute J[u->k'] and the 2nd stage is to find J[k
 The twoTwoStage structure is to handle such a process.
 @Para:
 userTwoStage: true if we use such a two stage strategy
-divRound: usually R/2. Of course, other number is also OK.
+divRound: usually R/2. Of course, other number is also OK. In the 1st stage, 0 means (preRound + R)/2 and a positive value is used for the 2nd stage.
 hint: the respresentation of k'
+preRound: if positive, the first preRound rounds are expanded as ANF instead of the MILP model (hybrid mode, see grainPreRound)
+prePoly: the ANF of the state after preRound rounds (see grainANF)
+sched: if not NULL, the job runs under the scheduler. The 2nd stage asks it for the number of threads and the result is not displayed
+profile: if not empty, the variant of the parameter profiles used by both stages (see envpool.h)
+screen: if positive, the 1st stage (or the single stage) is preceded by a feasibility pass without the pool and the callback, limited to screen sec.
+If no trail exists, the enumeration is skipped and -1 is returned with the proof time as dulation (early zero sum)
+report: if not NULL, receives the statistics and the size of the model, including the presolve (see benchmarkFormulationGrain128a)
+stop: if not NULL, the solve is aborted once *stop becomes true (see grainRace). If *stop is already true, only the feasibility pass runs and -2 is returned
+unless it proves the zero sum (see cubeSearchGrain128a)
+quiet: if true, the result is not displayed, as for the enumerations inside the benchmarks, the tuning and the verification
+backend: the solver of both stages (see newBackend), empty = the default of the build
+solver: if not NULL, the single stage is built on it instead (e.g. the stubbed solver of the microbenchmarks)
 */
 struct twoStageGrain {
-	bool useTwoStage;
-	int divRound;
+	bool useTwoStage = false;
+	int divRound = 0;
 	vector<bitset<256>> hint;
+	int preRound = 0;
+	vector<anfPoly<256>>* prePoly = NULL;
+	jobScheduler* sched = NULL;
+	string profile;
+	atomic<bool>* stop = NULL;
+	struct pruneStat* report = NULL;
+	double screen = 0;
+	long long parent = 0;
+	bool quiet = false;
+	string backend;
+	divBackend* solver = NULL;
 };
 
 
-/***************************************
- * MILP model for each components
- ***************************************/
+static const vector<vector<int>> grainMonomialH = { { 12, 128 + 8 }, { 128 + 13, 128 + 20 }, { 95, 128 + 42 }, { 128 + 60, 128 + 79 }, { 12, 95, 128 + 94 } };
+static const vector<vector<int>> grainMonomialO = { { 128 + 93 }, { 2 }, { 15 }, { 36 }, { 45 }, { 64 }, { 73 }, { 89 } };
+static const vector<vector<int>> grainMonomialF = { { 128 + 0 }, { 128 + 7 }, { 128 + 38 }, { 128 + 70 }, { 128 + 81 }, { 128 + 96 } };
+static const vector<vector<int>> grainMonomialG = { { 0 }, { 26 }, { 56 }, { 91 }, { 96 }, { 3, 67 }, { 11, 13 }, { 17, 18 }, { 27, 59 }, { 40, 48 }, { 61, 65 }, { 68, 84 }, { 88, 92, 93, 95 }, { 22, 24, 25 }, { 70, 78, 82 } };
+static bool grainMonomialForward(const vector<vector<int>>& monomials, bitset<256>& fw) {
+	for (int j = 0; j < monomials.size(); j++) {
+		bool m = true;
+		for (int k = 0; k < monomials[j].size(); k++) {
+			if (fw[monomials[j][k]] == 0) m = false;
+		}
+		if (m) return true;
+	}
+	return false;
+}
+static void grainMonomialBackward(const vector<vector<int>>& monomials, bitset<256>& fw, bitset<256>& t) {
+	for (int j = 0; j < monomials.size(); j++) {
+		bool m = true;
+		for (int k = 0; k < monomials[j].size(); k++) {
+			if (fw[monomials[j][k]] == 0) m = false;
+		}
+		if (m) {
+			for (int k = 0; k < monomials[j].size(); k++) {
+				t[monomials[j][k]] = 1;
+			}
+		}
+	}
+}
 /*
-The tap operation of NLFSRs. It corresponds to the COPY operation of division property:
-A variable x is first copied to x->(y,z). x is replaced with z and y will be involved in other operations (such as AND, XOR etc.)
-@Para
-model: the MILP model
-x: the 3-subset division property of the variable to be tapped.
+The forward part of grainReachability. It does not depend on the number of rounds,
+so fw[0..r] of a longer model is also the forward part of the r-round model (see grainSweep)
 */
-GRBVar tap(GRBModel& model, GRBVar& x) {
+static vector<bitset<256>> grainForward(vector<int>& cube, vector<int>& flag, int evalNumRounds, struct twoStageGrain& opt) {
 
-  GRBVar y = model.addVar(0, 1, 0, GRB_BINARY);
-  GRBVar z = model.addVar(0, 1, 0, GRB_BINARY);
-  GRBVar tmp[2] = { y,z };
-  model.addGenConstrOr(x, tmp, 2);
-  x = z;
-  return y;
+	bool pinned = (opt.useTwoStage == true) && (opt.hint.size() > 0);
+	int r0 = opt.preRound;
 
-}
+	vector<bitset<256>> fw(evalNumRounds + 1);
+	if (r0 == 0) {
+		for (int i = 0; i < 128; i++) {
+			fw[0][i] = 1;
+			fw[0][128 + i] = 1;
+		}
+		for (int i = 0; i < 96; i++) {
+			if ((cube[i] == 0) && (flag[128 + i] == 0))
+				fw[0][128 + i] = 0;
+		}
+		fw[0][128 + 127] = 0;
+	}
+	else {
+		for (int i = 0; i < 256; i++) {
+			if ((*opt.prePoly)[i].size() > 0) fw[r0][i] = 1;
+		}
+	}
 
+	for (int r = r0; r <= evalNumRounds; r++) {
+		if (pinned && (r == opt.divRound))
+			fw[r] &= opt.hint[r];
+		if (r == evalNumRounds)
+			break;
+
+		bool z = grainMonomialForward(grainMonomialH, fw[r]) || grainMonomialForward(grainMonomialO, fw[r]);
+		bool f = grainMonomialForward(grainMonomialF, fw[r]);
+		bool g = grainMonomialForward(grainMonomialG, fw[r]);
+		for (int i = 0; i < 127; i++) {
+			fw[r + 1][i] = fw[r][i + 1];
+			fw[r + 1][128 + i] = fw[r][128 + i + 1];
+		}
+		fw[r + 1][127] = z || g || fw[r][128];
+		fw[r + 1][128 + 127] = z || f;
+	}
 
+	return fw;
+}
 
-/***************************************
- * MILP model for the H function
- ***************************************/
 /*
-The h function of the Grain-128a stream cihper--the non-linear part of the output function z=h+LinearPart
-h= b12s8 + s13s20 + b95s42 + s60s79 + b12b95s94
-An additional parameter "target" is introduced enabling to evaluate the division property of each term b12s8, s12s20 ... separately.
-For example, if we set target=1, we regard the the output bit as z'=b12s8 so the corresponding superpoly is only related to b12s8. 
-target=2,...5 corresponds to the rest terms s13s20,..., b12b95s94
-target=6 corresponds to the linear part of the output function
-target=-1 is used during the initialization phase.
-@Para
-model: the MILP model
-b: the three-subset division property for the NFSR
-s: the three-subset division property for the LFSR
-target: the evaluation target: -1->initialization round, 6->ignore the non-linear part and only regard the linear parts as the output, 1-5->corresponds to the evaluation of b12s8,...,b12b94s94 separately
+Bit-level reachability pruning before the MILP model is constructed.
+The state is represented as a 256-bit vector (NFSR b in [0,128), LFSR s in [128,256)) as the trail in threeEnumurationGrain.
+Forward: a bit can be nonzero only if it is reachable from the free bits of round 0. A monomial needs all of its factors.
+Backward: every nonzero unit must arrive at the output monomials selected by target, so a bit can be nonzero only if one of its successors can be nonzero.
+In the 2nd stage, the pinned k' at divRound restarts both propagations.
+Bits failing either test are fixed to 0 and the corresponding taps are not generated.
+@Para:
+cube, flag, evalNumRounds, target, opt: same as grainThreeEnumuration
+return: live[r][i] = 1 if the i-th bit of the state at round r can be nonzero
 */
-GRBVar funcH(GRBModel& model, vector<GRBVar>& b, vector<GRBVar>& s, int target = -1) {
+vector<bitset<256>> grainReachability(vector<int>& cube, vector<int>& flag, int evalNumRounds, int target, struct twoStageGrain& opt) {
 
-  GRBVar b12x = tap(model, b[12]);
-  GRBVar s8 = tap(model, s[8]);
-  model.addConstr(b12x == s8);
+	bool pinned = (opt.useTwoStage == true) && (opt.hint.size() > 0);
+	int r0 = opt.preRound;
 
-  GRBVar s13 = tap(model, s[13]);
-  GRBVar s20 = tap(model, s[20]);
-  model.addConstr(s13 == s20);
+	// forward
+	vector<bitset<256>> fw = grainForward(cube, flag, evalNumRounds, opt);
 
-  GRBVar b95x = tap(model, b[95]);
-  GRBVar s42 = tap(model, s[42]);
-  model.addConstr(b95x == s42);
-
-  GRBVar s60 = tap(model, s[60]);
-  GRBVar s79 = tap(model, s[79]);
-  model.addConstr(s60 == s79);
-
-  GRBVar b12y = tap(model, b[12]);
-  GRBVar b95y = tap(model, b[95]);
-  GRBVar s94 = tap(model, s[94]);
-  model.addConstr(b12y == b95y);
-  model.addConstr(b12y == s94);
-
-  GRBVar y = model.addVar(0, 1, 0, GRB_BINARY);
-  model.addConstr(y == b12x + s13 + b95x + s60 + b12y);
+	// backward
+	vector<bitset<256>> live(evalNumRounds + 1);
+	bitset<256> t;
+	for (int j = 0; j < 5; j++) {
+		if ((target == -1) || (target == 5 - j))
+			grainMonomialBackward({ grainMonomialH[j] }, fw[evalNumRounds], t);
+	}
+	if ((target == -1) || (target == 6))
+		grainMonomialBackward(grainMonomialO, fw[evalNumRounds], t);
+	live[evalNumRounds] = fw[evalNumRounds] & t;
+
+	for (int r = evalNumRounds - 1; r >= r0; r--) {
+		bool newb = live[r + 1][127];
+		bool news = live[r + 1][128 + 127];
+
+		t.reset();
+		for (int i = 0; i < 127; i++) {
+			t[i + 1] = live[r + 1][i];
+			t[128 + i + 1] = live[r + 1][128 + i];
+		}
+		if (newb || news) {
+			grainMonomialBackward(grainMonomialH, fw[r], t);
+			grainMonomialBackward(grainMonomialO, fw[r], t);
+		}
+		if (news)
+			grainMonomialBackward(grainMonomialF, fw[r], t);
+		if (newb) {
+			grainMonomialBackward(grainMonomialG, fw[r], t);
+			t[128] = 1;
+		}
 
-	if (target == 1)
-		model.addConstr(b12y == 1);
-	else if (target == 2)
-		model.addConstr(s60 == 1);
-	else if (target == 3)
-		model.addConstr(b95x == 1);
-	else if (target == 4)
-		model.addConstr(s13 == 1);
-	else if (target == 5)
-		model.addConstr(b12x == 1);
-	else if (target == 6)
-		model.addConstr(y == 0);
+		live[r] = fw[r] & t;
+		if (pinned && (r == opt.divRound))
+			live[r] &= opt.hint[r];
+	}
 
-  return y;
+	// hybrid mode: the variables of the initial state appearing in the live polynomials
+	if (r0 > 0) {
+		for (int i = 0; i < 256; i++) {
+			if (live[r0][i] == 0)
+				continue;
+			auto it = (*opt.prePoly)[i].begin();
+			while (it != (*opt.prePoly)[i].end()) {
+				live[0] |= (*it);
+				it++;
+			}
+		}
+	}
 
+	return live;
 }
 
-/***************************************
- * MILP model for the output function 
- ***************************************/
 /*
-The linear part of the output function
-LinearPart= s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89
-The parameter "target" corresponds to the "target" in "funcH" so 
--1 corresponds to the initialization phase, 
-1-5 corresponds to the 5 non-linear terms in h function so there is an additional y=0 constraint in the fundO
-6 corresponds the situation that regards the linear part as the output so there is and additional y=1 constraint in funcO
+Upper bound of the degree in the cube variables of every target by the numeric mapping, the 1st stage of the cube search (see triviumDegreeBound).
+A key bit, a const 1 bit or a padding bit has degree 0, an active bit 1 and a const 0 bit no degree (-1).
 @Para
-model: the MILP model
-b: the three-subset division property for the NFSR
-s: the three-subset division property for the LFSR
-target: the evaluation target: -1->initialization round, 6->ignore the non-linear part and only regard the linear parts as the output, 1-5->corresponds to the evaluation of b12s8,...,b12b94s94 separately
+cube, flag: same as grainThreeEnumuration
+return: the bound of the target j + 1 (see grainReachability), -1 if the term is always 0
 */
-GRBVar funcO(GRBModel& model, vector<GRBVar>& b, vector<GRBVar>& s, int target = -1) {
-  GRBVar s93 = tap(model, s[93]);
-  GRBVar b2 = tap(model, b[2]);
-  GRBVar b15 = tap(model, b[15]);
-  GRBVar b36 = tap(model, b[36]);
-  GRBVar b45 = tap(model, b[45]);
-  GRBVar b64 = tap(model, b[64]);
-  GRBVar b73 = tap(model, b[73]);
-  GRBVar b89 = tap(model, b[89]);
-
-  GRBVar y = model.addVar(0, 1, 0, GRB_BINARY);
-  model.addConstr(y == s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89);  
+static int grainMonomialDegree(const vector<vector<int>>& monomials, vector<int>& d, int cubeSize) {
+	int deg = -1;
+	for (int j = 0; j < monomials.size(); j++) {
+		int m = 0;
+		for (int k = 0; k < monomials[j].size(); k++) {
+			m = (d[monomials[j][k]] < 0) ? -1 : min(m + d[monomials[j][k]], cubeSize);
+			if (m < 0)
+				break;
+		}
+		deg = max(deg, m);
+	}
+	return deg;
+}
+vector<int> grainDegreeBound(vector<int>& cube, vector<int>& flag, int evalNumRounds) {
 
-	if (target == 6)
-		model.addConstr(y == 1);
-	else if (target >= 1)
-		model.addConstr(y == 0);
+	int cubeSize = 0;
+	vector<int> d(256, 0);
+	for (int i = 0; i < 96; i++) {
+		if (cube[i] == 1) {
+			d[128 + i] = 1;
+			cubeSize++;
+		}
+		else if (flag[128 + i] == 0) {
+			d[128 + i] = -1;
+		}
+	}
+	d[128 + 127] = -1;
+
+	for (int r = 0; r < evalNumRounds; r++) {
+		int z = max(grainMonomialDegree(grainMonomialH, d, cubeSize), grainMonomialDegree(grainMonomialO, d, cubeSize));
+		int f = grainMonomialDegree(grainMonomialF, d, cubeSize);
+		int g = grainMonomialDegree(grainMonomialG, d, cubeSize);
+		int s0 = d[128];
+		for (int i = 0; i < 127; i++) {
+			d[i] = d[i + 1];
+			d[128 + i] = d[128 + i + 1];
+		}
+		d[127] = max(max(z, g), s0);
+		d[128 + 127] = max(z, f);
+	}
 
-  return y;
+	vector<int> bound(6);
+	for (int j = 0; j < 5; j++) {
+		bound[4 - j] = grainMonomialDegree({ grainMonomialH[j] }, d, cubeSize);
+	}
+	bound[5] = grainMonomialDegree(grainMonomialO, d, cubeSize);
+	return bound;
 }
 
-/***************************************
- * MILP model for the F function
- ***************************************/
 /*
-The updating function of the LFSR
-f=s0 + s7 + s38 + s70 + s81 + s96
+The ANF of the state after r0 rounds over the initial state, indexed as grainReachability (NFSR in [0,128), LFSR in [128,256)).
+The key bits, the active bits and the flag 1 IV bits are variables, the flag 0 IV bits are substituted by 0 and the padding s[96..126] by 1,
+so the hybrid mode gives the same superpoly as the MILP, where the flag 1 IV bits are kept in the superpoly.
 @Para
-model: the MILP model
-s: the three-subset division property for the LFSR
+cube: the cube indices
+flag: the flag values of each state bit: secret 3, active 2, const 1, const 0
+r0: the number of rounds to be expanded
 */
-GRBVar funcF(GRBModel& model, vector<GRBVar>& s) {
-  GRBVar s0 = tap(model, s[0]);
-  GRBVar s7 = tap(model, s[7]);
-  GRBVar s38 = tap(model, s[38]);
-  GRBVar s70 = tap(model, s[70]);
-  GRBVar s81 = tap(model, s[81]);
-  GRBVar s96 = tap(model, s[96]);
-
-  GRBVar f = model.addVar(0, 1, 0, GRB_BINARY);
-  model.addConstr(f == s0 + s7 + s38 + s70 + s81 + s96);
-
-  return f;
+static anfPoly<256> grainMonomialANF(const vector<vector<int>>& monomials, vector<anfPoly<256>>& x) {
+	anfPoly<256> y;
+	for (int j = 0; j < monomials.size(); j++) {
+		anfPoly<256> m = x[monomials[j][0]];
+		for (int k = 1; k < monomials[j].size(); k++) {
+			m = anfMul(m, x[monomials[j][k]]);
+		}
+		anfAdd(y, m);
+	}
+	return y;
 }
+vector<anfPoly<256>> grainANF(vector<int>& cube, vector<int>& flag, int r0) {
 
-/***************************************
- * MILP model for the G function
- ***************************************/
-/*
-The updating function of the LFSR
-g=b0 + b26 + b56 + b91 + b96 + b3b67 + b11b13 + b17b18 + b27b59 + b40b48 + b61b65 + b68b84 + b88b92b93b95 + b22b24b25 + b70b78b82 
-@Para
-model: the MILP model
-b: the three-subset division property for the NFSR
-*/
-GRBVar funcG(GRBModel& model, vector<GRBVar>& b) {
-  // nonlinear
-  GRBVar b26 = tap(model, b[26]);
-  GRBVar b56 = tap(model, b[56]);
-  GRBVar b91 = tap(model, b[91]);
-  GRBVar b96 = tap(model, b[96]);
-
-  GRBVar b3 = tap(model, b[3]);
-  GRBVar b67 =  tap(model, b[67]);
-  model.addConstr(b3 == b67);
-
-  GRBVar b11 = tap(model, b[11]);
-  GRBVar b13 = tap(model, b[13]);
-  model.addConstr(b11 == b13);
-
-  GRBVar b17 = tap(model, b[17]);
-  GRBVar b18 = tap(model, b[18]);
-  model.addConstr(b17 == b18);
-
-  GRBVar b27=  tap(model, b[27]);
-  GRBVar b59= tap(model, b[59]);
-  model.addConstr(b27 == b59);
-
-  GRBVar b40=  tap(model, b[40]);
-  GRBVar b48=  tap(model, b[48]);
-  model.addConstr(b40 == b48);
-
-  GRBVar b61=  tap(model, b[61]);
-  GRBVar b65=  tap(model, b[65]);
-  model.addConstr(b61 == b65);
-
-  GRBVar b68=  tap(model, b[68]);
-  GRBVar b84=  tap(model, b[84]);
-  model.addConstr(b68 == b84);
-
-  GRBVar b88=  tap(model, b[88]);
-  GRBVar b92=  tap(model, b[92]);
-  GRBVar b93=  tap(model, b[93]);
-  GRBVar b95=  tap(model, b[95]);
-  model.addConstr(b88 == b92);
-  model.addConstr(b88 == b93);
-  model.addConstr(b88 == b95);
-
-  GRBVar b22=  tap(model, b[22]);
-  GRBVar b24=  tap(model, b[24]);
-  GRBVar b25=  tap(model, b[25]);
-  model.addConstr(b22 == b24);
-  model.addConstr(b22 == b25);
-
-  GRBVar b70=  tap(model, b[70]);
-  GRBVar b78=  tap(model, b[78]);
-  GRBVar b82=  tap(model, b[82]);
-  model.addConstr(b70 == b78);
-  model.addConstr(b70 == b82);
+	vector<anfPoly<256>> x(256);
+	for (int i = 0; i < 128; i++) {
+		x[i] = anfVar<256>(i);
+	}
+	for (int i = 0; i < 128; i++) {
+		if ((i < 96) && (cube[i] == 1))
+			x[128 + i] = anfVar<256>(128 + i);
+		else if ((i < 96) && (flag[128 + i] == 0))
+			x[128 + i] = anfConst<256>(0);
+		else if (i < 96)
+			x[128 + i] = anfVar<256>(128 + i);
+		else if (i < 127)
+			x[128 + i] = anfConst<256>(1);
+		else
+			x[128 + i] = anfConst<256>(0);
+	}
 
-  // nonlinear feed back
-  GRBVar g = model.addVar(0, 1, 0, GRB_BINARY);
-  model.addConstr(g == b[0] + b26 + b56 + b91 + b96 + b3 + b11 + b17 + b27 + b40 + b61 + b68 + b88 + b22 + b70);
+	for (int r = 0; r < r0; r++) {
+		anfPoly<256> y = grainMonomialANF(grainMonomialH, x);
+		anfAdd(y, grainMonomialANF(grainMonomialO, x));
+		anfPoly<256> f = grainMonomialANF(grainMonomialF, x);
+		anfPoly<256> g = grainMonomialANF(grainMonomialG, x);
+		anfAdd(g, x[128]);
+
+		anfAdd(f, y);
+		anfAdd(g, y);
+		for (int i = 0; i < 127; i++) {
+			x[i] = x[i + 1];
+			x[128 + i] = x[128 + i + 1];
+		}
+		x[127] = g;
+		x[128 + 127] = f;
+	}
 
-  return g;
+	return x;
 }
 
+/*
+Display the monomials u and J[u] stored in the countingBox
+*/
+void displayGrainBox(map<bitset<256>, int, cmpBitset256>& countingBox, vector<int>& cube, double dulation) {
+
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
 
+		cout << ((*it).second % 2) << " | " << (*it).second << "\t";
+
+		bitset<256> tmp = (*it).first;
+		for (int i = 0; i < 128; i++) {
+			if ((tmp[i] == 1)) {
+				cout << "k" << (i + 1) << " ";
+			}
+		}
+		for (int i = 0; i < 96; i++) {
+			if ((tmp[128 + i] == 1) && (cube[i] == 0)) {
+				cout << "v" << (i + 1) << " ";
+			}
+		}
+		for (int i = 96; i < 128; i++) {
+			if (tmp[128 + i] == 1) {
+				cout << "v" << (i + 1) << " ";
+			}
+		}
+		cout << endl;
 
+		it++;
+	}
+	cout << dulation << "sec" << endl;
+	cout << endl;
 
+}
 
 /*
-The main function for the three-subset division property attack on Grain128a
-@Para
-cube: the cube indices
-flag: the flag values of each state bit: secret 3, active 2, const 1, const 0
-evalNumRounds: the number of initialization rounds to be attacked
-countingBox: store the vector u and the corresponding trail number J[u]
-dulation: the solution time
-threadNumber: the number of threads used for solving the MILP model
-target: same with the "target" in funcH and funcO
-opt: the parameters used in the two-stage strategy
-*/
-int grainThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<256>, int, cmpBitset256>& countingBox, double& dulation, int threadNumber, int target = -1, struct twoStageGrain opt = { false, 0, });
-/*
-The class defining the callback strategy for enumerating the trails to acquire J[u]
+Display the superpoly: the cube bits and the padding bits are removed from the monomials u, and the monomials with odd J[u] (the superpoly) are listed before the cancelled ones.
+The non-cube IV bits regarded as undetermined constants (flag 1) are displayed as v.
 */
-class threeEnumurationGrain : public GRBCallback
-{
-public:
-	vector<int> cube;
-	vector<int> flag;
-	vector<vector<GRBVar>> s;
-	vector<vector<GRBVar>> b;
-	map<bitset<256>, int, cmpBitset256>* countingBox;
-	int threadNumber;
-	ofstream* outputfile;
-	int target;
-	threeEnumurationGrain(vector<int> xcube, vector<int> xflag, vector<vector<GRBVar>> xs, vector<vector<GRBVar>> xb, int xtarget, map<bitset<256>, int, cmpBitset256>* xcountingBox, int xthreadNumber, ofstream* xoutputfile) {
-		cube = xcube;
-		flag = xflag;
-		s = xs;
-		b = xb;
-		countingBox = xcountingBox;
-		threadNumber = xthreadNumber;
-		outputfile = xoutputfile;
-		target = xtarget;
-	}
-protected:
-	void callback() {
-		try {
-			if (where == GRB_CB_MIPSOL) {
-
-				int evalNumRounds = s.size() - 1;
-				int divRound = evalNumRounds / 2;
-
-				(*outputfile) << "\tfound \t divide in " << divRound << "\t" << getDoubleInfo(GRB_CB_RUNTIME) << "sec" << endl;
-
-
-				// store found solution into trail
-				vector<bitset<256>> trail(evalNumRounds + 1);
-				for (int r = 0; r <= evalNumRounds; r++) {
-					for (int i = 0; i < 128; i++) {
-						if (round(getSolution(b[r][i])) == 1) trail[r][i] = 1;
-						else trail[r][i] = 0;
-					}
-					for (int i = 0; i < 128; i++) {
-						if (round(getSolution(s[r][i])) == 1) trail[r][128 + i] = 1;
-						else trail[r][128 + i] = 0;
-					}
-				}
+void displayGrainSuperpoly(ostream& out, map<bitset<256>, int, cmpBitset256>& countingBox, vector<int>& cube) {
 
-				//
-				double dulation;
-				int solCnt = grainThreeEnumuration(cube, flag, evalNumRounds, *countingBox, dulation, threadNumber, target, { true, divRound, trail });
+	out << "*****************************" << endl;
+	out << "Final solution" << endl;
+	out << countingBox.size() << " solutions are found" << endl;
 
-				//
-				int solTotal = 0;
-				auto it = (*countingBox).begin();
-				while (it != (*countingBox).end()) {
-					solTotal += (*it).second;
-					it++;
-				}
-				(*outputfile) << "\t" << solCnt << "( total : " << solTotal << ")" << endl;
-				(*outputfile) << "\t" << (*countingBox).size() << " monomials are involved" << endl;
+	map<bitset<256>, int, cmpBitset256> countingBox2;
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
+		bitset<256> tmp = (*it).first;
+		for (int i = 0; i < 96; i++) {
+			if (cube[i] == 1) {
+				tmp[128 + i] = 0;
+			}
+		}
+		for (int i = 96; i < 128; i++) {
+			tmp[128 + i] = 0;
+		}
+		countingBox2[tmp] += (*it).second;
+		it++;
+	}
 
-				
-				// remove
-				GRBLinExpr addCon = 0;
+	for (int parity = 1; parity >= 0; parity--) {
+		out << ((parity == 1) ? "odd list" : "even list") << endl;
+		auto it2 = countingBox2.begin();
+		while (it2 != countingBox2.end()) {
+			if (((*it2).second % 2) == parity) {
+				out << ((*it2).second % 2) << " | " << (*it2).second << "\t";
+				bitset<256> tmp = (*it2).first;
 				for (int i = 0; i < 128; i++) {
-					if (trail[divRound][i] == 1) {
-						addCon += (1 - b[divRound][i]);
-					}
-					else {
-						addCon += b[divRound][i];
+					if ((tmp[i] == 1)) {
+						out << "k" << (i + 1) << " ";
 					}
 				}
-				for (int i = 0; i < 128; i++) {
-					if (trail[divRound][128 + i] == 1) {
-						addCon += (1 - s[divRound][i]);
-					}
-					else {
-						addCon += s[divRound][i];
+				for (int i = 0; i < 96; i++) {
+					if ((tmp[128 + i] == 1)) {
+						out << "v" << (i + 1) << " ";
 					}
 				}
-				addLazy(addCon >= 1);
-			}
-			else if (where == GRB_CB_MESSAGE) {
-				// Message callback
-				string msg = getStringInfo(GRB_CB_MSG_STRING);
-				(*outputfile) << msg << flush;
+				out << endl;
 			}
+			it2++;
+		}
+		out << endl;
+	}
+
+}
+
+/*
+The number of monomials of the superpoly (odd J[u] after the projection of displayGrainSuperpoly) and its degree
+*/
+static int grainSuperpolySize(map<bitset<256>, int, cmpBitset256>& countingBox, vector<int>& cube, int& degree) {
+
+	map<bitset<256>, int, cmpBitset256> countingBox2;
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
+		bitset<256> tmp = (*it).first;
+		for (int i = 0; i < 96; i++) {
+			if (cube[i] == 1)
+				tmp[128 + i] = 0;
 		}
-		catch (GRBException e) {
-			cerr << "Error number: " << e.getErrorCode() << endl;
-			cerr << e.getMessage() << endl;
+		for (int i = 96; i < 128; i++) {
+			tmp[128 + i] = 0;
 		}
-		catch (...) {
-			cerr << "Error during callback" << endl;
+		countingBox2[tmp] += (*it).second;
+		it++;
+	}
+
+	int monomials = 0;
+	degree = 0;
+	auto it2 = countingBox2.begin();
+	while (it2 != countingBox2.end()) {
+		if (((*it2).second % 2) == 1) {
+			monomials++;
+			degree = max(degree, (int)(*it2).first.count());
 		}
+		it2++;
 	}
-};
-int grainThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<256>, int, cmpBitset256>& countingBox, double& dulation, int threadNumber, int target, struct twoStageGrain opt) {
+	return monomials;
 
+}
 
-	//
-	ofstream outputfile;
-	if ((opt.useTwoStage == true) && (opt.hint.size() == 0)) {
-		outputfile.open("log_grain128a.txt", ios::app);
+/*
+The predecessors of the state vector k at round r+1 by one round of the MILP model in grainThreeEnumuration.
+The new LFSR bit comes from z (z1) or a term of f, and the new NFSR bit from z (z2), a term of g or the remainder of s0.
+If z is used, it comes from one of the terms of h and the linear part, and (s0, z) = (1,1) is removed as in the MILP model.
+*/
+void grainBackward(const bitset<256>& k, vector<bitset<256>>& pred) {
+
+	bitset<256> base;
+	for (int i = 0; i < 127; i++) {
+		base[i + 1] = k[i];
+		base[128 + i + 1] = k[128 + i];
 	}
-	else if ((opt.useTwoStage == true) && (opt.hint.size() > 0)) {
-		outputfile.open("log_grain128a2.txt", ios::app);
+	bool newb = k[127];
+	bool news = k[128 + 127];
+
+	// -1: z, otherwise the index of the term (the remainder of s0 is the last one for the NFSR)
+	vector<int> optS = { 0 };
+	vector<int> optB = { 0 };
+	if (news) {
+		optS.clear();
+		for (int j = -1; j < (int)grainMonomialF.size(); j++)
+			optS.push_back(j);
 	}
-	else {
-		outputfile.open("log_grain128a.txt", ios::app);
+	if (newb) {
+		optB.clear();
+		for (int j = -1; j <= (int)grainMonomialG.size(); j++)
+			optB.push_back(j);
 	}
 
+	for (int e1 = 0; e1 < optS.size(); e1++) {
+		for (int e2 = 0; e2 < optB.size(); e2++) {
+			bitset<256> x = base;
+			bool z = false;
+			if (news) {
+				if (optS[e1] == -1)
+					z = true;
+				else
+					for (int i : grainMonomialF[optS[e1]]) x[i] = 1;
+			}
+			if (newb) {
+				if (optB[e2] == -1)
+					z = true;
+				else if (optB[e2] == grainMonomialG.size())
+					x[128] = 1;
+				else
+					for (int i : grainMonomialG[optB[e2]]) x[i] = 1;
+			}
 
-	//
-	if (opt.useTwoStage == true) {
-		if (opt.hint.size() == 0) {
-			outputfile << endl;
-			outputfile << "++++++++++++++++++++++++++++" << endl;
-			outputfile << "1st stage" << endl;
-		}
-		else {
-			outputfile << "---" << endl;
-			outputfile << "2nd stage" << endl;
+			if (z == false) {
+				pred.push_back(x);
+				continue;
+			}
+			for (int j = 0; j < grainMonomialH.size() + grainMonomialO.size(); j++) {
+				bitset<256> y = x;
+				const vector<int>& m = (j < grainMonomialH.size()) ? grainMonomialH[j] : grainMonomialO[j - grainMonomialH.size()];
+				for (int i : m) y[i] = 1;
+				if (y[128] == 0)
+					pred.push_back(y);
+			}
 		}
 	}
 
+}
+
+/*
+Solver-free counterpart of grainThreeEnumuration.
+The division trails are counted by the backward expansion from the output monomials selected by target to round 0 (see native.h).
+A state vector at round r is dropped if it contains a bit which is not live (see grainReachability),
+or if the upper bound of its degree in the cube variables (numeric mapping) is smaller than the cube size.
+The countingBox is filled with the same u and J[u] as grainThreeEnumuration.
+@Para
+cube, flag, evalNumRounds, countingBox, dulation, threadNumber, target: same as grainThreeEnumuration
+parity: if true, only the parity of J[u] is counted, which removes the cancelled vectors from the frontier
+divRound: if positive, the expansion from the output stops at divRound (or earlier if the frontier is larger than memLimit),
+  and the midpoints are expanded to round 0 in batches (see nativeMidpoints)
+memLimit: the number of vectors of a frontier kept in memory in the batched expansion
+quiet: if true, the result is not displayed (see twoStageGrain)
+return: the number of division trails
+*/
+int grainNativeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<256>, int, cmpBitset256>& countingBox, double& dulation, int threadNumber, int target = -1, bool parity = false, int divRound = 0, long long memLimit = nativeMemLimit, bool quiet = false) {
+
+	logStream outputfile("log_grain128a.txt");
+	outputfile << endl;
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << "native " << evalNumRounds << " rounds, target " << target << ", divRound " << divRound << endl;
 
-	//gurobi
-	try {
-		// Create the environment
-		GRBEnv env = GRBEnv();
+	auto start = chrono::steady_clock::now();
+	metricsJob metrics("grain128a native " + to_string(evalNumRounds) + " target " + to_string(target), 3, threadNumber);
 
-		// close standard output
-		env.set(GRB_IntParam_LogToConsole, 0);
-		env.set(GRB_IntParam_Threads, threadNumber);
-		//env.set(GRB_IntParam_MIPFocus, GRB_MIPFOCUS_BESTBOUND);
+	// live bits
+	struct twoStageGrain opt;
+	vector<bitset<256>> live = grainReachability(cube, flag, evalNumRounds, target, opt);
 
-		if ((opt.useTwoStage == true) && (opt.hint.size() == 0)) {
-			env.set(GRB_IntParam_LazyConstraints, 1);
+	// upper bound of the degree in the cube variables
+	int cubeSize = 0;
+	bitset<256> cubeMask;
+	for (int i = 0; i < 96; i++) {
+		if (cube[i] == 1) {
+			cubeSize++;
+			cubeMask[128 + i] = 1;
 		}
-		else if ((opt.useTwoStage == true) && (opt.hint.size() > 0)) {
-			env.set(GRB_StringParam_LogFile, "log_grain128a2.txt");
-			env.set(GRB_IntParam_PoolSearchMode, 2);
-			env.set(GRB_IntParam_PoolSolutions, 2000000000);
-			env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
+	}
+	auto degMonomials = [&](const vector<vector<int>>& monomials, vector<int>& d) {
+		int m = 0;
+		for (int j = 0; j < monomials.size(); j++) {
+			int t = 0;
+			for (int i : monomials[j]) t += d[i];
+			m = max(m, t);
 		}
-		else {
-			env.set(GRB_StringParam_LogFile, "log_grain128a.txt");
-			env.set(GRB_IntParam_PoolSearchMode, 2);
-			env.set(GRB_IntParam_PoolSolutions, 2000000000);
-			env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
+		return m;
+	};
+	vector<vector<int>> deg(evalNumRounds + 1, vector<int>(256, 0));
+	for (int i = 0; i < 256; i++) {
+		deg[0][i] = cubeMask[i];
+	}
+	for (int r = 0; r < evalNumRounds; r++) {
+		int z = max(degMonomials(grainMonomialH, deg[r]), degMonomials(grainMonomialO, deg[r]));
+		int f = degMonomials(grainMonomialF, deg[r]);
+		int g = degMonomials(grainMonomialG, deg[r]);
+		for (int i = 0; i < 127; i++) {
+			deg[r + 1][i] = deg[r][i + 1];
+			deg[r + 1][128 + i] = deg[r][128 + i + 1];
 		}
+		deg[r + 1][127] = min(max(max(z, g), deg[r][128]), cubeSize);
+		deg[r + 1][128 + 127] = min(max(z, f), cubeSize);
+	}
 
-		// Create the model
-		GRBModel model = GRBModel(env);
+	// the output monomials at the last round
+	int numShards = 4 * max(threadNumber, 1);
+	nativeFrontier<256> frontier(numShards);
+	vector<vector<int>> outputs;
+	for (int j = 0; j < 5; j++) {
+		if ((target == -1) || (target == 5 - j))
+			outputs.push_back(grainMonomialH[j]);
+	}
+	for (int j = 0; j < grainMonomialO.size(); j++) {
+		if ((target == -1) || (target == 6))
+			outputs.push_back(grainMonomialO[j]);
+	}
+	for (int j = 0; j < outputs.size(); j++) {
+		bitset<256> k;
+		for (int i : outputs[j]) k[i] = 1;
+		if ((k & ~live[evalNumRounds]).none())
+			frontier[hash<bitset<256>>()(k) % numShards][k] += 1;
+	}
 
-		// Create variables
-		vector<vector<GRBVar>> s(evalNumRounds + 1, vector<GRBVar>(128));
-		vector<vector<GRBVar>> b(evalNumRounds + 1, vector<GRBVar>(128));
-		for (int i = 0; i < 128; i++) {
-			s[0][i] = model.addVar(0, 1, 0, GRB_BINARY);
-			b[0][i] = model.addVar(0, 1, 0, GRB_BINARY);
+	// backward expansion
+	auto keep = [&](int r, const bitset<256>& k) {
+		if ((k & ~live[r]).any())
+			return false;
+		if ((r == 0) && ((k & cubeMask) != cubeMask))
+			return false;
+		int d = 0;
+		for (int i = 0; (i < 256) && (d < cubeSize); i++) {
+			if (k[i] == 1)
+				d += deg[r][i];
 		}
-
-		// IV constraint
-		for (int i = 0; i < 96; i++) {
-			if (cube[i] == 1)
-				model.addConstr(s[0][i] == 1);
-			else if (flag[128 + i] == 0)
-				model.addConstr(s[0][i] == 0);
+		return (d >= cubeSize);
+	};
+	// with divRound, the expansion also stops at the first round whose frontier is larger than memLimit
+	int midRound = divRound;
+	for (int r = evalNumRounds - 1; r >= divRound; r--) {
+		frontier = nativeExpand(frontier, grainBackward, [&](const bitset<256>& k) { return keep(r, k); }, threadNumber, parity);
+		outputfile << r << "\t" << nativeSize(frontier) << endl;
+		if ((divRound > 0) && (r > divRound) && ((long long)nativeSize(frontier) > memLimit)) {
+			midRound = r;
+			break;
 		}
-		model.addConstr(s[0][127] == 0);
-
-
-
-		// Round function
-		for (int r = 0; r <= evalNumRounds; r++) {
-			vector<GRBVar> tmpb = b[r];
-			vector<GRBVar> tmps = s[r];
+	}
 
-			if (r < evalNumRounds) {
-				GRBVar h = funcH(model, tmpb, tmps);
-				GRBVar o = funcO(model, tmpb, tmps);
+	// batched expansion of the midpoints below midRound
+	long long midpoints = 0;
+	if (divRound > 0) {
+		midpoints = nativeSize(frontier);
+		if (nativeSize(frontier) > memLimit)
+			outputfile << nativeSize(frontier) << " midpoints at round " << midRound << " are split and spilled to disk" << endl;
+		frontier = nativeMidpoints(frontier, midRound, grainBackward, keep, threadNumber, parity, memLimit, "native_grain_spill");
+		outputfile << "midpoints\t" << nativeSize(frontier) << endl;
+	}
 
-				GRBVar z = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(z == h + o);
+	metrics.phase("solve", { { "midpoints", midpoints } });
 
-				GRBVar z1 = model.addVar(0, 1, 0, GRB_BINARY);
-				GRBVar z2 = model.addVar(0, 1, 0, GRB_BINARY);
-				GRBVar tmpVar[2] = { z1,z2 };
-				model.addGenConstrOr(z, tmpVar, 2);
+	// store the information about solutions
+	long long solCount = 0;
+	for (int sh = 0; sh < numShards; sh++) {
+		auto it = frontier[sh].begin();
+		while (it != frontier[sh].end()) {
+			countingBox[(*it).first] += (*it).second;
+			solCount += (*it).second;
+			it++;
+		}
+	}
+	dulation = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	outputfile << solCount << " trails\t" << dulation << "sec" << endl;
+	metrics.phase("extract", { { "solutions", solCount }, { "monomials", countingBox.size() } });
 
-				GRBVar f = funcF(model, tmps);
-				GRBVar g = funcG(model, tmpb);
+	// disp
+	if (!quiet)
+		displayGrainBox(countingBox, cube, dulation);
 
-				GRBVar news = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(news == z1 + f);
+	return solCount;
+}
 
-				GRBVar newb = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(newb == z2 + g + tmps[0]);
+/*
+The solver-free counterpart of grainManifestJob for the regression benchmark (engine=native, see regress.h).
+The targets of the job are counted one after another by grainNativeEnumuration (with the batched expansion of the midpoints at div= if given, pre= is not used)
+and the superpoly is written into job.out in the format of grainManifestJob.
+return: 0, or 1 if the result file cannot be written
+*/
+int grainNativeJob(struct manifestJob& job, int threadNumber) {
 
-				for (int i = 0; i < 127; i++) {
-					b[r + 1][i] = tmpb[i + 1];
-					s[r + 1][i] = tmps[i + 1];
-				}
-				b[r + 1][127] = newb;
-				s[r + 1][127] = news;
+	// constant (secret 3, active 2, const 1, const 0)
+	vector<int> cube(96, 0);
+	vector<int> flag(256, 0);
+	for (int i = 0; i < 128; i++) {
+		flag[i] = 3;
+	}
+	for (int i = 0; i < job.consts.size(); i++) {
+		flag[128 + job.consts[i]] = 1;
+	}
+	for (int i = 0; i < job.cube.size(); i++) {
+		cube[job.cube[i]] = 1;
+		flag[128 + job.cube[i]] = 2;
+	}
+	for (int i = 96; i < 127; i++) {
+		flag[128 + i] = 1;
+	}
+
+	map<bitset<256>, int, cmpBitset256> countingBox;
+	for (int j = 0; j < job.targets.size(); j++) {
+		double dulation = 0;
+		grainNativeEnumuration(cube, flag, job.rounds, countingBox, dulation, threadNumber, job.targets[j], true, job.divRound, nativeMemLimit, true);
+	}
+
+	ofstream outputfile(job.out);
+	outputfile << "# grain " << job.rounds << " cube=" << job.cubeText << " const=" << job.constText << " div=" << job.divRound << " engine=native" << endl;
+	displayGrainSuperpoly(outputfile, countingBox, cube);
+	return outputfile ? 0 : 1;
+
+}
+
+
+/***************************************
+ * MILP model for each components
+ ***************************************/
+/*
+The COPY x -> (y_1, ..., y_n) in the formulation of stat (see Formulation in envpool.h)
+general: x = y_1 | ... | y_n as a general constraint
+linear, merged: y_i <= x and y_1 + ... + y_n >= x
+*/
+static void grainCopy(divBackend& solver, int& x, vector<int> ys, struct pruneStat& stat) {
+
+  if ((stat.formulation == "linear") || (stat.formulation == "merged")) {
+    solver.addOr(x, ys, true);
+    stat.constrs++;
+  }
+  else {
+    solver.addOr(x, ys);
+    stat.genConstrs++;
+  }
+
+}
+
+/*
+The tap operation of NLFSRs. It corresponds to the COPY operation of division property:
+A variable x is first copied to x->(y,z). x is replaced with z and y will be involved in other operations (such as AND, XOR etc.)
+If x is the fixed variable "zero" or the tapped branch can never be nonzero (see grainReachability), nothing is generated and zero is returned.
+In the formulation "merged", y is only recorded in stat.pending and x is replaced by grainFlushTaps at the end of the round,
+so a bit tapped several times in one round gets one COPY instead of a chain.
+@Para
+solver: the backend of the MILP model (see backend.h)
+x: the 3-subset division property of the variable to be tapped.
+zero: the variable fixed to 0
+branch: false if y can never be nonzero
+stat: counts the generated variables and constraints
+into: if not NULL and the formulation is "merged", this variable is used as y (the monomial of tapMonomial)
+*/
+int tap(divBackend& solver, int& x, int zero, bool branch, struct pruneStat& stat, int* into = NULL) {
+
+  if ((branch == false) || (x == zero))
+    return zero;
+
+  if (stat.formulation == "merged") {
+    int y;
+    if (into != NULL) {
+      y = *into;
+    }
+    else {
+      y = solver.addVar();
+      stat.vars++;
+    }
+    int j = 0;
+    while ((j < stat.pending.size()) && (stat.pending[j].first != &x))
+      j++;
+    if (j == stat.pending.size())
+      stat.pending.push_back(make_pair(&x, vector<int>()));
+    stat.pending[j].second.push_back(y);
+    return y;
+  }
+
+  int y = solver.addVar();
+  int z = solver.addVar();
+  grainCopy(solver, x, { y, z }, stat);
+  x = z;
+  stat.vars += 2;
+  return y;
+
+}
+
+/*
+Emit the merged COPY x -> (y_1, ..., y_n, z) of every bit tapped in this round and replace x with z (formulation "merged")
+*/
+static void grainFlushTaps(divBackend& solver, struct pruneStat& stat) {
+
+  for (int j = 0; j < stat.pending.size(); j++) {
+    int z = solver.addVar();
+    stat.vars++;
+    stat.pending[j].second.push_back(z);
+    grainCopy(solver, *stat.pending[j].first, stat.pending[j].second, stat);
+    *stat.pending[j].first = z;
+  }
+  stat.pending.clear();
+
+}
+
+/*
+Tap all factors of one monomial. The factors of a monomial take the same value in the 3-subset division property, so the first tapped variable represents the monomial.
+If a factor is zero or the destination of the monomial is dead, no factor is tapped and zero is returned.
+In the formulation "merged", the other factors are tapped directly into the monomial, without their own variables and the equalities.
+If ands is not NULL, the variable of the monomial is appended (see AndPriority in envpool.h).
+*/
+int tapMonomial(divBackend& solver, vector<int*> factors, int zero, bool branch, struct pruneStat& stat, vector<int>* ands = NULL) {
+
+  for (int i = 0; i < factors.size(); i++) {
+    if (*factors[i] == zero)
+      branch = false;
+  }
+  if (branch == false)
+    return zero;
+
+  int m = tap(solver, *factors[0], zero, true, stat);
+  for (int i = 1; i < factors.size(); i++) {
+    if (stat.formulation == "merged") {
+      tap(solver, *factors[i], zero, true, stat, &m);
+      continue;
+    }
+    int y = tap(solver, *factors[i], zero, true, stat);
+    solver.addEqual(m, y);
+    stat.constrs++;
+  }
+  if (ands != NULL)
+    ands->push_back(m);
+  return m;
+
+}
+
+/*
+The XOR of the terms. Terms fixed to zero are dropped, and a single remaining term is returned without a new variable.
+*/
+int xorTerms(divBackend& solver, vector<int> terms, int zero, struct pruneStat& stat) {
+
+  vector<int> live;
+  for (int i = 0; i < terms.size(); i++) {
+    if (terms[i] != zero)
+      live.push_back(terms[i]);
+  }
+
+  if (live.size() == 0)
+    return zero;
+  else if (live.size() == 1)
+    return live[0];
+
+  int y = solver.addVar();
+  solver.addSum(y, live);
+  stat.vars++;
+  stat.constrs++;
+  return y;
+
+}
+
+
+
+/***************************************
+ * MILP model for the H function
+ ***************************************/
+/*
+The h function of the Grain-128a stream cihper--the non-linear part of the output function z=h+LinearPart
+h= b12s8 + s13s20 + b95s42 + s60s79 + b12b95s94
+An additional parameter "target" is introduced enabling to evaluate the division property of each term b12s8, s12s20 ... separately.
+For example, if we set target=1, we regard the the output bit as z'=b12s8 so the corresponding superpoly is only related to b12s8. 
+target=2,...5 corresponds to the rest terms s13s20,..., b12b95s94
+target=6 corresponds to the linear part of the output function
+target=-1 is used during the initialization phase.
+@Para
+solver: the backend of the MILP model (see backend.h)
+b: the three-subset division property for the NFSR
+s: the three-subset division property for the LFSR
+zero, stat: see tap
+out: false if the output of h can never be nonzero
+target: the evaluation target: -1->initialization round, 6->ignore the non-linear part and only regard the linear parts as the output, 1-5->corresponds to the evaluation of b12s8,...,b12b94s94 separately
+ands: see tapMonomial
+*/
+int funcH(divBackend& solver, vector<int>& b, vector<int>& s, int zero, bool out, struct pruneStat& stat, int target = -1, vector<int>* ands = NULL) {
+
+  int b12x = tapMonomial(solver, { &b[12], &s[8] }, zero, out && ((target == -1) || (target == 5)), stat, ands);
+  int s13 = tapMonomial(solver, { &s[13], &s[20] }, zero, out && ((target == -1) || (target == 4)), stat, ands);
+  int b95x = tapMonomial(solver, { &b[95], &s[42] }, zero, out && ((target == -1) || (target == 3)), stat, ands);
+  int s60 = tapMonomial(solver, { &s[60], &s[79] }, zero, out && ((target == -1) || (target == 2)), stat, ands);
+  int b12y = tapMonomial(solver, { &b[12], &b[95], &s[94] }, zero, out && ((target == -1) || (target == 1)), stat, ands);
+
+  int y = xorTerms(solver, { b12x, s13, b95x, s60, b12y }, zero, stat);
+
+	// the terms other than the target are not generated, so only the target term is fixed
+	if (target == 1)
+		solver.fix(b12y, 1);
+	else if (target == 2)
+		solver.fix(s60, 1);
+	else if (target == 3)
+		solver.fix(b95x, 1);
+	else if (target == 4)
+		solver.fix(s13, 1);
+	else if (target == 5)
+		solver.fix(b12x, 1);
+
+  return y;
+
+}
+
+/***************************************
+ * MILP model for the output function 
+ ***************************************/
+/*
+The linear part of the output function
+LinearPart= s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89
+The parameter "target" corresponds to the "target" in "funcH" so 
+-1 corresponds to the initialization phase, 
+1-5 corresponds to the 5 non-linear terms in h function so the linear part is not generated (y=0)
+6 corresponds the situation that regards the linear part as the output so there is and additional y=1 constraint in funcO
+@Para
+solver: the backend of the MILP model (see backend.h)
+b: the three-subset division property for the NFSR
+s: the three-subset division property for the LFSR
+zero, out, stat: see funcH
+target: the evaluation target: -1->initialization round, 6->ignore the non-linear part and only regard the linear parts as the output, 1-5->corresponds to the evaluation of b12s8,...,b12b94s94 separately
+*/
+int funcO(divBackend& solver, vector<int>& b, vector<int>& s, int zero, bool out, struct pruneStat& stat, int target = -1) {
+  bool branch = out && ((target == -1) || (target == 6));
+  int s93 = tap(solver, s[93], zero, branch, stat);
+  int b2 = tap(solver, b[2], zero, branch, stat);
+  int b15 = tap(solver, b[15], zero, branch, stat);
+  int b36 = tap(solver, b[36], zero, branch, stat);
+  int b45 = tap(solver, b[45], zero, branch, stat);
+  int b64 = tap(solver, b[64], zero, branch, stat);
+  int b73 = tap(solver, b[73], zero, branch, stat);
+  int b89 = tap(solver, b[89], zero, branch, stat);
+
+  int y = xorTerms(solver, { s93, b2, b15, b36, b45, b64, b73, b89 }, zero, stat);
+
+	if (target == 6)
+		solver.fix(y, 1);
+
+  return y;
+}
+
+/***************************************
+ * MILP model for the F function
+ ***************************************/
+/*
+The updating function of the LFSR
+f=s0 + s7 + s38 + s70 + s81 + s96
+@Para
+solver: the backend of the MILP model (see backend.h)
+s: the three-subset division property for the LFSR
+zero, out, stat: see funcH
+*/
+int funcF(divBackend& solver, vector<int>& s, int zero, bool out, struct pruneStat& stat) {
+  int s0 = tap(solver, s[0], zero, out, stat);
+  int s7 = tap(solver, s[7], zero, out, stat);
+  int s38 = tap(solver, s[38], zero, out, stat);
+  int s70 = tap(solver, s[70], zero, out, stat);
+  int s81 = tap(solver, s[81], zero, out, stat);
+  int s96 = tap(solver, s[96], zero, out, stat);
+
+  return xorTerms(solver, { s0, s7, s38, s70, s81, s96 }, zero, stat);
+}
+
+/***************************************
+ * MILP model for the G function
+ ***************************************/
+/*
+The updating function of the LFSR
+g=b0 + b26 + b56 + b91 + b96 + b3b67 + b11b13 + b17b18 + b27b59 + b40b48 + b61b65 + b68b84 + b88b92b93b95 + b22b24b25 + b70b78b82 
+@Para
+solver: the backend of the MILP model (see backend.h)
+b: the three-subset division property for the NFSR
+zero, out, stat, ands: see funcH
+*/
+int funcG(divBackend& solver, vector<int>& b, int zero, bool out, struct pruneStat& stat, vector<int>* ands = NULL) {
+  // linear
+  int b26 = tap(solver, b[26], zero, out, stat);
+  int b56 = tap(solver, b[56], zero, out, stat);
+  int b91 = tap(solver, b[91], zero, out, stat);
+  int b96 = tap(solver, b[96], zero, out, stat);
+
+  // nonlinear
+  int b3 = tapMonomial(solver, { &b[3], &b[67] }, zero, out, stat, ands);
+  int b11 = tapMonomial(solver, { &b[11], &b[13] }, zero, out, stat, ands);
+  int b17 = tapMonomial(solver, { &b[17], &b[18] }, zero, out, stat, ands);
+  int b27 = tapMonomial(solver, { &b[27], &b[59] }, zero, out, stat, ands);
+  int b40 = tapMonomial(solver, { &b[40], &b[48] }, zero, out, stat, ands);
+  int b61 = tapMonomial(solver, { &b[61], &b[65] }, zero, out, stat, ands);
+  int b68 = tapMonomial(solver, { &b[68], &b[84] }, zero, out, stat, ands);
+  int b88 = tapMonomial(solver, { &b[88], &b[92], &b[93], &b[95] }, zero, out, stat, ands);
+  int b22 = tapMonomial(solver, { &b[22], &b[24], &b[25] }, zero, out, stat, ands);
+  int b70 = tapMonomial(solver, { &b[70], &b[78], &b[82] }, zero, out, stat, ands);
+
+  // nonlinear feed back
+  return xorTerms(solver, { b[0], b26, b56, b91, b96, b3, b11, b17, b27, b40, b61, b68, b88, b22, b70 }, zero, stat);
+}
+
+
+/*
+Hybrid mode: the first preRound rounds are replaced by the ANF of the state at preRound.
+If a state bit at preRound is 1, exactly one monomial of its polynomial is chosen, and the initial state is the union of the chosen monomials.
+As in triviumPreRound, the parity of the number of solutions for each initial state is the parity of the number of trails through the omitted rounds.
+@Para
+solver: the backend of the MILP model (see backend.h)
+b, s: the variables of each round. The initial state and the state at preRound are filled in this function
+live: the result of grainReachability
+zero: the variable fixed to 0
+prePoly: the ANF of the state at preRound
+stat: counts the generated variables and constraints
+*/
+void grainPreRound(divBackend& solver, vector<vector<int>>& b, vector<vector<int>>& s, vector<bitset<256>>& live, int zero, int preRound, vector<anfPoly<256>>& prePoly, struct pruneStat& stat) {
+
+	for (int r = 0; r < preRound; r++) {
+		for (int i = 0; i < 128; i++) {
+			b[r][i] = zero;
+			s[r][i] = zero;
+		}
+	}
+	vector<int> x0(256, zero);
+	for (int i = 0; i < 256; i++) {
+		if (live[0][i] == 1) {
+			x0[i] = solver.addVar();
+			stat.vars++;
+		}
+	}
+
+	// choose one monomial for each active bit at preRound
+	vector<int> xr(256, zero);
+	vector<vector<int>> cover(256);
+	for (int i = 0; i < 256; i++) {
+		if (live[preRound][i] == 0)
+			continue;
+		xr[i] = solver.addVar();
+		stat.vars++;
+
+		vector<int> choice;
+		auto it = prePoly[i].begin();
+		while (it != prePoly[i].end()) {
+			int m = solver.addVar();
+			stat.vars++;
+			choice.push_back(m);
+			for (int j = 0; j < 256; j++) {
+				if ((*it)[j] == 1) {
+					// m <= x0[j]
+					solver.addClause({ -(m + 1), x0[j] + 1 });
+					stat.constrs++;
+					cover[j].push_back(m + 1);
+				}
+			}
+			it++;
+		}
+		solver.addSum(xr[i], choice);
+		stat.constrs++;
+	}
+
+	// the initial state is the union of the chosen monomials
+	for (int j = 0; j < 256; j++) {
+		if (x0[j] != zero) {
+			cover[j].push_back(-(x0[j] + 1));
+			solver.addClause(cover[j]);
+			stat.constrs++;
+		}
+	}
+
+	for (int i = 0; i < 128; i++) {
+		b[0][i] = x0[i];
+		s[0][i] = x0[128 + i];
+		b[preRound][i] = xr[i];
+		s[preRound][i] = xr[128 + i];
+	}
+
+}
+
+
+
+
+/*
+One initialization round of the MILP model: the state (bIn, sIn) of round r is updated to (bOut, sOut) of round r + 1.
+The taps are applied to copies, so bIn and sIn keep the variables of round r.
+@Para
+liveOut: the live bits of round r + 1 (see grainReachability)
+zero, stat, ands: see funcH
+*/
+static void grainRound(divBackend& solver, vector<int>& bIn, vector<int>& sIn, vector<int>& bOut, vector<int>& sOut, bitset<256>& liveOut, int zero, struct pruneStat& stat, vector<int>* ands) {
+
+	vector<int> tmpb = bIn;
+	vector<int> tmps = sIn;
+	bool newbLive = liveOut[127];
+	bool newsLive = liveOut[128 + 127];
+
+	int h = funcH(solver, tmpb, tmps, zero, newbLive || newsLive, stat, -1, ands);
+	int o = funcO(solver, tmpb, tmps, zero, newbLive || newsLive, stat);
+
+	int z = xorTerms(solver, { h, o }, zero, stat);
+
+	// z is copied to the LFSR (z1) and the NFSR (z2)
+	int z1 = zero;
+	int z2 = zero;
+	if (z == zero) {
+	}
+	else if (newsLive && newbLive) {
+		z1 = solver.addVar();
+		z2 = solver.addVar();
+		grainCopy(solver, z, { z1, z2 }, stat);
+		stat.vars += 2;
+	}
+	else if (newsLive) {
+		z1 = z;
+	}
+	else {
+		z2 = z;
+	}
+
+	int f = funcF(solver, tmps, zero, newsLive, stat);
+	int g = funcG(solver, tmpb, zero, newbLive, stat, ands);
+	grainFlushTaps(solver, stat);
+
+	int news = zero;
+	if (newsLive)
+		news = xorTerms(solver, { z1, f }, zero, stat);
+
+	int newb = zero;
+	if (newbLive)
+		newb = xorTerms(solver, { z2, g, tmps[0] }, zero, stat);
+
+	for (int i = 0; i < 127; i++) {
+		bOut[i] = tmpb[i + 1];
+		sOut[i] = tmps[i + 1];
+	}
+	bOut[127] = newb;
+	sOut[127] = news;
+
+	// remove (s0, z) = (1,1) 
+	if ((sIn[0] != zero) && (z != zero)) {
+		solver.addClause({ -(sIn[0] + 1), -(z + 1) });
+		stat.constrs++;
+	}
+
+	// the remaining copies which can never be nonzero
+	if ((newbLive == false) && (tmps[0] != zero))
+		solver.fix(tmps[0], 0);
+	for (int i = 0; i < 128; i++) {
+		if ((liveOut[i] == 0) && (bOut[i] != zero)) {
+			solver.fix(bOut[i], 0);
+			bOut[i] = zero;
+		}
+		if ((liveOut[128 + i] == 0) && (sOut[i] != zero)) {
+			solver.fix(sOut[i], 0);
+			sOut[i] = zero;
+		}
+	}
+
+}
+
+/*
+The output layer after the last round: z = 1 for the target and all other bits of the state are 0.
+The taps are applied to copies of b and s (see grainSweep)
+*/
+static void grainOutput(divBackend& solver, vector<int> b, vector<int> s, int zero, int target, struct pruneStat& stat, vector<int>* ands) {
+
+	int h = funcH(solver, b, s, zero, true, stat, target, ands);
+	int o = funcO(solver, b, s, zero, true, stat, target);
+	grainFlushTaps(solver, stat);
+
+	int z = xorTerms(solver, { h, o }, zero, stat);
+
+	solver.fix(z, 1);
+
+	for (int i = 0; i < 128; i++) {
+		if (b[i] != zero)
+			solver.fix(b[i], 0);
+		if (s[i] != zero)
+			solver.fix(s[i], 0);
+	}
+
+}
+
+
+
+
+/*
+The main function for the three-subset division property attack on Grain128a
+@Para
+cube: the cube indices
+flag: the flag values of each state bit: secret 3, active 2, const 1, const 0
+evalNumRounds: the number of initialization rounds to be attacked
+countingBox: store the vector u and the corresponding trail number J[u]
+dulation: the solution time
+threadNumber: the number of threads used for solving the MILP model
+target: same with the "target" in funcH and funcO
+opt: the parameters used in the two-stage strategy
+The model is built on the backend of opt (see backend.h), and the 1st stage cuts off every trail by the lazy clause of its divRound layer
+*/
+int grainThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<256>, int, cmpBitset256>& countingBox, double& dulation, int threadNumber, int target = -1, struct twoStageGrain opt = twoStageGrain());
+int grainThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<256>, int, cmpBitset256>& countingBox, double& dulation, int threadNumber, int target, struct twoStageGrain opt) {
+
+
+	// the log of the job (see asynclog.h)
+	logStream outputfile(((opt.useTwoStage == true) && (opt.hint.size() > 0)) ? "log_grain128a2.txt" : "log_grain128a.txt");
+
+
+	//
+	if (opt.useTwoStage == true) {
+		if (opt.hint.size() == 0) {
+			outputfile << endl;
+			outputfile << "++++++++++++++++++++++++++++" << endl;
+			outputfile << "1st stage" << endl;
+		}
+		else {
+			outputfile << "---" << endl;
+			outputfile << "2nd stage" << endl;
+		}
+	}
+
+
+	// metrics of the solve (see metrics.h): stage 0 (single stage), 1 or 2. A 2nd stage is a child of its 1st stage
+	int stage = (opt.useTwoStage == false) ? 0 : ((opt.hint.size() == 0) ? 1 : 2);
+	metricsJob metrics("grain128a " + to_string(evalNumRounds) + " target " + to_string(target), stage, threadNumber, opt.parent);
+
+	// the backend with the environment of the profile
+	string profile = "grain128a";
+	if ((opt.useTwoStage == true) && (opt.hint.size() == 0))
+		profile = "grain128a1";
+	else if ((opt.useTwoStage == true) && (opt.hint.size() > 0))
+		profile = "grain128a2";
+	backendProfile(profile, stage == 1, false);
+	if (opt.profile.size() > 0)
+		profile += "/" + opt.profile;
+	unique_ptr<divBackend> owned;
+	divBackend* solver = opt.solver;
+	if ((solver == NULL) || (stage > 0)) {
+		owned.reset(newBackend(opt.backend, profile, threadNumber));
+		solver = owned.get();
+	}
+	if (solver == NULL) {
+		cerr << "the backend " << opt.backend << " is not available" << endl;
+		return -1;
+	}
+	metrics.phase("env", { { "cacheHit", solver->cacheHit() } });
+
+	// Reachability pruning
+	struct pruneStat stat(evalNumRounds);
+	stat.formulation = solver->option("Formulation");
+	vector<bitset<256>> live = grainReachability(cube, flag, evalNumRounds, target, opt);
+	for (int r = 0; r <= evalNumRounds; r++) {
+		stat.liveBits[r] = live[r].count();
+	}
+	int zero = solver->addVar();
+	solver->fix(zero, 0);
+
+	// Create variables
+	vector<vector<int>> s(evalNumRounds + 1, vector<int>(128));
+	vector<vector<int>> b(evalNumRounds + 1, vector<int>(128));
+	if (opt.preRound == 0) {
+		for (int i = 0; i < 128; i++) {
+			s[0][i] = (live[0][128 + i] == 1) ? solver->addVar() : zero;
+			b[0][i] = (live[0][i] == 1) ? solver->addVar() : zero;
+		}
+	}
+	else {
+		grainPreRound(*solver, b, s, live, zero, opt.preRound, *opt.prePoly, stat);
+	}
+
+	// IV constraint (const 0 bits and s[0][127] are implied by the pruning)
+	for (int i = 0; i < 96; i++) {
+		if (cube[i] == 1)
+			solver->fix(s[0][i], 1);
+	}
+
+
+
+	// Round function. ands[r] keeps the monomials of the AND gates of round r
+	int divRound = (opt.divRound > 0) ? opt.divRound : (opt.preRound + evalNumRounds) / 2;
+	vector<vector<int>> ands(evalNumRounds + 1);
+	for (int r = opt.preRound; r <= evalNumRounds; r++) {
+		if (r < evalNumRounds) {
+			int numVars = stat.vars;
+			int numConstrs = stat.constrs + stat.genConstrs;
+			grainRound(*solver, b[r], s[r], b[r + 1], s[r + 1], live[r + 1], zero, stat, &ands[r]);
+
+			// 115 variables, 28 linear and 54 general constraints per round without pruning
+			stat.removedVars[r] = 115 - (stat.vars - numVars);
+			stat.removedConstrs[r] = 28 + 54 - (stat.constrs + stat.genConstrs - numConstrs);
+		}
+		else {
+			grainOutput(*solver, b[r], s[r], zero, target, stat, &ands[r]);
+		}
+	}
+	if ((opt.useTwoStage == true) && (opt.hint.size() > 0))
+		displayPruneStat(outputfile, stat, false);
+	else
+		displayPruneStat(outputfile, stat, true);
+
+
+	// Objective of the profile. Only key gives the upper bound of the degree as the return value
+	string objective = solver->option("Objective");
+	if (objective == "minkey") {
+		solver->setObjective(b[0], false);
+	}
+	else if (objective == "middle") {
+		vector<int> sumMiddle = b[divRound];
+		sumMiddle.insert(sumMiddle.end(), s[divRound].begin(), s[divRound].end());
+		solver->setObjective(sumMiddle, false);
+	}
+	else if (objective == "none") {
+		solver->setObjective(vector<int>(), true);
+	}
+	else {
+		solver->setObjective(b[0], true);
+	}
+
+	//
+	if (opt.useTwoStage == true) {
+		if (opt.hint.size() > 0) {
+
+			// fix
+			for (int i = 0; i < 128; i++) {
+				if (opt.hint[opt.divRound][i] == 1)
+					solver->fix(b[opt.divRound][i], 1);
+				else if (b[opt.divRound][i] != zero)
+					solver->fix(b[opt.divRound][i], 0);
+
+				if (opt.hint[opt.divRound][128 + i] == 1)
+					solver->fix(s[opt.divRound][i], 1);
+				else if (s[opt.divRound][i] != zero)
+					solver->fix(s[opt.divRound][i], 0);
+			}
+
+			// hint
+			vector<pair<int, int>> start;
+			for (int r = 0; r < evalNumRounds; r++) {
+				for (int i = 0; i < 128; i++) {
+					if (b[r][i] != zero)
+						start.push_back(make_pair(b[r][i], (int)opt.hint[r][i]));
+					if (s[r][i] != zero)
+						start.push_back(make_pair(s[r][i], (int)opt.hint[r][128 + i]));
+				}
+			}
+			solver->addStart(start);
+		}
+	}
+
+	// Branching priority (RoundPriority, RegisterPriority and AndPriority of the profile). A variable shared by several rounds gets its first round
+	string order = solver->option("RoundPriority");
+	string reg = solver->option("RegisterPriority");
+	bool andFirst = (solver->option("AndPriority") == "1");
+	if ((order.size() > 0) || (reg.size() > 0) || andFirst) {
+		for (int r = evalNumRounds; r >= opt.preRound; r--) {
+			int value = roundPriority(order, r, opt.preRound, evalNumRounds, divRound);
+			for (int i = 0; i < 128; i++) {
+				if (b[r][i] != zero)
+					solver->setPriority(b[r][i], value + ((reg == "b") ? evalNumRounds + 1 : 0));
+				if (s[r][i] != zero)
+					solver->setPriority(s[r][i], value + ((reg == "s") ? evalNumRounds + 1 : 0));
+			}
+			for (int j = 0; j < ands[r].size(); j++) {
+				solver->setPriority(ands[r][j], value + (andFirst ? 2 * (evalNumRounds + 1) : 0));
+			}
+		}
+	}
+
+	// Solve
+	stat.modelVars = solver->numVariables();
+	stat.modelConstrs = solver->numConstraints();
+	stat.modelGenConstrs = solver->numGenConstraints();
+	outputfile << "model : " << stat.modelVars << " variables, " << stat.modelConstrs << " constraints and " << stat.modelGenConstrs << " general constraints" << endl;
+	metrics.phase("build", { { "vars", stat.modelVars }, { "constrs", stat.modelConstrs }, { "genConstrs", stat.modelGenConstrs } });
+	if (opt.report != NULL) {
+		auto start = chrono::steady_clock::now();
+		solver->presolve(stat.presolvedVars, stat.presolvedConstrs);
+		stat.presolveSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		*opt.report = stat;
+		// the one presolve record of the model (the presolve inside the solve is then counted in the solve)
+		metrics.phase("presolve", stat.presolveSec, { { "vars", stat.presolvedVars }, { "constrs", stat.presolvedConstrs } });
+	}
+
+	// the messages of the solver go to the log of the job (the environments have no LogFile)
+	solver->watch(opt.stop, &outputfile);
+
+	// Feasibility pass: stop at the first trail, without the pool and the 2nd stages
+	if ((opt.screen > 0) && (stage < 2)) {
+		int status = solver->feasible(opt.screen);
+		double proof = solver->runtime();
+		metrics.phase("screen", { { "status", status } });
+		if (status == BACKEND_INFEASIBLE) {
+			outputfile << "feasibility pass : no trail\t" << proof << "sec" << endl;
+			dulation = proof;
+			if ((opt.sched == NULL) && !opt.quiet)
+				displayGrainBox(countingBox, cube, dulation);
+			return -1;
+		}
+		outputfile << "feasibility pass : " << ((status == BACKEND_SOLUTION_LIMIT) ? "a trail exists" : "undecided") << "\t" << proof << "sec" << endl;
+		if ((opt.stop != NULL) && opt.stop->load()) {
+			dulation = proof;
+			return -2;
+		}
+	}
+
+	// the 2nd stages run from the 1st stage (see histogram.h), and the number of trails in the counting box
+	callbackProfile profiler;
+	long long solTotal = 0;
+	for (auto it = countingBox.begin(); it != countingBox.end(); it++)
+		solTotal += (*it).second;
+	long long solCount;
+	if (stage == 1) {
+		solCount = solver->enumerate([&](const vector<char>& sol) {
+			if (profiler.due())
+				profiler.report(outputfile, "callback");
+			outputfile << "\tfound \t divide in " << divRound << "\t" << solver->runtime() << "sec" << endl;
+
+
+			// store found solution into trail
+			vector<bitset<256>> trail(evalNumRounds + 1);
+			for (int r = 0; r <= evalNumRounds; r++) {
+				for (int i = 0; i < 128; i++) {
+					trail[r][i] = sol[b[r][i]];
+					trail[r][128 + i] = sol[s[r][i]];
+				}
+			}
+
+			//
+			double dulation;
+			int subThreads = (opt.sched != NULL) ? opt.sched->threads() : threadNumber;
+			profiler.enter();
+			struct twoStageGrain second = opt;
+			second.useTwoStage = true;
+			second.divRound = divRound;
+			second.hint = trail;
+			second.report = NULL;
+			second.screen = 0;
+			second.parent = metrics.id;
+			int solCnt = grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, subThreads, target, second);
+
+			profiler.leave(solCnt);
+
+			// the 2nd stage adds solCnt trails to the counting box
+			solTotal += max(solCnt, 0);
+			outputfile << "\t" << solCnt << "( total : " << solTotal << ")" << endl;
+			outputfile << "\t" << countingBox.size() << " monomials are involved" << endl;
+
+			
+			// remove
+			vector<int> cut;
+			for (int i = 0; i < 128; i++) {
+				if (b[divRound][i] != zero)
+					cut.push_back((trail[divRound][i] == 1) ? -(b[divRound][i] + 1) : b[divRound][i] + 1);
+				if (s[divRound][i] != zero)
+					cut.push_back((trail[divRound][128 + i] == 1) ? -(s[divRound][i] + 1) : s[divRound][i] + 1);
+			}
+			solver->addLazy(cut);
+		}, true);
+	}
+	else {
+		// store the information about solutions
+		solCount = solver->enumerate([&](const vector<char>& sol) {
+			bitset<256> tmp;
+			for (int j = 0; j < 128; j++) {
+				tmp[j] = sol[b[0][j]];
+				tmp[128 + j] = sol[s[0][j]];
+			}
+			countingBox[tmp]++;
+		});
+	}
+
+	//
+	dulation = solver->runtime();
+	double presolveSec = (opt.report != NULL) ? -1 : solver->presolveSec();
+	if (presolveSec >= 0)
+		metrics.phase("presolve", presolveSec, {});
+	metrics.phase("solve", dulation - max(presolveSec, 0.0), { { "status", solver->status() }, { "solutions", solCount }, { "midpoints", profiler.numMidpoints() }, { "nodes", solver->nodes() } });
+	if (stage == 1) {
+		profiler.report(outputfile, "1st stage");
+		metrics.phase("callback", profiler.insideSec(), profiler.values());
+	}
+	else {
+		metrics.phase("extract", { { "solutions", solCount }, { "monomials", countingBox.size() } });
+	}
+	if (solCount < 0) {
+		if ((opt.stop == NULL) || (opt.stop->load() == false))
+			cerr << "the enumeration did not finish (status " << solver->status() << ")" << endl;
+		return -2;
+	}
+	if (stage == 2)
+		return solCount;
+
+
+
+	// disp
+	if ((opt.sched == NULL) && !opt.quiet)
+		displayGrainBox(countingBox, cube, dulation);
+
+	//result
+	if (solver->status() == BACKEND_INFEASIBLE) {
+		return -1;
+	}
+	else if (solver->status() == BACKEND_OPTIMAL) {
+		int upperBound = round(solver->objVal());
+		return upperBound;
+	}
+	else {
+		cout << solver->status() << endl;
+		return -2;
+	}
+}
+
+
+
+/***************************************
+ * Computing Superpolies with 96 active bits
+ ***************************************/
+// the targets in the order of the boxes of grainAddTargets
+static const vector<int> grainTargets = { 6, 5, 4, 3, 2, 1 };
+
+/*
+Add the 6 targets of one cube to the scheduler. The result of the j-th target is stored into boxes[j] and displayed when the job finishes.
+@Para
+sched: the scheduler
+label: the name of the cube in the output and in the timing file
+cube, flag, evalNumRounds, preRound, prePoly: see grain128a (cube, flag and prePoly must live until sched.run() returns)
+boxes: 6 countingBoxes
+*/
+static void grainAddTargets(jobScheduler& sched, string label, vector<int>& cube, vector<int>& flag, int evalNumRounds, int preRound, double screen, vector<anfPoly<256>>& prePoly, vector<map<bitset<256>, int, cmpBitset256>>& boxes) {
+
+	//Seperately evaluate the non-linear terms and the linear part of the output bit
+	static const vector<string> names = { "s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89", "b12 * s8", "s13 * s20", "b95 * s42", "s60 * s79", "b12 * b95 * s94" };
+	boxes.resize(grainTargets.size());
+	for (int j = 0; j < grainTargets.size(); j++) {
+		string name = "grain " + to_string(evalNumRounds) + " pre " + to_string(preRound) + " " + label + " " + names[j];
+		sched.add(name, [&sched, &cube, &flag, &prePoly, &boxes, j, label, evalNumRounds, preRound, screen]() {
+			double dulation = 0;
+			struct twoStageGrain stage;
+			stage.useTwoStage = true;
+			stage.preRound = preRound;
+			stage.prePoly = &prePoly;
+			stage.sched = &sched;
+			stage.screen = screen;
+			int result = grainThreeEnumuration(cube, flag, evalNumRounds, boxes[j], dulation, sched.threads(), grainTargets[j], stage);
+
+			lock_guard<mutex> lock(sched.outputLock);
+			cout << "++++++++++++++++++++++++++++++++++++++" << endl;
+			cout << "Target " << names[j] << " (" << label << ")" << endl;
+			if ((boxes[j].size() == 0) && (result == -1) && (screen > 0)) {
+				cout << "zero sum\t" << dulation << "sec (no trail in the feasibility pass)" << endl;
+			}
+			else if (boxes[j].size() == 0) {
+				cout << "zero sum\t" << dulation << "sec" << endl;
+			}
+			else {
+				displayGrainBox(boxes[j], cube, dulation);
+			}
+		});
+	}
+
+}
+
+/*
+Write the superpoly of all targets and of each target (boxes in the order of grainTargets) to the binary file, see superpoly.h
+*/
+static void grainWriteSuperpoly(string filename, int evalNumRounds, vector<int>& cube, map<bitset<256>, int, cmpBitset256>& countingBox, vector<map<bitset<256>, int, cmpBitset256>>& boxes) {
+
+	superpolyWriter writer("grain128a", evalNumRounds, 256, 0, 128, 128, 96, cube, grainTargets);
+	writer.section(0, countingBox);
+	for (int j = 0; j < boxes.size(); j++) {
+		writer.section(grainTargets[j], boxes[j]);
+	}
+	if (writer.write(filename))
+		cout << "the superpoly is written to " << filename << endl;
+
+}
+
+/*
+evalNumRounds: the number of initialization rounds
+threadNumber: the number of threads
+*/
+int grain128a(int evalNumRounds, int threadNumber, int preRound, double screen) {
 
-				// remove (s[r][0], z[r]) = (1,1) 
-				model.addConstr((1 - s[r][0]) + (1 - z) >= 1);
-			}
-			else {
-				GRBVar h = funcH(model, tmpb, tmps, target);
-				GRBVar o = funcO(model, tmpb, tmps, target);
+	//
+	ofstream outputfile, outputfile2, outputfile3;
+	outputfile.open("log_grain128a.txt");
+	outputfile2.open("log_grain128a2.txt");
 
-				GRBVar z = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(z == h + o);
+	// active bits
+	vector<int> cube(96, 0);
+	for (int i = 0; i < 96; i++) {
+		cube[i] = 1;
+	}
+	//cube[46] = 0;
+	cout << "the index of cube" << endl;
+	for (int i = 0; i < 96; i++) {
+		if (cube[i] == 1)
+			cout << "iv" << (i + 1) << ", ";
+	}
+	cout << endl;
 
-				model.addConstr(z == 1);
 
-				for (int i = 0; i < 128; i++) {
-					model.addConstr(tmpb[i] == 0);
-					model.addConstr(tmps[i] == 0);
-				}
-			}
+	// constant (secret 3, active 2, const 1, const 0)
+	vector<int> flag(256, 0);
+	for (int i = 0; i < 128; i++) {
+		flag[i] = 3;
+	}
+	for (int i = 0; i < 96; i++) {
+		if (cube[i] == 1) {
+			flag[128 + i] = 2;
 		}
+	}
+	for (int i = 96; i < 127; i++) {
+		flag[128 + i] = 1;
+	}
 
+	// hybrid mode
+	vector<anfPoly<256>> prePoly;
+	if (preRound > 0) {
+		clock_t start = clock();
+		prePoly = grainANF(cube, flag, preRound);
+		size_t numMonomials = 0;
+		for (int i = 0; i < 256; i++) {
+			numMonomials += prePoly[i].size();
+		}
+		cout << "ANF of " << preRound << " rounds : " << numMonomials << " monomials\t" << (double)(clock() - start) / CLOCKS_PER_SEC << "sec" << endl;
+	}
 
-		//
-		GRBLinExpr sumKey = 0;
-		for (int i = 0; i < 128; i++) {
-			sumKey += b[0][i];
+	//
+	map<bitset<256>, int, cmpBitset256> countingBox;
+	vector<map<bitset<256>, int, cmpBitset256>> boxes;
+	jobScheduler sched(threadNumber, "schedule_grain128a.txt");
+	grainAddTargets(sched, "full", cube, flag, evalNumRounds, preRound, screen, prePoly, boxes);
+	sched.run();
+	metricsJob metrics("grain128a " + to_string(evalNumRounds) + " merge", 0, threadNumber);
+	for (int j = 0; j < boxes.size(); j++) {
+		auto it = boxes[j].begin();
+		while (it != boxes[j].end()) {
+			countingBox[(*it).first] += (*it).second;
+			it++;
 		}
-		model.setObjective(sumKey, GRB_MAXIMIZE);
+	}
+	metrics.phase("merge", { { "monomials", countingBox.size() } });
 
-		//
-		if (opt.useTwoStage == true) {
-			if (opt.hint.size() > 0) {
+	
 
-				// fix
-				for (int i = 0; i < 128; i++) {
-					if (opt.hint[opt.divRound][i] == 1)
-						model.addConstr(b[opt.divRound][i] == 1);
-					else
-						model.addConstr(b[opt.divRound][i] == 0);
-
-					if (opt.hint[opt.divRound][128 + i] == 1)
-						model.addConstr(s[opt.divRound][i] == 1);
-					else
-						model.addConstr(s[opt.divRound][i] == 0);
-				}
+	displayGrainSuperpoly(cout, countingBox, cube);
+	grainWriteSuperpoly("superpoly_grain128a_" + to_string(evalNumRounds) + ".spb", evalNumRounds, cube, countingBox, boxes);
 
-				// hint
-				for (int r = 0; r < evalNumRounds; r++) {
-					for (int i = 0; i < 128; i++) {
-						if (opt.hint[r][i] == 1)
-							b[r][i].set(GRB_DoubleAttr_Start, 1);
-						else
-							b[r][i].set(GRB_DoubleAttr_Start, 0);
-
-						if (opt.hint[r][128 + i] == 1)
-							s[r][i].set(GRB_DoubleAttr_Start, 1);
-						else
-							s[r][i].set(GRB_DoubleAttr_Start, 0);
-					}
-				}
+	return 0;
+}
+
+
+/***************************************
+ * Computing 15 Superpolies with 95 active bits
+ ***************************************/
+int grain128aSub(int evalNumRounds, int threadNumber, int preRound, double screen) {
+
+	//
+	ofstream outputfile, outputfile2;
+	outputfile.open("log_grain128a.txt");
+	outputfile2.open("log_grain128a2.txt");
+
+	vector<int> cons_pos_vector = { 26,29,30,31,33,40,43,44,45,47,57,58,63,69,71 };
+
+	// every (cube, target) is one job, see jobScheduler
+	int numCubes = cons_pos_vector.size();
+	vector<vector<int>> cubes(numCubes);
+	vector<vector<int>> flags(numCubes);
+	vector<vector<anfPoly<256>>> prePolys(numCubes);
+	vector<vector<map<bitset<256>, int, cmpBitset256>>> boxes(numCubes);
+	jobScheduler sched(threadNumber, "schedule_grain128a.txt");
+
+	for (int id = 0; id < numCubes; id++) {
+
+		int cons_pos = cons_pos_vector[id];
+
+		// active bits
+		vector<int>& cube = cubes[id];
+		cube.assign(96, 0);
+		for (int i = 0; i < 96; i++) {
+			cube[i] = 1;
+		}
+		cube[cons_pos] = 0;
+
+
+		// constant (secret 3, active 2, const 1, const 0)
+		vector<int>& flag = flags[id];
+		flag.assign(256, 0);
+		for (int i = 0; i < 128; i++) {
+			flag[i] = 3;
+		}
+		for (int i = 0; i < 96; i++) {
+			if (cube[i] == 1) {
+				flag[128 + i] = 2;
 			}
 		}
+		for (int i = 96; i < 127; i++) {
+			flag[128 + i] = 1;
+		}
 
-		// Solve
-		model.update();
-		if ((opt.useTwoStage == true) && (opt.hint.size() == 0)) {
-			threeEnumurationGrain cb = threeEnumurationGrain(cube, flag, s, b, target, &countingBox, threadNumber, &outputfile);
-			model.setCallback(&cb);
-			model.optimize();
+		// hybrid mode
+		vector<anfPoly<256>>& prePoly = prePolys[id];
+		if (preRound > 0) {
+			clock_t start = clock();
+			prePoly = grainANF(cube, flag, preRound);
+			size_t numMonomials = 0;
+			for (int i = 0; i < 256; i++) {
+				numMonomials += prePoly[i].size();
+			}
+			cout << "ANF of " << preRound << " rounds : " << numMonomials << " monomials\t" << (double)(clock() - start) / CLOCKS_PER_SEC << "sec" << endl;
 		}
-		else {
-			model.optimize();
+
+		grainAddTargets(sched, "constant iv" + to_string(cons_pos + 1), cube, flag, evalNumRounds, preRound, screen, prePoly, boxes[id]);
+	}
+	sched.run();
+
+	for (int id = 0; id < numCubes; id++) {
+
+		int cons_pos = cons_pos_vector[id];
+		vector<int>& cube = cubes[id];
+
+		cout << "///////////////////////////////////////////" << endl;
+		cout << "        CONSTANT IV[" << cons_pos + 1 << "]" << endl;
+		cout << "///////////////////////////////////////////" << endl;
+
+		cout << "the index of cube" << endl;
+		for (int i = 0; i < 96; i++) {
+			if (cube[i] == 1)
+				cout << "iv" << (i + 1) << ", ";
 		}
+		cout << endl;
 
 		//
-		int solCount = model.get(GRB_IntAttr_SolCount);
-		dulation = model.get(GRB_DoubleAttr_Runtime);
+		metricsJob metrics("grain128a " + to_string(evalNumRounds) + " constant iv" + to_string(cons_pos + 1) + " merge", 0, threadNumber);
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		for (int j = 0; j < boxes[id].size(); j++) {
+			auto it = boxes[id][j].begin();
+			while (it != boxes[id][j].end()) {
+				countingBox[(*it).first] += (*it).second;
+				it++;
+			}
+		}
+		metrics.phase("merge", { { "monomials", countingBox.size() } });
+
+
+		displayGrainSuperpoly(cout, countingBox, cube);
+		grainWriteSuperpoly("superpoly_grain128a_" + to_string(evalNumRounds) + "_cons" + to_string(cons_pos + 1) + ".spb", evalNumRounds, cube, countingBox, boxes[id]);
+
+		cout << endl;
+		cout << endl;
+
+	}
+
+	return 0;
+
+
+
+
+
+
+}
+
+
+
 
 
 
-		//
-		if (opt.useTwoStage == true) {
-			if (opt.hint.size() > 0) {
-				// check solution limit
-				if (solCount >= 2000000000) {
-					cerr << "Number of solutions is too large" << endl;
-					exit(0);
-				}
 
-				// store the information about solutions
-				for (int i = 0; i < solCount; i++) {
-					model.set(GRB_IntParam_SolutionNumber, i);
-					bitset<256> tmp;
-					for (int j = 0; j < 128; j++) {
-						if (round(b[0][j].get(GRB_DoubleAttr_Xn)) == 1) tmp[j] = 1;
-						else tmp[j] = 0;
 
-						if (round(s[0][j].get(GRB_DoubleAttr_Xn)) == 1) tmp[128 + j] = 1;
-						else tmp[128 + j] = 0;
-					}
-					countingBox[tmp]++;
-				}
 
-				return solCount;
+
+
+
+
+/***************************************
+ * Batch jobs from the manifest
+ ***************************************/
+/*
+Same as triviumManifestJob for Grain-128AEAD
+*/
+void grainManifestJob(jobScheduler& sched, struct manifestJob& job) {
+
+	static map<pair<vector<int>, int>, vector<anfPoly<256>>> anfCache;
+
+	struct jobState {
+		vector<int> cube;
+		vector<int> flag;
+		vector<anfPoly<256>>* prePoly;
+		vector<map<bitset<256>, int, cmpBitset256>> boxes;
+		atomic<int> remaining;
+	};
+	shared_ptr<jobState> st = make_shared<jobState>();
+
+	// constant (secret 3, active 2, const 1, const 0)
+	st->cube.assign(96, 0);
+	st->flag.assign(256, 0);
+	for (int i = 0; i < 128; i++) {
+		st->flag[i] = 3;
+	}
+	for (int i = 0; i < job.consts.size(); i++) {
+		st->flag[128 + job.consts[i]] = 1;
+	}
+	for (int i = 0; i < job.cube.size(); i++) {
+		st->cube[job.cube[i]] = 1;
+		st->flag[128 + job.cube[i]] = 2;
+	}
+	for (int i = 96; i < 127; i++) {
+		st->flag[128 + i] = 1;
+	}
+
+	// hybrid mode
+	pair<vector<int>, int> key = make_pair(st->flag, job.preRound);
+	metricsJob metrics("grain " + to_string(job.rounds) + " manifest line " + to_string(job.line), 0, sched.threads());
+	bool hit = (anfCache.count(key) > 0);
+	if ((job.preRound > 0) && (anfCache.count(key) == 0))
+		anfCache[key] = grainANF(st->cube, st->flag, job.preRound);
+	st->prePoly = &anfCache[key];
+	if (job.preRound > 0)
+		metrics.phase("anf", { { "cacheHit", hit } });
+
+	st->boxes.resize(job.targets.size());
+	st->remaining = job.targets.size();
+	for (int j = 0; j < job.targets.size(); j++) {
+		string name = "grain " + to_string(job.rounds) + " pre " + to_string(job.preRound) + " div " + to_string(job.divRound) + " cube " + job.cubeText + " const " + job.constText + " target " + to_string(job.targets[j]);
+		sched.add(name, [&sched, st, job, j]() {
+			double dulation = 0;
+			struct twoStageGrain stage;
+			stage.useTwoStage = true;
+			stage.divRound = job.divRound;
+			stage.preRound = job.preRound;
+			stage.prePoly = st->prePoly;
+			stage.sched = &sched;
+			stage.screen = job.screen;
+			grainThreeEnumuration(st->cube, st->flag, job.rounds, st->boxes[j], dulation, sched.threads(), job.targets[j], stage);
+			if (--st->remaining > 0)
+				return;
+
+			metricsJob metrics("grain " + to_string(job.rounds) + " manifest line " + to_string(job.line), 0, sched.threads());
+			map<bitset<256>, int, cmpBitset256> countingBox;
+			for (int k = 0; k < st->boxes.size(); k++) {
+				auto it = st->boxes[k].begin();
+				while (it != st->boxes[k].end()) {
+					countingBox[(*it).first] += (*it).second;
+					it++;
+				}
 			}
-		}
-		else {
-			// check solution limit
-			if (solCount >= 2000000000) {
-				cerr << "Number of solutions is too large" << endl;
-				exit(0);
+			metrics.phase("merge", { { "monomials", countingBox.size() } });
+			ofstream outputfile(job.out);
+			outputfile << "# grain " << job.rounds << " cube=" << job.cubeText << " const=" << job.constText << " pre=" << job.preRound << " div=" << job.divRound << endl;
+			displayGrainSuperpoly(outputfile, countingBox, st->cube);
+
+			lock_guard<mutex> lock(sched.outputLock);
+			cout << "manifest line " << job.line << " : " << countingBox.size() << " monomials -> " << job.out << endl;
+		});
+	}
+
+}
+
+
+#ifndef NOGUROBI
+/***************************************
+ * Round sweep
+ ***************************************/
+/*
+Same as triviumSweep for Grain-128AEAD. The rounds of grainRound are appended to the live model,
+and the output layer of grainOutput (the taps of h and the linear part, z = 1 and the other bits = 0) is removed after every solve
+by the rollback to the checkpoint of the last round (see divBackend).
+*/
+void grainSweep(vector<int> cube, vector<int> flag, int firstRound, int lastRound, int threadNumber, function<void(int, map<bitset<256>, int, cmpBitset256>&, double)> onRound) {
+
+	logStream outputfile("log_grain128a.txt");
+	outputfile << endl;
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << "sweep " << firstRound << " - " << lastRound << " rounds" << endl;
+
+	// the environment of the single stage (see grainThreeEnumuration)
+	backendProfile("grain128a", false, false);
+	unique_ptr<divBackend> solver(newBackend("gurobi", "grain128a", threadNumber));
+	solver->watch(NULL, &outputfile);
+
+	struct twoStageGrain opt;
+	vector<bitset<256>> fw = grainForward(cube, flag, lastRound, opt);
+	struct pruneStat stat;
+	stat.formulation = solver->option("Formulation");
+	int zero = solver->addVar();
+	solver->fix(zero, 0);
+
+	vector<int> b(128), s(128);
+	for (int i = 0; i < 128; i++) {
+		b[i] = (fw[0][i] == 1) ? solver->addVar() : zero;
+		s[i] = (fw[0][128 + i] == 1) ? solver->addVar() : zero;
+	}
+	vector<int> x0(b);
+	x0.insert(x0.end(), s.begin(), s.end());
+	for (int i = 0; i < 96; i++) {
+		if (cube[i] == 1)
+			solver->fix(s[i], 1);
+	}
+	solver->setObjective(b, true);
+
+	map<bitset<256>, int, cmpBitset256> previous;
+	auto start = chrono::steady_clock::now();
+	for (int r = 0; r <= lastRound; r++) {
+		if (r >= firstRound) {
+			// output layer
+			solver->checkpoint();
+			grainOutput(*solver, b, s, zero, -1, stat, NULL);
+
+			// warm start from the monomials of the previous round
+			int numStart = min((int)previous.size(), 10);
+			auto it = previous.begin();
+			for (int k = 0; k < numStart; k++) {
+				vector<pair<int, int>> values;
+				for (int i = 0; i < 256; i++) {
+					if (x0[i] != zero)
+						values.push_back(make_pair(x0[i], (int)(*it).first[i]));
+				}
+				solver->addStart(values);
+				it++;
 			}
+			double built = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-			// store the information about solutions
-			for (int i = 0; i < solCount; i++) {
-				model.set(GRB_IntParam_SolutionNumber, i);
+			map<bitset<256>, int, cmpBitset256> countingBox;
+			long long solCount = solver->enumerate([&](const vector<char>& sol) {
 				bitset<256> tmp;
-				for (int j = 0; j < 128; j++) {
-					if (round(b[0][j].get(GRB_DoubleAttr_Xn)) == 1) tmp[j] = 1;
-					else tmp[j] = 0;
-
-					if (round(s[0][j].get(GRB_DoubleAttr_Xn)) == 1) tmp[128 + j] = 1;
-					else tmp[128 + j] = 0;
+				for (int i = 0; i < 256; i++) {
+					tmp[i] = sol[x0[i]];
 				}
 				countingBox[tmp]++;
+			});
+			double dulation = solver->runtime();
+			if (solCount < 0)
+				return;
+			outputfile << "round " << r << " : " << solver->numVariables() << " variables, " << solver->numConstraints() << " constraints, built in " << built << "sec, ";
+			outputfile << solCount << " trails\t" << dulation << "sec" << endl;
+
+			onRound(r, countingBox, dulation);
+			previous = countingBox;
+
+			// remove the output layer
+			solver->rollback();
+			start = chrono::steady_clock::now();
+		}
+		if (r == lastRound)
+			break;
+
+		// one more round
+		vector<int> nb(128), ns(128);
+		grainRound(*solver, b, s, nb, ns, fw[r + 1], zero, stat, NULL);
+		b = nb;
+		s = ns;
+	}
+
+}
+#endif
+
+/***************************************
+ * Code for the practical verification
+ ***************************************/
+static int roundFuncGrain128a(bitset<128>& b, bitset<128>& s) {
+
+	int f = s[0] ^ s[7] ^ s[38] ^ s[70] ^ s[81] ^ s[96];
+	int g = s[0] ^ b[0] ^ b[26] ^ b[56] ^ b[91] ^ b[96] ^ (b[3] & b[67]) ^ (b[11] & b[13]) ^ (b[17] & b[18]) ^ (b[27] & b[59]) ^ (b[40] & b[48]) ^ (b[61] & b[65]) ^ (b[68] & b[84]);
+	g ^= (b[88] & b[92] & b[93] & b[95]) ^ (b[22] & b[24] & b[25]) ^ (b[70] & b[78] & b[82]);
+	int h = (b[12] & s[8]) ^ (s[13] & s[20]) ^ (b[95] & s[42]) ^ (s[60] & s[79]) ^ (b[12] & b[95] & s[94]);
+	int y = h ^ s[93] ^ b[2] ^ b[15] ^ b[36] ^ b[45] ^ b[64] ^ b[73] ^ b[89];
+
+	b >>= 1;
+	b[127] = g ^ y;
+
+	s >>= 1;
+	s[127] = f ^ y;
+
+	return y;
+}
+static int encryptionSum(int evalNumRounds, vector<int> cube, vector<int> iv, vector<int> key) {
+
+	bitset<128> b, s;
+	for (int i = 0; i < 128; i++) {
+		b[i] = key[i];
+	}
+	for (int i = 0; i < 128; i++) {
+		if (iv[i] == 0) s[i] = 0;
+		else if (iv[i] == 1) s[i] = 1;
+	}
+
+	int DATA_SIZE = 0;
+	vector<int> map;
+	for (int i = 0; i < cube.size(); i++) {
+		DATA_SIZE += cube[i];
+		if (cube[i] == 1) {
+			map.push_back(i);
+		}
+	}
+
+	int sum = 0;
+	for (int in = 0; in < (1 << DATA_SIZE); in++) {
+
+		bitset<128> tmp_b = b;
+		bitset<128> tmp_s = s;
+		for (int i = 0; i < DATA_SIZE; i++) {
+			tmp_s[map[i]] = ((in >> i) & 1);
+		}
+
+		int z = 0;
+		for (int r = 0; r <= evalNumRounds; r++) {
+			z = roundFuncGrain128a(tmp_b, tmp_s);
+		}
+		sum ^= z;
+	}
+
+	return sum;
+}
+static int theoreticalSum(map<bitset<256>, int, cmpBitset256>& countingBox, vector<int>& cube, vector<int>& iv, vector<int>& key) {
+
+	int sum = 0;
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
+
+		if (((*it).second % 2) == 1) {
+
+			int var = 1;
+			for (int i = 0; i < 256; i++) {
+				if ((*it).first[i] == 1) {
+					if (i < 128) {
+						var *= key[i];
+					}
+					else {
+						if (cube[i - 128] == 0) {
+							var *= iv[i - 128];
+						}
+					}
+				}
 			}
+			sum ^= var;
+
 		}
 
+		it++;
+	}
+	return sum;
+
+}
+/*
+Same as verifyTrivium for Grain-128AEAD
+*/
+static void verifyGrain128a(int evalNumRounds, vector<int>& cube, map<bitset<256>, int, cmpBitset256>& countingBox) {
+
+	if (countingBox.size() == 0) {
+		cout << "zero sum" << endl;
+	}
+	else {
+		cout << "               key              \t";
+		cout << "            iv                ";
+		cout << "expe.   ";
+		cout << "theo.   ";
+		cout << endl;
+
+		for (int trial = 0; trial < 100; trial++) {
 
+			vector<int> key(128);
+			for (int i = 0; i < 128; i++)
+				key[i] = rand() % 2;
 
-		// disp
-		auto it = countingBox.begin();
-		while (it != countingBox.end()) {
+			vector<int> iv(128);
+			for (int i = 0; i < 96; i++)
+				iv[i] = rand() % 2;
+			for (int i = 96; i < 127; i++)
+				iv[i] = 1;
 
-			cout << ((*it).second % 2) << " | " << (*it).second << "\t";
+			int sum1 = encryptionSum(evalNumRounds, cube, iv, key);
+			int sum2 = theoreticalSum(countingBox, cube, iv, key);
 
-			bitset<256> tmp = (*it).first;
-			for (int i = 0; i < 128; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "k" << (i + 1) << " ";
+			for (int i = 15; i >= 0; i--) {
+				int hexvar = 0;
+				for (int j = 7; j >= 0; j--) {
+					hexvar ^= (key[8 * i + j] << j);
 				}
+				printf("%02x", hexvar);
 			}
-			for (int i = 0; i < 96; i++) {
-				if ((tmp[128 + i] == 1) && (cube[i] == 0)) {
-					cout << "v" << (i + 1) << " ";
+			cout << "\t";
+
+			for (int i = 11; i >= 0; i--) {
+				int hexvar = 0;
+				for (int j = 7; j >= 0; j--) {
+					hexvar ^= (iv[8 * i + j] << j);
 				}
+				printf("%02x", hexvar);
 			}
-			for (int i = 96; i < 128; i++) {
-				if (tmp[128 + i] == 1) {
-					cout << "v" << (i + 1) << " ";
-				}
+			cout << "\t";
+
+			cout << sum1 << "\t" << sum2 << "\t";
+
+			if (sum1 == sum2) {
+				cout << "OK" << endl;
+			}
+			else {
+				cout << endl;
+				cout << "error" << endl;
+				cerr << "error" << endl;
 			}
-			cout << endl;
 
-			it++;
-		}
-		cout << dulation << "sec" << endl;
-		cout << endl;
 
-		//result
-		if (model.get(GRB_IntAttr_Status) == GRB_INFEASIBLE) {
-			return -1;
-		}
-		else if ((model.get(GRB_IntAttr_Status) == GRB_OPTIMAL)) {
-			int upperBound = round(model.get(GRB_DoubleAttr_ObjVal));
-			return upperBound;
-		}
-		else {
-			cout << model.get(GRB_IntAttr_Status) << endl;
-			return -2;
 		}
-	}
-	catch (GRBException e) {
-		cerr << "Error code = " << e.getErrorCode() << endl;
-		cerr << e.getMessage() << endl;
-	}
-	catch (...) {
-		cerr << "Exception during optimization" << endl;
+
 	}
 
-	return -1;
 }
-
-
-
-/***************************************
- * Computing Superpolies with 96 active bits
- ***************************************/
 /*
-evalNumRounds: the number of initialization rounds
-threadNumber: the number of threads
+Same as triviumPracticalInstance for Grain-128AEAD: iv1, iv2, iv3 and 1 to 4 random IV bits are active
 */
-int grain128a(int evalNumRounds, int threadNumber) {
+static void grainPracticalInstance(function<int(int)> random, vector<int>& cube, vector<int>& flag) {
 
-	//
-	ofstream outputfile, outputfile2, outputfile3;
-	outputfile.open("log_grain128a.txt");
-	outputfile2.open("log_grain128a2.txt");
+	// create cube index at random
+	int numActBits = 1 + random(4);
+	cout << numActBits << " active bits" << endl;
 
-	// active bits
-	vector<int> cube(96, 0);
-	for (int i = 0; i < 96; i++) {
-		cube[i] = 1;
-	}
-	//cube[46] = 0;
-	cout << "the index of cube" << endl;
-	for (int i = 0; i < 96; i++) {
-		if (cube[i] == 1)
-			cout << "iv" << (i + 1) << ", ";
+	cube.assign(96, 0);
+	for (int i = 0; i < numActBits; i++) {
+		int index;
+		do {
+			index = random(96);
+		} while (cube[index] == 1);
+		cube[index] = 1;
 	}
-	cout << endl;
+	cube[0] = 1;
+	cube[1] = 1;
+	cube[2] = 1;
 
 
-	// constant (secret 3, active 2, const 1, const 0)
-	vector<int> flag(256, 0);
+	// fix non-IV bits at random
+	// constant (secret 3, active 2, const/undermined 1, const 0)
+	flag.assign(256, 0);
 	for (int i = 0; i < 128; i++) {
 		flag[i] = 3;
-	}
-	for (int i = 0; i < 96; i++) {
-		if (cube[i] == 1) {
-			flag[128 + i] = 2;
+
+		if (i < 96) {
+			if (cube[i] == 1) {
+				flag[128 + i] = 2;
+			}
+			else {
+				flag[128 + i] = 1;
+			}
+		}
+		else if (i == 127) {
+			flag[i] = 0;
+		}
+		else {
+			flag[i] = 1;
 		}
-	}
-	for (int i = 96; i < 127; i++) {
-		flag[128 + i] = 1;
 	}
 
-	//
-	map<bitset<256>, int, cmpBitset256> countingBox;
-	double dulation = 0;
+}
+void practicalTestGrain128a(int native) {
 
-	//Seperately evaluate the non-linear terms and the linear part of the output bit
-	cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-	cout << "Target s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89" << endl;
-	grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 6, { true, 0, });
-	if (countingBox.size() == 0) {
-		cout << "zero sum\t" << dulation << "sec" << endl;
-	}
 
-	cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-	cout << "Target b12 * s8" << endl;
-	grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 5, { true, 0, });
-	if (countingBox.size() == 0) {
-		cout << "zero sum\t" << dulation << "sec" << endl;
-	}
+	//
+	ofstream outputfile, outputfile2;
+	outputfile.open("log_grain128a.txt");
+	outputfile2.open("log_grain128a2.txt");
 
-	cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-	cout << "Target s13 * s20" << endl;
-	grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 4, { true, 0, });
-	if (countingBox.size() == 0) {
-		cout << "zero sum\t" << dulation << "sec" << endl;
-	}
 
-	cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-	cout << "Target b95 * s42" << endl;
-	grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 3, { true, 0, });
-	if (countingBox.size() == 0) {
-		cout << "zero sum\t" << dulation << "sec" << endl;
-	}
+	srand(time(NULL));
 
-	cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-	cout << "Target s60 * s79" << endl;
-	grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 2, { true, 0, });
-	if (countingBox.size() == 0) {
-		cout << "zero sum\t" << dulation << "sec" << endl;
-	}
+	vector<int> cube, flag;
+	grainPracticalInstance([](int n) { return rand() % n; }, cube, flag);
 
-	cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-	cout << "Target b12 * b95 * s94" << endl;
-	grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 1, { true, 0, });
-	if (countingBox.size() == 0) {
-		cout << "zero sum\t" << dulation << "sec" << endl;
+	// input
+	for (int i = 0; i < 96; i++) {
+		cout << flag[128 + i];
 	}
+	cout << endl;
 
-	
-
-	cout << "*****************************" << endl;
-	cout << "Final solution" << endl;
-	cout << countingBox.size() << " solutions are found" << endl;
-
-	map<bitset<256>, int, cmpBitset256> countingBox2;
-	auto it = countingBox.begin();
-	while (it != countingBox.end()) {
-		bitset<256> tmp = (*it).first;
-		for (int i = 0; i < 96; i++) {
-			if (cube[i] == 1) {
-				tmp[128 + i] = 0;
-			}
-		}
-		for (int i = 96; i < 128; i++) {
-			tmp[128 + i] = 0;
-		}
-		countingBox2[tmp] += (*it).second;
-		it++;
+#ifndef NOGUROBI
+	// -sweep: one model extended round by round (see grainSweep)
+	if (native == 3) {
+		int firstNonzero = -1;
+		grainSweep(cube, flag, 50, 119, 1, [&](int r, map<bitset<256>, int, cmpBitset256>& countingBox, double dulation) {
+			cout << "##############################" << endl;
+			cout << r << " rounds\t" << dulation << "sec" << endl;
+			int degree;
+			if ((firstNonzero < 0) && (grainSuperpolySize(countingBox, cube, degree) > 0))
+				firstNonzero = r;
+			verifyGrain128a(r, cube, countingBox);
+			cout << endl << endl;
+		});
+		if (firstNonzero < 0)
+			cout << "zero sum up to 119 rounds" << endl;
+		else
+			cout << "zero sum up to " << (firstNonzero - 1) << " rounds, the superpoly is not zero from " << firstNonzero << " rounds" << endl;
+		return;
 	}
+#endif
 
-	// 
-	cout << "odd list" << endl;
-	auto it2 = countingBox2.begin();
-	while (it2 != countingBox2.end()) {
-		if (((*it2).second % 2) == 1) {
-			cout << ((*it2).second % 2) << " | " << (*it2).second << "\t";
-			bitset<256> tmp = (*it2).first;
-			for (int i = 0; i < 128; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "k" << (i + 1) << " ";
-				}
-			}
-			cout << endl;
-		}
-		it2++;
-	}
-	cout << endl;
+	//
+	for (int r = 50; r < 120; r++) {
+		cout << "##############################" << endl;
+		cout << r << " rounds" << endl;
 
-	cout << "even list" << endl;
-	it2 = countingBox2.begin();
-	while (it2 != countingBox2.end()) {
-		if (((*it2).second % 2) == 0) {
-			cout << ((*it2).second % 2) << " | " << (*it2).second << "\t";
-			bitset<256> tmp = (*it2).first;
-			for (int i = 0; i < 128; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "k" << (i + 1) << " ";
-				}
-			}
-			cout << endl;
-		}
-		it2++;
+		double dulation;
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		if (native == 0)
+			grainThreeEnumuration(cube, flag, r, countingBox, dulation, 1);
+		else
+			grainNativeEnumuration(cube, flag, r, countingBox, dulation, 1, -1, false, (native == 2) ? r / 2 : 0);
+
+		verifyGrain128a(r, cube, countingBox);
+		cout << endl << endl;
 	}
 
 
 
 }
+/*
+Same as differentialTestTrivium for Grain-128AEAD (verify_grain128a.txt)
+*/
+int differentialTestGrain128a(int evalNumRounds, int native, int threadNumber, unsigned long long seed, int trials) {
 
-
-/***************************************
- * Computing 15 Superpolies with 95 active bits
- ***************************************/
-int grain128aSub(int evalNumRounds, int threadNumber) {
-
-	//
 	ofstream outputfile, outputfile2;
 	outputfile.open("log_grain128a.txt");
 	outputfile2.open("log_grain128a2.txt");
 
-	vector<int> cons_pos_vector = { 26,29,30,31,33,40,43,44,45,47,57,58,63,69,71 };
-
-	for (int id = 0; id < cons_pos_vector.size(); id++) {
+	cout << "seed " << seed << ", " << trials << " trials per round" << endl;
+	verifyRandom draw(seed);
+	vector<int> cube, flag;
+	grainPracticalInstance([&](int n) { return draw.below(n); }, cube, flag);
+	for (int i = 0; i < 96; i++) {
+		cout << flag[128 + i];
+	}
+	cout << endl;
 
-		int cons_pos = cons_pos_vector[id];
+	vector<verifyRound> rounds;
+	verifyMismatch mismatch;
+	// the superpolies of the workers are not displayed
+	struct twoStageGrain quiet;
+	quiet.quiet = true;
+	bool ok = verifyRun<map<bitset<256>, int, cmpBitset256>>(50, (evalNumRounds > 0) ? evalNumRounds : 119, trials, threadNumber, seed,
+		[&](int r, map<bitset<256>, int, cmpBitset256>& countingBox) {
+			double dulation;
+			if ((native != 1) && (native != 2))
+				grainThreeEnumuration(cube, flag, r, countingBox, dulation, 1, -1, quiet);
+			else
+				grainNativeEnumuration(cube, flag, r, countingBox, dulation, 1, -1, false, (native == 2) ? r / 2 : 0, nativeMemLimit, true);
+		},
+		[&](map<bitset<256>, int, cmpBitset256>& countingBox, int& degree) {
+			return grainSuperpolySize(countingBox, cube, degree);
+		},
+		[&](int r, map<bitset<256>, int, cmpBitset256>& countingBox, verifyRandom& rng, vector<int>& key, vector<int>& iv, int& expe, int& theo) {
+			key.resize(128);
+			for (int i = 0; i < 128; i++)
+				key[i] = rng.bit();
+			iv.assign(128, 0);
+			for (int i = 0; i < 96; i++)
+				iv[i] = rng.bit();
+			for (int i = 96; i < 127; i++)
+				iv[i] = 1;
+			expe = encryptionSum(r, cube, iv, key);
+			theo = theoreticalSum(countingBox, cube, iv, key);
+		},
+		rounds, mismatch);
+
+	ofstream result("verify_grain128a.txt");
+	verifyTable(cout, rounds, trials);
+	verifyTable(result, rounds, trials);
+	if (ok == false) {
+		stringstream ss;
+		ss << "mismatch at " << mismatch.round << " rounds, trial " << mismatch.trial << " of seed " << seed << endl;
+		ss << "key " << verifyHex(mismatch.key, 16) << "\tiv " << verifyHex(mismatch.iv, 12) << "\texpe. " << mismatch.expe << "\ttheo. " << mismatch.theo << endl;
+		cout << ss.str();
+		result << ss.str();
+		cerr << "error" << endl;
+		return 1;
+	}
+	return 0;
 
-		cout << "///////////////////////////////////////////" << endl;
-		cout << "        CONSTANT IV[" << cons_pos + 1 << "]" << endl;
-		cout << "///////////////////////////////////////////" << endl;
+}
 
-		// active bits
-		vector<int> cube(96, 0);
-		for (int i = 0; i < 96; i++) {
-			cube[i] = 1;
-		}
-		cube[cons_pos] = 0;
-		cout << "the index of cube" << endl;
-		for (int i = 0; i < 96; i++) {
-			if (cube[i] == 1)
-				cout << "iv" << (i + 1) << ", ";
-		}
-		cout << endl;
+/*
+Same as triviumGoldenCheck for Grain-128AEAD. The padding IV bits 97 to 127 are 1 and the last one is 0, as in grainNativeJob.
+*/
+bool grainGoldenCheck(struct manifestJob& job, string golden, int trials, int maxCube, string& detail) {
 
+	if (job.cube.size() > maxCube) {
+		detail = "not checked (cube of " + to_string(job.cube.size()) + " bits)";
+		return true;
+	}
+	legacyFile text;
+	if (!legacyParse(golden, text) || (text.results.size() != 1)) {
+		detail = "cannot read " + golden;
+		return false;
+	}
+	set<array<uint64_t, 4>> odd;
+	legacyOdd(text.results[0], odd);
 
-		// constant (secret 3, active 2, const 1, const 0)
-		vector<int> flag(256, 0);
-		for (int i = 0; i < 128; i++) {
-			flag[i] = 3;
-		}
-		for (int i = 0; i < 96; i++) {
-			if (cube[i] == 1) {
-				flag[128 + i] = 2;
-			}
+	vector<int> cube(96, 0);
+	for (int i = 0; i < job.cube.size(); i++) {
+		cube[job.cube[i]] = 1;
+	}
+	// the random trials, half of them with the bits 1 at 3/4, and then the trials at the variables of each monomial of the golden file
+	verifyRandom rng(job.rounds);
+	vector<array<uint64_t, 4>> points(odd.begin(), odd.end());
+	for (int t = 0; t < trials + points.size(); t++) {
+		vector<int> key(128), iv(128, 0);
+		for (int i = 0; i < 128; i++)
+			key[i] = (t < trials) ? (rng.bit() | ((t % 2) & rng.bit())) : ((points[t - trials][i / 64] >> (i % 64)) & 1);
+		for (int i = 0; i < job.consts.size(); i++) {
+			int j = job.consts[i];
+			iv[j] = (t < trials) ? (rng.bit() | ((t % 2) & rng.bit())) : ((points[t - trials][2 + j / 64] >> (j % 64)) & 1);
 		}
-		for (int i = 96; i < 127; i++) {
-			flag[128 + i] = 1;
+		for (int i = 96; i < 127; i++)
+			iv[i] = 1;
+		int expe = encryptionSum(job.rounds, cube, iv, key);
+		int theo = legacyEvaluate(odd, key, iv);
+		if (expe != theo) {
+			detail = "trial " + to_string(t) + " key " + verifyHex(key, 16) + " iv " + verifyHex(iv, 12) + " expe. " + to_string(expe) + " theo. " + to_string(theo);
+			return false;
 		}
+	}
+	detail = to_string(trials + points.size()) + " cube sums";
+	return true;
 
-		//
-		map<bitset<256>, int, cmpBitset256> countingBox;
-		double dulation = 0;
+}
 
-		//Seperately evaluate the non-linear terms and the linear part of the output bit
-		cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-		cout << "Target s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89" << endl;
-		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 6, { true, 0, });
-		if (countingBox.size() == 0) {
-			cout << "zero sum\t" << dulation << "sec" << endl;
-		}
 
-		cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-		cout << "Target b12 * s8" << endl;
-		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 5, { true, 0, });
-		if (countingBox.size() == 0) {
-			cout << "zero sum\t" << dulation << "sec" << endl;
-		}
 
-		cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-		cout << "Target s13 * s20" << endl;
-		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 4, { true, 0, });
-		if (countingBox.size() == 0) {
-			cout << "zero sum\t" << dulation << "sec" << endl;
-		}
+/***************************************
+ * Key recovery at reduced rounds
+ ***************************************/
+/*
+Same as triviumKeystream for Grain-128AEAD
+*/
+static vector<int> grainKeystream(int evalNumRounds, vector<int>& key, vector<int>& iv, int length) {
 
-		cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-		cout << "Target b95 * s42" << endl;
-		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 3, { true, 0, });
-		if (countingBox.size() == 0) {
-			cout << "zero sum\t" << dulation << "sec" << endl;
-		}
+	bitset<128> b, s;
+	for (int i = 0; i < 128; i++) {
+		b[i] = key[i];
+		s[i] = iv[i];
+	}
 
-		cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-		cout << "Target s60 * s79" << endl;
-		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 2, { true, 0, });
-		if (countingBox.size() == 0) {
-			cout << "zero sum\t" << dulation << "sec" << endl;
-		}
+	vector<int> keystream;
+	for (int r = 0; r < evalNumRounds + length; r++) {
+		int z = roundFuncGrain128a(b, s);
+		if (r >= evalNumRounds)
+			keystream.push_back(z);
+	}
+	return keystream;
 
-		cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-		cout << "Target b12 * b95 * s94" << endl;
-		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 1, { true, 0, });
-		if (countingBox.size() == 0) {
-			cout << "zero sum\t" << dulation << "sec" << endl;
-		}
+}
+/*
+Same as triviumSlicedLoad for Grain-128AEAD: the windows b (NFSR) and s (LFSR) of work move up by one word per round.
+iv: the 128 words of the LFSR (with the padding)
+*/
+static void grainSlicedLoad(const uint64_t* key, const uint64_t* iv, int total, vector<uint64_t>& work, uint64_t*& b, uint64_t*& s) {
 
+	work.assign(2 * (128 + total), 0);
+	b = work.data();
+	s = work.data() + 128 + total;
+	for (int i = 0; i < 128; i++) {
+		b[i] = key[i];
+		s[i] = iv[i];
+	}
 
-		cout << "*****************************" << endl;
-		cout << "Final solution" << endl;
-		cout << countingBox.size() << " solutions are found" << endl;
+}
+static inline uint64_t grainSlicedRound(uint64_t*& b, uint64_t*& s) {
 
-		map<bitset<256>, int, cmpBitset256> countingBox2;
-		auto it = countingBox.begin();
-		while (it != countingBox.end()) {
-			bitset<256> tmp = (*it).first;
-			for (int i = 0; i < 128; i++) {
-				if (cube[i] == 1) {
-					tmp[128 + i] = 0;
-				}
-			}
-			for (int i = 96; i < 128; i++) {
-				tmp[128 + i] = 0;
-			}
-			countingBox2[tmp] += (*it).second;
-			it++;
-		}
+	uint64_t f = s[0] ^ s[7] ^ s[38] ^ s[70] ^ s[81] ^ s[96];
+	uint64_t g = s[0] ^ b[0] ^ b[26] ^ b[56] ^ b[91] ^ b[96] ^ (b[3] & b[67]) ^ (b[11] & b[13]) ^ (b[17] & b[18]) ^ (b[27] & b[59]) ^ (b[40] & b[48]) ^ (b[61] & b[65]) ^ (b[68] & b[84]);
+	g ^= (b[88] & b[92] & b[93] & b[95]) ^ (b[22] & b[24] & b[25]) ^ (b[70] & b[78] & b[82]);
+	uint64_t h = (b[12] & s[8]) ^ (s[13] & s[20]) ^ (b[95] & s[42]) ^ (s[60] & s[79]) ^ (b[12] & b[95] & s[94]);
+	uint64_t y = h ^ s[93] ^ b[2] ^ b[15] ^ b[36] ^ b[45] ^ b[64] ^ b[73] ^ b[89];
 
-		cout << "odd list" << endl;
-		auto it2 = countingBox2.begin();
-		while (it2 != countingBox2.end()) {
-			if (((*it2).second % 2) == 1) {
-				cout << ((*it2).second % 2) << " | " << (*it2).second << "\t";
-				bitset<256> tmp = (*it2).first;
-				for (int i = 0; i < 128; i++) {
-					if ((tmp[i] == 1)) {
-						cout << "k" << (i + 1) << " ";
-					}
-				}
-				cout << endl;
-			}
-			it2++;
-		}
-		cout << endl;
+	b[128] = g ^ y;
+	s[128] = f ^ y;
+	b++;
+	s++;
 
-		cout << "even list" << endl;
-		it2 = countingBox2.begin();
-		while (it2 != countingBox2.end()) {
-			if (((*it2).second % 2) == 0) {
-				cout << ((*it2).second % 2) << " | " << (*it2).second << "\t";
-				bitset<256> tmp = (*it2).first;
-				for (int i = 0; i < 128; i++) {
-					if ((tmp[i] == 1)) {
-						cout << "k" << (i + 1) << " ";
-					}
-				}
-				cout << endl;
-			}
-			it2++;
+	return y;
+}
+/*
+Same as triviumSliced for Grain-128AEAD
+*/
+static uint64_t grainSliced(int evalNumRounds, const uint64_t* key, const uint64_t* iv, vector<int>& keystream, vector<uint64_t>& work) {
+
+	int total = evalNumRounds + keystream.size();
+	uint64_t* b;
+	uint64_t* s;
+	grainSlicedLoad(key, iv, total, work, b, s);
+	uint64_t alive = ~0ULL;
+	for (int r = 0; r < total; r++) {
+		uint64_t y = grainSlicedRound(b, s);
+		if (r >= evalNumRounds) {
+			alive &= ~(y ^ (keystream[r - evalNumRounds] ? ~0ULL : 0));
+			if (alive == 0)
+				break;
 		}
+	}
+	return alive;
 
-		cout << endl;
-		cout << endl;
+}
+/*
+Same as keySearchTrivium for Grain-128AEAD (keysearch_grain128a.txt).
+The cubes are those of the practical test, the other IV bits are 0 and the padding is 1...10.
+@Para
+evalNumRounds: the rounds (0: 50, the first round of the practical test)
+*/
+int keySearchGrain128a(int evalNumRounds, int threadNumber, unsigned long long seed, int freeBits, int maxDegree) {
+
+	int R = (evalNumRounds > 0) ? evalNumRounds : 50;
+	const int numCubes = 32;
+	verifyRandom draw(seed);
+	vector<int> key(128);
+	for (int i = 0; i < 128; i++)
+		key[i] = draw.bit();
+	cout << "seed " << seed << ", " << R << " rounds, planted key " << verifyHex(key, 16) << endl;
+
+	stringstream table;
+	table << "phase\tsec\tresult" << endl;
+	auto start = chrono::steady_clock::now();
+	auto lap = [&](string phase, string result) {
+		auto now = chrono::steady_clock::now();
+		table << phase << "\t" << chrono::duration<double>(now - start).count() << "\t" << result << endl;
+		start = now;
+	};
+
+	// offline: the superpolies (the enumerations are quiet)
+	gf2KeyRecovery system(128);
+	vector<vector<int>> cubes;
+	for (int c = 0; c < numCubes; c++) {
+		vector<int> cube, flag;
+		grainPracticalInstance([&](int n) { return draw.below(n); }, cube, flag);
+		flag.assign(256, 0);
+		for (int i = 0; i < 128; i++) {
+			flag[i] = 3;
+			if (i < 96)
+				flag[128 + i] = (cube[i] == 1) ? 2 : 0;
+			else if (i < 127)
+				flag[128 + i] = 1;
+		}
+		double dulation;
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		grainNativeEnumuration(cube, flag, R, countingBox, dulation, threadNumber, -1, false, 0, nativeMemLimit, true);
+		string name = "cube" + to_string(c);
+		system.add(name, countingBox, 0, 128, cube);
+		cubes.push_back(cube);
+	}
+	lap("superpolies", to_string(numCubes) + " cubes");
+
+	// online: the cube sums
+	string sums;
+	for (int c = 0; c < numCubes; c++) {
+		vector<int> iv(128, 0);
+		for (int i = 96; i < 127; i++)
+			iv[i] = 1;
+		sums += encryptionSum(R, cubes[c], iv, key) ? '1' : '0';
+	}
+	lap("cube sums", sums);
 
+	if (system.solve(cout, maxDegree, sums, threadNumber) < 0) {
+		cerr << "error" << endl;
+		return 1;
+	}
+	vector<int> bits = system.freeKeyBits();
+	lap("linear algebra", to_string(128 - bits.size()) + " linear equations");
+
+	vector<int> known(128, -1);
+	while (bits.size() > freeBits) {
+		int j = draw.below(bits.size());
+		known[bits[j]] = key[bits[j]];
+		bits.erase(bits.begin() + j);
 	}
+	vector<int> offset;
+	vector<vector<int>> basis;
+	system.keySpace(known, offset, basis);
+
+	vector<int> iv(128, 0);
+	for (int i = 0; i < 96; i++)
+		iv[i] = draw.bit();
+	for (int i = 96; i < 127; i++)
+		iv[i] = 1;
+	vector<int> keystream = grainKeystream(R, key, iv, 64);
+	cout << "2^" << basis.size() << " keys, iv " << verifyHex(iv, 12) << ", keystream ";
+	for (int j = 0; j < keystream.size(); j++)
+		cout << keystream[j];
+	cout << endl;
 
+	vector<uint64_t> ivWords(128);
+	for (int i = 0; i < 128; i++)
+		ivWords[i] = iv[i] ? ~0ULL : 0;
+	keySearch search(offset, basis, "grain128a " + to_string(R) + " rounds iv " + verifyHex(iv, 12), "keysearch_grain128a.ckpt");
+	vector<vector<int>> found;
+	uint64_t tested = search.run(threadNumber, [&](const uint64_t* k, vector<uint64_t>& work) {
+		return grainSliced(R, k, ivWords.data(), keystream, work);
+	}, found);
+	bool ok = false;
+	for (int i = 0; i < found.size(); i++) {
+		cout << "found " << verifyHex(found[i], 16) << ((found[i] == key) ? " (planted)" : "") << endl;
+		ok = ok || (found[i] == key);
+	}
+	lap("key search", to_string(tested) + " keys, " + to_string(found.size()) + " found");
+
+	ofstream result("keysearch_grain128a.txt");
+	cout << table.str();
+	result << "seed " << seed << ", " << R << " rounds, 2^" << basis.size() << " keys" << endl << table.str();
+	if (ok == false) {
+		cerr << "the planted key is not found" << endl;
+		return 1;
+	}
 	return 0;
 
+}
 
 
 
+/*
+Same as oracleTrivium for Grain-128AEAD (the IV is 96 bits, the padding is added by the oracle)
+*/
+int oracleGrain128a(string path, int threadNumber, unsigned long long seed) {
 
+	verifyRandom draw(seed);
+	vector<int> key(128);
+	vector<uint64_t> keyWords(128);
+	for (int i = 0; i < 128; i++) {
+		key[i] = draw.bit();
+		keyWords[i] = key[i] ? ~0ULL : 0;
+	}
+	auto kernel = [&](int rounds, const uint64_t* iv, vector<uint64_t>& work) {
+		uint64_t padded[128];
+		for (int i = 0; i < 128; i++)
+			padded[i] = (i < 96) ? iv[i] : ((i < 127) ? ~0ULL : 0);
+		uint64_t* b;
+		uint64_t* s;
+		grainSlicedLoad(keyWords.data(), padded, rounds + 1, work, b, s);
+		uint64_t y = 0;
+		for (int r = 0; r <= rounds; r++)
+			y = grainSlicedRound(b, s);
+		return y;
+	};
+
+	vector<vector<int>> ivs(64, vector<int>(128, 0));
+	vector<uint64_t> lanes(96, 0), work;
+	for (int l = 0; l < 64; l++) {
+		for (int i = 0; i < 96; i++) {
+			ivs[l][i] = draw.bit();
+			lanes[i] |= (uint64_t)ivs[l][i] << l;
+		}
+		for (int i = 96; i < 127; i++)
+			ivs[l][i] = 1;
+	}
+	uint64_t z = kernel(100, lanes.data(), work);
+	vector<int> cube(96, 0);
+	for (int l = 0; l < 64; l++) {
+		if (encryptionSum(100, cube, ivs[l], key) != ((z >> l) & 1)) {
+			cerr << "the bitsliced kernel differs from roundFuncGrain128a" << endl;
+			return 1;
+		}
+	}
+	return oracleServe(path, "grain128a", 96, threadNumber, kernel);
 
 }
 
+/***************************************
+ * Benchmark of the counting backends
+ ***************************************/
+/*
+Same as benchmarkTrivium for Grain-128AEAD
+@Para
+threadNumber: the number of threads for Gurobi and the native engine
+*/
+static void grainBenchInstance(vector<int>& cube, vector<int>& flag) {
+
+	cube.assign(96, 0);
+	cube[0] = 1;
+	cube[1] = 1;
+	cube[2] = 1;
+
+	flag.assign(256, 0);
+	for (int i = 0; i < 128; i++) {
+		flag[i] = 3;
+		if (i < 96)
+			flag[128 + i] = (cube[i] == 1) ? 2 : 1;
+	}
 
+}
+void benchmarkGrain128a(int threadNumber) {
 
+	vector<int> cube, flag;
+	grainBenchInstance(cube, flag);
 
+	cout << "rounds\tbackend\ttrails\tmonomials\tsec\tsame" << endl;
+	for (int r = 80; r <= 100; r += 5) {
+		map<bitset<256>, int, cmpBitset256> nativeBox;
+		double dulation;
+		long long nativeCount = grainNativeEnumuration(cube, flag, r, nativeBox, dulation, threadNumber, -1, false, 0, nativeMemLimit, true);
+		cout << r << "\tnative\t" << nativeCount << "\t" << nativeBox.size() << "\t" << dulation << "\t-" << endl;
+
+		vector<string> backends = { "cnf" };
+#ifndef NOGUROBI
+		backends.push_back("gurobi");
+#endif
+		for (int j = 0; j < backends.size(); j++) {
+			map<bitset<256>, int, cmpBitset256> countingBox;
+			struct twoStageGrain opt;
+			opt.backend = backends[j];
+			opt.quiet = true;
+			auto start = chrono::steady_clock::now();
+			grainThreeEnumuration(cube, flag, r, countingBox, dulation, threadNumber, -1, opt);
+			dulation = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			long long solCount = 0;
+			for (auto it = countingBox.begin(); it != countingBox.end(); it++)
+				solCount += (*it).second;
+			cout << r << "\t" << backends[j] << "\t" << solCount << "\t" << countingBox.size() << "\t" << dulation << "\t" << ((countingBox == nativeBox) ? "yes" : "NO") << endl;
+		}
+	}
 
+}
 
+/*
+Same as microbenchTrivium for Grain-128AEAD (micro_grain128a.txt). build is grainRound (funcF, funcG, funcH and funcO) on the Gurobi backend.
+@Para
+evalNumRounds: the rounds of the model (0: 190)
+*/
+int microbenchGrain128a(int evalNumRounds, string previous) {
+
+	if (evalNumRounds == 0)
+		evalNumRounds = 190;
+	vector<int> cube, flag;
+	grainBenchInstance(cube, flag);
+	verifyRandom rng(1);
+	microBench bench;
+	cout << "kernel\tvariant\tunit\tunits\tns/unit" << endl;
+
+	// build
+	double dulation;
+	struct twoStageGrain opt;
+	opt.quiet = true;
+	bench.run("build", "stub", "rounds", [&]() {
+		stubBackend stub;
+		opt.solver = &stub;
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, 1, -1, opt);
+		return (long long)evalNumRounds;
+	});
+#ifndef NOGUROBI
+	backendProfile("backend", false, false);
+	bench.run("build", "gurobi", "rounds", [&]() {
+		unique_ptr<divBackend> solver(newBackend("gurobi", "backend", 1));
+		struct pruneStat stat(evalNumRounds);
+		vector<bitset<256>> live = grainReachability(cube, flag, evalNumRounds, -1, opt);
+		int zero = solver->addVar();
+		solver->fix(zero, 0);
+		vector<vector<int>> s(evalNumRounds + 1, vector<int>(128));
+		vector<vector<int>> b(evalNumRounds + 1, vector<int>(128));
+		for (int i = 0; i < 128; i++) {
+			s[0][i] = (live[0][128 + i] == 1) ? solver->addVar() : zero;
+			b[0][i] = (live[0][i] == 1) ? solver->addVar() : zero;
+		}
+		for (int r = 0; r < evalNumRounds; r++) {
+			grainRound(*solver, b[r], s[r], b[r + 1], s[r + 1], live[r + 1], zero, stat, NULL);
+		}
+		grainOutput(*solver, b[evalNumRounds], s[evalNumRounds], zero, -1, stat, NULL);
+		// numVariables updates the model
+		solver->numVariables();
+		return (long long)evalNumRounds;
+	});
+#endif
+
+	// extract
+	{
+		int extractRounds = min(evalNumRounds, 100);
+		stubBackend sizing;
+		opt.solver = &sizing;
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		grainThreeEnumuration(cube, flag, extractRounds, countingBox, dulation, 1, -1, opt);
+		vector<vector<char>> solutions(1 << 13, vector<char>(sizing.numVariables()));
+		for (int k = 0; k < solutions.size(); k++) {
+			for (int i = 0; i < solutions[k].size(); i++) {
+				solutions[k][i] = rng.bit();
+			}
+		}
+		long long units;
+		double buildNs = bench.measure([&]() {
+			stubBackend stub;
+			opt.solver = &stub;
+			map<bitset<256>, int, cmpBitset256> box;
+			grainThreeEnumuration(cube, flag, extractRounds, box, dulation, 1, -1, opt);
+			return 1LL;
+		}, units);
+		double totalNs = bench.measure([&]() {
+			stubBackend stub(&solutions);
+			opt.solver = &stub;
+			map<bitset<256>, int, cmpBitset256> box;
+			grainThreeEnumuration(cube, flag, extractRounds, box, dulation, 1, -1, opt);
+			return 1LL;
+		}, units);
+		bench.add("extract", "stub", "solutions", solutions.size(), max(totalNs - buildNs, 0.0) / solutions.size());
+	}
 
+	// the counting box: random monomials of the key bits, the cube bits and the non-cube IV bits
+	vector<bitset<256>> keys(1 << 16);
+	for (int k = 0; k < keys.size(); k++) {
+		for (int i = 0; i < 128; i++) {
+			keys[k][i] = rng.bit();
+		}
+		for (int i = 0; i < 96; i++) {
+			keys[k][128 + i] = (cube[i] == 1) ? 1 : rng.bit();
+		}
+	}
+	bench.run("box.insert", "-", "inserts", [&]() {
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		for (int k = 0; k < keys.size(); k++) {
+			countingBox[keys[k]]++;
+		}
+		return (long long)keys.size();
+	});
+	map<bitset<256>, int, cmpBitset256> countingBox;
+	for (int k = 0; k < keys.size(); k++) {
+		countingBox[keys[k]] += 1 + rng.below(3);
+	}
+	bench.run("box.fold", "-", "monomials", [&]() {
+		int degree;
+		grainSuperpolySize(countingBox, cube, degree);
+		return (long long)countingBox.size();
+	});
+
+	// round functions (sink keeps the outputs alive)
+	volatile int sink = 0;
+	bench.run("round", "scalar", "rounds", [&]() {
+		bitset<128> b, s;
+		for (int i = 0; i < 128; i++) {
+			b[i] = rng.bit();
+			s[i] = rng.bit();
+		}
+		for (int r = 0; r < 4096; r++) {
+			sink ^= roundFuncGrain128a(b, s);
+		}
+		return 4096LL;
+	});
+	vector<uint64_t> key(128), iv(128), work;
+	for (int i = 0; i < 128; i++) {
+		key[i] = rng.next();
+		iv[i] = rng.next();
+	}
+	bench.run("round", "bitsliced", "rounds", [&]() {
+		uint64_t* b;
+		uint64_t* s;
+		grainSlicedLoad(key.data(), iv.data(), 4096, work, b, s);
+		uint64_t y = 0;
+		for (int r = 0; r < 4096; r++) {
+			y ^= grainSlicedRound(b, s);
+		}
+		sink ^= (int)(y & 1);
+		return 64LL * 4096;
+	});
 
+	// theoreticalSum
+	vector<int> keyBits(128), ivBits(128);
+	for (int i = 0; i < 128; i++) {
+		keyBits[i] = rng.bit();
+		ivBits[i] = (i < 96) ? rng.bit() : 1;
+	}
+	bench.run("theoreticalSum", "-", "monomials", [&]() {
+		sink ^= theoreticalSum(countingBox, cube, ivBits, keyBits);
+		return (long long)countingBox.size();
+	});
 
+	stringstream title;
+	title << "micro grain128a " << evalNumRounds << " rounds";
+	return bench.write("micro_grain128a.txt", title.str(), previous) ? 0 : 1;
 
+}
 
 
 
+#ifndef NOGUROBI
 /***************************************
- * Code for the practical verification
+ * Parameter profiles: racing and tuning
  ***************************************/
-static int roundFuncGrain128a(bitset<128>& b, bitset<128>& s) {
+/*
+Same as triviumRace for Grain-128AEAD
+*/
+int grainRace(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<256>, int, cmpBitset256>& countingBox, double& dulation, int threadNumber, int target, struct twoStageGrain opt, vector<string> variants) {
+
+	vector<map<bitset<256>, int, cmpBitset256>> boxes(variants.size());
+	vector<double> dulations(variants.size());
+	int subThreads = max(1, threadNumber / (int)variants.size());
+	int winner = tuneRace(variants.size(), [&](int i, atomic<bool>* stop) {
+		struct twoStageGrain sub = opt;
+		sub.profile = variants[i];
+		sub.stop = stop;
+		grainThreeEnumuration(cube, flag, evalNumRounds, boxes[i], dulations[i], subThreads, target, sub);
+	});
+
+	auto it = boxes[winner].begin();
+	while (it != boxes[winner].end()) {
+		countingBox[(*it).first] += (*it).second;
+		it++;
+	}
+	dulation = dulations[winner];
+	return winner;
 
-	int f = s[0] ^ s[7] ^ s[38] ^ s[70] ^ s[81] ^ s[96];
-	int g = s[0] ^ b[0] ^ b[26] ^ b[56] ^ b[91] ^ b[96] ^ (b[3] & b[67]) ^ (b[11] & b[13]) ^ (b[17] & b[18]) ^ (b[27] & b[59]) ^ (b[40] & b[48]) ^ (b[61] & b[65]) ^ (b[68] & b[84]);
-	g ^= (b[88] & b[92] & b[93] & b[95]) ^ (b[22] & b[24] & b[25]) ^ (b[70] & b[78] & b[82]);
-	int h = (b[12] & s[8]) ^ (s[13] & s[20]) ^ (b[95] & s[42]) ^ (s[60] & s[79]) ^ (b[12] & b[95] & s[94]);
-	int y = h ^ s[93] ^ b[2] ^ b[15] ^ b[36] ^ b[45] ^ b[64] ^ b[73] ^ b[89];
+}
 
-	b >>= 1;
-	b[127] = g ^ y;
+/*
+Same as tuneTrivium for Grain-128AEAD, with the instance of benchmarkGrain128a and the profiles grain128a, grain128a1 and grain128a2.
+The wall times are written into tune_grain128a.txt
+*/
+void tuneGrain128a(int evalNumRounds, int threadNumber, string race) {
 
-	s >>= 1;
-	s[127] = f ^ y;
+	vector<int> cube, flag;
+	grainBenchInstance(cube, flag);
 
-	return y;
-}
-static int encryptionSum(int evalNumRounds, vector<int> cube, vector<int> iv, vector<int> key) {
+	ofstream outputfile("tune_grain128a.txt", ios::app);
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << evalNumRounds << " rounds, " << threadNumber << " threads" << endl;
 
-	bitset<128> b, s;
-	for (int i = 0; i < 128; i++) {
-		b[i] = key[i];
-	}
-	for (int i = 0; i < 128; i++) {
-		if (iv[i] == 0) s[i] = 0;
-		else if (iv[i] == 1) s[i] = 1;
+	if (race.size() > 0) {
+		vector<string> variants = tuneVariants(race);
+		map<bitset<256>, int, cmpBitset256> countingBox;
+		double dulation;
+		auto start = chrono::steady_clock::now();
+		struct twoStageGrain stage;
+		stage.useTwoStage = true;
+		stage.quiet = true;
+		int winner = grainRace(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, -1, stage, variants);
+		double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		string name = (variants[winner].size() > 0) ? variants[winner] : "default";
+		cout << "race " << race << " : " << name << " wins in " << sec << " sec" << endl;
+		outputfile << "race " << race << " : " << name << " wins in " << sec << " sec" << endl;
+		return;
 	}
 
-	int DATA_SIZE = 0;
-	vector<int> map;
-	for (int i = 0; i < cube.size(); i++) {
-		DATA_SIZE += cube[i];
-		if (cube[i] == 1) {
-			map.push_back(i);
+	vector<vector<pair<string, string>>> grid = tuneGrid(tuneAxes("0"));
+	const char* stages[3] = { "grain128a", "grain128a1", "grain128a2" };
+	cout << "stage\tsec\tsame\tparameters" << endl;
+	for (int j = 0; j < 3; j++) {
+		map<bitset<256>, int, cmpBitset256> defaultBox;
+		double bestSec = -1;
+		int best = 0;
+		for (int g = 0; g < grid.size(); g++) {
+			sharedEnvPool().configure(string(stages[j]) + "/tune", grid[g]);
+
+			map<bitset<256>, int, cmpBitset256> countingBox;
+			double dulation;
+			auto start = chrono::steady_clock::now();
+			struct twoStageGrain stage;
+			stage.useTwoStage = (j > 0);
+			stage.profile = "tune";
+			stage.quiet = true;
+			grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, -1, stage);
+			double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			// the first point is the default profile
+			if (g == 0)
+				defaultBox = countingBox;
+			bool same = (countingBox == defaultBox);
+			if (same && ((bestSec < 0) || (sec < bestSec))) {
+				bestSec = sec;
+				best = g;
+			}
+			cout << stages[j] << "\t" << sec << "\t" << (same ? "yes" : "NO") << "\t" << tuneText(grid[g]) << endl;
+			outputfile << stages[j] << "\t" << sec << "\t" << (same ? "yes" : "NO") << "\t" << tuneText(grid[g]) << endl;
 		}
+		sharedEnvPool().configure(string(stages[j]) + "/tune", vector<pair<string, string>>());
+		cout << "suggested: " << stages[j] << " " << tuneText(grid[best]) << endl;
+		outputfile << "suggested: " << stages[j] << " " << tuneText(grid[best]) << endl;
 	}
 
-	int sum = 0;
-	for (int in = 0; in < (1 << DATA_SIZE); in++) {
-
-		bitset<128> tmp_b = b;
-		bitset<128> tmp_s = s;
-		for (int i = 0; i < DATA_SIZE; i++) {
-			tmp_s[map[i]] = ((in >> i) & 1);
+}
+/*
+Same as strategyTrivium for Grain-128AEAD. The table is also written into strategy_grain128a.txt
+*/
+void strategyGrain128a(int evalNumRounds, int threadNumber) {
+
+	vector<int> cube, flag;
+	grainBenchInstance(cube, flag);
+
+	ofstream outputfile("strategy_grain128a.txt", ios::app);
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << evalNumRounds << " rounds, " << threadNumber << " threads" << endl;
+
+	vector<pair<string, vector<pair<string, string>>>> strategies = tuneStrategies({ "b", "s" });
+	const char* stages[3] = { "grain128a", "grain128a1", "grain128a2" };
+	map<bitset<256>, int, cmpBitset256> defaultBox;
+	vector<double> defaultSec(2);
+	cout << "strategy\tsingle\ttwo-stage\tspeedup\tsame" << endl;
+	outputfile << "strategy\tsingle\ttwo-stage\tspeedup\tsame" << endl;
+	for (int k = 0; k < strategies.size(); k++) {
+		for (int j = 0; j < 3; j++) {
+			sharedEnvPool().configure(string(stages[j]) + "/strategy", strategies[k].second);
 		}
 
-		int z = 0;
-		for (int r = 0; r <= evalNumRounds; r++) {
-			z = roundFuncGrain128a(tmp_b, tmp_s);
+		vector<double> sec(2);
+		bool same = true;
+		for (int two = 0; two < 2; two++) {
+			map<bitset<256>, int, cmpBitset256> countingBox;
+			double dulation;
+			auto start = chrono::steady_clock::now();
+			struct twoStageGrain stage;
+			stage.useTwoStage = (two == 1);
+			stage.profile = "strategy";
+			stage.quiet = true;
+			grainThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, -1, stage);
+			sec[two] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			if ((k == 0) && (two == 0))
+				defaultBox = countingBox;
+			same = same && (countingBox == defaultBox);
 		}
-		sum ^= z;
+		if (k == 0)
+			defaultSec = sec;
+
+		double speedup = (defaultSec[0] + defaultSec[1]) / max(sec[0] + sec[1], 1e-9);
+		cout << strategies[k].first << "\t" << sec[0] << "\t" << sec[1] << "\t" << speedup << "\t" << (same ? "yes" : "NO") << endl;
+		outputfile << strategies[k].first << "\t" << sec[0] << "\t" << sec[1] << "\t" << speedup << "\t" << (same ? "yes" : "NO") << "\t" << tuneText(strategies[k].second) << endl;
+	}
+	for (int j = 0; j < 3; j++) {
+		sharedEnvPool().configure(string(stages[j]) + "/strategy", vector<pair<string, string>>());
 	}
 
-	return sum;
 }
-static int theoreticalSum(map<bitset<256>, int, cmpBitset256> countingBox, vector<int> cube, vector<int> iv, vector<int> key) {
 
-	int sum = 0;
-	auto it = countingBox.begin();
-	while (it != countingBox.end()) {
 
-		if (((*it).second % 2) == 1) {
+/*
+Same as benchmarkFormulationTrivium for Grain-128AEAD over the range of practicalTestGrain128a (50 to 119 rounds, every 7 rounds).
+The table is also written into formulation_grain128a.txt
+*/
+void benchmarkFormulationGrain128a(int threadNumber) {
 
-			int var = 1;
-			for (int i = 0; i < 256; i++) {
-				if ((*it).first[i] == 1) {
-					if (i < 128) {
-						var *= key[i];
-					}
-					else {
-						if (cube[i - 128] == 0) {
-							var *= iv[i - 128];
-						}
-					}
-				}
-			}
-			sum ^= var;
+	srand(1);
+	const char* formulations[3] = { "general", "linear", "merged" };
+	ofstream outputfile("formulation_grain128a.txt", ios::app);
+	outputfile << "++++++++++++++++++++++++++++" << endl;
 
+	int mismatch = 0;
+	cout << "rounds\tformulation\tvars\tconstrs\tgeneral\tpresolved vars\tpresolved constrs\tpresolve sec\tenumeration sec\tsame" << endl;
+	for (int r = 50; r < 120; r += 7) {
+		// a random cube of 1 to 4 bits and v0, v1, v2 as in practicalTestGrain128a (the flags of benchmarkGrain128a)
+		vector<int> cube(96, 0);
+		int numActBits = 1 + rand() % 4;
+		for (int i = 0; i < numActBits; i++) {
+			int index;
+			do {
+				index = rand() % 96;
+			} while (cube[index] == 1);
+			cube[index] = 1;
+		}
+		cube[0] = 1;
+		cube[1] = 1;
+		cube[2] = 1;
+		vector<int> flag(256, 0);
+		for (int i = 0; i < 128; i++) {
+			flag[i] = 3;
+			if (i < 96)
+				flag[128 + i] = (cube[i] == 1) ? 2 : 1;
 		}
 
-		it++;
+		// the exact reference by the native engine
+		map<bitset<256>, int, cmpBitset256> nativeBox;
+		double dulation;
+		grainNativeEnumuration(cube, flag, r, nativeBox, dulation, threadNumber, -1, false, 0, nativeMemLimit, true);
+
+		for (int j = 0; j < 3; j++) {
+			sharedEnvPool().configure("grain128a/formulation", { make_pair("Formulation", formulations[j]) });
+
+			map<bitset<256>, int, cmpBitset256> countingBox;
+			struct pruneStat report;
+			struct twoStageGrain stage;
+			stage.profile = "formulation";
+			stage.report = &report;
+			stage.quiet = true;
+			grainThreeEnumuration(cube, flag, r, countingBox, dulation, threadNumber, -1, stage);
+
+			bool same = (countingBox == nativeBox);
+			if (same == false)
+				mismatch++;
+			cout << r << "\t" << formulations[j] << "\t" << report.modelVars << "\t" << report.modelConstrs << "\t" << report.modelGenConstrs << "\t";
+			cout << report.presolvedVars << "\t" << report.presolvedConstrs << "\t" << report.presolveSec << "\t" << dulation << "\t" << (same ? "yes" : "NO") << endl;
+			outputfile << r << "\t" << formulations[j] << "\t" << report.modelVars << "\t" << report.modelConstrs << "\t" << report.modelGenConstrs << "\t";
+			outputfile << report.presolvedVars << "\t" << report.presolvedConstrs << "\t" << report.presolveSec << "\t" << dulation << "\t" << (same ? "yes" : "NO") << endl;
+		}
 	}
-	return sum;
-
-}
-void practicalTestGrain128a(void) {
+	sharedEnvPool().configure("grain128a/formulation", vector<pair<string, string>>());
 
+	if (mismatch == 0)
+		cout << "all formulations agree with the native engine" << endl;
+	else
+		cout << mismatch << " superpolys differ from the native engine" << endl;
 
-	//
-	ofstream outputfile, outputfile2;
-	outputfile.open("log_grain128a.txt");
-	outputfile2.open("log_grain128a2.txt");
+}
 
 
-	srand(time(NULL));
 
-	// create cube index at random
-	int numActBits = 1 + rand() % 4;
-	cout << numActBits << " active bits" << endl;
 
-	vector<int> cube(96, 0);
-	for (int i = 0; i < numActBits; i++) {
-		int index;
-		do {
-			index = (rand() % 96);
-		} while (cube[index] == 1);
-		cube[index] = 1;
-	}
-	cube[0] = 1;
-	cube[1] = 1;
-	cube[2] = 1;
+/***************************************
+ * Cube search
+ ***************************************/
+/*
+Same as cubeSearchTrivium for Grain-128AEAD. The ranked table is written into cubesearch_grain128a.txt
+*/
+int cubeSearchGrain128a(int evalNumRounds, int threadNumber, string family, int preRound, double screen, double budget) {
 
+	vector<cubeCandidate> candidates;
+	if (cubeCandidates(family, 96, candidates) == false)
+		return 0;
+	int numCandidates = candidates.size();
+	cout << numCandidates << " candidates of " << family << endl;
 
-	// fix non-IV bits at random
-	// constant (secret 3, active 2, const/undermined 1, const 0)
-	vector<int> flag(256, 0);
-	for (int i = 0; i < 128; i++) {
-		flag[i] = 3;
+	// stage 1: reachability of the cube bits and the degree bound
+	vector<vector<int>> flags(numCandidates);
+	int survivors = 0;
+	for (int c = 0; c < numCandidates; c++) {
+		cubeCandidate& cand = candidates[c];
+		auto start = chrono::steady_clock::now();
 
-		if (i < 96) {
-			if (cube[i] == 1) {
+		// constant (secret 3, active 2, const 1, const 0)
+		vector<int>& flag = flags[c];
+		flag.assign(256, 0);
+		int cubeSize = 0;
+		for (int i = 0; i < 128; i++) {
+			flag[i] = 3;
+		}
+		for (int i = 0; i < 96; i++) {
+			if (cand.cube[i] == 1) {
 				flag[128 + i] = 2;
-			}
-			else {
-				flag[128 + i] = 1;
+				cubeSize++;
 			}
 		}
-		else if (i == 127) {
-			flag[i] = 0;
+		for (int i = 96; i < 127; i++) {
+			flag[128 + i] = 1;
 		}
-		else {
-			flag[i] = 1;
+
+		vector<int> bound = grainDegreeBound(cand.cube, flag, evalNumRounds);
+		for (int t = 1; t <= 6; t++) {
+			if (bound[t - 1] < cubeSize)
+				continue;
+			struct twoStageGrain opt;
+			vector<bitset<256>> live = grainReachability(cand.cube, flag, evalNumRounds, t, opt);
+			bool reach = true;
+			for (int i = 0; i < 96; i++) {
+				if ((cand.cube[i] == 1) && (live[0][128 + i] == 0))
+					reach = false;
+			}
+			if (reach)
+				cand.targets.push_back(t);
 		}
+		cand.stage = 1;
+		if (cand.targets.size() == 0)
+			cand.status = "bound";
+		else
+			survivors++;
+		cand.sec += chrono::duration<double>(chrono::steady_clock::now() - start).count();
 	}
-	
-
-
-	// input
-	for (int i = 0; i < 96; i++) {
-		cout << flag[128 + i];
+	cout << "stage 1 (bound) : " << survivors << " candidates remain" << endl;
+
+	// hybrid mode
+	vector<vector<anfPoly<256>>> prePolys(numCandidates);
+	if (preRound > 0) {
+		for (int c = 0; c < numCandidates; c++) {
+			if (candidates[c].status.size() == 0)
+				prePolys[c] = grainANF(candidates[c].cube, flags[c], preRound);
+		}
 	}
-	cout << endl;
 
-	//
-	for (int r = 50; r < 120; r++) {
-		cout << "##############################" << endl;
-		cout << r << " rounds" << endl;
+	// stage 2: feasibility pass. *stop is true from the start, so the enumeration is skipped
+	jobScheduler sched(threadNumber, "schedule_cubesearch.txt");
+	vector<vector<int>> results(numCandidates);
+	vector<vector<double>> secs(numCandidates);
+	if (screen > 0) {
+		for (int c = 0; c < numCandidates; c++) {
+			cubeCandidate& cand = candidates[c];
+			if (cand.status.size() > 0)
+				continue;
+			results[c].assign(cand.targets.size(), 0);
+			secs[c].assign(cand.targets.size(), 0);
+			for (int k = 0; k < cand.targets.size(); k++) {
+				string name = "grain " + to_string(evalNumRounds) + " pre " + to_string(preRound) + " cube " + cand.text + " target " + to_string(cand.targets[k]) + " feasibility";
+				sched.add(name, [&, c, k]() {
+					auto start = chrono::steady_clock::now();
+					map<bitset<256>, int, cmpBitset256> box;
+					double dulation = 0;
+					atomic<bool> stop(true);
+					struct twoStageGrain stage;
+					stage.useTwoStage = true;
+					stage.preRound = preRound;
+					stage.prePoly = &prePolys[c];
+					stage.sched = &sched;
+					stage.stop = &stop;
+					stage.screen = screen;
+					results[c][k] = grainThreeEnumuration(candidates[c].cube, flags[c], evalNumRounds, box, dulation, sched.threads(), candidates[c].targets[k], stage);
+					secs[c][k] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				});
+			}
+		}
+		sched.run();
+
+		survivors = 0;
+		for (int c = 0; c < numCandidates; c++) {
+			cubeCandidate& cand = candidates[c];
+			if (cand.status.size() > 0)
+				continue;
+			vector<int> targets;
+			for (int k = 0; k < cand.targets.size(); k++) {
+				if (results[c][k] != -1)
+					targets.push_back(cand.targets[k]);
+				cand.sec += secs[c][k];
+			}
+			cand.targets = targets;
+			cand.stage = 2;
+			if (cand.targets.size() == 0) {
+				cand.status = "no trail";
+				prePolys[c].clear();
+			}
+			else
+				survivors++;
+		}
+		cout << "stage 2 (feasibility) : " << survivors << " candidates remain" << endl;
+	}
 
-		double dulation;
+	// stage 3: enumeration within the budget
+	vector<vector<map<bitset<256>, int, cmpBitset256>>> boxes(numCandidates);
+	vector<vector<char>> timeouts(numCandidates);
+	for (int c = 0; c < numCandidates; c++) {
+		cubeCandidate& cand = candidates[c];
+		if (cand.status.size() > 0)
+			continue;
+		boxes[c].resize(cand.targets.size());
+		timeouts[c].assign(cand.targets.size(), 0);
+		secs[c].assign(cand.targets.size(), 0);
+		for (int k = 0; k < cand.targets.size(); k++) {
+			string name = "grain " + to_string(evalNumRounds) + " pre " + to_string(preRound) + " cube " + cand.text + " target " + to_string(cand.targets[k]);
+			sched.add(name, [&, c, k]() {
+				auto start = chrono::steady_clock::now();
+				timeouts[c][k] = cubeDeadline(budget, [&](atomic<bool>* stop) {
+					double dulation = 0;
+					struct twoStageGrain stage;
+					stage.useTwoStage = true;
+					stage.preRound = preRound;
+					stage.prePoly = &prePolys[c];
+					stage.sched = &sched;
+					stage.stop = stop;
+					grainThreeEnumuration(candidates[c].cube, flags[c], evalNumRounds, boxes[c][k], dulation, sched.threads(), candidates[c].targets[k], stage);
+				});
+				secs[c][k] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			});
+		}
+	}
+	sched.run();
+
+	map<string, map<bitset<256>, int, cmpBitset256>> superpolys;
+	for (int c = 0; c < numCandidates; c++) {
+		cubeCandidate& cand = candidates[c];
+		if (cand.status.size() > 0)
+			continue;
+		cand.stage = 3;
+		bool timeout = false;
 		map<bitset<256>, int, cmpBitset256> countingBox;
-		grainThreeEnumuration(cube, flag, r, countingBox, dulation, 1);
-
-		if (countingBox.size() == 0) {
-			cout << "zero sum" << endl;
+		for (int k = 0; k < cand.targets.size(); k++) {
+			cand.sec += secs[c][k];
+			if (timeouts[c][k])
+				timeout = true;
+			auto it = boxes[c][k].begin();
+			while (it != boxes[c][k].end()) {
+				countingBox[(*it).first] += (*it).second;
+				it++;
+			}
+		}
+		if (timeout) {
+			cand.status = "timeout";
+			continue;
+		}
+		cand.monomials = grainSuperpolySize(countingBox, cand.cube, cand.degree);
+		if (cand.monomials == 0) {
+			cand.status = "zero sum";
 		}
 		else {
-			cout << "               key              \t";
-			cout << "            iv                ";
-			cout << "expe.   ";
-			cout << "theo.   ";
-			cout << endl;
-
-			for (int trial = 0; trial < 100; trial++) {
-
-				vector<int> key(128);
-				for (int i = 0; i < 128; i++)
-					key[i] = rand() % 2;
-
-				vector<int> iv(128);
-				for (int i = 0; i < 96; i++)
-					iv[i] = rand() % 2;
-				for (int i = 96; i < 127; i++)
-					iv[i] = 1;
-
-				int sum1 = encryptionSum(r, cube, iv, key);
-				int sum2 = theoreticalSum(countingBox, cube, iv, key);
-
-				for (int i = 15; i >= 0; i--) {
-					int hexvar = 0;
-					for (int j = 7; j >= 0; j--) {
-						hexvar ^= (key[8 * i + j] << j);
-					}
-					printf("%02x", hexvar);
-				}
-				cout << "\t";
-
-				for (int i = 11; i >= 0; i--) {
-					int hexvar = 0;
-					for (int j = 7; j >= 0; j--) {
-						hexvar ^= (iv[8 * i + j] << j);
-					}
-					printf("%02x", hexvar);
-				}
-				cout << "\t";
-
-				cout << sum1 << "\t" << sum2 << "\t";
-
-				if (sum1 == sum2) {
-					cout << "OK" << endl;
-				}
-				else {
-					cout << endl;
-					cout << "error" << endl;
-					cerr << "error" << endl;
-				}
-
-
-			}
-
+			cand.status = "superpoly";
+			superpolys[cand.text] = countingBox;
 		}
-
-
-		cout << endl << endl;
 	}
 
+	// ranked table
+	cubeRank(candidates);
+	ofstream outputfile("cubesearch_grain128a.txt");
+	outputfile << "# grain " << evalNumRounds << " " << family << " pre=" << preRound << " screen=" << screen << " budget=" << budget << endl;
+	cubeTable(cout, candidates);
+	cubeTable(outputfile, candidates);
+	for (int c = 0; c < numCandidates; c++) {
+		if (candidates[c].status != "superpoly")
+			continue;
+		outputfile << endl;
+		outputfile << "# rank " << (c + 1) << " cube=" << candidates[c].text << endl;
+		displayGrainSuperpoly(outputfile, superpolys[candidates[c].text], candidates[c].cube);
+	}
 
-
+	return 0;
 }
+#endif
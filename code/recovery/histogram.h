@@ -0,0 +1,160 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include<iostream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<chrono>
+#include<algorithm>
+#include<cstdint>
+
+using namespace std;
+
+/*
+A histogram of non-negative integers with a bounded relative error, as in HdrHistogram.
+The values below 16 have their own buckets, and every power of two above is split into 16 buckets,
+so a value is known within 1/16 of itself. record is O(1) and the memory is fixed (976 counters).
+*/
+class latencyHistogram {
+public:
+	latencyHistogram() : counts(976, 0) {}
+
+	void record(uint64_t value) {
+		counts[bucket(value)]++;
+		total++;
+		sum += value;
+		maxValue = std::max(maxValue, value);
+		minValue = std::min(minValue, value);
+	}
+
+	uint64_t count() const { return total; }
+	uint64_t max() const { return maxValue; }
+	uint64_t min() const { return (total > 0) ? minValue : 0; }
+	double mean() const { return (total > 0) ? (double)sum / total : 0; }
+
+	// the smallest bucket bound below which a fraction p of the values lies (the max for p = 1)
+	uint64_t percentile(double p) const {
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t)(p * total);
+		if (rank >= total)
+			return maxValue;
+		uint64_t seen = 0;
+		for (int i = 0; i < counts.size(); i++) {
+			seen += counts[i];
+			if (seen > rank)
+				return std::min(upper(i), maxValue);
+		}
+		return maxValue;
+	}
+
+	void merge(const latencyHistogram& other) {
+		for (int i = 0; i < counts.size(); i++)
+			counts[i] += other.counts[i];
+		total += other.total;
+		sum += other.sum;
+		maxValue = std::max(maxValue, other.maxValue);
+		minValue = std::min(minValue, other.minValue);
+	}
+
+	// "p50 a p90 b p99 c max d" with the values scaled by unit (e.g. 1e-6 for microseconds displayed in seconds)
+	string summary(double unit = 1) const {
+		stringstream ss;
+		ss << "p50 " << percentile(0.5) * unit << " p90 " << percentile(0.9) * unit << " p99 " << percentile(0.99) * unit << " max " << maxValue * unit;
+		return ss.str();
+	}
+
+private:
+	static int bucket(uint64_t value) {
+		if (value < 16)
+			return value;
+		int e = 63 - __builtin_clzll(value);
+		return 16 * (e - 3) + ((value >> (e - 4)) & 15);
+	}
+	// the largest value of bucket i
+	static uint64_t upper(int i) {
+		if (i < 16)
+			return i;
+		int e = i / 16 + 3;
+		uint64_t low = (16 + (uint64_t)(i % 16)) << (e - 4);
+		return low + ((1ULL << (e - 4)) - 1);
+	}
+
+	vector<uint64_t> counts;
+	uint64_t total = 0;
+	uint64_t sum = 0;
+	uint64_t maxValue = 0;
+	uint64_t minValue = UINT64_MAX;
+};
+
+/*
+The profile of the 1st stage of the two-stage enumeration, kept by its callback (threeEnumuration, threeEnumurationGrain).
+Every midpoint is bracketed by enter and leave, which record the time of the 2nd stage (microseconds) and its trails.
+The time inside the callback is the time of the 2nd stages, and the rest of the wall time is the search of the 1st stage,
+so a share inside close to 100% means that the 1st stage waits on the 2nd stages.
+The callbacks of Gurobi are not concurrent, so no lock is taken.
+*/
+class callbackProfile {
+public:
+	// interval: the seconds between two periodic reports
+	callbackProfile(double xinterval = 10) : interval(xinterval) {
+		start = chrono::steady_clock::now();
+		reported = start;
+	}
+
+	void enter() { entered = chrono::steady_clock::now(); }
+
+	void leave(long long trails) {
+		auto now = chrono::steady_clock::now();
+		double sec = chrono::duration<double>(now - entered).count();
+		inside += sec;
+		stageTime.record((uint64_t)(sec * 1e6));
+		trailCount.record((uint64_t)std::max(trails, 0LL));
+		midpoints++;
+	}
+
+	// true once per interval
+	bool due() {
+		auto now = chrono::steady_clock::now();
+		if (chrono::duration<double>(now - reported).count() < interval)
+			return false;
+		reported = now;
+		return true;
+	}
+
+	double wallSec() const { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+	double insideSec() const { return inside; }
+	long long numMidpoints() const { return midpoints; }
+
+	void report(ostream& out, string label) const {
+		double wall = wallSec();
+		double outside = std::max(wall - inside, 1e-9);
+		out << label << " " << wall << "sec : " << midpoints << " midpoints (" << (midpoints / std::max(wall, 1e-9)) << "/sec, "
+			<< (midpoints / outside) << "/sec of the 1st stage), inside the callback " << inside << "sec (" << (100 * inside / std::max(wall, 1e-9)) << "%)" << endl;
+		if (midpoints > 0) {
+			out << "\t2nd stage sec : mean " << stageTime.mean() * 1e-6 << " " << stageTime.summary(1e-6) << endl;
+			out << "\ttrails per midpoint : mean " << trailCount.mean() << " " << trailCount.summary() << endl;
+		}
+	}
+
+	// the values of the metrics record (see metrics.h)
+	vector<pair<string, double>> values() const {
+		return { { "midpoints", midpoints }, { "insideSec", inside }, { "wallSec", wallSec() },
+			{ "stageP50", stageTime.percentile(0.5) * 1e-6 }, { "stageP99", stageTime.percentile(0.99) * 1e-6 }, { "stageMax", stageTime.max() * 1e-6 },
+			{ "trailsP50", (double)trailCount.percentile(0.5) }, { "trailsP99", (double)trailCount.percentile(0.99) }, { "trailsMax", (double)trailCount.max() } };
+	}
+
+	latencyHistogram stageTime;
+	latencyHistogram trailCount;
+
+private:
+	double interval;
+	chrono::steady_clock::time_point start;
+	chrono::steady_clock::time_point reported;
+	chrono::steady_clock::time_point entered;
+	double inside = 0;
+	long long midpoints = 0;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<set>
+#include<functional>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<chrono>
+#include<cstdio>
+#include<cstdint>
+#include"native.h"
+
+using namespace std;
+
+/*
+Exhaustive key search over an affine space of keys (the keys left by the linear equations of gf2KeyRecovery).
+The key x of the space is offset + sum_j x_j basis[j]. The candidates are tested 64 at a time, bitsliced: word i of the key is the key bit i
+of 64 candidates (lane l is candidate l), the free bits 0 to 5 vary over the lanes and the others over the batches, and the batches are
+visited in Gray code order so that the next batch differs from the previous one by one basis vector.
+The batches are split into chunks which the threads take in order. The number of leading chunks done and the keys found are written to the
+checkpoint file at most once per second, and a search with the same id restarts from there. The file is removed at the end.
+*/
+class keySearch {
+public:
+	/*
+	@Para
+	offset: a key of the space (keySize bits)
+	basis: the directions of the free bits
+	id: the description of the search (the cipher, the rounds and the keystream), compared with the checkpoint
+	checkpoint: the checkpoint file ("" for none)
+	*/
+	keySearch(vector<int>& xoffset, vector<vector<int>>& xbasis, string xid, string xcheckpoint) : offset(xoffset), basis(xbasis), checkpoint(xcheckpoint) {
+		keySize = offset.size();
+		// the id covers the space, so a checkpoint of another space is not used
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		auto mix = [&](int bit) { hash = (hash ^ bit) * 0x100000001b3ULL; };
+		for (int i = 0; i < keySize; i++)
+			mix(offset[i]);
+		for (int j = 0; j < basis.size(); j++) {
+			for (int i = 0; i < keySize; i++)
+				mix(basis[j][i]);
+		}
+		char buf[17];
+		snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+		id = xid + " space " + buf;
+	}
+
+	/*
+	Run the search
+	threadNumber: the number of threads
+	test: the candidates of a batch (keySize words) are checked against the keystream, the lanes which pass are returned (work is a buffer of the thread)
+	found: the keys which passed
+	return: the number of keys tested (not counting the chunks restored from the checkpoint)
+	*/
+	uint64_t run(int threadNumber, function<uint64_t(const uint64_t*, vector<uint64_t>&)> test, vector<vector<int>>& found) {
+
+		int freeBits = basis.size();
+		int laneBits = min(freeBits, 6);
+		uint64_t laneMask = (laneBits == 6) ? ~0ULL : ((1ULL << (1 << laneBits)) - 1);
+		uint64_t numBatches = 1ULL << (freeBits - laneBits);
+		uint64_t chunkBatches = max<uint64_t>(1, min<uint64_t>(1 << 12, numBatches / (64 * max(threadNumber, 1))));
+		uint64_t numChunks = (numBatches + chunkBatches - 1) / chunkBatches;
+
+		// the lanes of the free bits 0 to 5
+		const uint64_t laneBit[6] = { 0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL, 0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL };
+		vector<uint64_t> lanes(keySize, 0);
+		for (int j = 0; j < laneBits; j++) {
+			for (int i = 0; i < keySize; i++) {
+				if (basis[j][i])
+					lanes[i] ^= laneBit[j];
+			}
+		}
+
+		set<vector<int>> keys;
+		uint64_t first = restore(numChunks, keys);
+		if (first > 0)
+			cerr << "the search restarts from chunk " << first << "/" << numChunks << " of " << checkpoint << endl;
+
+		mutex lock;
+		atomic<uint64_t> next(first);
+		atomic<uint64_t> tested(0);
+		vector<char> done(numChunks, 0);
+		uint64_t frontier = first;
+		auto start = chrono::steady_clock::now();
+		auto saved = start;
+
+		// the chunks are taken from next, so the thread index is not needed
+		nativeRun(max(threadNumber, 1), [&](int) {
+			vector<uint64_t> work;
+			vector<uint64_t> key(keySize);
+			vector<int> base(keySize);
+			while (true) {
+				uint64_t c = next++;
+				if (c >= numChunks)
+					break;
+				uint64_t last = min(numBatches, (c + 1) * chunkBatches);
+				for (uint64_t g = c * chunkBatches; g < last; g++) {
+					uint64_t gray = g ^ (g >> 1);
+					if (g == c * chunkBatches) {
+						base = offset;
+						for (int j = laneBits; j < freeBits; j++) {
+							if ((gray >> (j - laneBits)) & 1) {
+								for (int i = 0; i < keySize; i++)
+									base[i] ^= basis[j][i];
+							}
+						}
+					}
+					else {
+						int j = laneBits + __builtin_ctzll(g);
+						for (int i = 0; i < keySize; i++)
+							base[i] ^= basis[j][i];
+					}
+					for (int i = 0; i < keySize; i++)
+						key[i] = (base[i] ? ~0ULL : 0) ^ lanes[i];
+
+					uint64_t pass = test(key.data(), work) & laneMask;
+					while (pass) {
+						int l = __builtin_ctzll(pass);
+						pass &= pass - 1;
+						vector<int> k(keySize);
+						for (int i = 0; i < keySize; i++)
+							k[i] = (key[i] >> l) & 1;
+						lock_guard<mutex> guard(lock);
+						keys.insert(k);
+					}
+				}
+				tested += (last - c * chunkBatches) * (laneMask == ~0ULL ? 64 : __builtin_popcountll(laneMask));
+
+				lock_guard<mutex> guard(lock);
+				done[c] = 1;
+				while ((frontier < numChunks) && done[frontier])
+					frontier++;
+				auto now = chrono::steady_clock::now();
+				if (chrono::duration<double>(now - saved).count() >= 1.0) {
+					saved = now;
+					double sec = chrono::duration<double>(now - start).count();
+					cerr << "key search " << frontier << "/" << numChunks << " chunks, " << tested << " keys, " << (tested / sec / 1e6) << " Mkeys/s" << endl;
+					save(frontier, numChunks, keys);
+				}
+			}
+		});
+
+		found.assign(keys.begin(), keys.end());
+		if (checkpoint.size() > 0)
+			remove(checkpoint.c_str());
+		return tested;
+
+	}
+
+private:
+	// the checkpoint: the id, the number of leading chunks done and the keys found (one line each)
+	void save(uint64_t frontier, uint64_t numChunks, set<vector<int>>& keys) {
+		if (checkpoint.size() == 0)
+			return;
+		string tmp = checkpoint + ".tmp";
+		ofstream out(tmp);
+		out << id << endl;
+		out << frontier << " " << numChunks << endl;
+		for (auto it = keys.begin(); it != keys.end(); it++) {
+			for (int i = 0; i < keySize; i++)
+				out << (*it)[i];
+			out << endl;
+		}
+		out.close();
+		rename(tmp.c_str(), checkpoint.c_str());
+	}
+
+	// the first chunk to search (0 without a checkpoint of this search)
+	uint64_t restore(uint64_t numChunks, set<vector<int>>& keys) {
+		if (checkpoint.size() == 0)
+			return 0;
+		ifstream in(checkpoint);
+		string line;
+		if (!getline(in, line) || (line != id))
+			return 0;
+		uint64_t frontier = 0, chunks = 0;
+		if (!getline(in, line) || (sscanf(line.c_str(), "%llu %llu", (unsigned long long*)&frontier, (unsigned long long*)&chunks) != 2) || (chunks != numChunks))
+			return 0;
+		while (getline(in, line)) {
+			if (line.size() != keySize) {
+				keys.clear();
+				return 0;
+			}
+			vector<int> k(keySize);
+			for (int i = 0; i < keySize; i++)
+				k[i] = line[i] - '0';
+			keys.insert(k);
+		}
+		return frontier;
+	}
+
+	int keySize;
+	vector<int> offset;
+	vector<vector<int>> basis;
+	string id;
+	string checkpoint;
+};
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef LEGACY_H
+#define LEGACY_H
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<map>
+#include<set>
+#include<array>
+#include<algorithm>
+#include<chrono>
+#include<cstdint>
+#include<cstring>
+#include"superpoly.h"
+
+using namespace std;
+
+/*
+Reader of the text results printed by trivium(), grain128a() and grain128aSub(), and of the archived results in this repository
+(trivium842R_cube19_35.txt and the files in superpoly_grain128a). The recognized lines are
++++
+842 round trivium.                      the cipher and the number of rounds
+CONSTANT IV[27] / fill bits active      a new cube (grain128aSub, the archived Grain-128AEAD results)
+the index of cube                       followed by the cube, iv1, iv2, ...
+Target s162 / Target b12 * s8 (full)    a new target listing of display*Box, which ends at the next banner
+1 | 1689355	k1 v3 c286              a monomial with its number of trails (the parity first), in a target listing or in the final list
+zero sum	12.8sec                     the target has no trail
+Final solution                          the final list of display*Superpoly (odd list / even list are skipped)
+found monomials                         the final list of the archived Grain-128AEAD results, one monomial per line without count (count 1)
++++
+and any other line (logs, times, separators) is skipped.
+The file is mapped into memory and scanned line by line without a string per line, and the monomials are appended to flat arrays.
+*/
+
+/*
+A monomial in the layout of the parser: k[i] is bit i - 1, v[i] is bit 128 + i - 1 (both 1-origin, at most 128).
+The constant bits c are dropped as in display*Superpoly, so the counts of the monomials which differ only in c are summed on conversion
+*/
+struct legacyMonomial {
+	uint64_t mask[4];
+	uint64_t count;
+};
+
+/*
+One target listing or the final list
+name: the name of the target in the text (e.g. s162, b12 * s8), empty for the final list
+target: the target number (see triviumThreeEnumuration / grainThreeEnumuration), 0 for the final list or an unknown name
+zero: the listing is a zero sum
+*/
+struct legacyList {
+	string name;
+	int target;
+	bool zero;
+	vector<legacyMonomial> monomials;
+};
+
+/*
+The result of one cube
+label: empty, or "constant iv27" for the cubes of grain128aSub (the label of the target listings)
+cube: the active IV bits (1 for active)
+targets: the target listings in the order of the text
+final: the final list. hasFinal: the final list was found
+*/
+struct legacyResult {
+	string label;
+	vector<int> cube;
+	vector<legacyList> targets;
+	legacyList final;
+	bool hasFinal;
+};
+
+/*
+cipher: trivium or grain128a, detected from the first line or the size of the cube (more than 80 IV bits)
+rounds: 0 if the text does not give it
+bytes, sec: the size of the text and the time of the parse
+*/
+struct legacyFile {
+	string cipher;
+	int rounds;
+	vector<legacyResult> results;
+	size_t bytes;
+	double sec;
+};
+
+/*
+The number of a target name of trivium() and grainAddTargets, or 0
+*/
+inline int legacyTarget(string name) {
+	static const vector<string> names = { "s66", "s93", "s162", "s177", "s243", "s288",
+		"b12 * b95 * s94", "s60 * s79", "b95 * s42", "s13 * s20", "b12 * s8", "s93 + b2 + b15 + b36 + b45 + b64 + b73 + b89" };
+	static const vector<int> targets = { 1, 2, 3, 4, 5, 6, 1, 2, 3, 4, 5, 6 };
+	for (int i = 0; i < names.size(); i++) {
+		if (name == names[i])
+			return targets[i];
+	}
+	return 0;
+}
+
+inline bool legacyPrefix(const char* p, const char* end, const char* prefix) {
+	size_t n = strlen(prefix);
+	return ((size_t)(end - p) >= n) && (memcmp(p, prefix, n) == 0);
+}
+
+/*
+Read the variables "k1 v3 c286 " of [p, end) into the monomial. return false on an unknown token
+*/
+inline bool legacyVariables(const char* p, const char* end, legacyMonomial& mono) {
+	while (p < end) {
+		char kind = *p;
+		if ((kind == ' ') || (kind == '\t')) {
+			p++;
+			continue;
+		}
+		p++;
+		int index = 0;
+		while ((p < end) && ('0' <= *p) && (*p <= '9')) {
+			index = 10 * index + (*p - '0');
+			p++;
+		}
+		if ((index < 1) || ((kind != 'c') && (index > 128)))
+			return false;
+		if (kind == 'k')
+			mono.mask[(index - 1) / 64] |= (1ULL << ((index - 1) % 64));
+		else if (kind == 'v')
+			mono.mask[2 + (index - 1) / 64] |= (1ULL << ((index - 1) % 64));
+		else if (kind != 'c')
+			return false;
+	}
+	return true;
+}
+
+/*
+Parse the text file. On error, the reason and the line number are written to cerr and false is returned
+*/
+inline bool legacyParse(string filename, legacyFile& out) {
+
+	auto start = chrono::steady_clock::now();
+	int fd = open(filename.c_str(), O_RDONLY);
+	struct stat st;
+	if ((fd < 0) || (fstat(fd, &st) != 0)) {
+		cerr << "cannot open " << filename << endl;
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+	size_t size = st.st_size;
+	const char* data = "";
+	if (size > 0) {
+		void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED) {
+			cerr << "cannot map " << filename << endl;
+			close(fd);
+			return false;
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+		data = (const char*)map;
+	}
+	close(fd);
+
+	out.cipher = "";
+	out.rounds = 0;
+	out.results.assign(1, { "", vector<int>(), vector<legacyList>(), { "", 0, false, vector<legacyMonomial>() }, false });
+	out.bytes = size;
+
+	// the result of the latest banner receives the cube, the final list and the target listings without label,
+	// the target listings with a label (grain128aSub) go to the result of the label
+	int current = 0;
+	legacyList* list = NULL;
+	bool cubeLine = false;
+	bool found = false;
+	bool ok = true;
+	int lineNumber = 0;
+	auto result = [&](string label) {
+		if (label == "full")
+			label = "";
+		for (int i = 0; i < out.results.size(); i++) {
+			if (out.results[i].label == label)
+				return i;
+		}
+		out.results.push_back({ label, vector<int>(), vector<legacyList>(), { "", 0, false, vector<legacyMonomial>() }, false });
+		return (int)out.results.size() - 1;
+	};
+
+	const char* p = data;
+	const char* last = data + size;
+	while (ok && (p < last)) {
+		const char* end = (const char*)memchr(p, '\n', last - p);
+		if (end == NULL)
+			end = last;
+		const char* next = end + 1;
+		if ((end > p) && (end[-1] == '\r'))
+			end--;
+		lineNumber++;
+
+		if (cubeLine) {
+			// iv1, iv2, ...
+			cubeLine = false;
+			vector<int>& cube = out.results[current].cube;
+			cube.assign(128, 0);
+			int ivSize = 0;
+			for (const char* q = p; q + 2 < end; q++) {
+				if ((q[0] == 'i') && (q[1] == 'v')) {
+					int index = atoi(q + 2);
+					if ((index >= 1) && (index <= 128)) {
+						cube[index - 1] = 1;
+						ivSize = max(ivSize, index);
+					}
+				}
+			}
+			if (out.cipher.size() == 0)
+				out.cipher = (ivSize > 80) ? "grain128a" : "trivium";
+			cube.resize((out.cipher == "trivium") ? 80 : 96);
+		}
+		else if (((*p == '0') || (*p == '1')) && legacyPrefix(p + 1, end, " | ") && (list != NULL)) {
+			// 1 | 1689355	k1 v3
+			legacyMonomial mono = { { 0, 0, 0, 0 }, 0 };
+			const char* q = p + 4;
+			while ((q < end) && ('0' <= *q) && (*q <= '9')) {
+				mono.count = 10 * mono.count + (*q - '0');
+				q++;
+			}
+			ok = legacyVariables(q, end, mono);
+			list->monomials.push_back(mono);
+		}
+		else if (found && ((*p == 'k') || (*p == 'v'))) {
+			// k48 k50 (found monomials)
+			legacyMonomial mono = { { 0, 0, 0, 0 }, 1 };
+			ok = legacyVariables(p, end, mono);
+			list->monomials.push_back(mono);
+		}
+		else if (legacyPrefix(p, end, "Target ")) {
+			string name(p + 7, end);
+			string label;
+			size_t paren = name.rfind(" (");
+			if ((paren != string::npos) && (name.back() == ')')) {
+				label = name.substr(paren + 2, name.size() - paren - 3);
+				name = name.substr(0, paren);
+			}
+			legacyResult& res = out.results[(label.size() > 0) ? result(label) : current];
+			res.targets.push_back({ name, legacyTarget(name), false, vector<legacyMonomial>() });
+			list = &res.targets.back();
+			found = false;
+		}
+		else if (legacyPrefix(p, end, "zero sum") && (list != NULL)) {
+			list->zero = true;
+		}
+		else if (legacyPrefix(p, end, "Final solution") || legacyPrefix(p, end, "found monomials")) {
+			found = (*p == 'f');
+			out.results[current].hasFinal = true;
+			list = &out.results[current].final;
+		}
+		else if (legacyPrefix(p, end, "the index of cube")) {
+			cubeLine = true;
+		}
+		else if (legacyPrefix(p, end, "        CONSTANT IV[")) {
+			current = result("constant iv" + to_string(atoi(p + 20)));
+			list = NULL;
+			found = false;
+		}
+		else if (legacyPrefix(p, end, "        fill bits active")) {
+			current = result("");
+			list = NULL;
+			found = false;
+		}
+		else if (legacyPrefix(p, end, "++++") || legacyPrefix(p, end, "****") || legacyPrefix(p, end, "////")) {
+			list = NULL;
+			found = false;
+		}
+		else if ((out.rounds == 0) && ('1' <= *p) && (*p <= '9')) {
+			// 842 round trivium. / 190 round Grain128a.
+			const char* q = p;
+			int rounds = 0;
+			while ((q < end) && ('0' <= *q) && (*q <= '9')) {
+				rounds = 10 * rounds + (*q - '0');
+				q++;
+			}
+			if (legacyPrefix(q, end, " round trivium.")) {
+				out.rounds = rounds;
+				out.cipher = "trivium";
+			}
+			else if (legacyPrefix(q, end, " round Grain128a.")) {
+				out.rounds = rounds;
+				out.cipher = "grain128a";
+			}
+		}
+		p = next;
+	}
+	if (size > 0)
+		munmap((void*)data, size);
+	if (ok == false) {
+		cerr << filename << " line " << lineNumber << ": cannot read the monomial" << endl;
+		return false;
+	}
+
+	// the default result is dropped if every listing went to a labelled cube
+	if ((out.results.size() > 1) && (out.results[0].cube.size() == 0) && (out.results[0].targets.size() == 0) && (out.results[0].hasFinal == false))
+		out.results.erase(out.results.begin());
+	if (out.cipher.size() == 0)
+		out.cipher = "trivium";
+	out.sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return true;
+
+}
+
+/*
+Project the monomials (drop the cube bits), map them to the state of the cipher (see superpolyHeader), sort them and sum the counts of the same mask
+into the records of superpolyWriter::section
+*/
+inline vector<uint64_t> legacyRecords(vector<legacyMonomial>& monomials, vector<int>& cube, bool trivium) {
+
+	vector<legacyMonomial> sorted;
+	sorted.reserve(monomials.size());
+	for (int m = 0; m < monomials.size(); m++) {
+		legacyMonomial mono = monomials[m];
+		for (int i = 0; i < cube.size(); i++) {
+			if (cube[i] == 1)
+				mono.mask[2 + i / 64] &= ~(1ULL << (i % 64));
+		}
+		if (trivium) {
+			// v[i] is state bit 93 + i - 1, k[i] stays at i - 1 (at most 80)
+			uint64_t iv[2] = { mono.mask[2], mono.mask[3] };
+			mono.mask[2] = mono.mask[3] = 0;
+			for (int w = 0; w < 2; w++) {
+				while (iv[w]) {
+					int bit = 93 + w * 64 + __builtin_ctzll(iv[w]);
+					mono.mask[bit / 64] |= (1ULL << (bit % 64));
+					iv[w] &= iv[w] - 1;
+				}
+			}
+		}
+		sorted.push_back(mono);
+	}
+	sort(sorted.begin(), sorted.end(), [](const legacyMonomial& a, const legacyMonomial& b) { return superpolyLess(a.mask, b.mask, 4); });
+
+	int words = trivium ? 5 : 4;
+	vector<uint64_t> records;
+	for (int m = 0; m < sorted.size(); m++) {
+		if ((m > 0) && (superpolyLess(sorted[m - 1].mask, sorted[m].mask, 4) == false)) {
+			records.back() += sorted[m].count;
+			continue;
+		}
+		for (int w = 0; w < words; w++) {
+			records.push_back((w < 4) ? sorted[m].mask[w] : 0);
+		}
+		records.push_back(sorted[m].count);
+	}
+	return records;
+
+}
+
+/*
+Convert a text result into superpoly files (-convert): [file without .txt].spb, or [file without .txt]_[label].spb for each cube if the text has several (grain128aSub).
+Section 0 is the final list (the sum of the target listings if the text has no final list) and the other sections are the target listings.
+@Para
+filename: the text file
+rounds: the number of rounds if the text does not give it (e.g. 190 for the files in superpoly_grain128a)
+return: 0, or 1 on error
+*/
+inline int legacyConvert(string filename, int rounds) {
+
+	legacyFile text;
+	if (legacyParse(filename, text) == false)
+		return 1;
+	if (text.rounds == 0)
+		text.rounds = rounds;
+	size_t total = 0;
+	for (int r = 0; r < text.results.size(); r++) {
+		total += text.results[r].final.monomials.size();
+		for (int j = 0; j < text.results[r].targets.size(); j++) {
+			total += text.results[r].targets[j].monomials.size();
+		}
+	}
+	cout << filename << " : " << text.cipher << " " << text.rounds << " rounds, " << text.results.size() << " cubes, " << total << " lines of monomials, "
+		<< text.bytes / 1e6 << " MB in " << text.sec << " sec (" << text.bytes / 1e6 / max(text.sec, 1e-9) << " MB/sec)" << endl;
+
+	string base = filename;
+	if ((base.size() > 4) && (base.substr(base.size() - 4) == ".txt"))
+		base = base.substr(0, base.size() - 4);
+	bool trivium = (text.cipher == "trivium");
+	for (int r = 0; r < text.results.size(); r++) {
+		legacyResult& res = text.results[r];
+		if (res.cube.size() == 0) {
+			cerr << filename << ": the cube is missing (the index of cube)" << endl;
+			return 1;
+		}
+		vector<int> targets;
+		for (int j = 0; j < res.targets.size(); j++) {
+			targets.push_back(res.targets[j].target);
+		}
+		superpolyWriter writer(text.cipher, text.rounds, trivium ? 288 : 256, 0, trivium ? 80 : 128, trivium ? 93 : 128, trivium ? 80 : 96, res.cube, targets);
+
+		vector<legacyMonomial> all;
+		if (res.hasFinal == false) {
+			for (int j = 0; j < res.targets.size(); j++) {
+				all.insert(all.end(), res.targets[j].monomials.begin(), res.targets[j].monomials.end());
+			}
+		}
+		vector<uint64_t> records = legacyRecords(res.hasFinal ? res.final.monomials : all, res.cube, trivium);
+		writer.section(0, records);
+		for (int j = 0; j < res.targets.size(); j++) {
+			records = legacyRecords(res.targets[j].monomials, res.cube, trivium);
+			writer.section(res.targets[j].target, records);
+		}
+
+		string name = base;
+		if (text.results.size() > 1) {
+			name += "_" + res.label;
+			replace(name.begin(), name.end(), ' ', '_');
+		}
+		name += ".spb";
+		if (writer.write(name) == false)
+			return 1;
+		cout << name << " : " << res.targets.size() << " targets, " << (res.hasFinal ? "final list" : "no final list (sum of the targets)") << endl;
+	}
+	return 0;
+
+}
+
+/*
+The superpoly of one cube: the monomials with an odd number of trails in the final list (the sum of the target listings if the text has no final list)
+*/
+inline void legacyOdd(legacyResult& res, set<array<uint64_t, 4>>& odd) {
+	vector<legacyMonomial>* list = &res.final.monomials;
+	vector<legacyMonomial> all;
+	if (res.hasFinal == false) {
+		for (int j = 0; j < res.targets.size(); j++)
+			all.insert(all.end(), res.targets[j].monomials.begin(), res.targets[j].monomials.end());
+		list = &all;
+	}
+	map<array<uint64_t, 4>, uint64_t> counts;
+	for (int i = 0; i < list->size(); i++) {
+		legacyMonomial& mono = (*list)[i];
+		counts[{ { mono.mask[0], mono.mask[1], mono.mask[2], mono.mask[3] } }] += mono.count;
+	}
+	odd.clear();
+	for (auto it = counts.begin(); it != counts.end(); it++) {
+		if ((*it).second % 2 == 1)
+			odd.insert((*it).first);
+	}
+}
+
+/*
+The value of the superpoly (see legacyOdd) at the key and the IV (key[i] is k(i+1) and iv[i] is v(i+1))
+*/
+inline int legacyEvaluate(const set<array<uint64_t, 4>>& odd, vector<int>& key, vector<int>& iv) {
+	uint64_t x[4] = { 0, 0, 0, 0 };
+	for (int i = 0; (i < key.size()) && (i < 128); i++)
+		x[i / 64] |= (uint64_t)(key[i] & 1) << (i % 64);
+	for (int i = 0; (i < iv.size()) && (i < 128); i++)
+		x[2 + i / 64] |= (uint64_t)(iv[i] & 1) << (i % 64);
+	int sum = 0;
+	for (auto it = odd.begin(); it != odd.end(); it++) {
+		const array<uint64_t, 4>& mask = *it;
+		sum ^= ((mask[0] & ~x[0]) | (mask[1] & ~x[1]) | (mask[2] & ~x[2]) | (mask[3] & ~x[3])) == 0;
+	}
+	return sum;
+}
+
+/*
+Compare the superpolies of two text results (the result of a job and its golden file in the regression benchmark, see regress.h):
+the monomials with an odd number of trails in the final list of every cube (the sum of the target listings if the text has no final list)
+detail: the number of monomials, or the numbers of missing and extra monomials
+return: true if the superpolies are the same
+*/
+inline bool legacySame(string filename, string golden, string& detail) {
+
+	legacyFile text[2];
+	if (!legacyParse(filename, text[0]) || !legacyParse(golden, text[1])) {
+		detail = "cannot read";
+		return false;
+	}
+	if (text[0].results.size() != text[1].results.size()) {
+		detail = to_string(text[0].results.size()) + " cubes, " + to_string(text[1].results.size()) + " expected";
+		return false;
+	}
+	size_t total = 0, missing = 0, extra = 0;
+	for (int r = 0; r < text[0].results.size(); r++) {
+		set<array<uint64_t, 4>> odd[2];
+		for (int k = 0; k < 2; k++) {
+			legacyOdd(text[k].results[r], odd[k]);
+		}
+		total += odd[0].size();
+		for (auto it = odd[1].begin(); it != odd[1].end(); it++)
+			missing += (odd[0].count(*it) == 0);
+		for (auto it = odd[0].begin(); it != odd[0].end(); it++)
+			extra += (odd[1].count(*it) == 0);
+	}
+	if ((missing > 0) || (extra > 0)) {
+		detail = to_string(missing) + " monomials missing, " + to_string(extra) + " extra";
+		return false;
+	}
+	detail = to_string(total) + " monomials";
+	return true;
+
+}
+
+#endif
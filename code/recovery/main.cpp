@@ -1,4 +1,73 @@
 #include"main.h"
+#include"schedule.h"
+#include"manifest.h"
+#include"envpool.h"
+#include"superpoly.h"
+#include"legacy.h"
+#include"gf2.h"
+#include"oracle.h"
+#include"metrics.h"
+#include"asynclog.h"
+#include"regress.h"
+
+/*
+Write the result of the reachability pruning into the log file
+@Para
+outputfile: the log file
+stat: the statistics filled during the model construction
+perRound: if true, the number of live bits and the removed variables/constraints are written for every round
+*/
+void displayPruneStat(ostream& outputfile, struct pruneStat& stat, bool perRound) {
+
+	int removedVars = 0;
+	int removedConstrs = 0;
+	for (int r = 0; r < stat.removedVars.size(); r++) {
+		removedVars += stat.removedVars[r];
+		removedConstrs += stat.removedConstrs[r];
+	}
+
+	if (perRound) {
+		outputfile << "round\tlive\tremoved vars\tremoved constrs" << endl;
+		for (int r = 0; r < stat.liveBits.size(); r++) {
+			outputfile << r << "\t" << stat.liveBits[r];
+			if (r < stat.removedVars.size())
+				outputfile << "\t" << stat.removedVars[r] << "\t" << stat.removedConstrs[r];
+			outputfile << endl;
+		}
+	}
+	outputfile << "pruning : " << removedVars << " variables and " << removedConstrs << " constraints are removed (" << stat.vars << " variables, " << stat.constrs << " constraints and " << stat.genConstrs << " general constraints remain)" << endl;
+
+}
+
+/*
+Run all jobs of the manifest (see manifest.h) in this process.
+The targets of all jobs share one scheduler, so the thread budget, the timing records and the ANF of the hybrid mode are reused across the jobs.
+Each job writes its superpoly into its own result file. Without Gurobi (NOGUROBI), the models are solved by the embedded SAT solver (see backend.h).
+@Para
+filename: the manifest
+threadNumber: the global thread budget
+*/
+int runManifest(string filename, int threadNumber) {
+
+	vector<manifestJob> jobs;
+	if (readManifest(filename, jobs) == false)
+		return 0;
+	cerr << jobs.size() << " jobs are read from " << filename << endl;
+
+	jobScheduler sched(threadNumber, "schedule_manifest.txt");
+	for (int i = 0; i < jobs.size(); i++) {
+		if (jobs[i].cipher == "trivium")
+			triviumManifestJob(sched, jobs[i]);
+		else
+			grainManifestJob(sched, jobs[i]);
+	}
+	sched.run();
+#ifndef NOGUROBI
+	sharedEnvPool().report(cerr);
+#endif
+
+	return 0;
+}
 
 int main(int argc, char const* argv[]){
 	
@@ -7,6 +76,44 @@ int main(int argc, char const* argv[]){
   int threadNumber = 1;
 	int practical = 0;
 	int subcube = 0;
+	int preRound = 0;
+	double screen = 60;
+	double budget = 600;
+	int native = 0;
+	int bench = 0;
+	int micro = 0;
+	string compare;
+	int nopool = 0;
+	int tune = 0;
+	int strategy = 0;
+	int formulation = 0;
+	int verify = 0;
+	unsigned long long seed = time(NULL);
+	int trials = 100;
+	int keysearch = 0;
+	int freeBits = 20;
+	string oracle;
+	string client;
+	int cubeSize = 16;
+	int depth = 4;
+	string manifest;
+	string profiles;
+	string race;
+	string search;
+	string query;
+	string convert;
+	vector<string> monomials;
+	vector<string> recover;
+	string metrics;
+	string logLevel;
+	vector<string> summarize;
+	string regress;
+	string baseline = "regress_baseline.txt";
+	double threshold = 1.25;
+	bool rebaseline = false;
+	bool record = false;
+	int degree = 1;
+	string sums;
 
   for (int i = 0; i < argc; i++) {
     if (!strcmp(argv[i], "-r")) evalNumRounds = atoi(argv[i + 1]);
@@ -19,13 +126,158 @@ int main(int argc, char const* argv[]){
 
 		if (!strcmp(argv[i], "-subcube")) subcube = 1;
 
+		if (!strcmp(argv[i], "-pre")) preRound = atoi(argv[i + 1]);
+
+		if (!strcmp(argv[i], "-screen")) screen = atof(argv[i + 1]);
+
+		if (!strcmp(argv[i], "-native")) native = 1;
+		if (!strcmp(argv[i], "-midpoint")) native = 2;
+		if (!strcmp(argv[i], "-sweep")) native = 3;
+
+		if (!strcmp(argv[i], "-verify")) verify = 1;
+		if (!strcmp(argv[i], "-seed")) seed = strtoull(argv[i + 1], NULL, 10);
+		if (!strcmp(argv[i], "-trials")) trials = atoi(argv[i + 1]);
+
+		if (!strcmp(argv[i], "-keysearch")) keysearch = 1;
+		if (!strcmp(argv[i], "-free")) freeBits = atoi(argv[i + 1]);
+
+		if (!strcmp(argv[i], "-oracle")) oracle = argv[i + 1];
+		if (!strcmp(argv[i], "-client")) client = argv[i + 1];
+		if (!strcmp(argv[i], "-cube")) cubeSize = atoi(argv[i + 1]);
+		if (!strcmp(argv[i], "-depth")) depth = atoi(argv[i + 1]);
+
+		if (!strcmp(argv[i], "-bench")) bench = 1;
+		if (!strcmp(argv[i], "-micro")) micro = 1;
+		if (!strcmp(argv[i], "-compare")) compare = argv[i + 1];
+
+		if (!strcmp(argv[i], "-manifest")) manifest = argv[i + 1];
+
+		if (!strcmp(argv[i], "-nopool")) nopool = 1;
+
+		if (!strcmp(argv[i], "-profiles")) profiles = argv[i + 1];
+		if (!strcmp(argv[i], "-tune")) tune = 1;
+		if (!strcmp(argv[i], "-race")) race = argv[i + 1];
+		if (!strcmp(argv[i], "-strategy")) strategy = 1;
+		if (!strcmp(argv[i], "-formulation")) formulation = 1;
+
+		if (!strcmp(argv[i], "-search")) search = argv[i + 1];
+		if (!strcmp(argv[i], "-budget")) budget = atof(argv[i + 1]);
+
+		if (!strcmp(argv[i], "-query")) query = argv[i + 1];
+		if (!strcmp(argv[i], "-monomial")) monomials.push_back(argv[i + 1]);
+		if (!strcmp(argv[i], "-convert")) convert = argv[i + 1];
+
+		if (!strcmp(argv[i], "-recover")) recover.push_back(argv[i + 1]);
+		if (!strcmp(argv[i], "-degree")) degree = atoi(argv[i + 1]);
+		if (!strcmp(argv[i], "-sums")) sums = argv[i + 1];
+
+		if (!strcmp(argv[i], "-metrics")) metrics = argv[i + 1];
+		if (!strcmp(argv[i], "-summarize")) summarize.push_back(argv[i + 1]);
+		if (!strcmp(argv[i], "-loglevel")) logLevel = argv[i + 1];
+
+		if (!strcmp(argv[i], "-regress")) regress = argv[i + 1];
+		if (!strcmp(argv[i], "-baseline")) baseline = argv[i + 1];
+		if (!strcmp(argv[i], "-threshold")) threshold = atof(argv[i + 1]);
+		if (!strcmp(argv[i], "-rebaseline")) rebaseline = true;
+		if (!strcmp(argv[i], "-record")) record = true;
+
   }
 
   cerr << endl;
+	if (summarize.size() > 0)
+		return metricsSummarize(summarize);
+	if ((metrics.size() > 0) && (sharedMetrics().open(metrics) == false))
+		return 0;
+	if (logLevel.size() > 0) {
+		vector<string> levels = { "error", "warn", "info", "debug" };
+		auto it = find(levels.begin(), levels.end(), logLevel);
+		if (it == levels.end()) {
+			cerr << "'-loglevel' is error, warn, info or debug" << endl;
+			return 0;
+		}
+		sharedLog().setLevel(it - levels.begin());
+	}
+	if (regress.size() > 0) {
+		// engine=milp runs the two-stage scheduler on Gurobi, or on the embedded SAT solver in the NOGUROBI build
+		auto runCase = [&](manifestJob& job) {
+			if (job.engine == "native")
+				return (job.cipher == "trivium") ? triviumNativeJob(job, threadNumber) : grainNativeJob(job, threadNumber);
+			jobScheduler sched(threadNumber, "schedule_regress.txt");
+			if (job.cipher == "trivium")
+				triviumManifestJob(sched, job);
+			else
+				grainManifestJob(sched, job);
+			sched.run();
+			return 0;
+		};
+		// the golden superpolies of cubes up to 20 bits are checked against the cube sums of the cipher (256 random trials and one per monomial)
+		auto check = [&](manifestJob& job, string golden, string& detail) {
+			return (job.cipher == "trivium") ? triviumGoldenCheck(job, golden, 256, 20, detail) : grainGoldenCheck(job, golden, 256, 20, detail);
+		};
+		return regressRun(regress, baseline, threshold, rebaseline, record, runCase, legacySame, check);
+	}
+	if (query.size() > 0)
+		return superpolyQuery(query, monomials);
+	if (convert.size() > 0)
+		return legacyConvert(convert, evalNumRounds);
+	if (recover.size() > 0)
+		return gf2Recover(recover, degree, sums, threadNumber);
+	if (oracle.size() > 0) {
+		if (target == 0) {
+			cerr << "'-oracle' needs -trivium or -grain" << endl;
+			return 0;
+		}
+		return (target == 1) ? oracleTrivium(oracle, threadNumber, seed) : oracleGrain128a(oracle, threadNumber, seed);
+	}
+	if (client.size() > 0) {
+		if ((cubeSize < 6) || (cubeSize > 30) || (depth < 1) || (evalNumRounds <= 0)) {
+			cerr << "'-client' needs '-r [number of rounds]', '-cube [number of cube bits]' from 6 to 30 and '-depth [requests in flight]' > 0" << endl;
+			return 0;
+		}
+		return oracleBench(client, evalNumRounds, cubeSize, depth);
+	}
+#ifndef NOGUROBI
+	if (nopool) {
+		cerr << "a fresh Gurobi environment is created for every solve" << endl;
+		sharedEnvPool().setEnabled(false);
+	}
+	if (profiles.size() > 0) {
+		if (sharedEnvPool().load(profiles) == false)
+			return 0;
+		cerr << "the parameter profiles are read from " << profiles << endl;
+	}
+#else
+	if ((profiles.size() > 0) || tune || strategy || formulation || (search.size() > 0)) {
+		cerr << "Built without Gurobi (NOGUROBI). '-profiles', '-tune', '-strategy', '-formulation' and '-search' are not supported." << endl;
+		return 0;
+	}
+#endif
+	if (manifest.size() > 0) {
+		cerr << "Batch jobs from the manifest. " << threadNumber << " cores are used." << endl;
+		return runManifest(manifest, threadNumber);
+	}
   if (target == 1) {
 		if (practical) {
 			cerr << "Practical verification for trivium." << endl;
 		}
+		else if (bench) {
+			cerr << "Benchmark of the counting backends for trivium." << endl;
+		}
+		else if (micro) {
+			cerr << "Microbenchmarks of the hot paths for trivium." << endl;
+		}
+		else if (formulation) {
+			cerr << "Equivalence check and benchmark of the COPY formulations for trivium." << endl;
+		}
+		else if (tune) {
+			cerr << "Tuning of the parameter profiles for " << evalNumRounds << " round trivium." << endl;
+		}
+		else if (strategy) {
+			cerr << "Benchmark of the search strategies for " << evalNumRounds << " round trivium." << endl;
+		}
+		else if (search.size() > 0) {
+			cerr << "Cube search over " << search << " for " << evalNumRounds << " round trivium." << endl;
+		}
 		else {
 			cerr << evalNumRounds << " round trivium." << endl;
 		}
@@ -34,6 +286,24 @@ int main(int argc, char const* argv[]){
 		if (practical) {
 			cerr << "Practical verification for Grain-128AEAD." << endl;
 		}
+		else if (bench) {
+			cerr << "Benchmark of the counting backends for Grain-128AEAD." << endl;
+		}
+		else if (micro) {
+			cerr << "Microbenchmarks of the hot paths for Grain-128AEAD." << endl;
+		}
+		else if (formulation) {
+			cerr << "Equivalence check and benchmark of the COPY formulations for Grain-128AEAD." << endl;
+		}
+		else if (tune) {
+			cerr << "Tuning of the parameter profiles for " << evalNumRounds << " round Grain128a." << endl;
+		}
+		else if (strategy) {
+			cerr << "Benchmark of the search strategies for " << evalNumRounds << " round Grain128a." << endl;
+		}
+		else if (search.size() > 0) {
+			cerr << "Cube search over " << search << " for " << evalNumRounds << " round Grain128a." << endl;
+		}
 		else {
 			cerr << evalNumRounds << " round Grain128a." << endl;
 		}
@@ -49,12 +319,94 @@ int main(int argc, char const* argv[]){
 		cerr << "Sorry, subcube option only works in the application to Grain." << endl;
 	}
 
+	if (bench) {
+		if (target == 1)
+			benchmarkTrivium(threadNumber);
+		else
+			benchmarkGrain128a(threadNumber);
+		return 0;
+	}
+	if (micro) {
+		if (target == 1)
+			return microbenchTrivium(evalNumRounds, compare);
+		else
+			return microbenchGrain128a(evalNumRounds, compare);
+	}
+#ifndef NOGUROBI
+	if (formulation) {
+		if (target == 1)
+			benchmarkFormulationTrivium(threadNumber);
+		else
+			benchmarkFormulationGrain128a(threadNumber);
+		return 0;
+	}
+#endif
+
   if (evalNumRounds == 0) {
 		if (practical == 0) {
 			cerr << "Please set option about number of rounds as '-r [number of rounds]'" << endl;
 			return 0;
 		}
   }
+#ifndef NOGUROBI
+	if (tune) {
+		if (target == 1)
+			tuneTrivium(evalNumRounds, threadNumber, race);
+		else
+			tuneGrain128a(evalNumRounds, threadNumber, race);
+		sharedEnvPool().report(cerr);
+		return 0;
+	}
+	if (strategy) {
+		if (target == 1)
+			strategyTrivium(evalNumRounds, threadNumber);
+		else
+			strategyGrain128a(evalNumRounds, threadNumber);
+		return 0;
+	}
+#endif
+	if ((preRound > 0) && ((practical == 1) || (preRound >= evalNumRounds))) {
+		cerr << "'-pre [number of rounds]' needs to be smaller than the number of rounds and does not work with -practical" << endl;
+		return 0;
+	}
+#ifndef NOGUROBI
+	if (search.size() > 0) {
+		if (target == 1)
+			cubeSearchTrivium(evalNumRounds, threadNumber, search, preRound, screen, budget);
+		else
+			cubeSearchGrain128a(evalNumRounds, threadNumber, search, preRound, screen, budget);
+		sharedEnvPool().report(cerr);
+		return 0;
+	}
+#endif
+#ifdef NOGUROBI
+	// the MILP models are solved by the embedded SAT solver (see backend.h)
+	if (native == 3) {
+		cerr << "'-sweep' needs Gurobi" << endl;
+		return 0;
+	}
+#endif
+	if ((native > 0) && (practical == 0)) {
+		cerr << "'-native', '-midpoint' and '-sweep' only work with -practical" << endl;
+		return 0;
+	}
+	if (verify && ((practical == 0) || (native == 3) || (trials <= 0) || ((evalNumRounds > 0) && (evalNumRounds < ((target == 1) ? 300 : 50))))) {
+		cerr << "'-verify' only works with -practical, does not work with -sweep, and needs '-trials [number]' > 0 and '-r [last round]' from 300 (trivium) or 50 (grain)" << endl;
+		return 0;
+	}
+	if (keysearch && ((practical == 0) || verify || (freeBits < 0) || (freeBits > 48))) {
+		cerr << "'-keysearch' only works with -practical, does not work with -verify, and needs '-free [number of key bits]' from 0 to 48" << endl;
+		return 0;
+	}
+	if (native == 1)
+		cerr << "the division trails are counted by the native engine without MILP" << endl;
+	else if (native == 2)
+		cerr << "the division trails are counted by the native engine with the batched expansion of the midpoints" << endl;
+	else if (native == 3)
+		cerr << "the division trails are counted by one MILP model extended round by round" << endl;
+	if (preRound > 0)
+		cerr << "the first " << preRound << " rounds are expanded as ANF" << endl;
+
 	if(practical == 0)
 	  cerr << evalNumRounds << " cores are used. to change, set '-r [number of rounds]'" << endl;
   cerr << threadNumber << " cores are used. to change, set '-t [number of threads]'" << endl;
@@ -64,26 +416,41 @@ int main(int argc, char const* argv[]){
 
   if (target == 1) {
 
-		if (practical) {
-			practicalTestTrivium();
+		if (practical && verify) {
+			return differentialTestTrivium(evalNumRounds, native, threadNumber, seed, trials);
+		}
+		else if (practical && keysearch) {
+			return keySearchTrivium(evalNumRounds, threadNumber, seed, freeBits, degree);
+		}
+		else if (practical) {
+			practicalTestTrivium(native);
 		}
 		else {
-			trivium(evalNumRounds, threadNumber);
+			trivium(evalNumRounds, threadNumber, preRound, screen);
 		}
 
   }else if (target == 2) {
 
-		if (practical) {
-			practicalTestGrain128a();
+		if (practical && verify) {
+			return differentialTestGrain128a(evalNumRounds, native, threadNumber, seed, trials);
+		}
+		else if (practical && keysearch) {
+			return keySearchGrain128a(evalNumRounds, threadNumber, seed, freeBits, degree);
+		}
+		else if (practical) {
+			practicalTestGrain128a(native);
 		}
 		else if (subcube) {
-			grain128aSub(evalNumRounds, threadNumber);
+			grain128aSub(evalNumRounds, threadNumber, preRound, screen);
 		}
 		else {
-			grain128a(evalNumRounds, threadNumber);
+			grain128a(evalNumRounds, threadNumber, preRound, screen);
 		}
 
   }
+#ifndef NOGUROBI
+	sharedEnvPool().report(cerr);
+#endif
 
   return 0;
 }
@@ -1,4 +1,6 @@
+#ifndef NOGUROBI
 #include"gurobi_c++.h"
+#endif
 #include<iostream>
 #include<fstream>
 #include<string>
@@ -9,12 +11,120 @@
 #include<map>
 #include<iomanip>
 #include<cmath>
+#include<ctime>
+#include<chrono>
+#include<memory>
+#include<atomic>
 
 using namespace std;
 
-void practicalTestTrivium(void);
-int trivium(int evalNumRounds, int threadNumber);
+/*
+Statistics of the reachability pruning applied before the MILP model is constructed.
+liveBits[r]: the number of state bits at round r which can carry a nonzero division property
+removedVars[r], removedConstrs[r]: the number of variables and constraints of round r which are not generated
+vars, constrs, genConstrs: running counters of the generated variables, linear constraints and general constraints
+(in Grain-128a a COPY counts as one constraint, or one general constraint, in every formulation)
+formulation: the encoding of the COPY gadgets (Formulation of the profile, see envpool.h). "" is the default of the cipher
+modelVars, modelConstrs, modelGenConstrs: the size of the model handed to the solver
+presolvedVars, presolvedConstrs, presolveSec: the size after the presolve and its time (only filled for the benchmarks)
+pending: the taps of the current round merged into one COPY per bit (formulation "merged", see grainFlushTaps)
+rounds: the number of rounds of the per-round statistics (0: only the counters)
+*/
+struct pruneStat {
+	pruneStat(int rounds = 0) : liveBits((rounds > 0) ? rounds + 1 : 0), removedVars(rounds), removedConstrs(rounds) {}
+	vector<int> liveBits;
+	vector<int> removedVars;
+	vector<int> removedConstrs;
+	int vars = 0;
+	int constrs = 0;
+	int genConstrs = 0;
+	string formulation;
+	int modelVars = 0;
+	int modelConstrs = 0;
+	int modelGenConstrs = 0;
+	int presolvedVars = 0;
+	int presolvedConstrs = 0;
+	double presolveSec = 0;
+	vector<pair<int*, vector<int>>> pending;
+};
+void displayPruneStat(ostream& outputfile, struct pruneStat& stat, bool perRound);
 
-void practicalTestGrain128a(void);
-int grain128a(int evalNumRounds, int threadNumber);
-int grain128aSub(int evalNumRounds, int threadNumber);
+/*
+native: 0 -> MILP (on the embedded SAT solver in the NOGUROBI build), 1 -> native engine, 2 -> native engine with the batched expansion of the midpoints (see nativeMidpoints), 3 -> MILP model extended round by round (see triviumSweep)
+*/
+void practicalTestTrivium(int native = 0);
+void practicalTestGrain128a(int native = 0);
+/*
+evalNumRounds: the last round (0: the last round of the practical test)
+seed: the seed of the cube and the trials (see verifyRun), trials: the number of random keys and IVs per round
+return: 0 if all trials passed, 1 otherwise (the exit status of -verify)
+*/
+int differentialTestTrivium(int evalNumRounds, int native, int threadNumber, unsigned long long seed, int trials);
+int differentialTestGrain128a(int evalNumRounds, int native, int threadNumber, unsigned long long seed, int trials);
+/*
+evalNumRounds: the rounds of the key recovery (0: the first round of the practical test)
+seed: the planted key, the cubes and the IV, freeBits: the number of unknown key bits in the key search, maxDegree: see gf2KeyRecovery::solve
+return: 0 if the planted key is found, 1 otherwise (the exit status of -keysearch)
+*/
+int keySearchTrivium(int evalNumRounds, int threadNumber, unsigned long long seed, int freeBits, int maxDegree);
+int keySearchGrain128a(int evalNumRounds, int threadNumber, unsigned long long seed, int freeBits, int maxDegree);
+/*
+The keystream oracle on the Unix socket path with the secret key drawn from seed (-oracle, see oracleServe). Runs until the process is stopped
+*/
+int oracleTrivium(string path, int threadNumber, unsigned long long seed);
+int oracleGrain128a(string path, int threadNumber, unsigned long long seed);
+void benchmarkTrivium(int threadNumber);
+void benchmarkGrain128a(int threadNumber);
+/*
+The microbenchmarks of the hot paths (see microbench.h)
+evalNumRounds: the rounds of the model (0: 840 for trivium, 190 for grain)
+previous: the result of a previous run to be compared with (empty: none)
+*/
+int microbenchTrivium(int evalNumRounds, string previous);
+int microbenchGrain128a(int evalNumRounds, string previous);
+/*
+One job of the manifest counted by the native engine, and the check of a golden file against the cube sums of the cipher,
+for the regression benchmark (see regress.h)
+*/
+struct manifestJob;
+int triviumNativeJob(struct manifestJob& job, int threadNumber);
+int grainNativeJob(struct manifestJob& job, int threadNumber);
+bool triviumGoldenCheck(struct manifestJob& job, string golden, int trials, int maxCube, string& detail);
+bool grainGoldenCheck(struct manifestJob& job, string golden, int trials, int maxCube, string& detail);
+/*
+The jobs of the manifest counted by the MILP model (see runManifest), on the embedded SAT solver in the NOGUROBI build
+*/
+class jobScheduler;
+void triviumManifestJob(jobScheduler& sched, struct manifestJob& job);
+void grainManifestJob(jobScheduler& sched, struct manifestJob& job);
+
+/*
+screen: the time limit of the feasibility pass of each target in sec (0: no feasibility pass, see twoStage)
+*/
+int trivium(int evalNumRounds, int threadNumber, int preRound = 0, double screen = 60);
+int grain128a(int evalNumRounds, int threadNumber, int preRound = 0, double screen = 60);
+int grain128aSub(int evalNumRounds, int threadNumber, int preRound = 0, double screen = 60);
+
+#ifndef NOGUROBI
+
+/*
+Tuning harness of the parameter profiles (see envpool.h). race: the variants to be raced, e.g. "default,fast", or empty to tune on the grid
+*/
+void tuneTrivium(int evalNumRounds, int threadNumber, string race);
+void tuneGrain128a(int evalNumRounds, int threadNumber, string race);
+/*
+Benchmark of the branching priorities and the objectives of the profiles on a reduced-round instance
+*/
+void strategyTrivium(int evalNumRounds, int threadNumber);
+void strategyGrain128a(int evalNumRounds, int threadNumber);
+/*
+Equivalence check and benchmark of the COPY formulations over the ranges of the practical tests
+*/
+void benchmarkFormulationTrivium(int threadNumber);
+void benchmarkFormulationGrain128a(int threadNumber);
+/*
+Cube search over a family of candidates (see cubesearch.h): the degree bound, the feasibility pass and the enumeration limited to budget sec
+*/
+int cubeSearchTrivium(int evalNumRounds, int threadNumber, string family, int preRound, double screen, double budget);
+int cubeSearchGrain128a(int evalNumRounds, int threadNumber, string family, int preRound, double screen, double budget);
+#endif
@@ -0,0 +1,188 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<cstdlib>
+
+using namespace std;
+
+/*
+One job of the batch manifest.
+The manifest is a text file with one job per line. Empty lines and lines starting with # are ignored.
+A line starts with the cipher and the number of rounds, followed by key=value fields:
++++
+trivium 840 cube=1-33,35-46,48-80 targets=all
+grain 190 cube=1-26,28-96 const=27 targets=6,5 div=95 pre=30 out=grain190_iv27.txt
++++
+cube: the active IV bits (1-origin, ranges with -)
+const: the non-cube IV bits regarded as undetermined constants (flag 1). The other non-cube IV bits are 0
+targets: all or the list of the evaluation targets (see triviumThreeEnumuration / grainThreeEnumuration)
+div: the round of the midpoint in the two-stage enumeration (default: the middle of pre and the number of rounds)
+pre: the number of rounds expanded as ANF (see -pre). The const bits stay variables of the ANF, so they appear in the superpoly as with the MILP
+screen: the time limit of the feasibility pass of each target in sec (default: 60, 0: no feasibility pass, see -screen)
+monomial: the key bits of the monomial J (1-origin, only for 855disproof)
+out: the result file (default: result_[line number].txt)
+engine: milp (default) or native, the counting backend of the job in the regression benchmark (see regress.h)
+golden: the expected result of the job in the regression benchmark (default: golden/[out])
+*/
+struct manifestJob {
+	int line;
+	string cipher;
+	int rounds;
+	string cubeText;
+	vector<int> cube;
+	string constText;
+	vector<int> consts;
+	vector<int> targets;
+	int divRound;
+	int preRound;
+	double screen;
+	vector<int> monomial;
+	string out;
+	string engine;
+	string golden;
+};
+
+/*
+Parse "1-33,35,40-42" into 0-origin indices. return false if malformed or out of [1, size]
+*/
+inline bool manifestIndices(string text, int size, vector<int>& indices) {
+
+	stringstream ss(text);
+	string item;
+	while (getline(ss, item, ',')) {
+		if (item.size() == 0)
+			continue;
+		size_t pos = item.find('-');
+		char* end;
+		int first = strtol(item.substr(0, pos).c_str(), &end, 10);
+		if (*end != '\0')
+			return false;
+		int last = first;
+		if (pos != string::npos) {
+			last = strtol(item.substr(pos + 1).c_str(), &end, 10);
+			if (*end != '\0')
+				return false;
+		}
+		if ((first < 1) || (last > size) || (first > last))
+			return false;
+		for (int i = first; i <= last; i++) {
+			indices.push_back(i - 1);
+		}
+	}
+	return true;
+
+}
+
+/*
+Read the manifest. On error, the reason and the line number are written to cerr and false is returned
+*/
+inline bool readManifest(string filename, vector<manifestJob>& jobs) {
+
+	ifstream file(filename);
+	if (!file) {
+		cerr << "cannot open the manifest " << filename << endl;
+		return false;
+	}
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+		stringstream ss(line);
+		manifestJob job = { lineNumber, "", 0, "", vector<int>(), "", vector<int>(), vector<int>(), 0, 0, 60, vector<int>(), "", "milp", "" };
+		if (!(ss >> job.cipher) || (job.cipher[0] == '#'))
+			continue;
+
+		int ivSize;
+		if (job.cipher == "trivium")
+			ivSize = 80;
+		else if (job.cipher == "grain")
+			ivSize = 96;
+		else {
+			cerr << "manifest line " << lineNumber << ": unknown cipher " << job.cipher << endl;
+			return false;
+		}
+		if (!(ss >> job.rounds) || (job.rounds <= 0)) {
+			cerr << "manifest line " << lineNumber << ": the number of rounds is missing" << endl;
+			return false;
+		}
+
+		string field;
+		string targets = "all";
+		while (ss >> field) {
+			size_t pos = field.find('=');
+			string key = field.substr(0, pos);
+			string value = (pos == string::npos) ? "" : field.substr(pos + 1);
+			bool ok = true;
+			if (key == "cube") {
+				job.cubeText = value;
+				ok = manifestIndices(value, ivSize, job.cube);
+			}
+			else if (key == "const") {
+				job.constText = value;
+				ok = manifestIndices(value, ivSize, job.consts);
+			}
+			else if (key == "targets")
+				targets = value;
+			else if (key == "div")
+				job.divRound = atoi(value.c_str());
+			else if (key == "pre")
+				job.preRound = atoi(value.c_str());
+			else if (key == "screen")
+				job.screen = atof(value.c_str());
+			else if (key == "monomial")
+				ok = manifestIndices(value, (job.cipher == "trivium") ? 80 : 128, job.monomial);
+			else if (key == "out")
+				job.out = value;
+			else if (key == "engine") {
+				job.engine = value;
+				ok = (value == "milp") || (value == "native");
+			}
+			else if (key == "golden")
+				job.golden = value;
+			else
+				ok = false;
+			if (ok == false) {
+				cerr << "manifest line " << lineNumber << ": cannot read " << field << endl;
+				return false;
+			}
+		}
+
+		if (targets == "all") {
+			for (int t = 6; t >= 1; t--) {
+				job.targets.push_back(t);
+			}
+		}
+		else if (manifestIndices(targets, 6, job.targets)) {
+			for (int i = 0; i < job.targets.size(); i++) {
+				job.targets[i]++;
+			}
+		}
+		else {
+			cerr << "manifest line " << lineNumber << ": cannot read targets=" << targets << endl;
+			return false;
+		}
+
+		if (job.cube.size() == 0) {
+			cerr << "manifest line " << lineNumber << ": the cube is empty" << endl;
+			return false;
+		}
+		if ((job.preRound < 0) || (job.preRound >= job.rounds) || (job.divRound < 0) || (job.divRound >= job.rounds) || ((job.divRound > 0) && (job.divRound <= job.preRound))) {
+			cerr << "manifest line " << lineNumber << ": pre and div need 0 <= pre < div < rounds" << endl;
+			return false;
+		}
+		if (job.out.size() == 0)
+			job.out = "result_" + to_string(lineNumber) + ".txt";
+
+		jobs.push_back(job);
+	}
+	return true;
+
+}
+
+#endif
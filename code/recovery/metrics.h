@@ -0,0 +1,301 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include<iostream>
+#include<iomanip>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<map>
+#include<mutex>
+#include<atomic>
+#include<chrono>
+#include<algorithm>
+#include<cstdio>
+#include<ctime>
+#include<sys/resource.h>
+#include<unistd.h>
+
+using namespace std;
+
+/*
+The metrics stream (-metrics file): one JSON record per line for every phase of every solve, appended to the file.
+A record has the run (the start time and the process id), the job (a number in the run), the parent job (the 1st stage of a 2nd stage, 0 otherwise),
+the name and the stage of the job, the phase, its time (sec), the end time (wall, UNIX time), the CPU time of the process so far (cpu),
+the peak RSS in KB (rss) and the threads of the solve, and then the values of the phase, e.g.
+{"run":"1700000000-1234","job":3,"parent":1,"name":"trivium 842 target 6","stage":2,"phase":"solve","sec":12.5,"wall":1700000123.4,"cpu":40.1,"rss":812345,"threads":4,"status":2,"solutions":17}
+The phases are env (the checkout of the Gurobi environment, cacheHit is 1 if an idle environment is reused), build (vars, constrs),
+presolve, solve (status, solutions, midpoints), callback (the 2nd stages run by the callback of a 1st stage, see callbackProfile),
+extract (the solutions read into the counting box) and merge (the boxes of the targets summed).
+Without -metrics nothing is written.
+*/
+class metricsSink {
+public:
+	~metricsSink() {
+		if (file != NULL)
+			fclose(file);
+	}
+
+	bool open(string filename) {
+		lock_guard<mutex> guard(lock);
+		file = fopen(filename.c_str(), "a");
+		if (file == NULL) {
+			cerr << "cannot open the metrics " << filename << endl;
+			return false;
+		}
+		run = to_string((long long)time(NULL)) + "-" + to_string((long long)getpid());
+		name = filename;
+		return true;
+	}
+
+	bool enabled() { return file != NULL; }
+
+	long long nextJob() { return ++jobs; }
+
+	void write(string record) {
+		lock_guard<mutex> guard(lock);
+		if (file == NULL)
+			return;
+		fputs(record.c_str(), file);
+		fputc('\n', file);
+		fflush(file);
+	}
+
+	string runId() { return run; }
+	string fileName() { return name; }
+
+private:
+	mutex lock;
+	FILE* file = NULL;
+	string run;
+	string name;
+	atomic<long long> jobs{ 0 };
+};
+
+/*
+The sink shared by all solves of the process
+*/
+inline metricsSink& sharedMetrics() {
+	static metricsSink sink;
+	return sink;
+}
+
+// a string of JSON
+inline string metricsQuote(string text) {
+	string out = "\"";
+	for (int i = 0; i < text.size(); i++) {
+		if ((text[i] == '"') || (text[i] == '\\'))
+			out += '\\';
+		if ((unsigned char)text[i] >= 0x20)
+			out += text[i];
+	}
+	return out + "\"";
+}
+
+/*
+The records of one job. Each call of phase ends the phase started by the previous call (or the constructor)
+*/
+class metricsJob {
+public:
+	metricsJob(string xname, int xstage, int xthreads, long long xparent = 0) : name(xname), stage(xstage), threads(xthreads), parent(xparent) {
+		id = sharedMetrics().enabled() ? sharedMetrics().nextJob() : 0;
+		start = chrono::steady_clock::now();
+	}
+
+	void phase(string phaseName, vector<pair<string, double>> values = vector<pair<string, double>>()) {
+		auto now = chrono::steady_clock::now();
+		phase(phaseName, chrono::duration<double>(now - start).count(), values);
+		start = now;
+	}
+
+	// a phase whose time is measured elsewhere (e.g. the presolve in the Gurobi runtime). The next phase starts now
+	void phase(string phaseName, double sec, vector<pair<string, double>> values) {
+		start = chrono::steady_clock::now();
+		if (!sharedMetrics().enabled())
+			return;
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+		double wall = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+
+		stringstream ss;
+		ss << setprecision(15);
+		ss << "{\"run\":" << metricsQuote(sharedMetrics().runId()) << ",\"job\":" << id << ",\"parent\":" << parent << ",\"name\":" << metricsQuote(name)
+			<< ",\"stage\":" << stage << ",\"phase\":" << metricsQuote(phaseName) << ",\"sec\":" << sec << ",\"wall\":" << wall << ",\"cpu\":" << cpu
+			<< ",\"rss\":" << usage.ru_maxrss << ",\"threads\":" << threads;
+		for (int i = 0; i < values.size(); i++) {
+			ss << "," << metricsQuote(values[i].first) << ":" << values[i].second;
+		}
+		ss << "}";
+		sharedMetrics().write(ss.str());
+	}
+
+	long long id;
+
+private:
+	string name;
+	int stage;
+	int threads;
+	long long parent;
+	chrono::steady_clock::time_point start;
+};
+
+/*
+The fields of a record written by metricsJob (a flat object of strings and numbers). return: false if the line is not such a record
+*/
+inline bool metricsParse(const string& line, map<string, string>& fields) {
+	fields.clear();
+	size_t i = line.find('{');
+	if (i == string::npos)
+		return false;
+	i++;
+	auto skip = [&]() {
+		while ((i < line.size()) && isspace((unsigned char)line[i]))
+			i++;
+	};
+	auto text = [&](string& out) {
+		out.clear();
+		if ((i >= line.size()) || (line[i] != '"'))
+			return false;
+		for (i++; (i < line.size()) && (line[i] != '"'); i++) {
+			if ((line[i] == '\\') && (i + 1 < line.size()))
+				i++;
+			out += line[i];
+		}
+		i++;
+		return i <= line.size();
+	};
+	while (true) {
+		skip();
+		if ((i < line.size()) && (line[i] == '}'))
+			return fields.size() > 0;
+		string key, value;
+		if (!text(key))
+			return false;
+		skip();
+		if ((i >= line.size()) || (line[i] != ':'))
+			return false;
+		i++;
+		skip();
+		if ((i < line.size()) && (line[i] == '"')) {
+			if (!text(value))
+				return false;
+		}
+		else {
+			while ((i < line.size()) && (line[i] != ',') && (line[i] != '}') && !isspace((unsigned char)line[i]))
+				value += line[i++];
+		}
+		fields[key] = value;
+		skip();
+		if ((i < line.size()) && (line[i] == ','))
+			i++;
+		else if ((i >= line.size()) || (line[i] != '}'))
+			return false;
+	}
+}
+
+/*
+The summarizer (-summarize): the records of the files are aggregated by run, and by stage and phase over all runs
+(the number of records, the total, mean and max time, and the share of the time of the run), with the solutions, the midpoints,
+the environment cache hits and the peak RSS. The lines which are not records are counted and skipped.
+return: 0, or 1 if no record is read
+*/
+inline int metricsSummarize(vector<string> filenames) {
+
+	struct aggregate {
+		long long records = 0;
+		double sec = 0;
+		double maxSec = 0;
+		double solutions = 0;
+		double midpoints = 0;
+		long long cacheHits = 0;
+		long long cacheMisses = 0;
+	};
+	struct runInfo {
+		double first = 1e300;
+		double last = 0;
+		double cpu = 0;
+		double rss = 0;
+		long long jobs = 0;
+		map<pair<int, string>, aggregate> phases;
+	};
+	map<string, runInfo> runs;
+	map<pair<int, string>, aggregate> total;
+	long long records = 0, skipped = 0;
+
+	for (int f = 0; f < filenames.size(); f++) {
+		ifstream in(filenames[f]);
+		if (!in) {
+			cerr << "cannot open " << filenames[f] << endl;
+			continue;
+		}
+		string line;
+		map<string, string> fields;
+		while (getline(in, line)) {
+			if (!metricsParse(line, fields) || (fields.count("run") == 0) || (fields.count("phase") == 0) || (fields.count("sec") == 0)) {
+				skipped += (line.size() > 0);
+				continue;
+			}
+			records++;
+			auto number = [&](string key) { return (fields.count(key) > 0) ? atof(fields[key].c_str()) : 0.0; };
+			double sec = number("sec");
+			runInfo& run = runs[fields["run"]];
+			run.first = min(run.first, number("wall") - sec);
+			run.last = max(run.last, number("wall"));
+			run.cpu = max(run.cpu, number("cpu"));
+			run.rss = max(run.rss, number("rss"));
+			run.jobs = max(run.jobs, (long long)number("job"));
+			pair<int, string> key = make_pair((int)number("stage"), fields["phase"]);
+			for (int k = 0; k < 2; k++) {
+				aggregate& a = (k == 0) ? run.phases[key] : total[key];
+				a.records++;
+				a.sec += sec;
+				a.maxSec = max(a.maxSec, sec);
+				a.solutions += number("solutions");
+				a.midpoints += number("midpoints");
+				if (fields.count("cacheHit") > 0)
+					(number("cacheHit") > 0) ? a.cacheHits++ : a.cacheMisses++;
+			}
+		}
+	}
+	if (records == 0) {
+		cerr << "no metrics record" << endl;
+		return 1;
+	}
+
+	auto table = [&](map<pair<int, string>, aggregate>& phases) {
+		double sum = 0;
+		for (auto it = phases.begin(); it != phases.end(); it++)
+			sum += (*it).second.sec;
+		cout << "stage\tphase\trecords\ttotal sec\tmean sec\tmax sec\tshare\tsolutions\tmidpoints\tcache hits" << endl;
+		for (auto it = phases.begin(); it != phases.end(); it++) {
+			aggregate& a = (*it).second;
+			cout << (*it).first.first << "\t" << (*it).first.second << "\t" << a.records << "\t" << a.sec << "\t" << (a.sec / a.records) << "\t" << a.maxSec << "\t"
+				<< fixed << setprecision(1) << (100 * a.sec / max(sum, 1e-9)) << "%" << defaultfloat << setprecision(6) << "\t"
+				<< a.solutions << "\t" << a.midpoints << "\t";
+			if (a.cacheHits + a.cacheMisses > 0)
+				cout << a.cacheHits << "/" << (a.cacheHits + a.cacheMisses);
+			else
+				cout << "-";
+			cout << endl;
+		}
+		cout << "phases " << sum << " sec" << endl;
+	};
+
+	for (auto it = runs.begin(); it != runs.end(); it++) {
+		runInfo& run = (*it).second;
+		cout << "run " << (*it).first << ": " << run.jobs << " jobs, wall " << (run.last - run.first) << " sec, cpu " << run.cpu << " sec, peak RSS " << run.rss << " KB" << endl;
+		table(run.phases);
+		cout << endl;
+	}
+	cout << runs.size() << " runs, " << records << " records";
+	if (skipped > 0)
+		cout << " (" << skipped << " lines skipped)";
+	cout << endl;
+	table(total);
+	return 0;
+
+}
+
+#endif
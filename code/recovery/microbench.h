@@ -0,0 +1,127 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include<iostream>
+#include<iomanip>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<map>
+#include<functional>
+#include<chrono>
+#include<algorithm>
+
+using namespace std;
+
+/*
+The microbenchmarks of the hot paths (-micro, see microbenchTrivium and microbenchGrain128a).
+A kernel is a function which does some units of work (rounds, solutions, inserts, monomials) and returns their number.
+It is repeated until minSec has passed, which gives one sample of the time per unit, and the median of the samples is kept.
+The results are written one kernel per line, sorted by kernel and variant,
++++
+# micro trivium 840 rounds
+kernel	variant	unit	units	ns/unit
+box.fold	-	monomials	65536	212.400
+build	stub	rounds	840	4107.900
++++
+so that the files of two commits are compared line by line, or by -compare [previous file] which adds the ratio to the previous time.
+The variant stub is the solver-free one (see stubBackend in backend.h), and gurobi the one with Gurobi (not in the NOGUROBI build).
+*/
+struct microResult {
+	string kernel;
+	string variant;
+	string unit;
+	long long units;
+	double nsPerUnit;
+};
+
+class microBench {
+public:
+	microBench(int xsamples = 5, double xminSec = 0.2) : samples(xsamples), minSec(xminSec) {}
+
+	// the median time per unit of body in ns, and the units of one call
+	double measure(function<long long()> body, long long& units) {
+		vector<double> times;
+		for (int k = 0; k < samples; k++) {
+			long long total = 0;
+			auto start = chrono::steady_clock::now();
+			double sec = 0;
+			do {
+				units = body();
+				total += units;
+				sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			} while (sec < minSec);
+			times.push_back(1e9 * sec / max(total, 1LL));
+		}
+		sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	void add(string kernel, string variant, string unit, long long units, double nsPerUnit) {
+		results.push_back({ kernel, variant, unit, units, nsPerUnit });
+		cout << kernel << "\t" << variant << "\t" << unit << "\t" << units << "\t" << fixed << setprecision(3) << nsPerUnit << defaultfloat << setprecision(6) << endl;
+	}
+
+	void run(string kernel, string variant, string unit, function<long long()> body) {
+		long long units;
+		double ns = measure(body, units);
+		add(kernel, variant, unit, units, ns);
+	}
+
+	/*
+	Write the results into filename. If previous is not empty, the ratio to its times is displayed.
+	title: the first line (e.g. "micro trivium 840 rounds")
+	*/
+	bool write(string filename, string title, string previous) {
+		sort(results.begin(), results.end(), [](const microResult& a, const microResult& b) {
+			return (a.kernel != b.kernel) ? (a.kernel < b.kernel) : (a.variant < b.variant);
+		});
+
+		map<string, double> before;
+		if (previous.size() > 0) {
+			ifstream in(previous);
+			if (!in) {
+				cerr << previous << " cannot be read" << endl;
+				return false;
+			}
+			string line;
+			while (getline(in, line)) {
+				stringstream ss(line);
+				string kernel, variant, unit;
+				long long units;
+				double ns;
+				if ((line.size() > 0) && (line[0] != '#') && (ss >> kernel >> variant >> unit >> units >> ns))
+					before[kernel + "\t" + variant] = ns;
+			}
+		}
+
+		ofstream out(filename);
+		out << "# " << title << endl;
+		out << "kernel\tvariant\tunit\tunits\tns/unit" << endl;
+		if (previous.size() > 0)
+			cout << "kernel\tvariant\tns/unit\tprevious\tratio" << endl;
+		for (int i = 0; i < results.size(); i++) {
+			microResult& res = results[i];
+			out << res.kernel << "\t" << res.variant << "\t" << res.unit << "\t" << res.units << "\t" << fixed << setprecision(3) << res.nsPerUnit << defaultfloat << setprecision(6) << endl;
+			if (previous.size() > 0) {
+				string key = res.kernel + "\t" + res.variant;
+				cout << key << "\t" << fixed << setprecision(3) << res.nsPerUnit << "\t";
+				if (before.count(key) > 0)
+					cout << before[key] << "\t" << setprecision(2) << (res.nsPerUnit / max(before[key], 1e-9)) << endl;
+				else
+					cout << "-\t-" << endl;
+				cout << defaultfloat << setprecision(6);
+			}
+		}
+		cerr << "the results are written into " << filename << endl;
+		return (bool)out;
+	}
+
+private:
+	int samples;
+	double minSec;
+	vector<microResult> results;
+};
+
+#endif
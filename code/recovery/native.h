@@ -0,0 +1,313 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include<bitset>
+#include<vector>
+#include<unordered_map>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<fstream>
+#include<string>
+#include<cstdio>
+#include<cstdint>
+#include<unistd.h>
+
+using namespace std;
+
+/*
+Solver-free counting of the three-subset division trails by the explicit backward expansion of monomials.
+The frontier at round r maps each state vector k (the same 288-/256-bit representation as the MILP model) to the number of division trails from k to the output.
+It is split into shards by the hash of k, so that the shards are expanded and merged in parallel (use a multiple of the number of threads).
+*/
+template<size_t N> using nativeFrontier = vector<unordered_map<bitset<N>, long long>>;
+
+// the default number of vectors of a frontier kept in memory (memLimit of nativeMidpoints)
+static const long long nativeMemLimit = 1LL << 24;
+
+/*
+Run f(0), ..., f(threadNumber-1) in parallel. A single thread runs in the caller.
+*/
+template<class Func> void nativeRun(int threadNumber, Func f) {
+	if (threadNumber <= 1) {
+		f(0);
+		return;
+	}
+	vector<thread> workers;
+	for (int t = 0; t < threadNumber; t++) {
+		workers.push_back(thread(f, t));
+	}
+	for (int t = 0; t < threadNumber; t++) {
+		workers[t].join();
+	}
+}
+
+/*
+In the parity mode, the vectors with even counts are removed from the shard and the others get count 1.
+*/
+template<size_t N> void nativeParity(unordered_map<bitset<N>, long long>& shard) {
+	auto it = shard.begin();
+	while (it != shard.end()) {
+		if (((*it).second % 2) == 0) {
+			it = shard.erase(it);
+		}
+		else {
+			(*it).second = 1;
+			it++;
+		}
+	}
+}
+
+/*
+Merge the frontiers local[k] into one frontier shard by shard, and clear them (see nativeParity for the parity mode).
+The largest map of a shard is moved into the result and only the others are inserted.
+*/
+template<size_t N> nativeFrontier<N> nativeMerge(vector<nativeFrontier<N>>& local, int threadNumber, bool parity) {
+
+	int numShards = local[0].size();
+	nativeFrontier<N> next(numShards);
+	nativeRun(threadNumber, [&](int t) {
+		for (int sh = t; sh < numShards; sh += threadNumber) {
+			int base = 0;
+			for (int k = 1; k < local.size(); k++) {
+				if (local[k][sh].size() > local[base][sh].size())
+					base = k;
+			}
+			next[sh].swap(local[base][sh]);
+			for (int k = 0; k < local.size(); k++) {
+				if (k == base)
+					continue;
+				auto it = local[k][sh].begin();
+				while (it != local[k][sh].end()) {
+					next[sh][(*it).first] += (*it).second;
+					it++;
+				}
+				local[k][sh].clear();
+			}
+			if (parity)
+				nativeParity(next[sh]);
+		}
+	});
+
+	return next;
+}
+
+/*
+Expand the frontier by one round backward.
+Every thread expands its own shards of cur. The predecessors are appended to small per-thread buffers, one per shard of the result,
+and a full buffer is added into its shard under the lock of the shard, so that every predecessor is inserted once without a merge.
+@Para
+cur: the frontier at round r+1
+step: step(k, pred) appends the predecessors of k at round r to pred, once per division trail through the round (a predecessor may appear several times)
+keep: keep(k) is false if k at round r can be dropped (pruning)
+threadNumber: the number of threads
+parity: if true, only J[k] mod 2 is kept and the vectors with even J[k] are removed
+return: the frontier at round r with the same number of shards
+*/
+template<size_t N, class Step, class Keep> nativeFrontier<N> nativeExpand(nativeFrontier<N>& cur, Step step, Keep keep, int threadNumber, bool parity) {
+
+	int numShards = cur.size();
+	if (threadNumber < 1)
+		threadNumber = 1;
+
+	nativeFrontier<N> next(numShards);
+	vector<mutex> locks(numShards);
+	// about 64K buffered predecessors per thread
+	int flushSize = max(64, 65536 / numShards);
+	nativeRun(threadNumber, [&](int t) {
+		hash<bitset<N>> hasher;
+		vector<bitset<N>> pred;
+		vector<vector<pair<bitset<N>, long long>>> buffer(numShards);
+		auto flush = [&](int sh) {
+			lock_guard<mutex> guard(locks[sh]);
+			for (int e = 0; e < buffer[sh].size(); e++) {
+				next[sh][buffer[sh][e].first] += buffer[sh][e].second;
+			}
+			buffer[sh].clear();
+		};
+		for (int sh = t; sh < numShards; sh += threadNumber) {
+			auto it = cur[sh].begin();
+			for (; it != cur[sh].end(); it++) {
+				pred.clear();
+				step((*it).first, pred);
+				for (int j = 0; j < pred.size(); j++) {
+					if (keep(pred[j]) == false)
+						continue;
+					int dest = hasher(pred[j]) % numShards;
+					buffer[dest].push_back(make_pair(pred[j], (*it).second));
+					if (buffer[dest].size() >= flushSize)
+						flush(dest);
+				}
+			}
+		}
+		for (int sh = 0; sh < numShards; sh++) {
+			flush(sh);
+		}
+	});
+
+	if (parity) {
+		nativeRun(threadNumber, [&](int t) {
+			for (int sh = t; sh < numShards; sh += threadNumber) {
+				nativeParity(next[sh]);
+			}
+		});
+	}
+
+	return next;
+}
+
+/*
+The number of state vectors in the frontier
+*/
+template<size_t N> size_t nativeSize(nativeFrontier<N>& cur) {
+	size_t size = 0;
+	for (int sh = 0; sh < cur.size(); sh++) {
+		size += cur[sh].size();
+	}
+	return size;
+}
+
+/*
+Disk spill of one shard: each vector is written as (N+63)/64 words followed by its count.
+*/
+template<size_t N> void nativeSpill(unordered_map<bitset<N>, long long>& shard, string filename) {
+	ofstream file(filename, ios::binary);
+	auto it = shard.begin();
+	while (it != shard.end()) {
+		for (int w = 0; w < (N + 63) / 64; w++) {
+			uint64_t word = 0;
+			for (int i = 0; (i < 64) && (64 * w + i < N); i++) {
+				if ((*it).first[64 * w + i] == 1)
+					word |= (1ULL << i);
+			}
+			file.write((char*)&word, sizeof(word));
+		}
+		file.write((char*)&(*it).second, sizeof(long long));
+		it++;
+	}
+	unordered_map<bitset<N>, long long>().swap(shard);
+}
+// the file is removed after loading unless erase is false
+template<size_t N> void nativeLoad(unordered_map<bitset<N>, long long>& shard, string filename, bool erase = true) {
+	ifstream file(filename, ios::binary);
+	while (true) {
+		bitset<N> k;
+		uint64_t word;
+		long long count;
+		for (int w = 0; w < (N + 63) / 64; w++) {
+			file.read((char*)&word, sizeof(word));
+			for (int i = 0; (i < 64) && (64 * w + i < N); i++) {
+				k[64 * w + i] = (word >> i) & 1;
+			}
+		}
+		file.read((char*)&count, sizeof(long long));
+		if (!file)
+			break;
+		shard[k] += count;
+	}
+	file.close();
+	if (erase)
+		remove(filename.c_str());
+}
+
+/*
+A spill file name unique to the process and the call (prefix.[pid].[call].[shard] is appended by the caller),
+so that concurrent runs in the same directory do not overwrite each other's files.
+*/
+inline string nativeSpillName(string prefix) {
+	static atomic<long long> calls(0);
+	return prefix + "." + to_string((long long)getpid()) + "." + to_string(calls++);
+}
+
+/*
+Move every second vector of cur into half (with the same shards), so that a frontier of at least two vectors is split into two non-empty halves.
+*/
+template<size_t N> void nativeHalve(nativeFrontier<N>& cur, nativeFrontier<N>& half) {
+	half.assign(cur.size(), unordered_map<bitset<N>, long long>());
+	bool odd = false;
+	for (int sh = 0; sh < cur.size(); sh++) {
+		auto it = cur[sh].begin();
+		while (it != cur[sh].end()) {
+			if (odd) {
+				half[sh].insert(*it);
+				it = cur[sh].erase(it);
+			}
+			else {
+				it++;
+			}
+			odd = !odd;
+		}
+	}
+}
+
+/*
+Batched expansion of the midpoints at divRound.
+The frontier at divRound holds J[k'->1] for every midpoint k', and J[u] = sum_k' J[u->k'] * J[k'->1] is the same sum as the two-stage MILP.
+This is not a meet-in-the-middle join: a forward frontier from round 0 would start from every u (every subset of the non-cube bits),
+so the lower side is the backward expansion of the midpoints themselves with J[k'->1] carried as the count.
+The midpoints are expanded in pieces, and every round of a piece is expanded by nativeExpand with all threads.
+A piece whose frontier is larger than memLimit vectors is halved at its current round (the counts are linear in the frontier),
+and the halves not expanded next are spilled to disk (nativeSpillName(spillName).[piece].[shard]) until they are taken again,
+so that no piece is restarted from divRound. A frontier of one vector is not split. The frontiers at round 0 of the pieces are summed.
+@Para
+mid: the frontier at divRound (destroyed)
+divRound: the round of the midpoints
+step: see nativeExpand
+keep: keep(r, k) is false if k at round r can be dropped
+threadNumber, parity: see nativeExpand
+memLimit: the number of vectors of a piece kept in memory
+spillName: the prefix of the spill files
+return: the frontier at round 0 with the same number of shards
+*/
+template<size_t N, class Step, class Keep> nativeFrontier<N> nativeMidpoints(nativeFrontier<N>& mid, int divRound, Step step, Keep keep, int threadNumber, bool parity, long long memLimit, string spillName) {
+
+	int numShards = mid.size();
+	if (threadNumber < 1)
+		threadNumber = 1;
+	string name = nativeSpillName(spillName);
+
+	// the spilled pieces: their round and their number in the file names
+	vector<pair<int, long long>> pending;
+	long long pieces = 0;
+
+	nativeFrontier<N> total(numShards);
+	nativeFrontier<N> cur;
+	cur.swap(mid);
+	int r = divRound;
+	while (true) {
+		while ((r > 0) && ((long long)nativeSize(cur) > max(memLimit, 1LL))) {
+			nativeFrontier<N> half;
+			nativeHalve(cur, half);
+			for (int sh = 0; sh < numShards; sh++) {
+				nativeSpill(half[sh], name + "." + to_string(pieces) + "." + to_string(sh));
+			}
+			pending.push_back(make_pair(r, pieces++));
+		}
+
+		if (r > 0) {
+			cur = nativeExpand(cur, step, [&](const bitset<N>& k) { return keep(r - 1, k); }, threadNumber, parity);
+			r--;
+			continue;
+		}
+
+		// the piece reached round 0
+		vector<nativeFrontier<N>> both(2);
+		both[0].swap(total);
+		both[1].swap(cur);
+		total = nativeMerge(both, threadNumber, parity);
+		if (pending.empty())
+			break;
+
+		// the last spilled piece is expanded next
+		r = pending.back().first;
+		cur.assign(numShards, unordered_map<bitset<N>, long long>());
+		for (int sh = 0; sh < numShards; sh++) {
+			nativeLoad(cur[sh], name + "." + to_string(pending.back().second) + "." + to_string(sh));
+		}
+		pending.pop_back();
+	}
+
+	return total;
+}
+
+#endif
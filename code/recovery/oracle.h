@@ -0,0 +1,298 @@
+#ifndef ORACLE_H
+#define ORACLE_H
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<deque>
+#include<functional>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<chrono>
+#include<algorithm>
+#include<cstring>
+#include<cstdint>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<unistd.h>
+#include"native.h"
+
+using namespace std;
+
+/*
+The keystream oracle of the online phase (-oracle, -client).
+A server holds a secret key and answers batches of IVs over a Unix socket with the output bit of the requested round for every IV.
+On connection the server sends an oracleHello, then every request is an oracleRequest followed by count IVs (2 words each, bit i of
+the IV is bit i % 64 of word i / 64) and is answered by (count + 63) / 64 words (bit j % 64 of word j / 64 is the output of IV j).
+A connection is closed by the client, and the server serves the connections on separate threads.
+A request of more than 2^20 rounds or oracleMaxCount IVs closes the connection.
+*/
+struct oracleHello {
+	char magic[4];
+	uint32_t ivBits;
+	char cipher[16];
+};
+struct oracleRequest {
+	char magic[4];
+	uint32_t rounds;
+	uint32_t count;
+	uint32_t reserved;
+};
+// the IVs of a request (16 MB of IVs)
+static const uint32_t oracleMaxCount = 1 << 20;
+
+inline bool oracleWrite(int fd, const void* data, size_t size) {
+	const char* p = (const char*)data;
+	while (size > 0) {
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+inline bool oracleRead(int fd, void* data, size_t size) {
+	char* p = (char*)data;
+	while (size > 0) {
+		ssize_t n = read(fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+/*
+Serve the oracle until the process is stopped
+@Para
+path: the Unix socket (replaced if it exists)
+cipher, ivBits: sent in the oracleHello
+threadNumber: the threads of a batch
+kernel: the outputs of the round for 64 IVs, bitsliced (word i is the IV bit i of the 64 lanes)
+return: 1 on error
+*/
+inline int oracleServe(string path, string cipher, int ivBits, int threadNumber, function<uint64_t(int, const uint64_t*, vector<uint64_t>&)> kernel) {
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if ((server < 0) || (path.size() >= sizeof(addr.sun_path))) {
+		cerr << "cannot open the socket " << path << endl;
+		return 1;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	unlink(path.c_str());
+	if ((bind(server, (sockaddr*)&addr, sizeof(addr)) < 0) || (listen(server, 16) < 0)) {
+		cerr << "cannot listen on " << path << endl;
+		return 1;
+	}
+	cerr << cipher << " oracle on " << path << endl;
+
+	oracleHello hello;
+	memset(&hello, 0, sizeof(hello));
+	memcpy(hello.magic, "ORC1", 4);
+	hello.ivBits = ivBits;
+	strncpy(hello.cipher, cipher.c_str(), sizeof(hello.cipher) - 1);
+
+	while (true) {
+		int fd = accept(server, NULL, NULL);
+		if (fd < 0)
+			continue;
+		thread([=]() {
+			oracleRequest request;
+			vector<uint64_t> ivs, out;
+			bool ok = oracleWrite(fd, &hello, sizeof(hello));
+			while (ok && oracleRead(fd, &request, sizeof(request)) && (memcmp(request.magic, "ORQ1", 4) == 0) && (request.rounds <= (1 << 20)) && (request.count <= oracleMaxCount)) {
+				ivs.resize(2 * (size_t)request.count);
+				if (oracleRead(fd, ivs.data(), ivs.size() * sizeof(uint64_t)) == false)
+					break;
+				// the groups of 64 IVs are transposed into lanes and run on the threads
+				int groups = (int)(((uint64_t)request.count + 63) / 64);
+				out.assign(groups, 0);
+				int threads = min(max(threadNumber, 1), groups);
+				nativeRun(threads, [&](int t) {
+					vector<uint64_t> lanes(ivBits), work;
+					for (int g = t; g < groups; g += threads) {
+						fill(lanes.begin(), lanes.end(), 0);
+						for (int l = 0; (l < 64) && (64 * g + l < request.count); l++) {
+							const uint64_t* iv = &ivs[2 * (64 * (size_t)g + l)];
+							for (int i = 0; i < ivBits; i++)
+								lanes[i] |= ((iv[i / 64] >> (i % 64)) & 1) << l;
+						}
+						uint64_t z = kernel(request.rounds, lanes.data(), work);
+						int valid = min(64, (int)request.count - 64 * g);
+						out[g] = (valid == 64) ? z : (z & ((1ULL << valid) - 1));
+					}
+				});
+				ok = oracleWrite(fd, out.data(), out.size() * sizeof(uint64_t));
+			}
+			close(fd);
+		}).detach();
+	}
+	return 0;
+
+}
+
+/*
+The cube sum of one run of the client and its statistics
+batch: the IVs per request, depth: the requests in flight
+latency: from the request to its response, in microseconds
+*/
+struct oracleStat {
+	int batch;
+	int depth;
+	uint64_t queries;
+	double sec;
+	double meanLatency;
+	double p50Latency;
+	double p99Latency;
+	int sum;
+};
+
+/*
+The cube sum over the oracle. The IVs of the cube are generated in Gray code order (one bit flipped per IV) and streamed in batches,
+at most depth requests are in flight, and the responses are summed by a second thread as they arrive.
+@Para
+fd: the connection (after the oracleHello)
+cube: the cube (the indices of the IV bits), base: the other IV bits (2 words)
+return: false if the connection failed
+*/
+inline bool oracleCubeSum(int fd, int rounds, vector<int>& cube, vector<uint64_t>& base, int batch, int depth, oracleStat& stat) {
+
+	uint64_t total = 1ULL << cube.size();
+	uint64_t numBatches = (total + batch - 1) / batch;
+	mutex lock;
+	condition_variable wake;
+	deque<chrono::steady_clock::time_point> sent;
+	vector<double> latency;
+	atomic<bool> failed(false);
+	int sum = 0;
+	auto start = chrono::steady_clock::now();
+
+	thread reader([&]() {
+		vector<uint64_t> out;
+		for (uint64_t k = 0; k < numBatches; k++) {
+			uint64_t count = min<uint64_t>(batch, total - k * batch);
+			out.resize((count + 63) / 64);
+			if (oracleRead(fd, out.data(), out.size() * sizeof(uint64_t)) == false) {
+				lock_guard<mutex> guard(lock);
+				failed = true;
+				wake.notify_all();
+				return;
+			}
+			int parity = 0;
+			for (int w = 0; w < out.size(); w++)
+				parity ^= __builtin_popcountll(out[w]) & 1;
+			lock_guard<mutex> guard(lock);
+			sum ^= parity;
+			latency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent.front()).count());
+			sent.pop_front();
+			wake.notify_all();
+		}
+	});
+
+	vector<uint64_t> iv = base;
+	vector<uint64_t> message;
+	for (uint64_t k = 0; (k < numBatches) && !failed; k++) {
+		uint64_t count = min<uint64_t>(batch, total - k * batch);
+		oracleRequest request;
+		memcpy(request.magic, "ORQ1", 4);
+		request.rounds = rounds;
+		request.count = count;
+		request.reserved = 0;
+		message.resize(2 * count);
+		for (uint64_t j = 0; j < count; j++) {
+			uint64_t g = k * batch + j;
+			if (g > 0) {
+				int bit = cube[__builtin_ctzll(g)];
+				iv[bit / 64] ^= (1ULL << (bit % 64));
+			}
+			message[2 * j] = iv[0];
+			message[2 * j + 1] = iv[1];
+		}
+		unique_lock<mutex> guard(lock);
+		wake.wait(guard, [&]() { return failed || (sent.size() < depth); });
+		sent.push_back(chrono::steady_clock::now());
+		guard.unlock();
+		if (!oracleWrite(fd, &request, sizeof(request)) || !oracleWrite(fd, message.data(), message.size() * sizeof(uint64_t))) {
+			failed = true;
+			break;
+		}
+	}
+	if (failed)
+		shutdown(fd, SHUT_RDWR);
+	reader.join();
+
+	stat.batch = batch;
+	stat.depth = depth;
+	stat.queries = total;
+	stat.sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	sort(latency.begin(), latency.end());
+	stat.meanLatency = 0;
+	for (int i = 0; i < latency.size(); i++)
+		stat.meanLatency += latency[i] / latency.size();
+	stat.p50Latency = (latency.size() > 0) ? latency[latency.size() / 2] : 0;
+	stat.p99Latency = (latency.size() > 0) ? latency[min(latency.size() - 1, (size_t)(latency.size() * 0.99))] : 0;
+	stat.sum = sum;
+	return !failed;
+
+}
+
+/*
+The benchmark of the online phase (-client): the cube sum of the first cubeSize IV bits (the other IV bits 0) is computed over the oracle
+with batches of 64 IVs up to the whole cube (at most oracleMaxCount), and the queries per second and the latency of every batch size are compared.
+The sums of all batch sizes must agree.
+return: 0, or 1 on error
+*/
+inline int oracleBench(string path, int rounds, int cubeSize, int depth) {
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	oracleHello hello;
+	if ((fd < 0) || (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) || !oracleRead(fd, &hello, sizeof(hello)) || (memcmp(hello.magic, "ORC1", 4) != 0)) {
+		cerr << "cannot connect to the oracle " << path << endl;
+		return 1;
+	}
+	hello.cipher[sizeof(hello.cipher) - 1] = 0;
+	cubeSize = min(cubeSize, (int)hello.ivBits);
+	cout << hello.cipher << " oracle, " << rounds << " rounds, cube iv1 to iv" << cubeSize << " (2^" << cubeSize << " IVs), " << depth << " requests in flight" << endl;
+
+	vector<int> cube;
+	for (int i = 0; i < cubeSize; i++)
+		cube.push_back(i);
+	vector<uint64_t> base(2, 0);
+
+	cout << "batch\tqueries/s\tmean us\tp50 us\tp99 us\tsum" << endl;
+	int sum = -1;
+	bool agree = true;
+	for (uint64_t batch = 64; ; batch *= 4) {
+		oracleStat stat;
+		if (oracleCubeSum(fd, rounds, cube, base, min<uint64_t>(batch, min<uint64_t>(1ULL << cubeSize, oracleMaxCount)), depth, stat) == false) {
+			cerr << "the oracle closed the connection" << endl;
+			close(fd);
+			return 1;
+		}
+		cout << stat.batch << "\t" << (stat.queries / stat.sec) << "\t" << stat.meanLatency << "\t" << stat.p50Latency << "\t" << stat.p99Latency << "\t" << stat.sum << endl;
+		agree = agree && ((sum < 0) || (sum == stat.sum));
+		sum = stat.sum;
+		if (batch >= min<uint64_t>(1ULL << cubeSize, oracleMaxCount))
+			break;
+	}
+	close(fd);
+	if (agree == false) {
+		cerr << "the cube sums of the batch sizes differ" << endl;
+		return 1;
+	}
+	return 0;
+
+}
+
+#endif
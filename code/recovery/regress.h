@@ -0,0 +1,214 @@
+#ifndef REGRESS_H
+#define REGRESS_H
+
+#include<iostream>
+#include<iomanip>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<map>
+#include<functional>
+#include<chrono>
+#include<algorithm>
+#include<sys/stat.h>
+#include"manifest.h"
+#include"metrics.h"
+
+using namespace std;
+
+/*
+The regression benchmark (-regress, make bench). The suite is a manifest (see manifest.h) whose jobs are the cases, e.g.
++++
+trivium 570 cube=1-18,20-34,36-80 engine=native out=regress_trivium570.txt
+trivium 570 cube=1-18,20-34,36-80 out=regress_trivium570_milp.txt golden=golden/regress_trivium570.txt
++++
+Every case is run alone with the whole thread budget, and
+- its result file (out=) is compared with the golden file (golden=, default golden/[out]). A missing or empty golden file fails the case,
+  unless record is given (-record), in which case it is recorded from the result,
+- the golden file is checked independently of the engines by check (e.g. against the cube sums of the cipher),
+- its wall time is compared with the baseline file (one line "[out] [sec]" per case). A case is slow if it takes more than threshold times
+  its baseline and at least one second more. A case without a baseline is recorded,
+- the time of each phase is summed from the metrics records of the case (see metrics.h).
+The table is displayed and written to regress_report.txt.
+return: 0, or 1 if a case fails, has no golden file, differs from its golden file, fails the check or is slow
+*/
+struct regressResult {
+	string name;
+	string engine;
+	string status;
+	double sec;
+	double baseline;
+	string detail;
+	map<string, double> phases;
+};
+
+// the time of each phase in the metrics records written after offset by this process
+inline map<string, double> regressPhases(string filename, long long offset) {
+	map<string, double> phases;
+	ifstream in(filename);
+	if (!in)
+		return phases;
+	in.seekg(offset);
+	string line;
+	map<string, string> fields;
+	while (getline(in, line)) {
+		if (metricsParse(line, fields) && (fields["run"] == sharedMetrics().runId()))
+			phases[fields["phase"]] += atof(fields["sec"].c_str());
+	}
+	return phases;
+}
+
+inline long long regressFileSize(string filename) {
+	struct stat st;
+	return (stat(filename.c_str(), &st) == 0) ? st.st_size : 0;
+}
+
+inline bool regressCopy(string from, string to) {
+	size_t slash = to.rfind('/');
+	if (slash != string::npos)
+		mkdir(to.substr(0, slash).c_str(), 0755);
+	ifstream in(from, ios::binary);
+	ofstream out(to, ios::binary);
+	out << in.rdbuf();
+	return in && out;
+}
+
+/*
+Compare two text results line by line, skipping the lines which start with one of the prefixes (e.g. the times)
+*/
+inline bool regressSameLines(string filename, string golden, vector<string> skip, string& detail) {
+	ifstream in[2] = { ifstream(filename), ifstream(golden) };
+	if (!in[0] || !in[1]) {
+		detail = "cannot read";
+		return false;
+	}
+	vector<string> lines[2];
+	for (int k = 0; k < 2; k++) {
+		string line;
+		while (getline(in[k], line)) {
+			bool skipped = false;
+			for (int i = 0; i < skip.size(); i++)
+				skipped = skipped || (line.compare(0, skip[i].size(), skip[i]) == 0);
+			if (!skipped)
+				lines[k].push_back(line);
+		}
+	}
+	for (int i = 0; i < max(lines[0].size(), lines[1].size()); i++) {
+		if ((i >= lines[0].size()) || (i >= lines[1].size()) || (lines[0][i] != lines[1][i])) {
+			detail = "line " + to_string(i + 1) + " differs";
+			return false;
+		}
+	}
+	detail = to_string(lines[0].size()) + " lines";
+	return true;
+}
+
+/*
+@Para
+filename: the suite
+baselineFile: the baselines (updated with the cases without one, or with every case if rebaseline)
+threshold: the slowdown which fails a case
+record: record the missing golden files from the results
+runCase: runs a case and writes its result file. return: 0, 1 on error, or 2 if the case is skipped
+same: compares a result file with its golden file (detail: the reason or a summary)
+check: checks the golden file of a case (detail: the reason or a summary)
+*/
+inline int regressRun(string filename, string baselineFile, double threshold, bool rebaseline, bool record, function<int(manifestJob&)> runCase, function<bool(string, string, string&)> same, function<bool(manifestJob&, string, string&)> check) {
+
+	vector<manifestJob> jobs;
+	if (readManifest(filename, jobs) == false)
+		return 1;
+
+	map<string, double> baselines;
+	{
+		ifstream in(baselineFile);
+		string name;
+		double sec;
+		while (in >> name >> sec)
+			baselines[name] = sec;
+	}
+	if ((sharedMetrics().enabled() == false) && (sharedMetrics().open("regress_metrics.jsonl") == false))
+		return 1;
+	string metricsFile = sharedMetrics().fileName();
+
+	vector<regressResult> results;
+	bool failed = false;
+	for (int j = 0; j < jobs.size(); j++) {
+		manifestJob& job = jobs[j];
+		string golden = (job.golden.size() > 0) ? job.golden : "golden/" + job.out;
+		cerr << "regress " << (j + 1) << "/" << jobs.size() << " : " << job.out << " (" << job.engine << ")" << endl;
+
+		long long offset = regressFileSize(metricsFile);
+		auto start = chrono::steady_clock::now();
+		int rc = runCase(job);
+		regressResult res = { job.out, job.engine, "ok", chrono::duration<double>(chrono::steady_clock::now() - start).count(), -1, "", regressPhases(metricsFile, offset) };
+		if (rc == 2) {
+			res.status = "skipped";
+			results.push_back(res);
+			continue;
+		}
+		if (rc != 0) {
+			res.status = "FAILED";
+		}
+		else if ((regressFileSize(golden) == 0) && !record) {
+			res.status = "FAILED";
+			res.detail = "no golden " + golden + " (-record to record it)";
+		}
+		else if (regressFileSize(golden) == 0) {
+			res.status = regressCopy(job.out, golden) ? "recorded" : "FAILED";
+			res.detail = "golden " + golden;
+		}
+		else if (same(job.out, golden, res.detail) == false) {
+			res.status = "DIFFERS";
+		}
+		// a golden file which fails the check is reported even if the result differs from it
+		if ((res.status == "ok") || (res.status == "recorded") || (res.status == "DIFFERS")) {
+			string detail;
+			if (check(job, golden, detail) == false)
+				res.status = "WRONG";
+			res.detail += (res.detail.size() > 0 ? ", " : "") + detail;
+		}
+
+		if ((baselines.count(job.out) > 0) && !rebaseline) {
+			res.baseline = baselines[job.out];
+			if ((res.status == "ok") && (res.sec > threshold * res.baseline) && (res.sec > res.baseline + 1))
+				res.status = "SLOW";
+		}
+		else if (rc == 0) {
+			baselines[job.out] = res.sec;
+		}
+		failed = failed || (res.status == "FAILED") || (res.status == "DIFFERS") || (res.status == "WRONG") || (res.status == "SLOW");
+		results.push_back(res);
+	}
+
+	{
+		ofstream out(baselineFile);
+		for (auto it = baselines.begin(); it != baselines.end(); it++)
+			out << (*it).first << " " << (*it).second << endl;
+	}
+
+	// the table
+	stringstream ss;
+	ss << "case\tengine\tstatus\tsec\tbaseline\tratio\tdetail\tphases" << endl;
+	for (int i = 0; i < results.size(); i++) {
+		regressResult& res = results[i];
+		ss << res.name << "\t" << res.engine << "\t" << res.status << "\t" << fixed << setprecision(2) << res.sec << "\t";
+		if (res.baseline >= 0)
+			ss << res.baseline << "\t" << (res.sec / max(res.baseline, 1e-9)) << "\t";
+		else
+			ss << "-\t-\t";
+		ss << res.detail << "\t";
+		for (auto it = res.phases.begin(); it != res.phases.end(); it++)
+			ss << (it == res.phases.begin() ? "" : " ") << (*it).first << "=" << (*it).second;
+		ss << defaultfloat << setprecision(6) << endl;
+	}
+	ss << (failed ? "FAILED" : "passed") << " (threshold " << threshold << ", baselines in " << baselineFile << ", metrics in " << metricsFile << ")" << endl;
+	cout << ss.str();
+	ofstream report("regress_report.txt");
+	report << ss.str();
+	return failed ? 1 : 0;
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include"main.h"
+#include"schedule.h"
+
+// the worker of the calling thread (-1 outside the workers of run)
+static thread_local int schedWorker = -1;
+
+jobScheduler::jobScheduler(int xbudget, string xtimingFile) : budget(max(xbudget, 1)), workers(1), timingFile(xtimingFile) {
+
+	// timings of the previous runs : name \t sec
+	ifstream file(timingFile);
+	string line;
+	while (getline(file, line)) {
+		size_t pos = line.rfind('\t');
+		if (pos == string::npos)
+			continue;
+		timing[line.substr(0, pos)] = atof(line.substr(pos + 1).c_str());
+	}
+
+}
+
+void jobScheduler::add(string name, function<void()> work) {
+
+	double expected = -1;
+	if (timing.count(name) > 0)
+		expected = timing[name];
+	jobs.push_back({ name, work, expected, (int)jobs.size() });
+
+}
+
+int jobScheduler::threads() {
+
+	lock_guard<mutex> guard(takenLock);
+	int me = schedWorker;
+	int inFlight = 0;
+	int rank = 0;
+	int others = 0;
+	for (int w = 0; w < busy.size(); w++) {
+		if (busy[w] == 0)
+			continue;
+		inFlight++;
+		if (w < me)
+			rank++;
+		if (w != me)
+			others += taken[w];
+	}
+	if ((me < 0) || (me >= busy.size()) || (busy[me] == 0))
+		return max(1, budget / max(1, inFlight));
+
+	// budget / inFlight, and one more for the first budget % inFlight workers
+	int share = budget / inFlight + ((rank < budget % inFlight) ? 1 : 0);
+	taken[me] = max(1, min(share, budget - others));
+	return taken[me];
+
+}
+
+void jobScheduler::run() {
+
+	// shortest expected first
+	sort(jobs.begin(), jobs.end(), [](const job& a, const job& b) {
+		if ((a.expected < 0) != (b.expected < 0))
+			return (b.expected < 0);
+		if (a.expected != b.expected)
+			return a.expected < b.expected;
+		return a.order < b.order;
+	});
+
+	workers = min(budget, (int)jobs.size());
+	vector<double> elapsed(jobs.size());
+	atomic<size_t> next(0);
+	taken.assign(workers, 0);
+	busy.assign(workers, 1);
+
+	vector<thread> pool;
+	for (int t = 0; t < workers; t++) {
+		pool.push_back(thread([&, t]() {
+			schedWorker = t;
+			size_t e;
+			while ((e = next++) < jobs.size()) {
+				auto start = chrono::steady_clock::now();
+				jobs[e].work();
+				elapsed[e] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				lock_guard<mutex> guard(takenLock);
+				taken[t] = 0;
+			}
+			lock_guard<mutex> guard(takenLock);
+			busy[t] = 0;
+		}));
+	}
+	for (int t = 0; t < workers; t++) {
+		pool[t].join();
+	}
+
+	// update the timings
+	for (int e = 0; e < jobs.size(); e++) {
+		timing[jobs[e].name] = elapsed[e];
+	}
+	ofstream file(timingFile);
+	auto it = timing.begin();
+	while (it != timing.end()) {
+		file << (*it).first << "\t" << (*it).second << endl;
+		it++;
+	}
+	jobs.clear();
+
+}
@@ -0,0 +1,59 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include<string>
+#include<vector>
+#include<map>
+#include<functional>
+#include<mutex>
+#include<atomic>
+#include<thread>
+
+using namespace std;
+
+/*
+Scheduler of the independent (cube, target) jobs under a global thread budget.
+The jobs run concurrently on at most budget workers, shortest expected first, where the expected time is the wall time of the job
+with the same name in the previous runs (timingFile). Jobs without a record run last in the order they were added.
+A solver environment created by a job asks threads() for its number of threads. The budget is split over the workers which run a job,
+the remainder going to the first ones, and a worker never takes more than the threads left by the others (taken).
+A job takes its share again at every environment it creates, so the threads freed by the workers that ran out of jobs go to
+the environments created afterwards (e.g. the 2nd stage of the two-stage enumeration).
+*/
+class jobScheduler {
+public:
+	jobScheduler(int budget, string timingFile);
+
+	// work is called once from a worker thread
+	void add(string name, function<void()> work);
+
+	// run all jobs, and update timingFile
+	void run();
+
+	// the number of threads for a new solver environment
+	int threads();
+
+	// serializes the output of the jobs
+	mutex outputLock;
+
+private:
+	struct job {
+		string name;
+		function<void()> work;
+		double expected;
+		int order;
+	};
+
+	int budget;
+	int workers;
+	string timingFile;
+	vector<job> jobs;
+	map<string, double> timing;
+
+	// the threads held by the current job of each worker, and whether the worker runs a job
+	mutex takenLock;
+	vector<int> taken;
+	vector<char> busy;
+};
+
+#endif
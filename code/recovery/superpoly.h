@@ -0,0 +1,379 @@
+#ifndef SUPERPOLY_H
+#define SUPERPOLY_H
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<map>
+#include<bitset>
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+using namespace std;
+
+/*
+Binary result file of a superpoly (.spb), written by trivium() and grain128a() next to the text output, or converted from the text (see legacy.h).
+All fields are in the byte order of the host and 8-byte aligned:
++++
+superpolyHeader
+superpolySection x numSections
+the records of section 0, the records of section 1, ...
++++
+A record is a monomial mask (words x uint64) followed by its count (uint64), and the records of a section are sorted by the mask
+(word 0 first, see superpolyLess), so a monomial is found by binary search over the mapped file without reading the others.
+The mask is the state of the cipher (bit i is bit i % 64 of word i / 64) after the projection of displayTriviumSuperpoly / displayGrainSuperpoly:
+only the key bits (from keyOffset) and the non-cube IV bits (from ivOffset) are kept, and the count is the sum of J[u] over the projected u.
+The superpoly is the set of the masks with odd counts.
+Section 0 is the superpoly of all targets and the other sections are the superpolies of each target (section.target).
+*/
+struct superpolyHeader {
+	char magic[4];
+	uint32_t version;
+	char cipher[16];
+	uint32_t rounds;
+	uint32_t stateBits;
+	uint32_t words;
+	uint32_t keyOffset;
+	uint32_t keySize;
+	uint32_t ivOffset;
+	uint32_t ivSize;
+	uint32_t numTargets;
+	int32_t targets[8];
+	uint64_t cube[2];
+	uint32_t numSections;
+	uint32_t reserved;
+};
+
+struct superpolySection {
+	int32_t target;
+	uint32_t reserved;
+	uint64_t count;
+	uint64_t offset;
+};
+
+/*
+The order of the records
+*/
+inline bool superpolyLess(const uint64_t* a, const uint64_t* b, int words) {
+	for (int w = 0; w < words; w++) {
+		if (a[w] != b[w])
+			return a[w] < b[w];
+	}
+	return false;
+}
+
+/*
+Collect the sections and write the file
+*/
+class superpolyWriter {
+public:
+	/*
+	cipher, rounds: the description in the header
+	stateBits: N of the countingBox
+	keyOffset, keySize, ivOffset, ivSize: the key bits and the IV bits in the state
+	cube: the active IV bits (at most 128)
+	targets: the evaluation targets (at most 8, see triviumThreeEnumuration / grainThreeEnumuration)
+	*/
+	superpolyWriter(string cipher, int rounds, int stateBits, int keyOffset, int keySize, int ivOffset, int ivSize, vector<int>& cube, vector<int> targets) {
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "SPB1", 4);
+		header.version = 1;
+		strncpy(header.cipher, cipher.c_str(), sizeof(header.cipher) - 1);
+		header.rounds = rounds;
+		header.stateBits = stateBits;
+		header.words = (stateBits + 63) / 64;
+		header.keyOffset = keyOffset;
+		header.keySize = keySize;
+		header.ivOffset = ivOffset;
+		header.ivSize = ivSize;
+		header.numTargets = min((int)targets.size(), 8);
+		for (int j = 0; j < header.numTargets; j++) {
+			header.targets[j] = targets[j];
+		}
+		for (int i = 0; (i < cube.size()) && (i < 128); i++) {
+			if (cube[i] == 1)
+				header.cube[i / 64] |= (1ULL << (i % 64));
+		}
+		this->cube = cube;
+	}
+
+	// project the countingBox (see superpolyHeader) and add it as a section
+	template<size_t N, class Cmp> void section(int target, map<bitset<N>, int, Cmp>& countingBox) {
+		bitset<N> keep;
+		for (int i = 0; i < header.keySize; i++) {
+			keep[header.keyOffset + i] = 1;
+		}
+		for (int i = 0; i < header.ivSize; i++) {
+			if (cube[i] == 0)
+				keep[header.ivOffset + i] = 1;
+		}
+
+		map<vector<uint64_t>, uint64_t> projected;
+		for (auto it = countingBox.begin(); it != countingBox.end(); it++) {
+			bitset<N> u = (*it).first & keep;
+			vector<uint64_t> mask(header.words, 0);
+			for (int i = 0; i < N; i++) {
+				if (u[i] == 1)
+					mask[i / 64] |= (1ULL << (i % 64));
+			}
+			projected[mask] += (*it).second;
+		}
+
+		targets.push_back(target);
+		records.push_back(vector<uint64_t>());
+		vector<uint64_t>& rec = records.back();
+		for (auto it = projected.begin(); it != projected.end(); it++) {
+			rec.insert(rec.end(), (*it).first.begin(), (*it).first.end());
+			rec.push_back((*it).second);
+		}
+	}
+
+	// add a section of records already projected, sorted by the mask and summed (the mask and the count of each record, see legacyRecords)
+	void section(int target, vector<uint64_t>& sorted) {
+		targets.push_back(target);
+		records.push_back(sorted);
+	}
+
+	// On error, the reason is written to cerr and false is returned
+	bool write(string filename) {
+		header.numSections = targets.size();
+		uint64_t offset = sizeof(superpolyHeader) + targets.size() * sizeof(superpolySection);
+		vector<superpolySection> sections(targets.size());
+		for (int s = 0; s < targets.size(); s++) {
+			sections[s] = { targets[s], 0, records[s].size() / (header.words + 1), offset };
+			offset += records[s].size() * sizeof(uint64_t);
+		}
+
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (file == NULL) {
+			cerr << "cannot write the superpoly " << filename << endl;
+			return false;
+		}
+		bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+		if (sections.size() > 0)
+			ok = ok && (fwrite(sections.data(), sizeof(superpolySection), sections.size(), file) == sections.size());
+		for (int s = 0; s < records.size(); s++) {
+			ok = ok && (fwrite(records[s].data(), sizeof(uint64_t), records[s].size(), file) == records[s].size());
+		}
+		ok = (fclose(file) == 0) && ok;
+		if (ok == false)
+			cerr << "cannot write the superpoly " << filename << endl;
+		return ok;
+	}
+
+private:
+	superpolyHeader header;
+	vector<int> cube;
+	vector<int> targets;
+	vector<vector<uint64_t>> records;
+};
+
+/*
+A superpoly file mapped into memory. Only the pages touched by a query are read from the disk
+*/
+class superpolyFile {
+public:
+	~superpolyFile() {
+		if (data != NULL)
+			munmap(data, size);
+	}
+
+	// On error, the reason is written to cerr and false is returned
+	bool open(string filename) {
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			cerr << "cannot open the superpoly " << filename << endl;
+			return false;
+		}
+		struct stat st;
+		if ((fstat(fd, &st) != 0) || (st.st_size < sizeof(superpolyHeader))) {
+			cerr << filename << " is not a superpoly file" << endl;
+			close(fd);
+			return false;
+		}
+		size = st.st_size;
+		void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			cerr << "cannot map the superpoly " << filename << endl;
+			return false;
+		}
+		data = (char*)map;
+
+		const superpolyHeader& h = header();
+		bool ok = (memcmp(h.magic, "SPB1", 4) == 0) && (h.version == 1) && (h.words == (h.stateBits + 63) / 64)
+			&& (sizeof(superpolyHeader) + (uint64_t)h.numSections * sizeof(superpolySection) <= size);
+		for (int s = 0; ok && (s < h.numSections); s++) {
+			ok = (section(s).offset + section(s).count * (h.words + 1) * sizeof(uint64_t) <= size);
+		}
+		if (ok == false) {
+			cerr << filename << " is not a superpoly file or is truncated" << endl;
+			return false;
+		}
+		return true;
+	}
+
+	const superpolyHeader& header() { return *(const superpolyHeader*)data; }
+
+	const superpolySection& section(int s) { return ((const superpolySection*)(data + sizeof(superpolyHeader)))[s]; }
+
+	// the mask of record i of section s, followed by its count
+	const uint64_t* record(int s, uint64_t i) {
+		return (const uint64_t*)(data + section(s).offset) + i * (header().words + 1);
+	}
+
+	// the count of the monomial in section s by binary search. return false if the monomial is not in the section
+	bool find(int s, vector<uint64_t>& mask, uint64_t& count) {
+		int words = header().words;
+		uint64_t lo = 0, hi = section(s).count;
+		while (lo < hi) {
+			uint64_t mid = (lo + hi) / 2;
+			if (superpolyLess(record(s, mid), mask.data(), words))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if ((lo == section(s).count) || superpolyLess(mask.data(), record(s, lo), words))
+			return false;
+		count = record(s, lo)[words];
+		return true;
+	}
+
+private:
+	char* data = NULL;
+	size_t size = 0;
+};
+
+/*
+"k1,k5,v3" (1-origin key bits k and IV bits v) or "1" (the constant term) into a mask of the file
+On error, the reason is written to cerr and false is returned
+*/
+inline bool superpolyParse(string text, const superpolyHeader& h, vector<uint64_t>& mask) {
+	mask.assign(h.words, 0);
+	if (text == "1")
+		return true;
+	size_t start = 0;
+	while (start <= text.size()) {
+		size_t end = text.find(',', start);
+		if (end == string::npos)
+			end = text.size();
+		string item = text.substr(start, end - start);
+		start = end + 1;
+		if (item.size() == 0)
+			continue;
+		int index = atoi(item.substr(1).c_str());
+		int bit = -1;
+		if ((item[0] == 'k') && (1 <= index) && (index <= h.keySize))
+			bit = h.keyOffset + index - 1;
+		else if ((item[0] == 'v') && (1 <= index) && (index <= h.ivSize) && (((h.cube[(index - 1) / 64] >> ((index - 1) % 64)) & 1) == 0))
+			bit = h.ivOffset + index - 1;
+		if (bit < 0) {
+			cerr << "cannot read " << item << " (k1-k" << h.keySize << " or a non-cube v1-v" << h.ivSize << ")" << endl;
+			return false;
+		}
+		mask[bit / 64] |= (1ULL << (bit % 64));
+	}
+	return true;
+}
+
+/*
+The name of a state bit of the file (k or v, 1-origin)
+*/
+inline string superpolyName(const superpolyHeader& h, int bit) {
+	if ((h.keyOffset <= bit) && (bit < h.keyOffset + h.keySize))
+		return "k" + to_string(bit - h.keyOffset + 1);
+	return "v" + to_string(bit - h.ivOffset + 1);
+}
+
+/*
+The query tool (-query):
+with monomials, the count and the parity of each monomial in every section (O(log n) per monomial),
+without, the statistics of every section (the number of monomials by degree and the occurrences of each variable in the superpoly),
+which read the records one by one through the mapping
+@Para
+filename: the superpoly file
+monomials: the monomials in the syntax of superpolyParse
+return: 0, or 1 on error
+*/
+inline int superpolyQuery(string filename, vector<string> monomials) {
+
+	superpolyFile file;
+	if (file.open(filename) == false)
+		return 1;
+	const superpolyHeader& h = file.header();
+
+	cout << h.cipher << " " << h.rounds << " rounds, cube ";
+	int cubeSize = 0;
+	for (int i = 0; i < h.ivSize; i++) {
+		if ((h.cube[i / 64] >> (i % 64)) & 1) {
+			cubeSize++;
+			cout << "iv" << (i + 1) << ",";
+		}
+	}
+	cout << " (" << cubeSize << " bits), targets";
+	for (int j = 0; j < h.numTargets; j++) {
+		cout << " " << h.targets[j];
+	}
+	cout << endl;
+
+	if (monomials.size() > 0) {
+		cout << "monomial\tsection\ttarget\tcount\tparity" << endl;
+		for (int m = 0; m < monomials.size(); m++) {
+			vector<uint64_t> mask;
+			if (superpolyParse(monomials[m], h, mask) == false)
+				return 1;
+			for (int s = 0; s < h.numSections; s++) {
+				uint64_t count = 0;
+				bool found = file.find(s, mask, count);
+				cout << monomials[m] << "\t" << s << "\t" << file.section(s).target << "\t" << count << "\t" << (found ? to_string(count % 2) : "-") << endl;
+			}
+		}
+		return 0;
+	}
+
+	for (int s = 0; s < h.numSections; s++) {
+		const superpolySection& sec = file.section(s);
+		vector<uint64_t> degrees(h.stateBits + 1, 0);
+		vector<uint64_t> occurrences(h.stateBits, 0);
+		uint64_t odd = 0;
+		int degree = -1;
+		for (uint64_t i = 0; i < sec.count; i++) {
+			const uint64_t* rec = file.record(s, i);
+			if ((rec[h.words] % 2) == 0)
+				continue;
+			odd++;
+			int d = 0;
+			for (int w = 0; w < h.words; w++) {
+				d += __builtin_popcountll(rec[w]);
+				uint64_t bits = rec[w];
+				while (bits) {
+					occurrences[w * 64 + __builtin_ctzll(bits)]++;
+					bits &= bits - 1;
+				}
+			}
+			degrees[d]++;
+			degree = max(degree, d);
+		}
+
+		cout << "section " << s << ", target " << sec.target << " : " << sec.count << " monomials, " << odd << " in the superpoly, degree " << degree << endl;
+		cout << "degree\tmonomials" << endl;
+		for (int d = 0; d <= degree; d++) {
+			if (degrees[d] > 0)
+				cout << d << "\t" << degrees[d] << endl;
+		}
+		cout << "variable\toccurrences" << endl;
+		for (int i = 0; i < h.stateBits; i++) {
+			if (occurrences[i] > 0)
+				cout << superpolyName(h, i) << "\t" << occurrences[i] << endl;
+		}
+	}
+	return 0;
+
+}
+
+#endif
@@ -1,4 +1,22 @@
 #include"main.h"
+#include"anf.h"
+#include"native.h"
+#include"backend.h"
+#include"schedule.h"
+#include"envpool.h"
+#include"tune.h"
+#include"manifest.h"
+#include"cubesearch.h"
+#include"verify.h"
+#include"superpoly.h"
+#include"gf2.h"
+#include"keysearch.h"
+#include"oracle.h"
+#include"metrics.h"
+#include"histogram.h"
+#include"asynclog.h"
+#include"microbench.h"
+#include"legacy.h"
 
 //Regard two 288-bit vectors a and b as ordinary integers and compare them to see whether a<b
 struct cmpBitset288 {
@@ -27,482 +45,1050 @@ Therefore, the 1st stage is to compute J[u->k'] and the 2nd stage is to find J[k
 The twoTwoStage structure is to handle such a process. 
 @Para:
 userTwoStage: true if we use such a two stage strategy
-divRound: usually R/2. Of course, other number is also OK. 
+divRound: usually R/2. Of course, other number is also OK. In the 1st stage, 0 means (preRound + R)/2 and a positive value is used for the 2nd stage. 
 hint: the respresentation of k'
+preRound: if positive, the first preRound rounds are expanded as ANF instead of the MILP model (hybrid mode, see triviumPreRound)
+prePoly: the ANF of the state after preRound rounds (see triviumANF)
+sched: if not NULL, the job runs under the scheduler. The 2nd stage asks it for the number of threads and the result is not displayed
+profile: if not empty, the variant of the parameter profiles used by both stages (see envpool.h)
+screen: if positive, the 1st stage (or the single stage) is preceded by a feasibility pass without the pool and the callback, limited to screen sec.
+If no trail exists, the enumeration is skipped and -1 is returned with the proof time as dulation (early zero sum)
+report: if not NULL, receives the statistics and the size of the model, including the presolve (see benchmarkFormulationTrivium)
+stop: if not NULL, the solve is aborted once *stop becomes true (see triviumRace). If *stop is already true, only the feasibility pass runs and -2 is returned
+unless it proves the zero sum (see cubeSearchTrivium)
+quiet: if true, the result is not displayed, as for the enumerations inside the benchmarks, the tuning and the verification
+backend: the solver of both stages (see newBackend), empty = the default of the build
+solver: if not NULL, the single stage is built on it instead (e.g. the stubbed solver of the microbenchmarks)
 */
 struct twoStage {
-	bool useTwoStage;
-	int divRound;
+	bool useTwoStage = false;
+	int divRound = 0;
 	vector<bitset<288>> hint;
+	int preRound = 0;
+	vector<anfPoly<288>>* prePoly = NULL;
+	jobScheduler* sched = NULL;
+	string profile;
+	atomic<bool>* stop = NULL;
+	struct pruneStat* report = NULL;
+	double screen = 0;
+	long long parent = 0;
+	bool quiet = false;
+	string backend;
+	divBackend* solver = NULL;
 };
 
+static const int triviumTaps[3][5] = { { 65, 170, 90, 91, 92 }, { 161, 263, 174, 175, 176 }, { 242, 68, 285, 286, 287 } };
+static const int triviumOutputs[6] = { 65, 92, 161, 176, 242, 287 };
 /*
-The core function of Trivium:
-x[i5]<-x[i3]*x[i4]+x[i2]+x[i1]+x[i5]
-x[*]<-x[*] where * is in [0,288)/{i1,i2,i3,i4,i5}
-@Para:
-model: the MILP model describing the 3-subset division property  
-x: the current k
-i1...i5: the indices involved
+The forward part of triviumReachability. It does not depend on the number of rounds,
+so fw[0..r] of a longer model is also the forward part of the r-round model (see triviumSweep)
 */
-void triviumCoreThree(GRBModel& model, vector<GRBVar>& x, int i1, int i2, int i3, int i4, int i5) {
-
-	GRBVar y1 = model.addVar(0, 1, 0, GRB_BINARY);
-	GRBVar y2 = model.addVar(0, 1, 0, GRB_BINARY);
-	GRBVar y3 = model.addVar(0, 1, 0, GRB_BINARY);
-	GRBVar y4 = model.addVar(0, 1, 0, GRB_BINARY);
-	GRBVar y5 = model.addVar(0, 1, 0, GRB_BINARY);
-
-	GRBVar z1 = model.addVar(0, 1, 0, GRB_BINARY);
-	GRBVar z2 = model.addVar(0, 1, 0, GRB_BINARY);
-	//GRBVar z3 = model.addVar(0, 1, 0, GRB_BINARY);
-	//GRBVar z4 = model.addVar(0, 1, 0, GRB_BINARY);
-
-	GRBVar a = model.addVar(0, 1, 0, GRB_BINARY);
-
-
-
-	model.addConstr(y1 <= x[i1]);
-	model.addConstr(z1 <= x[i1]);
-	model.addConstr(y1 + z1 >= x[i1]);
-
-
-	model.addConstr(y2 <= x[i2]);
-	model.addConstr(z2 <= x[i2]);
-	model.addConstr(y2 + z2 >= x[i2]);
-
-	model.addConstr(y3 <= x[i3]);
-	model.addConstr(a <= x[i3]);
-	model.addConstr(y3 + a >= x[i3]);
-
-	model.addConstr(y4 <= x[i4]);
-	model.addConstr(a <= x[i4]);
-	model.addConstr(y4 + a >= x[i4]);
+static vector<bitset<288>> triviumForward(vector<int>& flag, int evalNumRounds, struct twoStage& opt) {
 
-	model.addConstr(y5 == x[i5] + a + z1 + z2);
+	bool pinned = (opt.useTwoStage == true) && (opt.hint.size() > 0);
+	int r0 = opt.preRound;
 
-	x[i1] = y1;
-	x[i2] = y2;
-	x[i3] = y3;
-	x[i4] = y4;
-	x[i5] = y5;
+	vector<bitset<288>> fw(evalNumRounds + 1);
+	for (int i = 0; i < 288; i++) {
+		if (r0 == 0) {
+			if (flag[i] != 0) fw[0][i] = 1;
+		}
+		else {
+			if ((*opt.prePoly)[i].size() > 0) fw[r0][i] = 1;
+		}
+	}
+	for (int r = r0; r <= evalNumRounds; r++) {
+		if (pinned && (r == opt.divRound))
+			fw[r] &= opt.hint[r];
+		if (r == evalNumRounds)
+			break;
+
+		bitset<288> t = fw[r];
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			t[p[4]] = fw[r][p[4]] | fw[r][p[0]] | fw[r][p[1]] | (fw[r][p[2]] & fw[r][p[3]]);
+		}
+		fw[r + 1] = (t << 1) | (t >> 287);
+	}
 
+	return fw;
 }
+
 /*
-cube: cube indices
-flag: the situation of the 288 bits at current round: secret 3, active 2, const 1, const 0
-evalNumRounds: current round
-countingBox: map each monomial u(represented as a 288-bit vector) to an integer J[u] representing the number of available division trails 
-dulation: time for solving the model
-threadNumber: the number of threads used for solving the model
-target: 0: evaluate directly the exact output z=\sum ss[66,93,162,177,243,288]; 1-6 corresponding to s[66,93,162,177,243,288] resepectively to save the solving time.  
-opt: tell the solver to construct and solve the model corresponding to the 1st or 2nd stage
+Bit-level reachability pruning before the MILP model is constructed.
+Forward: s[r][i] can be nonzero only if it is reachable from the nonzero bits of round 0 (flag != 0). An AND needs both inputs.
+Backward: every nonzero unit must arrive at the output bits selected by target, so s[r][i] can be nonzero only if one of its successors can be nonzero.
+In the 2nd stage, the pinned k' at divRound restarts both propagations.
+Bits failing either test are fixed to 0 and the corresponding variables and constraints are dropped (see triviumCoreThree).
+@Para:
+flag, evalNumRounds, target, opt: same as triviumThreeEnumuration
+return: live[r][i] = 1 if s[r][i] can be nonzero
 */
-int triviumThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<288>, int, cmpBitset288>& countingBox, double& dulation, int threadNumber, int target = 0, struct twoStage opt = { false, 0, });
-class threeEnumuration : public GRBCallback
-{
-public:
-	vector<int> cube;
-	vector<int> flag;
-	vector<vector<GRBVar>> s;
-	int target;
-	map<bitset<288>, int, cmpBitset288>* countingBox;
-	int threadNumber;
-	ofstream* outputfile;
-	threeEnumuration(vector<int> xcube, vector<int> xflag, vector<vector<GRBVar>> xs, int xtarget, map<bitset<288>, int, cmpBitset288>* xcountingBox, int xthreadNumber, ofstream* xoutputfile) {
-		cube = xcube;
-		flag = xflag;
-		s = xs;
-		target = xtarget;
-		countingBox = xcountingBox;
-		threadNumber = xthreadNumber;
-		outputfile = xoutputfile;
-	}
-protected:
-	void callback() {
-		try {
-			if (where == GRB_CB_MIPSOL) {
-
-				int evalNumRounds = s.size() - 1;
-				int divRound = evalNumRounds / 2;
-
-				*outputfile << "found \t divide in " << divRound << "\t" << getDoubleInfo(GRB_CB_RUNTIME) << "sec" << endl;
-
-				// store found solution into trail
-				vector<bitset<288>> trail(evalNumRounds + 1);
-				for (int r = 0; r <= evalNumRounds; r++) {
-					for (int i = 0; i < 288; i++) {
-						if (round(getSolution(s[r][i])) == 1) trail[r][i] = 1;
-						else trail[r][i] = 0;
-					}
-				}
+vector<bitset<288>> triviumReachability(vector<int>& flag, int evalNumRounds, int target, struct twoStage& opt) {
 
-				// 2nd stage
-				double dulation = 0;
-				int solCnt = triviumThreeEnumuration(cube, flag, evalNumRounds, *countingBox, dulation, threadNumber, target, { true, divRound, trail });
+	bool pinned = (opt.useTwoStage == true) && (opt.hint.size() > 0);
+	int r0 = opt.preRound;
 
-				//
-				int solTotal = 0;
-				auto it = (*countingBox).begin();
-				while (it != (*countingBox).end()) {
-					solTotal += (*it).second;
-					it++;
-				}
-				(*outputfile) << "\t" << solCnt << "( total : " << solTotal << ")" << endl;
-				(*outputfile) << "\t" << (*countingBox).size() << " monomials are involved" << endl;
+	// forward
+	vector<bitset<288>> fw = triviumForward(flag, evalNumRounds, opt);
 
-				// remove
-				GRBLinExpr addCon = 0;
-				for (int i = 0; i < 288; i++) {
-					if (round(getSolution(s[divRound][i])) == 1) {
-						addCon += (1 - s[divRound][i]);
-					}
-					else {
-						addCon += s[divRound][i];
-					}
-				}
-				addLazy(addCon >= 1);
+	// backward
+	bitset<288> out;
+	for (int j = 0; j < 6; j++) {
+		if ((target == 0) || (target == j + 1))
+			out[triviumOutputs[j]] = 1;
+	}
 
+	vector<bitset<288>> live(evalNumRounds + 1);
+	live[evalNumRounds] = fw[evalNumRounds] & out;
+	for (int r = evalNumRounds - 1; r >= r0; r--) {
+		bitset<288> u = (live[r + 1] >> 1) | (live[r + 1] << 287);
+		bitset<288> t = u;
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			if (u[p[4]]) {
+				t[p[0]] = 1;
+				t[p[1]] = 1;
+				if (fw[r][p[3]]) t[p[2]] = 1;
+				if (fw[r][p[2]]) t[p[3]] = 1;
 			}
-			else if (where == GRB_CB_MESSAGE) {
-				// Message callback
-				string msg = getStringInfo(GRB_CB_MSG_STRING);
-				*outputfile << msg << flush;
-			}
-		}
-		catch (GRBException e) {
-			cerr << "Error number: " << e.getErrorCode() << endl;
-			cerr << e.getMessage() << endl;
-		}
-		catch (...) {
-			cout << "Error during callback" << endl;
 		}
-	}
-};
-int triviumThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<288>, int, cmpBitset288>& countingBox, double& dulation, int threadNumber, int target, struct twoStage opt) {
-
-	//
-	ofstream outputfile;
-	if ((opt.useTwoStage == true) && (opt.hint.size() == 0)) {
-		outputfile.open("log_trivium.txt", ios::app);
-	}
-	else if ((opt.useTwoStage == true) && (opt.hint.size() > 0)) {
-		outputfile.open("log_trivium2.txt", ios::app);
-	}
-	else {
-		outputfile.open("log_trivium.txt", ios::app);
+		live[r] = fw[r] & t;
+		if (pinned && (r == opt.divRound))
+			live[r] &= opt.hint[r];
 	}
 
-
-	//
-	if (opt.useTwoStage == true) {
-		if (opt.hint.size() == 0) {
-			outputfile << endl;
-			outputfile << "++++++++++++++++++++++++++++" << endl;
-			outputfile << "1st stage" << endl;
-		}
-		else {
-			outputfile << "---" << endl;
-			outputfile << "2nd stage" << endl;
+	// hybrid mode: the variables of s[0] appearing in the live polynomials
+	if (r0 > 0) {
+		for (int i = 0; i < 288; i++) {
+			if (live[r0][i] == 0)
+				continue;
+			auto it = (*opt.prePoly)[i].begin();
+			while (it != (*opt.prePoly)[i].end()) {
+				live[0] |= (*it);
+				it++;
+			}
 		}
 	}
 
-	//gurobi
-	try {
-		// Create the environment
-		GRBEnv env = GRBEnv();
+	return live;
+}
 
-		// close standard output
-		env.set(GRB_IntParam_LogToConsole, 0);
-		env.set(GRB_IntParam_Threads, threadNumber);
-		env.set(GRB_IntParam_MIPFocus, GRB_MIPFOCUS_BESTBOUND);
+/*
+Upper bound of the degree in the cube variables of every output bit by the numeric mapping, the 1st stage of the cube search.
+A key bit or a const 1 bit has degree 0, an active bit 1 and a const 0 bit no degree (-1). An AND adds the degrees and the XOR takes the maximum,
+capped by the cube size. If the bound of a target is smaller than the cube size, its superpoly is zero.
+@Para
+flag: the situation of the 288 bits: secret 3, active 2, const 1, const 0
+return: the bound of the target j + 1 (triviumOutputs[j]), -1 if the bit is always 0
+*/
+vector<int> triviumDegreeBound(vector<int>& flag, int evalNumRounds) {
+
+	int cubeSize = 0;
+	vector<int> d(288);
+	for (int i = 0; i < 288; i++) {
+		d[i] = (flag[i] == 0) ? -1 : ((flag[i] == 2) ? 1 : 0);
+		if (flag[i] == 2)
+			cubeSize++;
+	}
 
-		if ((opt.useTwoStage == true) && (opt.hint.size() == 0)) {
-			env.set(GRB_IntParam_LazyConstraints, 1);
-		}else if ((opt.useTwoStage == true) && (opt.hint.size() > 0)) {
-			env.set(GRB_StringParam_LogFile, "log_trivium2.txt");
-			env.set(GRB_IntParam_PoolSearchMode, 2);
-			env.set(GRB_IntParam_PoolSolutions, 2000000000);
-			env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
-		}
-		else {
-			env.set(GRB_StringParam_LogFile, "log_trivium.txt");
-			env.set(GRB_IntParam_PoolSearchMode, 2);
-			env.set(GRB_IntParam_PoolSolutions, 2000000000);
-			env.set(GRB_DoubleParam_PoolGap, GRB_INFINITY);
+	for (int r = 0; r < evalNumRounds; r++) {
+		vector<int> t = d;
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			int a = ((d[p[2]] < 0) || (d[p[3]] < 0)) ? -1 : min(d[p[2]] + d[p[3]], cubeSize);
+			t[p[4]] = max(max(d[p[4]], d[p[0]]), max(d[p[1]], a));
 		}
+		rotate(t.begin(), t.begin() + 287, t.end());
+		d = t;
+	}
 
-		
-		// Create the model
-		GRBModel model = GRBModel(env);
+	vector<int> bound(6);
+	for (int j = 0; j < 6; j++) {
+		bound[j] = d[triviumOutputs[j]];
+	}
+	return bound;
+}
 
-		// Create variables
-		vector<vector<GRBVar>> s(evalNumRounds + 1, vector<GRBVar>(288));
-		for (int i = 0; i < 288; i++) {
-			s[0][i] = model.addVar(0, 1, 0, GRB_BINARY);
-		}
+/*
+The ANF of the state after r0 rounds over the initial state s[0].
+The const 0 bits (flag 0) are substituted by 0, s[285..287] by 1 and the other bits are variables.
+The other flag 1 bits (the const= IV bits of a manifest job) stay variables as in the MILP, so they appear in the superpoly.
+@Para
+flag: the situation of the 288 bits: secret 3, active 2, const 1, const 0
+r0: the number of rounds to be expanded
+*/
+vector<anfPoly<288>> triviumANF(vector<int>& flag, int r0) {
+
+	vector<anfPoly<288>> x(288);
+	for (int i = 0; i < 288; i++) {
+		if (flag[i] == 0)
+			x[i] = anfConst<288>(0);
+		else if ((flag[i] == 1) && (i >= 285))
+			x[i] = anfConst<288>(1);
+		else
+			x[i] = anfVar<288>(i);
+	}
 
-		// IV constraint
-		for (int i = 0; i < 80; i++) {
-			if (cube[i] == 1)
-				model.addConstr(s[0][93 + i] == 1);
+	for (int r = 0; r < r0; r++) {
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			anfAdd(x[p[4]], x[p[0]]);
+			anfAdd(x[p[4]], x[p[1]]);
+			anfAdd(x[p[4]], anfMul(x[p[2]], x[p[3]]));
 		}
+		rotate(x.begin(), x.begin() + 287, x.end());
+	}
 
-		// Const 0, constraint
-		for (int i = 0; i < 288; i++) {
-			if (flag[i] == 0)
-				model.addConstr(s[0][i] == 0);
-		}
+	return x;
+}
 
-		// Round function
-		for (int r = 0; r < evalNumRounds; r++) {
-			vector<GRBVar> tmp = s[r];
-			triviumCoreThree(model, tmp, 65, 170, 90, 91, 92);
-			triviumCoreThree(model, tmp, 161, 263, 174, 175, 176);
-			triviumCoreThree(model, tmp, 242, 68, 285, 286, 287);
-			
-			for (int i = 0; i < 288; i++) {
-				s[r + 1][(i + 1) % 288] = tmp[i];
-			}
-		}
+/*
+Display the monomials u and J[u] stored in the countingBox
+*/
+void displayTriviumBox(map<bitset<288>, int, cmpBitset288>& countingBox, vector<int>& cube, double dulation) {
 
-		// Output constraint
-		if (target == 0) {
-			GRBLinExpr ks = 0;
-			for (int i = 0; i < 288; i++) {
-				if ((i == 65) || (i == 92) || (i == 161) || (i == 176) || (i == 242) || (i == 287)) {
-					ks += s[evalNumRounds][i];
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
-			}
-			model.addConstr(ks == 1);
-		}
-		else if (target == 1) {
-			for (int i = 0; i < 288; i++) {
-				if ((i == 65)) {
-					model.addConstr(s[evalNumRounds][i] == 1);
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
-			}
-		}
-		else if (target == 2) {
-			for (int i = 0; i < 288; i++) {
-				if ((i == 92)) {
-					model.addConstr(s[evalNumRounds][i] == 1);
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
+
+		cout << ((*it).second % 2) << " | " << (*it).second << "\t";
+		bitset<288> tmp = (*it).first;
+		for (int i = 0; i < 80; i++) {
+			if ((tmp[i] == 1)) {
+				cout << "k" << (i + 1) << " ";
 			}
 		}
-		else if (target == 3) {
-			for (int i = 0; i < 288; i++) {
-				if ((i == 161)) {
-					model.addConstr(s[evalNumRounds][i] == 1);
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
+		for (int i = 0; i < 80; i++) {
+			if ((cube[i] == 0) && (tmp[93 + i] == 1)) {
+				cout << "v" << (i + 1) << " ";
 			}
 		}
-		else if (target == 4) {
-			for (int i = 0; i < 288; i++) {
-				if ((i == 176)) {
-					model.addConstr(s[evalNumRounds][i] == 1);
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
+		for (int i = 285; i < 288; i++) {
+			if ((tmp[i] == 1)) {
+				cout << "c" << (i + 1) << " ";
 			}
 		}
-		else if (target == 5) {
-			for (int i = 0; i < 288; i++) {
-				if ((i == 242)) {
-					model.addConstr(s[evalNumRounds][i] == 1);
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
-			}
+		cout << endl;
 
-		}
-		else if (target == 6) {
-			for (int i = 0; i < 288; i++) {
-				if ((i == 287)) {
-					model.addConstr(s[evalNumRounds][i] == 1);
-				}
-				else {
-					model.addConstr(s[evalNumRounds][i] == 0);
-				}
-			}
-		}
+		it++;
+	}
+	cout << dulation << "sec" << endl;
 
-		//
-		GRBLinExpr sumKey = 0;
+}
+
+/*
+Display the superpoly: the cube bits and the constant 1 bits are removed from the monomials u, and the monomials with odd J[u] (the superpoly) are listed before the cancelled ones.
+The non-cube IV bits regarded as undetermined constants (flag 1) are displayed as v.
+*/
+void displayTriviumSuperpoly(ostream& out, map<bitset<288>, int, cmpBitset288>& countingBox, vector<int>& cube) {
+
+	out << "*****************************" << endl;
+	out << "Final solution" << endl;
+	out << countingBox.size() << " solutions are found" << endl;
+
+	map<bitset<288>, int, cmpBitset288> countingBox2;
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
+		bitset<288> tmp = (*it).first;
 		for (int i = 0; i < 80; i++) {
-			sumKey += s[0][i];
+			if(cube[i] == 1)
+				tmp[93 + i] = 0;
 		}
-		model.setObjective(sumKey, GRB_MAXIMIZE);
-	
-		//
-		if (opt.useTwoStage == true) {
-			if (opt.hint.size() > 0) {
+		tmp[285] = 0;
+		tmp[286] = 0;
+		tmp[287] = 0;
+		countingBox2[tmp] += (*it).second;
+		it++;
+	}
 
-				// fix
-				for (int i = 0; i < 288; i++) {
-					if (opt.hint[opt.divRound][i] == 1)
-						model.addConstr(s[opt.divRound][i] == 1);
-					else
-						model.addConstr(s[opt.divRound][i] == 0);
+	for (int parity = 1; parity >= 0; parity--) {
+		auto it2 = countingBox2.begin();
+		while (it2 != countingBox2.end()) {
+			if (((*it2).second % 2) == parity) {
+				out << ((*it2).second % 2) << " | " << (*it2).second << "\t";
+				bitset<288> tmp = (*it2).first;
+				for (int i = 0; i < 80; i++) {
+					if ((tmp[i] == 1)) {
+						out << "k" << (i + 1) << " ";
+					}
 				}
-
-				// hint
-				for (int r = 0; r < evalNumRounds; r++) {
-					for (int i = 0; i < 288; i++) {
-						if (opt.hint[r][i] == 1)
-							s[r][i].set(GRB_DoubleAttr_Start, 1);
-						else
-							s[r][i].set(GRB_DoubleAttr_Start, 0);
+				for (int i = 0; i < 80; i++) {
+					if ((tmp[93 + i] == 1)) {
+						out << "v" << (i + 1) << " ";
 					}
 				}
+				out << endl;
+			}
+			it2++;
+		}
+	}
 
+}
 
-			}
+/*
+The number of monomials of the superpoly (odd J[u] after the projection of displayTriviumSuperpoly) and its degree
+*/
+static int triviumSuperpolySize(map<bitset<288>, int, cmpBitset288>& countingBox, vector<int>& cube, int& degree) {
+
+	map<bitset<288>, int, cmpBitset288> countingBox2;
+	auto it = countingBox.begin();
+	while (it != countingBox.end()) {
+		bitset<288> tmp = (*it).first;
+		for (int i = 0; i < 80; i++) {
+			if (cube[i] == 1)
+				tmp[93 + i] = 0;
 		}
+		tmp[285] = 0;
+		tmp[286] = 0;
+		tmp[287] = 0;
+		countingBox2[tmp] += (*it).second;
+		it++;
+	}
 
-		// Solve
-		model.update();
-		if ((opt.useTwoStage == true) && (opt.hint.size() == 0) ) {
-			threeEnumuration cb = threeEnumuration(cube, flag, s, target, &countingBox, threadNumber, &outputfile);
-			model.setCallback(&cb);
-			model.optimize();
+	int monomials = 0;
+	degree = 0;
+	auto it2 = countingBox2.begin();
+	while (it2 != countingBox2.end()) {
+		if (((*it2).second % 2) == 1) {
+			monomials++;
+			degree = max(degree, (int)(*it2).first.count());
 		}
-		else {
-			model.optimize();
+		it2++;
+	}
+	return monomials;
+
+}
+
+/*
+The predecessors of the state vector k at round r+1 by one round of triviumCoreThree.
+If the output bit x[i5] of a gadget is 1, the unit comes from x[i5], x[i1], x[i2] or x[i3]*x[i4], and each choice is one division trail.
+*/
+void triviumBackward(const bitset<288>& k, vector<bitset<288>>& pred) {
+
+	bitset<288> u = (k >> 1) | (k << 287);
+	pred.push_back(u);
+
+	for (int j = 0; j < 3; j++) {
+		const int* p = triviumTaps[j];
+		if (u[p[4]] == 0)
+			continue;
+
+		int n = pred.size();
+		for (int e = 0; e < n; e++) {
+			bitset<288> x = pred[e];
+			x[p[4]] = 0;
+
+			bitset<288> x1 = x;
+			x1[p[0]] = 1;
+			bitset<288> x2 = x;
+			x2[p[1]] = 1;
+			bitset<288> x34 = x;
+			x34[p[2]] = 1;
+			x34[p[3]] = 1;
+
+			pred.push_back(x1);
+			pred.push_back(x2);
+			pred.push_back(x34);
 		}
+	}
 
+}
 
-		//
-		int solCount = model.get(GRB_IntAttr_SolCount);
-		dulation = model.get(GRB_DoubleAttr_Runtime);
+/*
+Solver-free counterpart of triviumThreeEnumuration.
+The division trails are counted by the backward expansion from the output bits selected by target to round 0 (see native.h).
+A state vector at round r is dropped if it contains a bit which is not live (see triviumReachability),
+or if the upper bound of its degree in the cube variables (numeric mapping) is smaller than the cube size.
+The countingBox is filled with the same u and J[u] as triviumThreeEnumuration.
+@Para
+cube, flag, evalNumRounds, countingBox, dulation, threadNumber, target: same as triviumThreeEnumuration
+parity: if true, only the parity of J[u] is counted, which removes the cancelled vectors from the frontier
+divRound: if positive, the expansion from the output stops at divRound (or earlier if the frontier is larger than memLimit),
+  and the midpoints are expanded to round 0 in batches (see nativeMidpoints)
+memLimit: the number of vectors of a frontier kept in memory in the batched expansion
+quiet: if true, the result is not displayed (see twoStage)
+return: the number of division trails
+*/
+int triviumNativeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<288>, int, cmpBitset288>& countingBox, double& dulation, int threadNumber, int target = 0, bool parity = false, int divRound = 0, long long memLimit = nativeMemLimit, bool quiet = false) {
 
+	logStream outputfile("log_trivium.txt");
+	outputfile << endl;
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << "native " << evalNumRounds << " rounds, target " << target << ", divRound " << divRound << endl;
 
-		//
-		if (opt.useTwoStage == true) {
-			if (opt.hint.size() > 0) {
-				// check solution limit
-				if (solCount >= 2000000000) {
-					cerr << "Number of solutions is too large" << endl;
-					exit(0);
-				}
+	auto start = chrono::steady_clock::now();
+	metricsJob metrics("trivium native " + to_string(evalNumRounds) + " target " + to_string(target), 3, threadNumber);
 
-				// store the information about solutions
-				for (int i = 0; i < solCount; i++) {
-					model.set(GRB_IntParam_SolutionNumber, i);
-					bitset<288> tmp;
-					for (int j = 0; j < 288; j++) {
-						if (round(s[0][j].get(GRB_DoubleAttr_Xn)) == 1) tmp[j] = 1;
-						else tmp[j] = 0;
-					}
-					countingBox[tmp]++;
-				}
+	// live bits
+	struct twoStage opt;
+	vector<bitset<288>> live = triviumReachability(flag, evalNumRounds, target, opt);
 
-				return solCount;
-			}
+	// upper bound of the degree in the cube variables
+	int cubeSize = 0;
+	bitset<288> cubeMask;
+	for (int i = 0; i < 80; i++) {
+		if (cube[i] == 1) {
+			cubeSize++;
+			cubeMask[93 + i] = 1;
 		}
-		else {
-			// check solution limit
-			if (solCount >= 2000000000) {
-				cerr << "Number of solutions is too large" << endl;
-				exit(0);
-			}
-
-			// store the information about solutions
-			for (int i = 0; i < solCount; i++) {
-				model.set(GRB_IntParam_SolutionNumber, i);
-				bitset<288> tmp;
-				for (int j = 0; j < 288; j++) {
-					if (round(s[0][j].get(GRB_DoubleAttr_Xn)) == 1) tmp[j] = 1;
-					else tmp[j] = 0;
-				}
-				countingBox[tmp]++;
-			}
+	}
+	vector<vector<int>> deg(evalNumRounds + 1, vector<int>(288, 0));
+	for (int i = 0; i < 288; i++) {
+		deg[0][i] = cubeMask[i];
+	}
+	for (int r = 0; r < evalNumRounds; r++) {
+		vector<int> d = deg[r];
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			d[p[4]] = max(max(d[p[4]], d[p[0]]), max(d[p[1]], d[p[2]] + d[p[3]]));
+			d[p[4]] = min(d[p[4]], cubeSize);
+		}
+		for (int i = 0; i < 288; i++) {
+			deg[r + 1][(i + 1) % 288] = d[i];
 		}
+	}
 
+	// the output bits at the last round
+	int numShards = 4 * max(threadNumber, 1);
+	nativeFrontier<288> frontier(numShards);
+	for (int i = 0; i < 288; i++) {
+		if (live[evalNumRounds][i] == 1) {
+			bitset<288> k;
+			k[i] = 1;
+			frontier[hash<bitset<288>>()(k) % numShards][k] = 1;
+		}
+	}
 
+	// backward expansion
+	auto keep = [&](int r, const bitset<288>& k) {
+		if ((k & ~live[r]).any())
+			return false;
+		if ((r == 0) && ((k & cubeMask) != cubeMask))
+			return false;
+		int d = 0;
+		for (int i = 0; (i < 288) && (d < cubeSize); i++) {
+			if (k[i] == 1)
+				d += deg[r][i];
+		}
+		return (d >= cubeSize);
+	};
+	// with divRound, the expansion also stops at the first round whose frontier is larger than memLimit
+	int midRound = divRound;
+	for (int r = evalNumRounds - 1; r >= divRound; r--) {
+		frontier = nativeExpand(frontier, triviumBackward, [&](const bitset<288>& k) { return keep(r, k); }, threadNumber, parity);
+		outputfile << r << "\t" << nativeSize(frontier) << endl;
+		if ((divRound > 0) && (r > divRound) && ((long long)nativeSize(frontier) > memLimit)) {
+			midRound = r;
+			break;
+		}
+	}
 
-		// display result
-		auto it = countingBox.begin();
-		while (it != countingBox.end()) {
+	// batched expansion of the midpoints below midRound
+	long long midpoints = 0;
+	if (divRound > 0) {
+		midpoints = nativeSize(frontier);
+		if (nativeSize(frontier) > memLimit)
+			outputfile << nativeSize(frontier) << " midpoints at round " << midRound << " are split and spilled to disk" << endl;
+		frontier = nativeMidpoints(frontier, midRound, triviumBackward, keep, threadNumber, parity, memLimit, "native_trivium_spill");
+		outputfile << "midpoints\t" << nativeSize(frontier) << endl;
+	}
 
-			cout << ((*it).second % 2) << " | " << (*it).second << "\t";
-			bitset<288> tmp = (*it).first;
-			for (int i = 0; i < 80; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "k" << (i + 1) << " ";
-				}
-			}
-			for (int i = 0; i < 80; i++) {
-				if ((cube[i] == 0) && (tmp[93 + i] == 1)) {
-					cout << "v" << (i + 1) << " ";
-				}
-			}
-			for (int i = 285; i < 288; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "c" << (i + 1) << " ";
-				}
-			}
-			cout << endl;
+	metrics.phase("solve", { { "midpoints", midpoints } });
 
+	// store the information about solutions
+	long long solCount = 0;
+	for (int sh = 0; sh < numShards; sh++) {
+		auto it = frontier[sh].begin();
+		while (it != frontier[sh].end()) {
+			countingBox[(*it).first] += (*it).second;
+			solCount += (*it).second;
 			it++;
 		}
-		cout << dulation << "sec" << endl;
+	}
+	dulation = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	outputfile << solCount << " trails\t" << dulation << "sec" << endl;
+	metrics.phase("extract", { { "solutions", solCount }, { "monomials", countingBox.size() } });
 
+	// display result
+	if (!quiet)
+		displayTriviumBox(countingBox, cube, dulation);
 
+	return solCount;
+}
 
-		//result
-		if (model.get(GRB_IntAttr_Status) == GRB_INFEASIBLE) {
-			return -1;
-		}
-		else if ((model.get(GRB_IntAttr_Status) == GRB_OPTIMAL)) {
-			int upperBound = round(model.get(GRB_DoubleAttr_ObjVal));
-			return upperBound;
-		}
-		else {
-			cout << model.get(GRB_IntAttr_Status) << endl;
-			return -2;
-		}
+/*
+The solver-free counterpart of triviumManifestJob for the regression benchmark (engine=native, see regress.h).
+The targets of the job are counted one after another by triviumNativeEnumuration (with the batched expansion of the midpoints at div= if given, pre= is not used)
+and the superpoly is written into job.out in the format of triviumManifestJob.
+return: 0, or 1 if the result file cannot be written
+*/
+int triviumNativeJob(struct manifestJob& job, int threadNumber) {
+
+	// constant (secret 3, active 2, const 1, const 0)
+	vector<int> cube(80, 0);
+	vector<int> flag(288, 0);
+	for (int i = 0; i < 80; i++) {
+		flag[i] = 3;
 	}
-	catch (GRBException e) {
-		cerr << "Error code = " << e.getErrorCode() << endl;
-		cerr << e.getMessage() << endl;
+	for (int i = 0; i < job.consts.size(); i++) {
+		flag[93 + job.consts[i]] = 1;
 	}
-	catch (...) {
-		cerr << "Exception during optimization" << endl;
+	for (int i = 0; i < job.cube.size(); i++) {
+		cube[job.cube[i]] = 1;
+		flag[93 + job.cube[i]] = 2;
+	}
+	flag[285] = 1;
+	flag[286] = 1;
+	flag[287] = 1;
+
+	map<bitset<288>, int, cmpBitset288> countingBox;
+	for (int j = 0; j < job.targets.size(); j++) {
+		double dulation = 0;
+		triviumNativeEnumuration(cube, flag, job.rounds, countingBox, dulation, threadNumber, job.targets[j], true, job.divRound, nativeMemLimit, true);
 	}
 
-	return -1;
-}
-int trivium(int evalNumRounds, int threadNumber) {
-
-  //
-  ofstream outputfile, outputfile2;
-  outputfile.open("log_trivium.txt");
-  outputfile2.open("log_trivium2.txt");
+	ofstream outputfile(job.out);
+	outputfile << "# trivium " << job.rounds << " cube=" << job.cubeText << " const=" << job.constText << " div=" << job.divRound << " engine=native" << endl;
+	displayTriviumSuperpoly(outputfile, countingBox, cube);
+	return outputfile ? 0 : 1;
 
-  // active bits
-  vector<int> cube(80, 0);
-  for (int i = 0; i < 80; i++) {
+}
 
-		if (evalNumRounds == 840) {
-			if ((i == 33) || (i == 46)) {
 
-			}
-			else {
+/*
+The core function of Trivium:
+x[i5]<-x[i3]*x[i4]+x[i2]+x[i1]+x[i5]
+x[*]<-x[*] where * is in [0,288)/{i1,i2,i3,i4,i5}
+Bits which can never be nonzero (see triviumReachability) are represented by the fixed variable "zero", and the COPY/AND/XOR branches touching them are not generated.
+If only one branch of a COPY survives, the input variable is passed through without new variables.
+@Para:
+solver: the backend of the model describing the 3-subset division property (see backend.h)
+x: the current k
+i1...i5: the indices involved
+zero: the variable fixed to 0
+in: the live bits of x before the update
+out: the live bits of x after the update (before the rotation)
+stat: counts the generated variables and constraints. stat.formulation selects the encoding of COPY (see Formulation in envpool.h):
+  general is x = y | w as a general constraint, and linear (default) is y <= x, w <= x, y + w >= x.
+  No bit is tapped twice in one round of Trivium (the 15 indices of the three gadgets are distinct), so merged is the same as linear
+ands: if not NULL, the output of the AND gate is appended (see AndPriority in envpool.h)
+*/
+static void triviumCopy(divBackend& solver, int& x, int& w, int zero, bool stay, struct pruneStat& stat) {
+
+	if (x == zero) {
+		return;
+	}
+
+	if (w == zero) {
+		if (stay == false) {
+			solver.fix(x, 0);
+			stat.constrs++;
+			x = zero;
+		}
+	}
+	else if (stay == false) {
+		solver.addEqual(w, x);
+		stat.constrs++;
+		x = zero;
+	}
+	else if (stat.formulation == "general") {
+		int y = solver.addVar();
+		solver.addOr(x, { y, w });
+		stat.vars++;
+		stat.genConstrs++;
+		x = y;
+	}
+	else {
+		int y = solver.addVar();
+		solver.addOr(x, { y, w }, true);
+		stat.vars++;
+		stat.constrs += 3;
+		x = y;
+	}
+
+}
+void triviumCoreThree(divBackend& solver, vector<int>& x, int i1, int i2, int i3, int i4, int i5, int zero, bitset<288>& in, bitset<288>& out, struct pruneStat& stat, vector<int>* ands = NULL) {
+
+	bool feed = out[i5];
+
+	// z1, z2 : x[i1] and x[i2] copied to the XOR
+	int z1 = zero;
+	if (in[i1] && feed && (out[i1] == false)) {
+		z1 = x[i1];
+		x[i1] = zero;
+	}
+	else {
+		if (in[i1] && feed) {
+			z1 = solver.addVar();
+			stat.vars++;
+		}
+		triviumCopy(solver, x[i1], z1, zero, out[i1], stat);
+	}
+
+	int z2 = zero;
+	if (in[i2] && feed && (out[i2] == false)) {
+		z2 = x[i2];
+		x[i2] = zero;
+	}
+	else {
+		if (in[i2] && feed) {
+			z2 = solver.addVar();
+			stat.vars++;
+		}
+		triviumCopy(solver, x[i2], z2, zero, out[i2], stat);
+	}
+
+	// a : x[i3]*x[i4] (z3 and z4 are removed because a = z3 = z4)
+	int a = zero;
+	if (in[i3] && in[i4] && feed) {
+		a = solver.addVar();
+		stat.vars++;
+		if (ands != NULL)
+			ands->push_back(a);
+	}
+	triviumCopy(solver, x[i3], a, zero, out[i3], stat);
+	triviumCopy(solver, x[i4], a, zero, out[i4], stat);
+
+	// y5 = x[i5] + a + z1 + z2
+	vector<int> terms;
+	if (x[i5] != zero) terms.push_back(x[i5]);
+	if (a != zero) terms.push_back(a);
+	if (z1 != zero) terms.push_back(z1);
+	if (z2 != zero) terms.push_back(z2);
+
+	if (terms.size() == 0) {
+		x[i5] = zero;
+	}
+	else if (terms.size() == 1) {
+		x[i5] = terms[0];
+	}
+	else {
+		int y5 = solver.addVar();
+		solver.addSum(y5, terms);
+		stat.vars++;
+		stat.constrs++;
+		x[i5] = y5;
+	}
+
+}
+
+/*
+Hybrid mode: the first preRound rounds are replaced by the ANF of s[preRound].
+If s[preRound][i] = 1, exactly one monomial of prePoly[i] is chosen, and s[0] is the union of the chosen monomials.
+For each s[0], the number of solutions of this layer is the coefficient of s[0] in the product of the chosen polynomials over the integers,
+so its parity is the same as the number of trails through the omitted rounds, and the parity of J[u] is preserved.
+The rounds in between are filled with zero.
+@Para
+solver: the backend of the model
+s: the variables of each round. s[0] and s[preRound] are filled in this function
+live: the result of triviumReachability
+zero: the variable fixed to 0
+prePoly: the ANF of s[preRound]
+stat: counts the generated variables and constraints
+*/
+void triviumPreRound(divBackend& solver, vector<vector<int>>& s, vector<bitset<288>>& live, int zero, int preRound, vector<anfPoly<288>>& prePoly, struct pruneStat& stat) {
+
+	for (int r = 0; r < preRound; r++) {
+		for (int i = 0; i < 288; i++) {
+			s[r][i] = zero;
+		}
+	}
+	for (int i = 0; i < 288; i++) {
+		if (live[0][i] == 1) {
+			s[0][i] = solver.addVar();
+			stat.vars++;
+		}
+	}
+
+	// choose one monomial for each active bit of s[preRound]
+	vector<vector<int>> cover(288);
+	for (int i = 0; i < 288; i++) {
+		if (live[preRound][i] == 0) {
+			s[preRound][i] = zero;
+			continue;
+		}
+		s[preRound][i] = solver.addVar();
+		stat.vars++;
+
+		vector<int> choice;
+		auto it = prePoly[i].begin();
+		while (it != prePoly[i].end()) {
+			int m = solver.addVar();
+			stat.vars++;
+			choice.push_back(m);
+			for (int j = 0; j < 288; j++) {
+				if ((*it)[j] == 1) {
+					// m <= s[0][j]
+					solver.addClause({ -(m + 1), s[0][j] + 1 });
+					stat.constrs++;
+					cover[j].push_back(m + 1);
+				}
+			}
+			it++;
+		}
+		solver.addSum(s[preRound][i], choice);
+		stat.constrs++;
+	}
+
+	// s[0] is the union of the chosen monomials
+	for (int j = 0; j < 288; j++) {
+		if (s[0][j] != zero) {
+			cover[j].push_back(-(s[0][j] + 1));
+			solver.addClause(cover[j]);
+			stat.constrs++;
+		}
+	}
+
+}
+/*
+cube: cube indices
+flag: the situation of the 288 bits at current round: secret 3, active 2, const 1, const 0
+evalNumRounds: current round
+countingBox: map each monomial u(represented as a 288-bit vector) to an integer J[u] representing the number of available division trails 
+dulation: time for solving the model
+threadNumber: the number of threads used for solving the model
+target: 0: evaluate directly the exact output z=\sum ss[66,93,162,177,243,288]; 1-6 corresponding to s[66,93,162,177,243,288] resepectively to save the solving time.  
+opt: tell the solver to construct and solve the model corresponding to the 1st or 2nd stage
+The model is built on the backend of opt (see backend.h). In the 1st stage, every trail found by the lazy enumeration runs its 2nd stage
+and is cut off by the lazy clause of its divRound layer, so the next trail has another k'.
+*/
+int triviumThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<288>, int, cmpBitset288>& countingBox, double& dulation, int threadNumber, int target = 0, struct twoStage opt = twoStage());
+int triviumThreeEnumuration(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<288>, int, cmpBitset288>& countingBox, double& dulation, int threadNumber, int target, struct twoStage opt) {
+
+	// the log of the job (see asynclog.h)
+	logStream outputfile(((opt.useTwoStage == true) && (opt.hint.size() > 0)) ? "log_trivium2.txt" : "log_trivium.txt");
+
+
+	//
+	if (opt.useTwoStage == true) {
+		if (opt.hint.size() == 0) {
+			outputfile << endl;
+			outputfile << "++++++++++++++++++++++++++++" << endl;
+			outputfile << "1st stage" << endl;
+		}
+		else {
+			outputfile << "---" << endl;
+			outputfile << "2nd stage" << endl;
+		}
+	}
+
+	// metrics of the solve (see metrics.h): stage 0 (single stage), 1 or 2. A 2nd stage is a child of its 1st stage
+	int stage = (opt.useTwoStage == false) ? 0 : ((opt.hint.size() == 0) ? 1 : 2);
+	metricsJob metrics("trivium " + to_string(evalNumRounds) + " target " + to_string(target), stage, threadNumber, opt.parent);
+
+	// the backend with the environment of the profile
+	string profile = "trivium";
+	if ((opt.useTwoStage == true) && (opt.hint.size() == 0))
+		profile = "trivium1";
+	else if ((opt.useTwoStage == true) && (opt.hint.size() > 0))
+		profile = "trivium2";
+	backendProfile(profile, stage == 1, true);
+	if (opt.profile.size() > 0)
+		profile += "/" + opt.profile;
+	unique_ptr<divBackend> owned;
+	divBackend* solver = opt.solver;
+	if ((solver == NULL) || (stage > 0)) {
+		owned.reset(newBackend(opt.backend, profile, threadNumber));
+		solver = owned.get();
+	}
+	if (solver == NULL) {
+		cerr << "the backend " << opt.backend << " is not available" << endl;
+		return -1;
+	}
+	metrics.phase("env", { { "cacheHit", solver->cacheHit() } });
+
+	// Reachability pruning
+	struct pruneStat stat(evalNumRounds);
+	stat.formulation = solver->option("Formulation");
+	vector<bitset<288>> live = triviumReachability(flag, evalNumRounds, target, opt);
+	for (int r = 0; r <= evalNumRounds; r++) {
+		stat.liveBits[r] = live[r].count();
+	}
+	int zero = solver->addVar();
+	solver->fix(zero, 0);
+
+	// Create variables
+	vector<vector<int>> s(evalNumRounds + 1, vector<int>(288));
+	if (opt.preRound == 0) {
+		for (int i = 0; i < 288; i++) {
+			if (live[0][i] == 1)
+				s[0][i] = solver->addVar();
+			else
+				s[0][i] = zero;
+		}
+	}
+	else {
+		triviumPreRound(*solver, s, live, zero, opt.preRound, *opt.prePoly, stat);
+	}
+
+	// IV constraint
+	for (int i = 0; i < 80; i++) {
+		if (cube[i] == 1)
+			solver->fix(s[0][93 + i], 1);
+	}
+
+	// Const 0 constraint is implied by the pruning (flag[i] == 0 means s[0][i] is zero)
+
+	// Round function. ands[r] keeps the outputs of the AND gates of round r
+	int divRound = (opt.divRound > 0) ? opt.divRound : (opt.preRound + evalNumRounds) / 2;
+	vector<vector<int>> ands(evalNumRounds + 1);
+	for (int r = opt.preRound; r < evalNumRounds; r++) {
+		vector<int> tmp = s[r];
+		bitset<288> out = (live[r + 1] >> 1) | (live[r + 1] << 287);
+		int numVars = stat.vars;
+		int numConstrs = stat.constrs;
+		int numGenConstrs = stat.genConstrs;
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			triviumCoreThree(*solver, tmp, p[0], p[1], p[2], p[3], p[4], zero, live[r], out, stat, &ands[r]);
+		}
+		stat.removedVars[r] = 3 * 8 - (stat.vars - numVars);
+		// a general COPY stands for the 3 constraints of the linear one
+		stat.removedConstrs[r] = 3 * 13 - (stat.constrs - numConstrs) - 3 * (stat.genConstrs - numGenConstrs);
+		
+		for (int i = 0; i < 288; i++) {
+			s[r + 1][(i + 1) % 288] = tmp[i];
+		}
+	}
+	if ((opt.useTwoStage == true) && (opt.hint.size() > 0))
+		displayPruneStat(outputfile, stat, false);
+	else
+		displayPruneStat(outputfile, stat, true);
+
+	// Output constraint
+	vector<int> ks;
+	for (int i = 0; i < 288; i++) {
+		bool output = false;
+		for (int j = 0; j < 6; j++) {
+			if ((i == triviumOutputs[j]) && ((target == 0) || (target == j + 1)))
+				output = true;
+		}
+		if (output) {
+			ks.push_back(s[evalNumRounds][i]);
+		}
+		else if (s[evalNumRounds][i] != zero) {
+			solver->fix(s[evalNumRounds][i], 0);
+		}
+	}
+	int one = solver->addVar();
+	solver->fix(one, 1);
+	solver->addSum(one, ks);
+
+	// Objective of the profile. Only key gives the upper bound of the degree as the return value
+	string objective = solver->option("Objective");
+	vector<int> sumKey(s[0].begin(), s[0].begin() + 80);
+	if (objective == "minkey") {
+		solver->setObjective(sumKey, false);
+	}
+	else if (objective == "middle") {
+		solver->setObjective(s[divRound], false);
+	}
+	else if (objective == "none") {
+		solver->setObjective(vector<int>(), true);
+	}
+	else {
+		solver->setObjective(sumKey, true);
+	}
+	
+	//
+	if (opt.useTwoStage == true) {
+		if (opt.hint.size() > 0) {
+
+			// fix
+			for (int i = 0; i < 288; i++) {
+				if (opt.hint[opt.divRound][i] == 1)
+					solver->fix(s[opt.divRound][i], 1);
+				else if (s[opt.divRound][i] != zero)
+					solver->fix(s[opt.divRound][i], 0);
+			}
+
+			// hint
+			vector<pair<int, int>> start;
+			for (int r = 0; r < evalNumRounds; r++) {
+				for (int i = 0; i < 288; i++) {
+					if (s[r][i] != zero)
+						start.push_back(make_pair(s[r][i], (int)opt.hint[r][i]));
+				}
+			}
+			solver->addStart(start);
+
+
+		}
+	}
+
+	// Branching priority (RoundPriority, RegisterPriority and AndPriority of the profile). A variable shared by several rounds gets its first round
+	string order = solver->option("RoundPriority");
+	string reg = solver->option("RegisterPriority");
+	bool andFirst = (solver->option("AndPriority") == "1");
+	if ((order.size() > 0) || (reg.size() > 0) || andFirst) {
+		for (int r = evalNumRounds; r >= opt.preRound; r--) {
+			int value = roundPriority(order, r, opt.preRound, evalNumRounds, divRound);
+			for (int i = 0; i < 288; i++) {
+				bool first = ((reg == "A") && (i < 93)) || ((reg == "B") && (i >= 93) && (i < 177)) || ((reg == "C") && (i >= 177));
+				if (s[r][i] != zero)
+					solver->setPriority(s[r][i], value + (first ? evalNumRounds + 1 : 0));
+			}
+			for (int j = 0; j < ands[r].size(); j++) {
+				solver->setPriority(ands[r][j], value + (andFirst ? 2 * (evalNumRounds + 1) : 0));
+			}
+		}
+	}
+
+	// Solve
+	stat.modelVars = solver->numVariables();
+	stat.modelConstrs = solver->numConstraints();
+	stat.modelGenConstrs = solver->numGenConstraints();
+	outputfile << "model : " << stat.modelVars << " variables, " << stat.modelConstrs << " constraints and " << stat.modelGenConstrs << " general constraints" << endl;
+	metrics.phase("build", { { "vars", stat.modelVars }, { "constrs", stat.modelConstrs }, { "genConstrs", stat.modelGenConstrs } });
+	if (opt.report != NULL) {
+		auto start = chrono::steady_clock::now();
+		solver->presolve(stat.presolvedVars, stat.presolvedConstrs);
+		stat.presolveSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		*opt.report = stat;
+		// the one presolve record of the model (the presolve inside the solve is then counted in the solve)
+		metrics.phase("presolve", stat.presolveSec, { { "vars", stat.presolvedVars }, { "constrs", stat.presolvedConstrs } });
+	}
+
+	// the messages of the solver go to the log of the job (the environments have no LogFile)
+	solver->watch(opt.stop, &outputfile);
+
+	// Feasibility pass: stop at the first trail, without the pool and the 2nd stages
+	if ((opt.screen > 0) && (stage < 2)) {
+		int status = solver->feasible(opt.screen);
+		double proof = solver->runtime();
+		metrics.phase("screen", { { "status", status } });
+		if (status == BACKEND_INFEASIBLE) {
+			outputfile << "feasibility pass : no trail\t" << proof << "sec" << endl;
+			dulation = proof;
+			if ((opt.sched == NULL) && !opt.quiet)
+				displayTriviumBox(countingBox, cube, dulation);
+			return -1;
+		}
+		outputfile << "feasibility pass : " << ((status == BACKEND_SOLUTION_LIMIT) ? "a trail exists" : "undecided") << "\t" << proof << "sec" << endl;
+		if ((opt.stop != NULL) && opt.stop->load()) {
+			dulation = proof;
+			return -2;
+		}
+	}
+
+	// the 2nd stages run from the 1st stage (see histogram.h), and the number of trails in the counting box
+	callbackProfile profiler;
+	long long solTotal = 0;
+	for (auto it = countingBox.begin(); it != countingBox.end(); it++)
+		solTotal += (*it).second;
+	long long solCount;
+	if (stage == 1) {
+		solCount = solver->enumerate([&](const vector<char>& sol) {
+			if (profiler.due())
+				profiler.report(outputfile, "callback");
+			outputfile << "found \t divide in " << divRound << "\t" << solver->runtime() << "sec" << endl;
+
+			// store found solution into trail
+			vector<bitset<288>> trail(evalNumRounds + 1);
+			for (int r = 0; r <= evalNumRounds; r++) {
+				for (int i = 0; i < 288; i++) {
+					trail[r][i] = sol[s[r][i]];
+				}
+			}
+
+			// 2nd stage
+			double dulation = 0;
+			int subThreads = (opt.sched != NULL) ? opt.sched->threads() : threadNumber;
+			profiler.enter();
+			struct twoStage second = opt;
+			second.useTwoStage = true;
+			second.divRound = divRound;
+			second.hint = trail;
+			second.report = NULL;
+			second.screen = 0;
+			second.parent = metrics.id;
+			int solCnt = triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, subThreads, target, second);
+
+			profiler.leave(solCnt);
+
+			// the 2nd stage adds solCnt trails to the counting box
+			solTotal += max(solCnt, 0);
+			outputfile << "\t" << solCnt << "( total : " << solTotal << ")" << endl;
+			outputfile << "\t" << countingBox.size() << " monomials are involved" << endl;
+
+			// remove
+			vector<int> cut;
+			for (int i = 0; i < 288; i++) {
+				if (s[divRound][i] != zero)
+					cut.push_back((trail[divRound][i] == 1) ? -(s[divRound][i] + 1) : s[divRound][i] + 1);
+			}
+			solver->addLazy(cut);
+		}, true);
+	}
+	else {
+		// store the information about solutions
+		solCount = solver->enumerate([&](const vector<char>& sol) {
+			bitset<288> tmp;
+			for (int j = 0; j < 288; j++) {
+				tmp[j] = sol[s[0][j]];
+			}
+			countingBox[tmp]++;
+		});
+	}
+
+	//
+	dulation = solver->runtime();
+	double presolveSec = (opt.report != NULL) ? -1 : solver->presolveSec();
+	if (presolveSec >= 0)
+		metrics.phase("presolve", presolveSec, {});
+	metrics.phase("solve", dulation - max(presolveSec, 0.0), { { "status", solver->status() }, { "solutions", solCount }, { "midpoints", profiler.numMidpoints() }, { "nodes", solver->nodes() } });
+	if (stage == 1) {
+		profiler.report(outputfile, "1st stage");
+		metrics.phase("callback", profiler.insideSec(), profiler.values());
+	}
+	else {
+		metrics.phase("extract", { { "solutions", solCount }, { "monomials", countingBox.size() } });
+	}
+	if (solCount < 0) {
+		if ((opt.stop == NULL) || (opt.stop->load() == false))
+			cerr << "the enumeration did not finish (status " << solver->status() << ")" << endl;
+		return -2;
+	}
+	if (stage == 2)
+		return solCount;
+
+
+
+	// display result
+	if ((opt.sched == NULL) && !opt.quiet)
+		displayTriviumBox(countingBox, cube, dulation);
+
+
+
+	//result
+	if (solver->status() == BACKEND_INFEASIBLE) {
+		return -1;
+	}
+	else if (solver->status() == BACKEND_OPTIMAL) {
+		int upperBound = round(solver->objVal());
+		return upperBound;
+	}
+	else {
+		cout << solver->status() << endl;
+		return -2;
+	}
+}
+int trivium(int evalNumRounds, int threadNumber, int preRound, double screen) {
+
+  //
+  ofstream outputfile, outputfile2;
+  outputfile.open("log_trivium.txt");
+  outputfile2.open("log_trivium2.txt");
+
+  // active bits
+  vector<int> cube(80, 0);
+  for (int i = 0; i < 80; i++) {
+
+		if (evalNumRounds == 840) {
+			if ((i == 33) || (i == 46)) {
+
+			}
+			else {
 				cube[i] = 1;
 			}
 		}else if (evalNumRounds == 841) {
@@ -542,107 +1128,286 @@ int trivium(int evalNumRounds, int threadNumber) {
 
 
 
+  // hybrid mode
+  vector<anfPoly<288>> prePoly;
+  if (preRound > 0) {
+    clock_t start = clock();
+    prePoly = triviumANF(flag, preRound);
+    size_t numMonomials = 0;
+    for (int i = 0; i < 288; i++) {
+      numMonomials += prePoly[i].size();
+    }
+    cout << "ANF of " << preRound << " rounds : " << numMonomials << " monomials\t" << (double)(clock() - start) / CLOCKS_PER_SEC << "sec" << endl;
+  }
+
   // 
   map<bitset<288>, int, cmpBitset288> countingBox;
-  double dulation = 0;
 
-  //
-  cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-  cout << "Target s288" << endl;
-	triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 6, { true,0, });
-  if (countingBox.size() == 0) {
-    cout << "zero sum\t" << dulation << "sec" << endl;
+  // every target is one job, see jobScheduler
+  vector<int> targets = { 6, 4, 2, 5, 3, 1 };
+  vector<string> names = { "s288", "s177", "s93", "s243", "s162", "s66" };
+  vector<map<bitset<288>, int, cmpBitset288>> boxes(targets.size());
+  jobScheduler sched(threadNumber, "schedule_trivium.txt");
+  for (int j = 0; j < targets.size(); j++) {
+    string name = "trivium " + to_string(evalNumRounds) + " pre " + to_string(preRound) + " " + names[j];
+    sched.add(name, [&, j]() {
+      double dulation = 0;
+      struct twoStage stage;
+      stage.useTwoStage = true;
+      stage.preRound = preRound;
+      stage.prePoly = &prePoly;
+      stage.sched = &sched;
+      stage.screen = screen;
+      int result = triviumThreeEnumuration(cube, flag, evalNumRounds, boxes[j], dulation, sched.threads(), targets[j], stage);
+
+      lock_guard<mutex> lock(sched.outputLock);
+      cout << "++++++++++++++++++++++++++++++++++++++" << endl;
+      cout << "Target " << names[j] << endl;
+      if ((boxes[j].size() == 0) && (result == -1) && (screen > 0)) {
+        cout << "zero sum\t" << dulation << "sec (no trail in the feasibility pass)" << endl;
+      }
+      else if (boxes[j].size() == 0) {
+        cout << "zero sum\t" << dulation << "sec" << endl;
+      }
+      else {
+        displayTriviumBox(boxes[j], cube, dulation);
+      }
+    });
   }
-
-  cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-  cout << "Target s177" << endl;
-  triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 4, { true,0, });
-  if (countingBox.size() == 0) {
-    cout << "zero sum\t" << dulation << "sec" << endl;
+  sched.run();
+
+  metricsJob metrics("trivium " + to_string(evalNumRounds) + " merge", 0, threadNumber);
+  for (int j = 0; j < targets.size(); j++) {
+    auto it = boxes[j].begin();
+    while (it != boxes[j].end()) {
+      countingBox[(*it).first] += (*it).second;
+      it++;
+    }
   }
+  metrics.phase("merge", { { "monomials", countingBox.size() } });
 
-  cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-  cout << "Target s93" << endl;
-  triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 2, { true,0, });
-  if (countingBox.size() == 0) {
-    cout << "zero sum\t" << dulation << "sec" << endl;
-  }
 
-  cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-  cout << "Target s243" << endl;
-  triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 5, { true,0, });
-  if (countingBox.size() == 0) {
-    cout << "zero sum\t" << dulation << "sec" << endl;
-  }
 
-  cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-  cout << "Target s162" << endl;
-  triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 3, { true,0, });
-  if (countingBox.size() == 0) {
-    cout << "zero sum\t" << dulation << "sec" << endl;
-  }
+	displayTriviumSuperpoly(cout, countingBox, cube);
 
-  cout << "++++++++++++++++++++++++++++++++++++++" << endl;
-  cout << "Target s66" << endl;
-  triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 1, { true,0, });
-  if (countingBox.size() == 0) {
-    cout << "zero sum\t" << dulation << "sec" << endl;
-  }
+	// the binary result, see superpoly.h
+	string filename = "superpoly_trivium_" + to_string(evalNumRounds) + ".spb";
+	superpolyWriter writer("trivium", evalNumRounds, 288, 0, 80, 93, 80, cube, targets);
+	writer.section(0, countingBox);
+	for (int j = 0; j < targets.size(); j++) {
+		writer.section(targets[j], boxes[j]);
+	}
+	if (writer.write(filename))
+		cout << "the superpoly is written to " << filename << endl;
 
+	return 0;
+}
+/***************************************
+ * Batch jobs from the manifest
+ ***************************************/
+/*
+Add the targets of one trivium job of the manifest to the scheduler (see runManifest).
+The result file job.out is written when the last target of the job finishes.
+The ANF of the hybrid mode is shared by the jobs with the same constants.
+*/
+void triviumManifestJob(jobScheduler& sched, struct manifestJob& job) {
 
+	static map<pair<vector<int>, int>, vector<anfPoly<288>>> anfCache;
 
-	cout << "*****************************" << endl;
-	cout << "Final solution" << endl;
-	cout << countingBox.size() << " solutions are found" << endl;
+	struct jobState {
+		vector<int> cube;
+		vector<int> flag;
+		vector<anfPoly<288>>* prePoly;
+		vector<map<bitset<288>, int, cmpBitset288>> boxes;
+		atomic<int> remaining;
+	};
+	shared_ptr<jobState> st = make_shared<jobState>();
 
-	map<bitset<288>, int, cmpBitset288> countingBox2;
-	auto it = countingBox.begin();
-	while (it != countingBox.end()) {
-		bitset<288> tmp = (*it).first;
-		for (int i = 0; i < 80; i++) {
-			if(cube[i] == 1)
-				tmp[93 + i] = 0;
-		}
-		tmp[285] = 0;
-		tmp[286] = 0;
-		tmp[287] = 0;
-		countingBox2[tmp] += (*it).second;
-		it++;
+	// constant (secret 3, active 2, const 1, const 0)
+	st->cube.assign(80, 0);
+	st->flag.assign(288, 0);
+	for (int i = 0; i < 80; i++) {
+		st->flag[i] = 3;
 	}
-
-	auto it2 = countingBox2.begin();
-	while (it2 != countingBox2.end()) {
-		if (((*it2).second % 2) == 1) {
-			cout << ((*it2).second % 2) << " | " << (*it2).second << "\t";
-			bitset<288> tmp = (*it2).first;
-			for (int i = 0; i < 80; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "k" << (i + 1) << " ";
+	for (int i = 0; i < job.consts.size(); i++) {
+		st->flag[93 + job.consts[i]] = 1;
+	}
+	for (int i = 0; i < job.cube.size(); i++) {
+		st->cube[job.cube[i]] = 1;
+		st->flag[93 + job.cube[i]] = 2;
+	}
+	st->flag[285] = 1;
+	st->flag[286] = 1;
+	st->flag[287] = 1;
+
+	// hybrid mode
+	pair<vector<int>, int> key = make_pair(st->flag, job.preRound);
+	metricsJob metrics("trivium " + to_string(job.rounds) + " manifest line " + to_string(job.line), 0, sched.threads());
+	bool hit = (anfCache.count(key) > 0);
+	if ((job.preRound > 0) && (anfCache.count(key) == 0))
+		anfCache[key] = triviumANF(st->flag, job.preRound);
+	st->prePoly = &anfCache[key];
+	if (job.preRound > 0)
+		metrics.phase("anf", { { "cacheHit", hit } });
+
+	st->boxes.resize(job.targets.size());
+	st->remaining = job.targets.size();
+	for (int j = 0; j < job.targets.size(); j++) {
+		string name = "trivium " + to_string(job.rounds) + " pre " + to_string(job.preRound) + " div " + to_string(job.divRound) + " cube " + job.cubeText + " const " + job.constText + " target " + to_string(job.targets[j]);
+		sched.add(name, [&sched, st, job, j]() {
+			double dulation = 0;
+			struct twoStage stage;
+			stage.useTwoStage = true;
+			stage.divRound = job.divRound;
+			stage.preRound = job.preRound;
+			stage.prePoly = st->prePoly;
+			stage.sched = &sched;
+			stage.screen = job.screen;
+			triviumThreeEnumuration(st->cube, st->flag, job.rounds, st->boxes[j], dulation, sched.threads(), job.targets[j], stage);
+			if (--st->remaining > 0)
+				return;
+
+			metricsJob metrics("trivium " + to_string(job.rounds) + " manifest line " + to_string(job.line), 0, sched.threads());
+			map<bitset<288>, int, cmpBitset288> countingBox;
+			for (int k = 0; k < st->boxes.size(); k++) {
+				auto it = st->boxes[k].begin();
+				while (it != st->boxes[k].end()) {
+					countingBox[(*it).first] += (*it).second;
+					it++;
 				}
 			}
-			cout << endl;
-		}
-		it2++;
+			metrics.phase("merge", { { "monomials", countingBox.size() } });
+			ofstream outputfile(job.out);
+			outputfile << "# trivium " << job.rounds << " cube=" << job.cubeText << " const=" << job.constText << " pre=" << job.preRound << " div=" << job.divRound << endl;
+			displayTriviumSuperpoly(outputfile, countingBox, st->cube);
+
+			lock_guard<mutex> lock(sched.outputLock);
+			cout << "manifest line " << job.line << " : " << countingBox.size() << " monomials -> " << job.out << endl;
+		});
 	}
 
+}
+
 
-	it2 = countingBox2.begin();
-	while (it2 != countingBox2.end()) {
-		if (((*it2).second % 2) == 0) {
-			cout << ((*it2).second % 2) << " | " << (*it2).second << "\t";
-			bitset<288> tmp = (*it2).first;
-			for (int i = 0; i < 80; i++) {
-				if ((tmp[i] == 1)) {
-					cout << "k" << (i + 1) << " ";
+
+#ifndef NOGUROBI
+/***************************************
+ * Round sweep
+ ***************************************/
+/*
+The single-stage enumeration for every number of rounds from firstRound to lastRound with one model.
+The model of r + 1 rounds is the model of r rounds with one more round of triviumCoreThree, so the rounds are appended to the live model
+and only the output layer (ks = 1 and the other bits of the last round = 0) is removed and added again.
+The backward pruning depends on the number of rounds and is not used. The forward pruning is the same for all rounds (see triviumForward).
+The monomials of the previous round are given as the MIP starts (the partial starts of s[0]), and Gurobi completes them if they have a trail.
+@Para
+cube, flag: same as triviumThreeEnumuration
+firstRound, lastRound: the range of the number of rounds
+threadNumber: the number of threads
+onRound: called with the number of rounds, the solutions (as countingBox of triviumThreeEnumuration) and the time of the solve after every round
+*/
+void triviumSweep(vector<int> cube, vector<int> flag, int firstRound, int lastRound, int threadNumber, function<void(int, map<bitset<288>, int, cmpBitset288>&, double)> onRound) {
+
+	logStream outputfile("log_trivium.txt");
+	outputfile << endl;
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << "sweep " << firstRound << " - " << lastRound << " rounds" << endl;
+
+	// the environment of the single stage (see triviumThreeEnumuration)
+	backendProfile("trivium", false, true);
+	unique_ptr<divBackend> solver(newBackend("gurobi", "trivium", threadNumber));
+	solver->watch(NULL, &outputfile);
+
+	struct twoStage opt;
+	vector<bitset<288>> fw = triviumForward(flag, lastRound, opt);
+	struct pruneStat stat;
+	stat.formulation = solver->option("Formulation");
+	int zero = solver->addVar();
+	solver->fix(zero, 0);
+
+	vector<int> s(288);
+	for (int i = 0; i < 288; i++) {
+		s[i] = (fw[0][i] == 1) ? solver->addVar() : zero;
+	}
+	vector<int> s0 = s;
+	for (int i = 0; i < 80; i++) {
+		if (cube[i] == 1)
+			solver->fix(s0[93 + i], 1);
+	}
+	solver->setObjective(vector<int>(s0.begin(), s0.begin() + 80), true);
+
+	map<bitset<288>, int, cmpBitset288> previous;
+	auto start = chrono::steady_clock::now();
+	for (int r = 0; r <= lastRound; r++) {
+		if (r >= firstRound) {
+			// output layer
+			solver->checkpoint();
+			vector<int> ks;
+			for (int i = 0; i < 288; i++) {
+				bool output = false;
+				for (int j = 0; j < 6; j++) {
+					if (i == triviumOutputs[j])
+						output = true;
 				}
+				if (output)
+					ks.push_back(s[i]);
+				else if (s[i] != zero)
+					solver->fix(s[i], 0);
 			}
-			cout << endl;
+			int one = solver->addVar();
+			solver->fix(one, 1);
+			solver->addSum(one, ks);
+
+			// warm start from the monomials of the previous round
+			int numStart = min((int)previous.size(), 10);
+			auto it = previous.begin();
+			for (int k = 0; k < numStart; k++) {
+				vector<pair<int, int>> values;
+				for (int i = 0; i < 288; i++) {
+					if (s0[i] != zero)
+						values.push_back(make_pair(s0[i], (int)(*it).first[i]));
+				}
+				solver->addStart(values);
+				it++;
+			}
+			double built = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			map<bitset<288>, int, cmpBitset288> countingBox;
+			long long solCount = solver->enumerate([&](const vector<char>& sol) {
+				bitset<288> tmp;
+				for (int i = 0; i < 288; i++) {
+					tmp[i] = sol[s0[i]];
+				}
+				countingBox[tmp]++;
+			});
+			double dulation = solver->runtime();
+			if (solCount < 0)
+				return;
+			outputfile << "round " << r << " : " << solver->numVariables() << " variables, " << solver->numConstraints() << " constraints, built in " << built << "sec, ";
+			outputfile << solCount << " trails\t" << dulation << "sec" << endl;
+
+			onRound(r, countingBox, dulation);
+			previous = countingBox;
+			solver->rollback();
+			start = chrono::steady_clock::now();
+		}
+		if (r == lastRound)
+			break;
+
+		// one more round
+		vector<int> tmp = s;
+		bitset<288> out = (fw[r + 1] >> 1) | (fw[r + 1] << 287);
+		for (int j = 0; j < 3; j++) {
+			const int* p = triviumTaps[j];
+			triviumCoreThree(*solver, tmp, p[0], p[1], p[2], p[3], p[4], zero, fw[r], out, stat);
+		}
+		for (int i = 0; i < 288; i++) {
+			s[(i + 1) % 288] = tmp[i];
 		}
-		it2++;
 	}
 
-
 }
+#endif
 
 // for the practical verification
 int roundFuncTrivium(bitset<288>& s) {
@@ -702,7 +1467,7 @@ int encryptionSum(int evalNumRounds, vector<int> cube, vector<int> iv, vector<in
 
 	return sum;
 }
-int theoreticalSum(map<bitset<288>, int, cmpBitset288> countingBox, vector<int> cube, vector<int> iv, vector<int> key) {
+int theoreticalSum(map<bitset<288>, int, cmpBitset288>& countingBox, vector<int>& cube, vector<int>& iv, vector<int>& key) {
 
 	int sum = 0;
 	auto it = countingBox.begin();
@@ -733,31 +1498,95 @@ int theoreticalSum(map<bitset<288>, int, cmpBitset288> countingBox, vector<int>
 	return sum;
 
 }
-void practicalTestTrivium(void) {
+/*
+Compare the cube sum of the cipher with the sum given by the superpoly for 100 random keys and IVs, and display the result
+*/
+static void verifyTrivium(int evalNumRounds, vector<int>& cube, map<bitset<288>, int, cmpBitset288>& countingBox) {
 
+  if (countingBox.size() == 0) {
+    cout << "zero sum" << endl;
+  }
+  else {
 
-	ofstream outputfile, outputfile2;
-	outputfile.open("log_trivium.txt");
-	outputfile2.open("log_trivium2.txt");
+			cout << "         key        \t";
+			cout << "          iv          ";
+			cout << "expe.   ";
+			cout << "theo.   ";
+			cout << endl;
 
-  srand(time(NULL));
+    for (int trial = 0; trial < 100; trial++) {
+
+      vector<int> key(80);
+      for (int i = 0; i < 80; i++)
+        key[i] = rand() % 2;
+
+
+				vector<int> iv(80);
+				for (int i = 0; i < 80; i++)
+					iv[i] = rand() % 2;
+      
+
+
+      int sum1 = encryptionSum(evalNumRounds, cube, iv, key);
+      int sum2 = theoreticalSum(countingBox, cube, iv, key);
+
+				for (int i = 9; i >= 0; i--) {
+					int hexvar = 0;
+					for (int j = 7; j >= 0; j--) {
+						hexvar ^= (key[8 * i + j] << j);
+					}
+					printf("%02x", hexvar);
+				}
+				cout << "\t";
+
+				for (int i = 9; i >= 0; i--) {
+					int hexvar = 0;
+					for (int j = 7; j >= 0; j--) {
+						hexvar ^= (iv[8 * i + j] << j);
+					}
+					printf("%02x", hexvar);
+				}
+				cout << "\t";
+
+				cout << sum1 << "\t" << sum2 << "\t";
+
+				if (sum1 == sum2) {
+					cout << "OK" << endl;
+				}
+				else {
+					cout << endl;
+					cout << "error" << endl;
+					cerr << "error" << endl;
+				}
+
+    }
+
+  }
+
+
+
+}
+/*
+The cube and the flag of the practical tests: 1 to 4 active IV bits drawn by random(n) in [0, n), the other IV bits are undetermined constants
+*/
+static void triviumPracticalInstance(function<int(int)> random, vector<int>& cube, vector<int>& flag) {
 
   // create cube index at random
-  int numActBits = 1 + rand() % 4;
+  int numActBits = 1 + random(4);
   cout << numActBits << " active bits" << endl;
 
-  vector<int> cube(80,0);
+  cube.assign(80, 0);
   for (int i = 0; i < numActBits; i++) {
     int index;
     do {
-      index = rand() % 80;
+      index = random(80);
     } while (cube[index] == 1);
     cube[index] = 1;
   }
 
   // C_0 = null
 	// constant (secret 3, active 2, const/undermine 1, const 0)
-	vector<int> flag(288, 0);
+	flag.assign(288, 0);
   for (int i = 0; i < 80; i++) {
     flag[i] = 3;
     if (cube[i] == 1) {
@@ -770,6 +1599,19 @@ void practicalTestTrivium(void) {
   flag[285] = 1;
   flag[286] = 1;
   flag[287] = 1;
+
+}
+void practicalTestTrivium(int native) {
+
+
+	ofstream outputfile, outputfile2;
+	outputfile.open("log_trivium.txt");
+	outputfile2.open("log_trivium2.txt");
+
+  srand(time(NULL));
+
+  vector<int> cube, flag;
+  triviumPracticalInstance([](int n) { return rand() % n; }, cube, flag);
   
 	//
 	cout << "the index of cube" << endl;
@@ -779,6 +1621,27 @@ void practicalTestTrivium(void) {
 	}
 	cout << endl;
 
+#ifndef NOGUROBI
+	// -sweep: one model extended round by round (see triviumSweep)
+	if (native == 3) {
+		int firstNonzero = -1;
+		triviumSweep(cube, flag, 300, 599, 2, [&](int r, map<bitset<288>, int, cmpBitset288>& countingBox, double dulation) {
+			cout << "##############################" << endl;
+			cout << r << " rounds\t" << dulation << "sec" << endl;
+			int degree;
+			if ((firstNonzero < 0) && (triviumSuperpolySize(countingBox, cube, degree) > 0))
+				firstNonzero = r;
+			verifyTrivium(r, cube, countingBox);
+			cout << endl << endl;
+		});
+		if (firstNonzero < 0)
+			cout << "zero sum up to 599 rounds" << endl;
+		else
+			cout << "zero sum up to " << (firstNonzero - 1) << " rounds, the superpoly is not zero from " << firstNonzero << " rounds" << endl;
+		return;
+	}
+#endif
+
   //
   for (int r = 300; r < 600; r++) {
     cout << "##############################" << endl;
@@ -786,7 +1649,10 @@ void practicalTestTrivium(void) {
 
     double dulation;
     map<bitset<288>, int, cmpBitset288> countingBox;
-		triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 2);
+		if (native == 0)
+			triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 2);
+		else
+			triviumNativeEnumuration(cube, flag, r, countingBox, dulation, 2, 0, false, (native == 2) ? r / 2 : 0);
 		
     //triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 2, 1);
 		//triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 2, 2);
@@ -795,70 +1661,1056 @@ void practicalTestTrivium(void) {
 		//triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 2, 5);
 		//triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 2, 6);
 		
-    if (countingBox.size() == 0) {
-      cout << "zero sum" << endl;
-    }
-    else {
+    verifyTrivium(r, cube, countingBox);
+    cout << endl << endl;
+  }
 
-			cout << "         key        \t";
-			cout << "          iv          ";
-			cout << "expe.   ";
-			cout << "theo.   ";
-			cout << endl;
 
-      for (int trial = 0; trial < 100; trial++) {
 
-        vector<int> key(80);
-        for (int i = 0; i < 80; i++)
-          key[i] = rand() % 2;
+}
 
+/*
+Differential verification of the counting backend (-practical -verify).
+The rounds of the practical test are counted and each superpoly is compared with the cube sum of the cipher for trials random keys and IVs.
+The rounds and the trials run on threadNumber threads, the cube and the trials are drawn from seed (see verifyRun),
+and the first mismatch stops the verification with the seed, the round, the trial, the key and the IV to reproduce it.
+The statistics are written to stdout and verify_trivium.txt.
+@Para
+evalNumRounds: the last round (0: 599, the last round of the practical test)
+native: same as practicalTestTrivium (1 or 2, otherwise MILP)
+return: 0 if all trials passed, 1 otherwise
+*/
+int differentialTestTrivium(int evalNumRounds, int native, int threadNumber, unsigned long long seed, int trials) {
 
-				vector<int> iv(80);
-				for (int i = 0; i < 80; i++)
-					iv[i] = rand() % 2;
-        
+	ofstream outputfile, outputfile2;
+	outputfile.open("log_trivium.txt");
+	outputfile2.open("log_trivium2.txt");
 
+	cout << "seed " << seed << ", " << trials << " trials per round" << endl;
+	verifyRandom draw(seed);
+	vector<int> cube, flag;
+	triviumPracticalInstance([&](int n) { return draw.below(n); }, cube, flag);
+	cout << "the index of cube" << endl;
+	for (int i = 0; i < 80; i++) {
+		if (cube[i] == 1)
+			cout << "iv" << (i + 1) << ", ";
+	}
+	cout << endl;
 
-        int sum1 = encryptionSum(r, cube, iv, key);
-        int sum2 = theoreticalSum(countingBox, cube, iv, key);
+	vector<verifyRound> rounds;
+	verifyMismatch mismatch;
+	// the superpolies of the workers are not displayed
+	struct twoStage quiet;
+	quiet.quiet = true;
+	bool ok = verifyRun<map<bitset<288>, int, cmpBitset288>>(300, (evalNumRounds > 0) ? evalNumRounds : 599, trials, threadNumber, seed,
+		[&](int r, map<bitset<288>, int, cmpBitset288>& countingBox) {
+			double dulation;
+			if ((native != 1) && (native != 2))
+				triviumThreeEnumuration(cube, flag, r, countingBox, dulation, 1, 0, quiet);
+			else
+				triviumNativeEnumuration(cube, flag, r, countingBox, dulation, 1, 0, false, (native == 2) ? r / 2 : 0, nativeMemLimit, true);
+		},
+		[&](map<bitset<288>, int, cmpBitset288>& countingBox, int& degree) {
+			return triviumSuperpolySize(countingBox, cube, degree);
+		},
+		[&](int r, map<bitset<288>, int, cmpBitset288>& countingBox, verifyRandom& rng, vector<int>& key, vector<int>& iv, int& expe, int& theo) {
+			key.resize(80);
+			for (int i = 0; i < 80; i++)
+				key[i] = rng.bit();
+			iv.resize(80);
+			for (int i = 0; i < 80; i++)
+				iv[i] = rng.bit();
+			expe = encryptionSum(r, cube, iv, key);
+			theo = theoreticalSum(countingBox, cube, iv, key);
+		},
+		rounds, mismatch);
+
+	ofstream result("verify_trivium.txt");
+	verifyTable(cout, rounds, trials);
+	verifyTable(result, rounds, trials);
+	if (ok == false) {
+		stringstream ss;
+		ss << "mismatch at " << mismatch.round << " rounds, trial " << mismatch.trial << " of seed " << seed << endl;
+		ss << "key " << verifyHex(mismatch.key, 10) << "\tiv " << verifyHex(mismatch.iv, 10) << "\texpe. " << mismatch.expe << "\ttheo. " << mismatch.theo << endl;
+		cout << ss.str();
+		result << ss.str();
+		cerr << "error" << endl;
+		return 1;
+	}
+	return 0;
 
-				for (int i = 9; i >= 0; i--) {
-					int hexvar = 0;
-					for (int j = 7; j >= 0; j--) {
-						hexvar ^= (key[8 * i + j] << j);
-					}
-					printf("%02x", hexvar);
-				}
-				cout << "\t";
+}
 
-				for (int i = 9; i >= 0; i--) {
-					int hexvar = 0;
-					for (int j = 7; j >= 0; j--) {
-						hexvar ^= (iv[8 * i + j] << j);
-					}
-					printf("%02x", hexvar);
-				}
-				cout << "\t";
+/*
+The independent check of a golden file of the regression benchmark (see regress.h): the superpoly of the golden file is compared
+with the cube sums of the cipher for random keys, so that a golden file recorded by the engine under test cannot hide an error of the engine.
+The IV bits of const= are drawn with the key and the other non-cube IV bits are 0, as in triviumNativeJob.
+A monomial of high degree is rarely 1 at a uniform key, so half of the random trials draw the bits 1 at 3/4,
+and every monomial of the golden file is also evaluated at its own variables (1) and the other bits 0, where a wrong monomial changes the sum.
+@Para
+job: the case
+golden: the golden file
+trials: the number of random trials (the seed is the number of rounds)
+maxCube: a larger cube is not checked (e.g. the full-size runs)
+detail: the number of cube sums, or the first mismatch
+return: false if a cube sum differs from the superpoly
+*/
+bool triviumGoldenCheck(struct manifestJob& job, string golden, int trials, int maxCube, string& detail) {
 
-				cout << sum1 << "\t" << sum2 << "\t";
+	if (job.cube.size() > maxCube) {
+		detail = "not checked (cube of " + to_string(job.cube.size()) + " bits)";
+		return true;
+	}
+	legacyFile text;
+	if (!legacyParse(golden, text) || (text.results.size() != 1)) {
+		detail = "cannot read " + golden;
+		return false;
+	}
+	set<array<uint64_t, 4>> odd;
+	legacyOdd(text.results[0], odd);
 
-				if (sum1 == sum2) {
-					cout << "OK" << endl;
-				}
-				else {
-					cout << endl;
-					cout << "error" << endl;
-					cerr << "error" << endl;
-				}
+	vector<int> cube(80, 0);
+	for (int i = 0; i < job.cube.size(); i++) {
+		cube[job.cube[i]] = 1;
+	}
+	// the random trials, half of them with the bits 1 at 3/4, and then the trials at the variables of each monomial of the golden file
+	verifyRandom rng(job.rounds);
+	vector<array<uint64_t, 4>> points(odd.begin(), odd.end());
+	for (int t = 0; t < trials + points.size(); t++) {
+		vector<int> key(80), iv(80, 0);
+		for (int i = 0; i < 80; i++)
+			key[i] = (t < trials) ? (rng.bit() | ((t % 2) & rng.bit())) : ((points[t - trials][i / 64] >> (i % 64)) & 1);
+		for (int i = 0; i < job.consts.size(); i++) {
+			int j = job.consts[i];
+			iv[j] = (t < trials) ? (rng.bit() | ((t % 2) & rng.bit())) : ((points[t - trials][2 + j / 64] >> (j % 64)) & 1);
+		}
+		int expe = encryptionSum(job.rounds, cube, iv, key);
+		int theo = legacyEvaluate(odd, key, iv);
+		if (expe != theo) {
+			detail = "trial " + to_string(t) + " key " + verifyHex(key, 10) + " iv " + verifyHex(iv, 10) + " expe. " + to_string(expe) + " theo. " + to_string(theo);
+			return false;
+		}
+	}
+	detail = to_string(trials + points.size()) + " cube sums";
+	return true;
 
-      }
+}
 
-    }
+/***************************************
+ * Key recovery at reduced rounds
+ ***************************************/
+/*
+The keystream of the key search: bit j is the output of evalNumRounds + j rounds (the output bit of the cube sums)
+*/
+static vector<int> triviumKeystream(int evalNumRounds, vector<int>& key, vector<int>& iv, int length) {
+
+	bitset<288> s;
+	for (int i = 0; i < 80; i++) {
+		s[i] = key[i];
+		s[93 + i] = iv[i];
+	}
+	s[285] = 1;
+	s[286] = 1;
+	s[287] = 1;
+
+	vector<int> keystream;
+	for (int r = 0; r < evalNumRounds + length; r++) {
+		int z = roundFuncTrivium(s);
+		if (r >= evalNumRounds)
+			keystream.push_back(z);
+	}
+	return keystream;
 
+}
+/*
+Bitsliced roundFuncTrivium: word i is the state bit i of 64 lanes (the candidate keys of the key search, the IVs of the oracle).
+The state is a window of work which moves down by one word per round, so the rotation costs one word.
+triviumSlicedLoad places the key and the IV (80 words each) for total rounds and returns the window.
+*/
+static uint64_t* triviumSlicedLoad(const uint64_t* key, const uint64_t* iv, int total, vector<uint64_t>& work) {
+
+	work.assign(288 + total, 0);
+	uint64_t* o = work.data() + total;
+	for (int i = 0; i < 80; i++) {
+		o[i] = key[i];
+		o[93 + i] = iv[i];
+	}
+	o[285] = ~0ULL;
+	o[286] = ~0ULL;
+	o[287] = ~0ULL;
+	return o;
+
+}
+static inline uint64_t triviumSlicedRound(uint64_t*& o) {
+
+	uint64_t x1 = o[92] ^ o[65];
+	uint64_t x2 = o[176] ^ o[161];
+	uint64_t x3 = o[287] ^ o[242];
+	uint64_t z = x1 ^ x2 ^ x3;
+
+	o[92] = x1 ^ (o[91] & o[90]) ^ o[170];
+	o[176] = x2 ^ (o[174] & o[175]) ^ o[263];
+	o[287] = x3 ^ (o[286] & o[285]) ^ o[68];
+	o[-1] = o[287];
+	o--;
+
+	return z;
+}
+/*
+The key search: the lanes whose outputs match the keystream (the batch stops at the first bit where no lane matches)
+*/
+static uint64_t triviumSliced(int evalNumRounds, const uint64_t* key, const uint64_t* iv, vector<int>& keystream, vector<uint64_t>& work) {
+
+	int total = evalNumRounds + keystream.size();
+	uint64_t* o = triviumSlicedLoad(key, iv, total, work);
+	uint64_t alive = ~0ULL;
+	for (int r = 0; r < total; r++) {
+		uint64_t z = triviumSlicedRound(o);
+		if (r >= evalNumRounds) {
+			alive &= ~(z ^ (keystream[r - evalNumRounds] ? ~0ULL : 0));
+			if (alive == 0)
+				break;
+		}
+	}
+	return alive;
+
+}
+/*
+End-to-end key recovery at reduced rounds with a planted key (-practical -keysearch)
+1. the superpolies of 32 random cubes of the practical test (the non-cube IV bits are 0) are counted by the native engine
+2. the cube sums of the planted key
+3. the linear equations in the key bits by gf2KeyRecovery (the superpolies up to maxDegree)
+4. the planted values of random free key bits are given until freeBits bits are unknown (the reduced key space)
+5. the bitsliced key search over the 2^freeBits keys against 64 keystream bits of a random IV
+The time of each phase is written to stdout and keysearch_trivium.txt.
+@Para
+evalNumRounds: the rounds (0: 300, the first round of the practical test)
+seed: the planted key, the cubes and the IV
+freeBits: the number of unknown key bits in the search
+maxDegree: see gf2KeyRecovery::solve
+return: 0 if the planted key is found, 1 otherwise
+*/
+int keySearchTrivium(int evalNumRounds, int threadNumber, unsigned long long seed, int freeBits, int maxDegree) {
+
+	int R = (evalNumRounds > 0) ? evalNumRounds : 300;
+	const int numCubes = 32;
+	verifyRandom draw(seed);
+	vector<int> key(80);
+	for (int i = 0; i < 80; i++)
+		key[i] = draw.bit();
+	cout << "seed " << seed << ", " << R << " rounds, planted key " << verifyHex(key, 10) << endl;
+
+	stringstream table;
+	table << "phase\tsec\tresult" << endl;
+	auto start = chrono::steady_clock::now();
+	auto lap = [&](string phase, string result) {
+		auto now = chrono::steady_clock::now();
+		table << phase << "\t" << chrono::duration<double>(now - start).count() << "\t" << result << endl;
+		start = now;
+	};
+
+	// offline: the superpolies (the enumerations are quiet)
+	gf2KeyRecovery system(80);
+	vector<vector<int>> cubes;
+	for (int c = 0; c < numCubes; c++) {
+		vector<int> cube, flag;
+		triviumPracticalInstance([&](int n) { return draw.below(n); }, cube, flag);
+		for (int i = 0; i < 80; i++) {
+			if (cube[i] == 0)
+				flag[93 + i] = 0;
+		}
+		double dulation;
+		map<bitset<288>, int, cmpBitset288> countingBox;
+		triviumNativeEnumuration(cube, flag, R, countingBox, dulation, threadNumber, 0, false, 0, nativeMemLimit, true);
+		string name = "cube" + to_string(c);
+		system.add(name, countingBox, 0, 93, cube);
+		cubes.push_back(cube);
+	}
+	lap("superpolies", to_string(numCubes) + " cubes");
+
+	// online: the cube sums
+	string sums;
+	for (int c = 0; c < numCubes; c++) {
+		vector<int> iv(80, 0);
+		sums += encryptionSum(R, cubes[c], iv, key) ? '1' : '0';
+	}
+	lap("cube sums", sums);
+
+	if (system.solve(cout, maxDegree, sums, threadNumber) < 0) {
+		cerr << "error" << endl;
+		return 1;
+	}
+	vector<int> bits = system.freeKeyBits();
+	lap("linear algebra", to_string(80 - bits.size()) + " linear equations");
+
+	vector<int> known(80, -1);
+	while (bits.size() > freeBits) {
+		int j = draw.below(bits.size());
+		known[bits[j]] = key[bits[j]];
+		bits.erase(bits.begin() + j);
+	}
+	vector<int> offset;
+	vector<vector<int>> basis;
+	system.keySpace(known, offset, basis);
+
+	vector<int> iv(80);
+	for (int i = 0; i < 80; i++)
+		iv[i] = draw.bit();
+	vector<int> keystream = triviumKeystream(R, key, iv, 64);
+	cout << "2^" << basis.size() << " keys, iv " << verifyHex(iv, 10) << ", keystream ";
+	for (int j = 0; j < keystream.size(); j++)
+		cout << keystream[j];
+	cout << endl;
+
+	vector<uint64_t> ivWords(80);
+	for (int i = 0; i < 80; i++)
+		ivWords[i] = iv[i] ? ~0ULL : 0;
+	keySearch search(offset, basis, "trivium " + to_string(R) + " rounds iv " + verifyHex(iv, 10), "keysearch_trivium.ckpt");
+	vector<vector<int>> found;
+	uint64_t tested = search.run(threadNumber, [&](const uint64_t* k, vector<uint64_t>& work) {
+		return triviumSliced(R, k, ivWords.data(), keystream, work);
+	}, found);
+	bool ok = false;
+	for (int i = 0; i < found.size(); i++) {
+		cout << "found " << verifyHex(found[i], 10) << ((found[i] == key) ? " (planted)" : "") << endl;
+		ok = ok || (found[i] == key);
+	}
+	lap("key search", to_string(tested) + " keys, " + to_string(found.size()) + " found");
+
+	ofstream result("keysearch_trivium.txt");
+	cout << table.str();
+	result << "seed " << seed << ", " << R << " rounds, 2^" << basis.size() << " keys" << endl << table.str();
+	if (ok == false) {
+		cerr << "the planted key is not found" << endl;
+		return 1;
+	}
+	return 0;
+
+}
+
+/*
+The keystream oracle of Trivium (-oracle, see oracleServe).
+The secret key is drawn from seed, and the kernel is checked against roundFuncTrivium for 64 random IVs before serving.
+return: 1 on error
+*/
+int oracleTrivium(string path, int threadNumber, unsigned long long seed) {
+
+	verifyRandom draw(seed);
+	vector<int> key(80);
+	vector<uint64_t> keyWords(80);
+	for (int i = 0; i < 80; i++) {
+		key[i] = draw.bit();
+		keyWords[i] = key[i] ? ~0ULL : 0;
+	}
+	auto kernel = [&](int rounds, const uint64_t* iv, vector<uint64_t>& work) {
+		uint64_t* o = triviumSlicedLoad(keyWords.data(), iv, rounds + 1, work);
+		uint64_t z = 0;
+		for (int r = 0; r <= rounds; r++)
+			z = triviumSlicedRound(o);
+		return z;
+	};
+
+	vector<vector<int>> ivs(64, vector<int>(80));
+	vector<uint64_t> lanes(80, 0), work;
+	for (int l = 0; l < 64; l++) {
+		for (int i = 0; i < 80; i++) {
+			ivs[l][i] = draw.bit();
+			lanes[i] |= (uint64_t)ivs[l][i] << l;
+		}
+	}
+	uint64_t z = kernel(300, lanes.data(), work);
+	vector<int> cube(80, 0);
+	for (int l = 0; l < 64; l++) {
+		if (encryptionSum(300, cube, ivs[l], key) != ((z >> l) & 1)) {
+			cerr << "the bitsliced kernel differs from roundFuncTrivium" << endl;
+			return 1;
+		}
+	}
+	return oracleServe(path, "trivium", 80, threadNumber, kernel);
+
+}
+
+/***************************************
+ * Benchmark of the counting backends
+ ***************************************/
+/*
+The same reduced-round instances are counted by every backend (Gurobi if available, the embedded SAT solver and the native engine),
+and the time and the number of trails are compared. The cube and the constant IV bits are fixed by the seed, so the table is reproducible.
+@Para
+threadNumber: the number of threads for Gurobi and the native engine
+*/
+static void triviumBenchInstance(vector<int>& cube, vector<int>& flag) {
+
+	srand(1);
+
+	cube.assign(80, 0);
+	for (int i = 0; i < 3; i++) {
+		int index;
+		do {
+			index = rand() % 80;
+		} while (cube[index] == 1);
+		cube[index] = 1;
+	}
+
+	flag.assign(288, 0);
+	for (int i = 0; i < 80; i++) {
+		flag[i] = 3;
+		flag[93 + i] = (cube[i] == 1) ? 2 : 1;
+	}
+	flag[285] = 1;
+	flag[286] = 1;
+	flag[287] = 1;
+
+}
+void benchmarkTrivium(int threadNumber) {
+
+	vector<int> cube, flag;
+	triviumBenchInstance(cube, flag);
+
+	cout << "rounds\tbackend\ttrails\tmonomials\tsec\tsame" << endl;
+	for (int r = 300; r <= 480; r += 30) {
+		map<bitset<288>, int, cmpBitset288> nativeBox;
+		double dulation;
+		long long nativeCount = triviumNativeEnumuration(cube, flag, r, nativeBox, dulation, threadNumber, 0, false, 0, nativeMemLimit, true);
+		cout << r << "\tnative\t" << nativeCount << "\t" << nativeBox.size() << "\t" << dulation << "\t-" << endl;
+
+		vector<string> backends = { "cnf" };
+#ifndef NOGUROBI
+		backends.push_back("gurobi");
+#endif
+		for (int j = 0; j < backends.size(); j++) {
+			map<bitset<288>, int, cmpBitset288> countingBox;
+			struct twoStage opt;
+			opt.backend = backends[j];
+			opt.quiet = true;
+			auto start = chrono::steady_clock::now();
+			triviumThreeEnumuration(cube, flag, r, countingBox, dulation, threadNumber, 0, opt);
+			dulation = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			long long solCount = 0;
+			for (auto it = countingBox.begin(); it != countingBox.end(); it++)
+				solCount += (*it).second;
+			cout << r << "\t" << backends[j] << "\t" << solCount << "\t" << countingBox.size() << "\t" << dulation << "\t" << ((countingBox == nativeBox) ? "yes" : "NO") << endl;
+		}
+	}
+
+}
+
+/*
+The microbenchmarks of the hot paths (-micro, see microbench.h) on the instance of benchmarkTrivium:
+build: the model of evalNumRounds rounds with the pruning, by triviumThreeEnumuration on the stubbed solver and by triviumCoreThree on the Gurobi backend (not solved)
+extract: random solutions of the stubbed solver packed into the keys of the counting box (triviumThreeEnumuration of 100 rounds minus its build)
+box.insert: random keys inserted into the counting box
+box.fold: the projection of the counting box onto the superpoly (countingBox2, see displayTriviumSuperpoly) by triviumSuperpolySize
+round: roundFuncTrivium, and the bitsliced round of the key search (per lane)
+theoreticalSum: the superpoly evaluated for a random key and IV
+The results are written into micro_trivium.txt.
+@Para
+evalNumRounds: the rounds of the model (0: 840)
+previous: the result of a previous run to be compared with (empty: none)
+return: 0, or 1 if the result cannot be written
+*/
+int microbenchTrivium(int evalNumRounds, string previous) {
+
+	if (evalNumRounds == 0)
+		evalNumRounds = 840;
+	vector<int> cube, flag;
+	triviumBenchInstance(cube, flag);
+	verifyRandom rng(1);
+	microBench bench;
+	cout << "kernel\tvariant\tunit\tunits\tns/unit" << endl;
+
+	// build
+	double dulation;
+	struct twoStage opt;
+	opt.quiet = true;
+	bench.run("build", "stub", "rounds", [&]() {
+		stubBackend stub;
+		opt.solver = &stub;
+		map<bitset<288>, int, cmpBitset288> countingBox;
+		triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, 1, 0, opt);
+		return (long long)evalNumRounds;
+	});
+#ifndef NOGUROBI
+	backendProfile("backend", false, false);
+	bench.run("build", "gurobi", "rounds", [&]() {
+		unique_ptr<divBackend> solver(newBackend("gurobi", "backend", 1));
+		struct pruneStat stat(evalNumRounds);
+		vector<bitset<288>> live = triviumReachability(flag, evalNumRounds, 0, opt);
+		int zero = solver->addVar();
+		solver->fix(zero, 0);
+		vector<int> s(288);
+		for (int i = 0; i < 288; i++) {
+			s[i] = (live[0][i] == 1) ? solver->addVar() : zero;
+		}
+		for (int r = 0; r < evalNumRounds; r++) {
+			vector<int> tmp = s;
+			bitset<288> out = (live[r + 1] >> 1) | (live[r + 1] << 287);
+			for (int j = 0; j < 3; j++) {
+				const int* p = triviumTaps[j];
+				triviumCoreThree(*solver, tmp, p[0], p[1], p[2], p[3], p[4], zero, live[r], out, stat);
+			}
+			for (int i = 0; i < 288; i++) {
+				s[(i + 1) % 288] = tmp[i];
+			}
+		}
+		// numVariables updates the model
+		solver->numVariables();
+		return (long long)evalNumRounds;
+	});
+#endif
+
+	// extract
+	{
+		int extractRounds = min(evalNumRounds, 100);
+		stubBackend sizing;
+		opt.solver = &sizing;
+		map<bitset<288>, int, cmpBitset288> countingBox;
+		triviumThreeEnumuration(cube, flag, extractRounds, countingBox, dulation, 1, 0, opt);
+		vector<vector<char>> solutions(1 << 13, vector<char>(sizing.numVariables()));
+		for (int k = 0; k < solutions.size(); k++) {
+			for (int i = 0; i < solutions[k].size(); i++) {
+				solutions[k][i] = rng.bit();
+			}
+		}
+		long long units;
+		double buildNs = bench.measure([&]() {
+			stubBackend stub;
+			opt.solver = &stub;
+			map<bitset<288>, int, cmpBitset288> box;
+			triviumThreeEnumuration(cube, flag, extractRounds, box, dulation, 1, 0, opt);
+			return 1LL;
+		}, units);
+		double totalNs = bench.measure([&]() {
+			stubBackend stub(&solutions);
+			opt.solver = &stub;
+			map<bitset<288>, int, cmpBitset288> box;
+			triviumThreeEnumuration(cube, flag, extractRounds, box, dulation, 1, 0, opt);
+			return 1LL;
+		}, units);
+		bench.add("extract", "stub", "solutions", solutions.size(), max(totalNs - buildNs, 0.0) / solutions.size());
+	}
+
+	// the counting box: random monomials of the key bits, the cube bits and the non-cube IV bits
+	vector<bitset<288>> keys(1 << 16);
+	for (int k = 0; k < keys.size(); k++) {
+		for (int i = 0; i < 80; i++) {
+			keys[k][i] = rng.bit();
+			keys[k][93 + i] = (cube[i] == 1) ? 1 : rng.bit();
+		}
+	}
+	bench.run("box.insert", "-", "inserts", [&]() {
+		map<bitset<288>, int, cmpBitset288> countingBox;
+		for (int k = 0; k < keys.size(); k++) {
+			countingBox[keys[k]]++;
+		}
+		return (long long)keys.size();
+	});
+	map<bitset<288>, int, cmpBitset288> countingBox;
+	for (int k = 0; k < keys.size(); k++) {
+		countingBox[keys[k]] += 1 + rng.below(3);
+	}
+	bench.run("box.fold", "-", "monomials", [&]() {
+		int degree;
+		triviumSuperpolySize(countingBox, cube, degree);
+		return (long long)countingBox.size();
+	});
+
+	// round functions (sink keeps the outputs alive)
+	volatile int sink = 0;
+	bench.run("round", "scalar", "rounds", [&]() {
+		bitset<288> s;
+		for (int i = 0; i < 288; i++) {
+			s[i] = rng.bit();
+		}
+		for (int r = 0; r < 4096; r++) {
+			sink ^= roundFuncTrivium(s);
+		}
+		return 4096LL;
+	});
+	vector<uint64_t> key(80), iv(80), work;
+	for (int i = 0; i < 80; i++) {
+		key[i] = rng.next();
+		iv[i] = rng.next();
+	}
+	bench.run("round", "bitsliced", "rounds", [&]() {
+		uint64_t* o = triviumSlicedLoad(key.data(), iv.data(), 4096, work);
+		uint64_t z = 0;
+		for (int r = 0; r < 4096; r++) {
+			z ^= triviumSlicedRound(o);
+		}
+		sink ^= (int)(z & 1);
+		return 64LL * 4096;
+	});
+
+	// theoreticalSum
+	vector<int> keyBits(80), ivBits(80);
+	for (int i = 0; i < 80; i++) {
+		keyBits[i] = rng.bit();
+		ivBits[i] = rng.bit();
+	}
+	bench.run("theoreticalSum", "-", "monomials", [&]() {
+		sink ^= theoreticalSum(countingBox, cube, ivBits, keyBits);
+		return (long long)countingBox.size();
+	});
+	stringstream title;
+	title << "micro trivium " << evalNumRounds << " rounds";
+	return bench.write("micro_trivium.txt", title.str(), previous) ? 0 : 1;
+
+}
+
+
+
+#ifndef NOGUROBI
+/***************************************
+ * Parameter profiles: racing and tuning
+ ***************************************/
+/*
+Race the variants of the profiles on the same instance (see envpool.h and tuneRace).
+Every variant runs triviumThreeEnumuration with threadNumber / variants.size() threads and its own box,
+and countingBox gets the box of the first one to finish. The others are aborted.
+@Para
+variants: the variants of the profiles ("" is the profile without variant)
+the others: same as triviumThreeEnumuration
+return: the index of the winner
+*/
+int triviumRace(vector<int> cube, vector<int> flag, int evalNumRounds, map<bitset<288>, int, cmpBitset288>& countingBox, double& dulation, int threadNumber, int target, struct twoStage opt, vector<string> variants) {
+
+	vector<map<bitset<288>, int, cmpBitset288>> boxes(variants.size());
+	vector<double> dulations(variants.size());
+	int subThreads = max(1, threadNumber / (int)variants.size());
+	int winner = tuneRace(variants.size(), [&](int i, atomic<bool>* stop) {
+		struct twoStage sub = opt;
+		sub.profile = variants[i];
+		sub.stop = stop;
+		triviumThreeEnumuration(cube, flag, evalNumRounds, boxes[i], dulations[i], subThreads, target, sub);
+	});
+
+	auto it = boxes[winner].begin();
+	while (it != boxes[winner].end()) {
+		countingBox[(*it).first] += (*it).second;
+		it++;
+	}
+	dulation = dulations[winner];
+	return winner;
+
+}
+
+/*
+Tuning harness of the parameter profiles.
+The reduced-round instance of benchmarkTrivium is solved under every point of tuneAxes for each stage
+(trivium: the single stage, trivium1: the 1st stage, trivium2: the 2nd stage), while the other stage keeps its profile.
+The wall time of each point is written into tune_trivium.txt, and the fastest point whose superpoly equals the default one
+is suggested as a line of the profiles (-profiles).
+If race is not empty (e.g. "default,fast"), the variants of the profiles are raced on the two-stage instance instead.
+@Para
+evalNumRounds: the number of rounds of the instance
+threadNumber: the number of threads
+race: the variants to be raced, separated by commas
+*/
+void tuneTrivium(int evalNumRounds, int threadNumber, string race) {
+
+	vector<int> cube, flag;
+	triviumBenchInstance(cube, flag);
+
+	ofstream outputfile("tune_trivium.txt", ios::app);
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << evalNumRounds << " rounds, " << threadNumber << " threads" << endl;
+
+	if (race.size() > 0) {
+		vector<string> variants = tuneVariants(race);
+		map<bitset<288>, int, cmpBitset288> countingBox;
+		double dulation;
+		auto start = chrono::steady_clock::now();
+		struct twoStage stage;
+		stage.useTwoStage = true;
+		stage.quiet = true;
+		int winner = triviumRace(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 0, stage, variants);
+		double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		string name = (variants[winner].size() > 0) ? variants[winner] : "default";
+		cout << "race " << race << " : " << name << " wins in " << sec << " sec" << endl;
+		outputfile << "race " << race << " : " << name << " wins in " << sec << " sec" << endl;
+		return;
+	}
+
+	vector<vector<pair<string, string>>> grid = tuneGrid(tuneAxes("3"));
+	const char* stages[3] = { "trivium", "trivium1", "trivium2" };
+	cout << "stage\tsec\tsame\tparameters" << endl;
+	for (int j = 0; j < 3; j++) {
+		map<bitset<288>, int, cmpBitset288> defaultBox;
+		double bestSec = -1;
+		int best = 0;
+		for (int g = 0; g < grid.size(); g++) {
+			sharedEnvPool().configure(string(stages[j]) + "/tune", grid[g]);
+
+			map<bitset<288>, int, cmpBitset288> countingBox;
+			double dulation;
+			auto start = chrono::steady_clock::now();
+			struct twoStage stage;
+			stage.useTwoStage = (j > 0);
+			stage.profile = "tune";
+			stage.quiet = true;
+			triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 0, stage);
+			double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			// the first point is the default profile
+			if (g == 0)
+				defaultBox = countingBox;
+			bool same = (countingBox == defaultBox);
+			if (same && ((bestSec < 0) || (sec < bestSec))) {
+				bestSec = sec;
+				best = g;
+			}
+			cout << stages[j] << "\t" << sec << "\t" << (same ? "yes" : "NO") << "\t" << tuneText(grid[g]) << endl;
+			outputfile << stages[j] << "\t" << sec << "\t" << (same ? "yes" : "NO") << "\t" << tuneText(grid[g]) << endl;
+		}
+		sharedEnvPool().configure(string(stages[j]) + "/tune", vector<pair<string, string>>());
+		cout << "suggested: " << stages[j] << " " << tuneText(grid[best]) << endl;
+		outputfile << "suggested: " << stages[j] << " " << tuneText(grid[best]) << endl;
+	}
+
+}
+/*
+Benchmark of the search strategies (tuneStrategies).
+The reduced-round instance of benchmarkTrivium is solved in the single stage and in the two stages under each strategy,
+which is applied to all profiles as the variant "strategy", and the time to enumerate all solutions is compared with the default.
+The table is also written into strategy_trivium.txt
+@Para
+evalNumRounds: the number of rounds of the instance
+threadNumber: the number of threads
+*/
+void strategyTrivium(int evalNumRounds, int threadNumber) {
+
+	vector<int> cube, flag;
+	triviumBenchInstance(cube, flag);
+
+	ofstream outputfile("strategy_trivium.txt", ios::app);
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+	outputfile << evalNumRounds << " rounds, " << threadNumber << " threads" << endl;
+
+	vector<pair<string, vector<pair<string, string>>>> strategies = tuneStrategies({ "A", "B", "C" });
+	const char* stages[3] = { "trivium", "trivium1", "trivium2" };
+	map<bitset<288>, int, cmpBitset288> defaultBox;
+	vector<double> defaultSec(2);
+	cout << "strategy\tsingle\ttwo-stage\tspeedup\tsame" << endl;
+	outputfile << "strategy\tsingle\ttwo-stage\tspeedup\tsame" << endl;
+	for (int k = 0; k < strategies.size(); k++) {
+		for (int j = 0; j < 3; j++) {
+			sharedEnvPool().configure(string(stages[j]) + "/strategy", strategies[k].second);
+		}
+
+		vector<double> sec(2);
+		bool same = true;
+		for (int two = 0; two < 2; two++) {
+			map<bitset<288>, int, cmpBitset288> countingBox;
+			double dulation;
+			auto start = chrono::steady_clock::now();
+			struct twoStage stage;
+			stage.useTwoStage = (two == 1);
+			stage.profile = "strategy";
+			stage.quiet = true;
+			triviumThreeEnumuration(cube, flag, evalNumRounds, countingBox, dulation, threadNumber, 0, stage);
+			sec[two] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			if ((k == 0) && (two == 0))
+				defaultBox = countingBox;
+			same = same && (countingBox == defaultBox);
+		}
+		if (k == 0)
+			defaultSec = sec;
+
+		double speedup = (defaultSec[0] + defaultSec[1]) / max(sec[0] + sec[1], 1e-9);
+		cout << strategies[k].first << "\t" << sec[0] << "\t" << sec[1] << "\t" << speedup << "\t" << (same ? "yes" : "NO") << endl;
+		outputfile << strategies[k].first << "\t" << sec[0] << "\t" << sec[1] << "\t" << speedup << "\t" << (same ? "yes" : "NO") << "\t" << tuneText(strategies[k].second) << endl;
+	}
+	for (int j = 0; j < 3; j++) {
+		sharedEnvPool().configure(string(stages[j]) + "/strategy", vector<pair<string, string>>());
+	}
+
+}
+
+
+/*
+Equivalence check and benchmark of the COPY formulations (Formulation in envpool.h).
+Over the range of practicalTestTrivium (300 to 599 rounds, every 30 rounds, a random cube of 1 to 4 bits fixed by the seed),
+the superpoly of each formulation in the single stage is compared with the native engine,
+and the size of the model, the size after the presolve, the presolve time and the enumeration time are displayed.
+The table is also written into formulation_trivium.txt
+@Para
+threadNumber: the number of threads
+*/
+void benchmarkFormulationTrivium(int threadNumber) {
+
+	srand(1);
+	const char* formulations[3] = { "general", "linear", "merged" };
+	ofstream outputfile("formulation_trivium.txt", ios::app);
+	outputfile << "++++++++++++++++++++++++++++" << endl;
+
+	int mismatch = 0;
+	cout << "rounds\tformulation\tvars\tconstrs\tgeneral\tpresolved vars\tpresolved constrs\tpresolve sec\tenumeration sec\tsame" << endl;
+	for (int r = 300; r < 600; r += 30) {
+		// a random cube of 1 to 4 bits as in practicalTestTrivium
+		vector<int> cube(80, 0);
+		int numActBits = 1 + rand() % 4;
+		for (int i = 0; i < numActBits; i++) {
+			int index;
+			do {
+				index = rand() % 80;
+			} while (cube[index] == 1);
+			cube[index] = 1;
+		}
+		vector<int> flag(288, 0);
+		for (int i = 0; i < 80; i++) {
+			flag[i] = 3;
+			flag[93 + i] = (cube[i] == 1) ? 2 : 1;
+		}
+		flag[285] = 1;
+		flag[286] = 1;
+		flag[287] = 1;
+
+		// the exact reference by the native engine
+		map<bitset<288>, int, cmpBitset288> nativeBox;
+		double dulation;
+		triviumNativeEnumuration(cube, flag, r, nativeBox, dulation, threadNumber, 0, false, 0, nativeMemLimit, true);
+
+		for (int j = 0; j < 3; j++) {
+			sharedEnvPool().configure("trivium/formulation", { make_pair("Formulation", formulations[j]) });
+
+			map<bitset<288>, int, cmpBitset288> countingBox;
+			struct pruneStat report;
+			struct twoStage stage;
+			stage.profile = "formulation";
+			stage.report = &report;
+			stage.quiet = true;
+			triviumThreeEnumuration(cube, flag, r, countingBox, dulation, threadNumber, 0, stage);
+
+			bool same = (countingBox == nativeBox);
+			if (same == false)
+				mismatch++;
+			cout << r << "\t" << formulations[j] << "\t" << report.modelVars << "\t" << report.modelConstrs << "\t" << report.modelGenConstrs << "\t";
+			cout << report.presolvedVars << "\t" << report.presolvedConstrs << "\t" << report.presolveSec << "\t" << dulation << "\t" << (same ? "yes" : "NO") << endl;
+			outputfile << r << "\t" << formulations[j] << "\t" << report.modelVars << "\t" << report.modelConstrs << "\t" << report.modelGenConstrs << "\t";
+			outputfile << report.presolvedVars << "\t" << report.presolvedConstrs << "\t" << report.presolveSec << "\t" << dulation << "\t" << (same ? "yes" : "NO") << endl;
+		}
+	}
+	sharedEnvPool().configure("trivium/formulation", vector<pair<string, string>>());
+
+	if (mismatch == 0)
+		cout << "all formulations agree with the native engine" << endl;
+	else
+		cout << mismatch << " superpolys differ from the native engine" << endl;
+
+}
 
-    cout << endl << endl;
-  }
 
 
 
-}
\ No newline at end of file
+/***************************************
+ * Cube search
+ ***************************************/
+/*
+Search the cubes of a family (see cubeCandidates) through the stages of cubeCandidate, cheapest first.
+The non-cube IV bits are 0. The (cube, target) pairs of a stage are the jobs of one scheduler, so the candidates run in parallel,
+and the environments of both stages of the enumeration come from the shared pool for all candidates (see envpool.h).
+The ranked table is displayed and written into cubesearch_trivium.txt with the superpolies.
+@Para
+family: the family of the candidates
+preRound: the number of rounds expanded as ANF in the stages 2 and 3
+screen: the time limit of the feasibility pass of each target in sec (0: the stage 2 is skipped)
+budget: the time limit of the enumeration of each target in sec
+*/
+int cubeSearchTrivium(int evalNumRounds, int threadNumber, string family, int preRound, double screen, double budget) {
+
+	vector<cubeCandidate> candidates;
+	if (cubeCandidates(family, 80, candidates) == false)
+		return 0;
+	int numCandidates = candidates.size();
+	cout << numCandidates << " candidates of " << family << endl;
+
+	// stage 1: reachability of the cube bits and the degree bound
+	vector<vector<int>> flags(numCandidates);
+	int survivors = 0;
+	for (int c = 0; c < numCandidates; c++) {
+		cubeCandidate& cand = candidates[c];
+		auto start = chrono::steady_clock::now();
+
+		// constant (secret 3, active 2, const 1, const 0)
+		vector<int>& flag = flags[c];
+		flag.assign(288, 0);
+		int cubeSize = 0;
+		for (int i = 0; i < 80; i++) {
+			flag[i] = 3;
+			if (cand.cube[i] == 1) {
+				flag[93 + i] = 2;
+				cubeSize++;
+			}
+		}
+		flag[285] = 1;
+		flag[286] = 1;
+		flag[287] = 1;
+
+		vector<int> bound = triviumDegreeBound(flag, evalNumRounds);
+		for (int t = 1; t <= 6; t++) {
+			if (bound[t - 1] < cubeSize)
+				continue;
+			struct twoStage opt;
+			vector<bitset<288>> live = triviumReachability(flag, evalNumRounds, t, opt);
+			bool reach = true;
+			for (int i = 0; i < 80; i++) {
+				if ((cand.cube[i] == 1) && (live[0][93 + i] == 0))
+					reach = false;
+			}
+			if (reach)
+				cand.targets.push_back(t);
+		}
+		cand.stage = 1;
+		if (cand.targets.size() == 0)
+			cand.status = "bound";
+		else
+			survivors++;
+		cand.sec += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+	cout << "stage 1 (bound) : " << survivors << " candidates remain" << endl;
+
+	// hybrid mode
+	vector<vector<anfPoly<288>>> prePolys(numCandidates);
+	if (preRound > 0) {
+		for (int c = 0; c < numCandidates; c++) {
+			if (candidates[c].status.size() == 0)
+				prePolys[c] = triviumANF(flags[c], preRound);
+		}
+	}
+
+	// stage 2: feasibility pass. *stop is true from the start, so the enumeration is skipped
+	jobScheduler sched(threadNumber, "schedule_cubesearch.txt");
+	vector<vector<int>> results(numCandidates);
+	vector<vector<double>> secs(numCandidates);
+	if (screen > 0) {
+		for (int c = 0; c < numCandidates; c++) {
+			cubeCandidate& cand = candidates[c];
+			if (cand.status.size() > 0)
+				continue;
+			results[c].assign(cand.targets.size(), 0);
+			secs[c].assign(cand.targets.size(), 0);
+			for (int k = 0; k < cand.targets.size(); k++) {
+				string name = "trivium " + to_string(evalNumRounds) + " pre " + to_string(preRound) + " cube " + cand.text + " target " + to_string(cand.targets[k]) + " feasibility";
+				sched.add(name, [&, c, k]() {
+					auto start = chrono::steady_clock::now();
+					map<bitset<288>, int, cmpBitset288> box;
+					double dulation = 0;
+					atomic<bool> stop(true);
+					struct twoStage stage;
+					stage.useTwoStage = true;
+					stage.preRound = preRound;
+					stage.prePoly = &prePolys[c];
+					stage.sched = &sched;
+					stage.stop = &stop;
+					stage.screen = screen;
+					results[c][k] = triviumThreeEnumuration(candidates[c].cube, flags[c], evalNumRounds, box, dulation, sched.threads(), candidates[c].targets[k], stage);
+					secs[c][k] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				});
+			}
+		}
+		sched.run();
+
+		survivors = 0;
+		for (int c = 0; c < numCandidates; c++) {
+			cubeCandidate& cand = candidates[c];
+			if (cand.status.size() > 0)
+				continue;
+			vector<int> targets;
+			for (int k = 0; k < cand.targets.size(); k++) {
+				if (results[c][k] != -1)
+					targets.push_back(cand.targets[k]);
+				cand.sec += secs[c][k];
+			}
+			cand.targets = targets;
+			cand.stage = 2;
+			if (cand.targets.size() == 0) {
+				cand.status = "no trail";
+				prePolys[c].clear();
+			}
+			else
+				survivors++;
+		}
+		cout << "stage 2 (feasibility) : " << survivors << " candidates remain" << endl;
+	}
+
+	// stage 3: enumeration within the budget
+	vector<vector<map<bitset<288>, int, cmpBitset288>>> boxes(numCandidates);
+	vector<vector<char>> timeouts(numCandidates);
+	for (int c = 0; c < numCandidates; c++) {
+		cubeCandidate& cand = candidates[c];
+		if (cand.status.size() > 0)
+			continue;
+		boxes[c].resize(cand.targets.size());
+		timeouts[c].assign(cand.targets.size(), 0);
+		secs[c].assign(cand.targets.size(), 0);
+		for (int k = 0; k < cand.targets.size(); k++) {
+			string name = "trivium " + to_string(evalNumRounds) + " pre " + to_string(preRound) + " cube " + cand.text + " target " + to_string(cand.targets[k]);
+			sched.add(name, [&, c, k]() {
+				auto start = chrono::steady_clock::now();
+				timeouts[c][k] = cubeDeadline(budget, [&](atomic<bool>* stop) {
+					double dulation = 0;
+					struct twoStage stage;
+					stage.useTwoStage = true;
+					stage.preRound = preRound;
+					stage.prePoly = &prePolys[c];
+					stage.sched = &sched;
+					stage.stop = stop;
+					triviumThreeEnumuration(candidates[c].cube, flags[c], evalNumRounds, boxes[c][k], dulation, sched.threads(), candidates[c].targets[k], stage);
+				});
+				secs[c][k] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			});
+		}
+	}
+	sched.run();
+
+	map<string, map<bitset<288>, int, cmpBitset288>> superpolys;
+	for (int c = 0; c < numCandidates; c++) {
+		cubeCandidate& cand = candidates[c];
+		if (cand.status.size() > 0)
+			continue;
+		cand.stage = 3;
+		bool timeout = false;
+		map<bitset<288>, int, cmpBitset288> countingBox;
+		for (int k = 0; k < cand.targets.size(); k++) {
+			cand.sec += secs[c][k];
+			if (timeouts[c][k])
+				timeout = true;
+			auto it = boxes[c][k].begin();
+			while (it != boxes[c][k].end()) {
+				countingBox[(*it).first] += (*it).second;
+				it++;
+			}
+		}
+		if (timeout) {
+			cand.status = "timeout";
+			continue;
+		}
+		cand.monomials = triviumSuperpolySize(countingBox, cand.cube, cand.degree);
+		if (cand.monomials == 0) {
+			cand.status = "zero sum";
+		}
+		else {
+			cand.status = "superpoly";
+			superpolys[cand.text] = countingBox;
+		}
+	}
+
+	// ranked table
+	cubeRank(candidates);
+	ofstream outputfile("cubesearch_trivium.txt");
+	outputfile << "# trivium " << evalNumRounds << " " << family << " pre=" << preRound << " screen=" << screen << " budget=" << budget << endl;
+	cubeTable(cout, candidates);
+	cubeTable(outputfile, candidates);
+	for (int c = 0; c < numCandidates; c++) {
+		if (candidates[c].status != "superpoly")
+			continue;
+		outputfile << endl;
+		outputfile << "# rank " << (c + 1) << " cube=" << candidates[c].text << endl;
+		displayTriviumSuperpoly(outputfile, superpolys[candidates[c].text], candidates[c].cube);
+	}
+
+	return 0;
+}
+#endif
@@ -0,0 +1,120 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include<string>
+#include<vector>
+#include<sstream>
+#include<functional>
+#include<thread>
+#include<atomic>
+
+using namespace std;
+
+/*
+The grid of the tuning harness (-tune). Every axis is a parameter of the profiles (see envpool.h) and its candidate values.
+The first value of each axis is the setting of the repo, so the first point of the grid is the default profile.
+@Para
+focus: the default MIPFocus of the cipher (3 for Trivium, 0 for Grain-128AEAD)
+*/
+inline vector<pair<string, vector<string>>> tuneAxes(string focus) {
+	vector<pair<string, vector<string>>> axes;
+	axes.push_back(make_pair("Presolve", vector<string>{ "-1", "2" }));
+	axes.push_back(make_pair("Cuts", vector<string>{ "-1", "0" }));
+	axes.push_back(make_pair("Heuristics", vector<string>{ "0.05", "0" }));
+	axes.push_back(make_pair("MIPFocus", vector<string>{ focus, (focus == "3") ? "0" : "3" }));
+	axes.push_back(make_pair("RoundPriority", vector<string>{ "none", "forward", "backward", "middle" }));
+	return axes;
+}
+
+/*
+The search strategies compared by -strategy: the branching priorities and the objectives of envpool.h, applied to every stage.
+@Para
+registers: the registers of the cipher for RegisterPriority
+*/
+inline vector<pair<string, vector<pair<string, string>>>> tuneStrategies(vector<string> registers) {
+	vector<pair<string, vector<pair<string, string>>>> strategies;
+	strategies.push_back(make_pair("default", vector<pair<string, string>>()));
+	strategies.push_back(make_pair("forward", vector<pair<string, string>>{ make_pair("RoundPriority", "forward") }));
+	strategies.push_back(make_pair("backward", vector<pair<string, string>>{ make_pair("RoundPriority", "backward") }));
+	strategies.push_back(make_pair("middle", vector<pair<string, string>>{ make_pair("RoundPriority", "middle") }));
+	strategies.push_back(make_pair("and", vector<pair<string, string>>{ make_pair("AndPriority", "1") }));
+	for (int i = 0; i < registers.size(); i++) {
+		strategies.push_back(make_pair("register" + registers[i], vector<pair<string, string>>{ make_pair("RegisterPriority", registers[i]) }));
+	}
+	strategies.push_back(make_pair("obj-none", vector<pair<string, string>>{ make_pair("Objective", "none") }));
+	strategies.push_back(make_pair("obj-minkey", vector<pair<string, string>>{ make_pair("Objective", "minkey") }));
+	strategies.push_back(make_pair("obj-middle", vector<pair<string, string>>{ make_pair("Objective", "middle") }));
+	strategies.push_back(make_pair("middle+and+obj-none", vector<pair<string, string>>{ make_pair("RoundPriority", "middle"), make_pair("AndPriority", "1"), make_pair("Objective", "none") }));
+	return strategies;
+}
+
+/*
+All points of the grid. The first axis varies slowest
+*/
+inline vector<vector<pair<string, string>>> tuneGrid(vector<pair<string, vector<string>>> axes) {
+	vector<vector<pair<string, string>>> grid(1);
+	for (int a = 0; a < axes.size(); a++) {
+		vector<vector<pair<string, string>>> next;
+		for (int g = 0; g < grid.size(); g++) {
+			for (int v = 0; v < axes[a].second.size(); v++) {
+				next.push_back(grid[g]);
+				next.back().push_back(make_pair(axes[a].first, axes[a].second[v]));
+			}
+		}
+		grid = next;
+	}
+	return grid;
+}
+
+/*
+"key=value key=value ...", the same format as a line of the profiles
+*/
+inline string tuneText(vector<pair<string, string>>& params) {
+	string text;
+	for (int i = 0; i < params.size(); i++) {
+		if (i > 0)
+			text += " ";
+		text += params[i].first + "=" + params[i].second;
+	}
+	return text;
+}
+
+/*
+Split "a,b" of -race into the variants. "default" is the profile without variant
+*/
+inline vector<string> tuneVariants(string text) {
+	vector<string> variants;
+	stringstream ss(text);
+	string item;
+	while (getline(ss, item, ',')) {
+		variants.push_back((item == "default") ? "" : item);
+	}
+	return variants;
+}
+
+/*
+Race: run(i, stop) is called concurrently for every candidate i, and the first one to return wins.
+Then *stop is set, so the others abort as soon as they see it.
+return: the index of the winner
+*/
+inline int tuneRace(int candidates, function<void(int, atomic<bool>*)> run) {
+
+	atomic<bool> stop(false);
+	atomic<int> winner(-1);
+	vector<thread> racers;
+	for (int i = 0; i < candidates; i++) {
+		racers.push_back(thread([&, i]() {
+			run(i, &stop);
+			int none = -1;
+			if (winner.compare_exchange_strong(none, i))
+				stop = true;
+		}));
+	}
+	for (int i = 0; i < candidates; i++) {
+		racers[i].join();
+	}
+	return winner;
+
+}
+
+#endif
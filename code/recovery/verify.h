@@ -0,0 +1,246 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<deque>
+#include<functional>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<condition_variable>
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+
+using namespace std;
+
+/*
+The PRNG of the differential verification (-verify), splitmix64.
+Every trial has its own generator seeded by (seed, round, trial), so the keys and IVs of a trial depend neither on the number of threads
+nor on the order in which the trials run, and a mismatch is reproduced from the seed, the round and the trial alone.
+*/
+class verifyRandom {
+public:
+	verifyRandom(uint64_t seed, uint64_t round = 0, uint64_t trial = 0) : state(seed) {
+		state = next() ^ round;
+		state = next() ^ trial;
+	}
+
+	uint64_t next() {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	int bit() { return next() & 1; }
+
+	// uniform in [0, n)
+	int below(int n) { return next() % n; }
+
+private:
+	uint64_t state;
+};
+
+/*
+The result of one round
+status: zero sum or superpoly (all trials passed), fail (a trial mismatched) or skipped (not finished before the early stop)
+monomials, degree: the size of the superpoly counted by the model
+checked, passed: the number of trials run and passed
+countSec: the time of the model (-1 if not counted), checkSec: the time of the trials
+*/
+struct verifyRound {
+	int round;
+	string status;
+	int monomials;
+	int degree;
+	int checked;
+	int passed;
+	double countSec;
+	double checkSec;
+};
+
+/*
+The first mismatch (the smallest round, then the smallest trial among the mismatches found before the stop)
+expe: the cube sum of the cipher, theo: the sum given by the superpoly
+*/
+struct verifyMismatch {
+	bool found;
+	int round;
+	int trial;
+	vector<int> key;
+	vector<int> iv;
+	int expe;
+	int theo;
+};
+
+/*
+Run the rounds and the trials on a pool of threadNumber workers.
+The rounds are counted in increasing order. The trials of a counted round are split into chunks which run before the next rounds are counted,
+and all work stops at the first mismatch.
+@Para
+firstRound, lastRound: the rounds (both included)
+trials: the number of random keys and IVs per round
+seed: the seed of verifyRandom
+count: fill the box (the superpoly) of round r with one thread
+size: the number of monomials and the degree of the box
+trial: draw the key and the IV of a trial from the generator, and compute the cube sum of the cipher (expe) and the sum given by the box (theo)
+rounds, mismatch: the results
+return: true if all trials passed
+*/
+template<class Box> bool verifyRun(int firstRound, int lastRound, int trials, int threadNumber, uint64_t seed,
+	function<void(int, Box&)> count,
+	function<int(Box&, int&)> size,
+	function<void(int, Box&, verifyRandom&, vector<int>&, vector<int>&, int&, int&)> trial,
+	vector<verifyRound>& rounds, verifyMismatch& mismatch) {
+
+	int numRounds = lastRound - firstRound + 1;
+	const int chunk = 10;
+	rounds.clear();
+	for (int r = firstRound; r <= lastRound; r++) {
+		rounds.push_back({ r, "skipped", 0, 0, 0, 0, -1, 0 });
+	}
+	mismatch = { false, 0, 0, vector<int>(), vector<int>(), 0, 0 };
+	vector<Box> boxes(numRounds);
+	vector<int> remaining(numRounds, 0);
+
+	mutex lock;
+	condition_variable wake;
+	deque<function<void()>> tasks;
+	int running = 0;
+	atomic<bool> stop(false);
+
+	auto check = [&](int i, int first, int last) {
+		auto start = chrono::steady_clock::now();
+		int checked = 0, passed = 0;
+		for (int t = first; (t < last) && !stop; t++) {
+			verifyRandom rng(seed, rounds[i].round, t);
+			vector<int> key, iv;
+			int expe, theo;
+			trial(rounds[i].round, boxes[i], rng, key, iv, expe, theo);
+			checked++;
+			if (expe == theo) {
+				passed++;
+				continue;
+			}
+			lock_guard<mutex> guard(lock);
+			if (!mismatch.found || (rounds[i].round < mismatch.round) || ((rounds[i].round == mismatch.round) && (t < mismatch.trial)))
+				mismatch = { true, rounds[i].round, t, key, iv, expe, theo };
+			stop = true;
+			break;
+		}
+		double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		lock_guard<mutex> guard(lock);
+		rounds[i].checked += checked;
+		rounds[i].passed += passed;
+		rounds[i].checkSec += sec;
+		if (--remaining[i] == 0)
+			boxes[i] = Box();
+	};
+
+	for (int i = 0; i < numRounds; i++) {
+		tasks.push_back([&, i]() {
+			auto start = chrono::steady_clock::now();
+			count(rounds[i].round, boxes[i]);
+			int degree = 0;
+			int monomials = size(boxes[i], degree);
+
+			lock_guard<mutex> guard(lock);
+			rounds[i].countSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			rounds[i].monomials = monomials;
+			rounds[i].degree = degree;
+			// the trials of this round go before the rounds not counted yet
+			for (int first = ((trials - 1) / chunk) * chunk; first >= 0; first -= chunk) {
+				remaining[i]++;
+				tasks.push_front([&, i, first]() { check(i, first, min(first + chunk, trials)); });
+			}
+			wake.notify_all();
+		});
+	}
+
+	vector<thread> pool;
+	for (int w = 0; w < max(threadNumber, 1); w++) {
+		pool.push_back(thread([&]() {
+			unique_lock<mutex> guard(lock);
+			while (true) {
+				wake.wait(guard, [&]() { return (tasks.size() > 0) || (running == 0); });
+				if (tasks.size() == 0)
+					break;
+				function<void()> task = tasks.front();
+				tasks.pop_front();
+				running++;
+				guard.unlock();
+				if (!stop)
+					task();
+				guard.lock();
+				running--;
+				wake.notify_all();
+			}
+		}));
+	}
+	for (int w = 0; w < pool.size(); w++) {
+		pool[w].join();
+	}
+
+	for (int i = 0; i < numRounds; i++) {
+		verifyRound& round = rounds[i];
+		if (round.checked > round.passed)
+			round.status = "fail";
+		else if ((round.countSec < 0) || (round.checked < trials))
+			round.status = "skipped";
+		else
+			round.status = (round.monomials == 0) ? "zero sum" : "superpoly";
+	}
+	return !mismatch.found;
+
+}
+
+/*
+bits in hex, the byte bytes - 1 first and the bit 7 first in each byte (the order of the practical tests)
+*/
+inline string verifyHex(vector<int>& bits, int bytes) {
+	string text;
+	for (int i = bytes - 1; i >= 0; i--) {
+		int hexvar = 0;
+		for (int j = 7; j >= 0; j--) {
+			hexvar ^= (bits[8 * i + j] << j);
+		}
+		char buf[3];
+		snprintf(buf, sizeof(buf), "%02x", hexvar);
+		text += buf;
+	}
+	return text;
+}
+
+/*
+The statistics, one round per line, and the totals
+*/
+inline void verifyTable(ostream& out, vector<verifyRound>& rounds, int trials) {
+
+	int counted = 0, zeroSum = 0, failed = 0;
+	long long checked = 0, passed = 0;
+	double countSec = 0, checkSec = 0;
+	out << "round\tstatus\tmonomials\tdegree\tpassed\tcount sec\tcheck sec" << endl;
+	for (int i = 0; i < rounds.size(); i++) {
+		verifyRound& round = rounds[i];
+		if (round.countSec < 0)
+			continue;
+		out << round.round << "\t" << round.status << "\t" << round.monomials << "\t" << round.degree << "\t"
+			<< round.passed << "/" << round.checked << "\t" << round.countSec << "\t" << round.checkSec << endl;
+		counted++;
+		zeroSum += (round.monomials == 0);
+		failed += (round.status == "fail");
+		checked += round.checked;
+		passed += round.passed;
+		countSec += round.countSec;
+		checkSec += round.checkSec;
+	}
+	out << counted << "/" << rounds.size() << " rounds counted (" << zeroSum << " zero sum), " << failed << " failed, "
+		<< passed << "/" << checked << " trials passed (" << trials << " per round), count " << countSec << " sec, check " << checkSec << " sec" << endl;
+
+}
+
+#endif